@@ -877,6 +877,15 @@ uint8_t uart_getch(struct uart_periph *p)
   return ret;
 }
 
+uint16_t uart_get_bytes(struct uart_periph *p, uint8_t *buf, uint16_t len)
+{
+  struct SerialInit *init_struct = (struct SerialInit *)(p->init_struct);
+  chMtxLock(init_struct->rx_mtx);
+  uint16_t n = uart_rx_buf_extract(p, buf, len);
+  chMtxUnlock(init_struct->rx_mtx);
+  return n;
+}
+
 /**
  * Set baudrate
  */
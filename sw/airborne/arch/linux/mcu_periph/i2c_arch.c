@@ -24,10 +24,22 @@
 
 /** @file arch/linux/mcu_periph/i2c_arch.c
  * I2C functionality
+ *
+ * Transactions are done by one thread per bus. All the transactions queued
+ * when the thread wakes up (up to I2C_LINUX_MAX_BATCH) are packed in a single
+ * I2C_RDWR ioctl, sorted by device priority (see i2c_linux_set_priority).
+ * If a batch fails, the kernel doesn't tell which messages were done, so
+ * the transactions that may not have been done are reported as failed and
+ * left to the drivers to retry; they are never done again here since they
+ * may have reached the device. Their devices are then kept out of the
+ * batches until their next successful transaction, so that an error is
+ * reported only for the faulty device.
  */
 
 #include "mcu_periph/i2c.h"
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
@@ -42,6 +54,17 @@
 #define I2C_THREAD_PRIO 10
 #endif
 
+/** Max number of transactions in one I2C_RDWR ioctl, 1 to disable batching
+ *  (a batch keeps the bus until all its messages are done)
+ */
+#ifndef I2C_LINUX_MAX_BATCH
+#define I2C_LINUX_MAX_BATCH 8
+#endif
+
+#if I2C_LINUX_MAX_BATCH * 2 > I2C_RDWR_IOCTL_MAX_MSGS
+#error "I2C_LINUX_MAX_BATCH too large for I2C_RDWR"
+#endif
+
 
 static bool i2c_linux_idle(struct i2c_periph *p __attribute__((unused))) __attribute__((unused));
 static bool i2c_linux_submit(struct i2c_periph *p, struct i2c_transaction *t) __attribute__((unused));
@@ -50,14 +73,51 @@ static void i2c_linux_setbitrate(struct i2c_periph *p  __attribute__((unused)),
 
 static void *i2c_thread(void *thread_data);
 
+/** Queued transaction */
+struct i2c_linux_pending {
+  struct i2c_transaction *t;
+  uint8_t prio;
+  uint32_t time;              ///< submit time (us)
+};
+
 // private I2C init structure
 struct i2c_thread_t {
   pthread_mutex_t mutex;
   pthread_cond_t condition;
+  i2c_linux_xfer_fn xfer;
+  /* queued transactions, in submit order */
+  struct i2c_linux_pending pending[I2C_TRANSACTION_QUEUE_LEN];
+  uint8_t nb_pending;
+  uint8_t max_batch;
+  uint8_t prio[128];          ///< priority of each 7 bit address
+  bool solo[128];             ///< device with errors, not batched
+  struct i2c_linux_stats stats;
 };
 
+static int i2c_linux_ioctl(int fd, struct i2c_msg *msgs, unsigned int nb)
+{
+  struct i2c_rdwr_ioctl_data data = {
+    .msgs = msgs,
+    .nmsgs = nb
+  };
+  return ioctl(fd, I2C_RDWR, &data);
+}
+
+static uint32_t i2c_linux_time_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
 static void UNUSED i2c_arch_init(struct i2c_periph *p)
 {
+  struct i2c_thread_t *th = (struct i2c_thread_t *)p->init_struct;
+  pthread_mutex_init(&th->mutex, NULL);
+  pthread_cond_init(&th->condition, NULL);
+  th->xfer = i2c_linux_ioctl;
+  th->max_batch = I2C_LINUX_MAX_BATCH;
+
   pthread_t tid;
   if (pthread_create(&tid, NULL, i2c_thread, (void *)p) != 0) {
     fprintf(stderr, "i2c_arch_init: Could not create I2C thread.\n");
@@ -68,6 +128,31 @@ static void UNUSED i2c_arch_init(struct i2c_periph *p)
 #endif
 }
 
+void i2c_linux_set_priority(struct i2c_periph *p, uint8_t slave_addr, uint8_t prio)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)p->init_struct;
+  pthread_mutex_lock(&th->mutex);
+  th->prio[slave_addr >> 1] = prio;
+  pthread_mutex_unlock(&th->mutex);
+}
+
+void i2c_linux_set_xfer(struct i2c_periph *p, i2c_linux_xfer_fn xfer)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)p->init_struct;
+  pthread_mutex_lock(&th->mutex);
+  th->xfer = (xfer != NULL) ? xfer : i2c_linux_ioctl;
+  th->max_batch = I2C_LINUX_MAX_BATCH;
+  pthread_mutex_unlock(&th->mutex);
+}
+
+void i2c_linux_get_stats(struct i2c_periph *p, struct i2c_linux_stats *stats)
+{
+  struct i2c_thread_t *th = (struct i2c_thread_t *)p->init_struct;
+  pthread_mutex_lock(&th->mutex);
+  *stats = th->stats;
+  pthread_mutex_unlock(&th->mutex);
+}
+
 void i2c_event(void)
 {
 }
@@ -83,126 +168,193 @@ static bool i2c_linux_idle(struct i2c_periph *p __attribute__((unused)))
 
 static bool i2c_linux_submit(struct i2c_periph *p, struct i2c_transaction *t)
 {
-  // get mutex lock and condition
-  pthread_mutex_t *mutex = &(((struct i2c_thread_t *)(p->init_struct))->mutex);
-  pthread_cond_t *condition = &(((struct i2c_thread_t *)(p->init_struct))->condition);
-
-  uint8_t next_idx;
-  pthread_mutex_lock(mutex);
-  next_idx = (p->trans_insert_idx + 1) % I2C_TRANSACTION_QUEUE_LEN;
-  if (next_idx == p->trans_extract_idx) {
+  struct i2c_thread_t *th = (struct i2c_thread_t *)p->init_struct;
+
+  pthread_mutex_lock(&th->mutex);
+  if (th->nb_pending == I2C_TRANSACTION_QUEUE_LEN) {
     // queue full
     p->errors->queue_full_cnt++;
     t->status = I2CTransFailed;
-    pthread_mutex_unlock(mutex);
+    pthread_mutex_unlock(&th->mutex);
     return false;
   }
 
   t->status = I2CTransPending;
 
   /* put transaction in queue */
-  p->trans[p->trans_insert_idx] = t;
-  p->trans_insert_idx = next_idx;
+  struct i2c_linux_pending *q = &th->pending[th->nb_pending++];
+  q->t = t;
+  q->prio = th->prio[t->slave_addr >> 1];
+  q->time = i2c_linux_time_us();
 
   /* wake handler thread */
-  pthread_cond_signal(condition);
-  pthread_mutex_unlock(mutex);
+  pthread_cond_signal(&th->condition);
+  pthread_mutex_unlock(&th->mutex);
 
   return true;
 }
 
-/*
- * Transactions handler thread
+/** Fill the messages of a transaction
+ * @return number of messages (0 if invalid type)
  */
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
+static unsigned int i2c_linux_msgs(struct i2c_msg *msgs, struct i2c_transaction *t)
+{
+  switch (t->type) {
+    // Just transmitting
+    case I2CTransTx:
+      msgs[0].addr = t->slave_addr >> 1;
+      msgs[0].flags = 0;
+      msgs[0].len = t->len_w;
+      msgs[0].buf = (void *) t->buf;
+      return 1;
+    // Just reading
+    case I2CTransRx:
+      msgs[0].addr = t->slave_addr >> 1;
+      msgs[0].flags = I2C_M_RD;
+      msgs[0].len = t->len_r;
+      msgs[0].buf = (void *) t->buf;
+      return 1;
+    // First Transmit and then read with repeated start
+    case I2CTransTxRx:
+      msgs[0].addr = t->slave_addr >> 1;
+      msgs[0].flags = 0; /* tx */
+      msgs[0].len = t->len_w;
+      msgs[0].buf = (void *) t->buf;
+      msgs[1].addr = t->slave_addr >> 1;
+      msgs[1].flags = I2C_M_RD;
+      msgs[1].len = t->len_r;
+      msgs[1].buf = (void *) t->buf;
+      return 2;
+    default:
+      return 0;
+  }
+}
+#pragma GCC diagnostic pop
+
+/** Count a failed transaction, with mutex locked */
+static void i2c_linux_error(struct i2c_periph *p, struct i2c_transaction *t)
+{
+  switch (t->type) {
+    case I2CTransTx:
+      p->errors->ack_fail_cnt++;
+      break;
+    case I2CTransRx:
+      p->errors->arb_lost_cnt++;
+      break;
+    case I2CTransTxRx:
+      p->errors->miss_start_stop_cnt++;
+      break;
+    default:
+      p->errors->unexpected_event_cnt++;
+      break;
+  }
+}
+
+/*
+ * Transactions handler thread
+ */
 static void *i2c_thread(void *data)
 {
-  struct i2c_msg trx_msgs[2];
-  struct i2c_rdwr_ioctl_data trx_data = {
-    .msgs = trx_msgs,
-    .nmsgs = 2
-  };
+  struct i2c_msg msgs[I2C_LINUX_MAX_BATCH * 2];
+  struct i2c_linux_pending batch[I2C_LINUX_MAX_BATCH];
+  unsigned int first_msg[I2C_LINUX_MAX_BATCH + 1];
+  bool failed[I2C_LINUX_MAX_BATCH];
 
   get_rt_prio(I2C_THREAD_PRIO);
 
   struct i2c_periph *p = (struct i2c_periph *)data;
-  pthread_mutex_t *mutex = &(((struct i2c_thread_t *)(p->init_struct))->mutex);
-  pthread_cond_t *condition = &(((struct i2c_thread_t *)(p->init_struct))->condition);
+  struct i2c_thread_t *th = (struct i2c_thread_t *)p->init_struct;
+  int fd = (int)(intptr_t)p->reg_addr;
 
   while (1) {
     /* wait for data to transfer */
-    pthread_mutex_lock(mutex);
-    if (p->trans_insert_idx == p->trans_extract_idx) {
-      pthread_cond_wait(condition, mutex);
+    pthread_mutex_lock(&th->mutex);
+    while (th->nb_pending == 0) {
+      pthread_cond_wait(&th->condition, &th->mutex);
     }
 
-    int fd = (int)p->reg_addr;
-    struct i2c_transaction *t = p->trans[p->trans_extract_idx];
-    pthread_mutex_unlock(mutex);
-
-    // Switch the different transaction types
-    switch (t->type) {
-      // Just transmitting
-      case I2CTransTx:
-        // Set the slave address, converted to 7 bit
-        ioctl(fd, I2C_SLAVE, t->slave_addr >> 1);
-        if (write(fd, (uint8_t *)t->buf, t->len_w) < 0) {
-          /* if write failed, increment error counter ack_fail_cnt */
-          pthread_mutex_lock(mutex);
-          p->errors->ack_fail_cnt++;
-          pthread_mutex_unlock(mutex);
-          t->status = I2CTransFailed;
-        } else {
-          t->status = I2CTransSuccess;
-        }
-        break;
-      // Just reading
-      case I2CTransRx:
-        // Set the slave address, converted to 7 bit
-        ioctl(fd, I2C_SLAVE, t->slave_addr >> 1);
-        if (read(fd, (uint8_t *)t->buf, t->len_r) < 0) {
-          /* if read failed, increment error counter arb_lost_cnt */
-          pthread_mutex_lock(mutex);
-          p->errors->arb_lost_cnt++;
-          pthread_mutex_unlock(mutex);
-          t->status = I2CTransFailed;
-        } else {
-          t->status = I2CTransSuccess;
-        }
-        break;
-      // First Transmit and then read with repeated start
-      case I2CTransTxRx:
-        trx_msgs[0].addr = t->slave_addr >> 1;
-        trx_msgs[0].flags = 0; /* tx */
-        trx_msgs[0].len = t->len_w;
-        trx_msgs[0].buf = (void *) t->buf;
-        trx_msgs[1].addr = t->slave_addr >> 1;
-        trx_msgs[1].flags = I2C_M_RD;
-        trx_msgs[1].len = t->len_r;
-        trx_msgs[1].buf = (void *) t->buf;
-        if (ioctl(fd, I2C_RDWR, &trx_data) < 0) {
-          /* if write/read failed, increment error counter miss_start_stop_cnt */
-          pthread_mutex_lock(mutex);
-          p->errors->miss_start_stop_cnt++;
-          pthread_mutex_unlock(mutex);
-          t->status = I2CTransFailed;
-        } else {
-          t->status = I2CTransSuccess;
-        }
-        break;
-      default:
-        t->status = I2CTransFailed;
-        break;
+    /* sort by priority, keeping the submit order for the same priority */
+    uint8_t i, j, nb;
+    for (i = 1; i < th->nb_pending; i++) {
+      struct i2c_linux_pending q = th->pending[i];
+      for (j = i; j > 0 && th->pending[j - 1].prio < q.prio; j--) {
+        th->pending[j] = th->pending[j - 1];
+      }
+      th->pending[j] = q;
+    }
+    /* take the batch out of the queue, a device with errors is alone */
+    nb = 1;
+    if (!th->solo[th->pending[0].t->slave_addr >> 1]) {
+      while (nb < th->nb_pending && nb < th->max_batch && !th->solo[th->pending[nb].t->slave_addr >> 1]) {
+        nb++;
+      }
+    }
+    memcpy(batch, th->pending, nb * sizeof(struct i2c_linux_pending));
+    th->nb_pending -= nb;
+    memmove(th->pending, th->pending + nb, th->nb_pending * sizeof(struct i2c_linux_pending));
+    i2c_linux_xfer_fn xfer = th->xfer;
+    pthread_mutex_unlock(&th->mutex);
+
+    /* build the messages */
+    unsigned int nb_msgs = 0;
+    for (i = 0; i < nb; i++) {
+      batch[i].t->status = I2CTransRunning;
+      first_msg[i] = nb_msgs;
+      unsigned int n = i2c_linux_msgs(&msgs[nb_msgs], batch[i].t);
+      failed[i] = (n == 0);
+      nb_msgs += n;
+    }
+    first_msg[nb] = nb_msgs;
+
+    uint32_t nb_ioctls = 0;
+    int ret = -1, err = 0;
+    if (nb_msgs > 0) {
+      ret = xfer(fd, msgs, nb_msgs);
+      err = errno;
+      nb_ioctls++;
+    }
+    /* on error, any transaction may have been done or not; the ioctl can
+     * also stop early and return the number of messages done */
+    unsigned int msgs_done = (ret < 0) ? 0 : Min((unsigned int)ret, nb_msgs);
+    bool batch_failed = (msgs_done < nb_msgs);
+    for (i = 0; i < nb; i++) {
+      failed[i] |= (first_msg[i + 1] > msgs_done);
     }
 
-    pthread_mutex_lock(mutex);
-    p->trans_extract_idx = (p->trans_extract_idx + 1) % I2C_TRANSACTION_QUEUE_LEN;
-    pthread_mutex_unlock(mutex);
+    /* complete the transactions */
+    uint32_t now = i2c_linux_time_us();
+    pthread_mutex_lock(&th->mutex);
+    if (ret < 0 && err == EOPNOTSUPP && nb > 1) {
+      // adapter can't do several messages in one ioctl
+      th->max_batch = 1;
+    }
+    for (i = 0; i < nb; i++) {
+      th->solo[batch[i].t->slave_addr >> 1] = failed[i];
+      if (failed[i]) {
+        i2c_linux_error(p, batch[i].t);
+        batch[i].t->status = I2CTransFailed;
+        th->stats.errors++;
+      } else {
+        batch[i].t->status = I2CTransSuccess;
+      }
+      uint32_t latency = now - batch[i].time;
+      th->stats.latency_sum += latency;
+      if (latency > th->stats.latency_max) {
+        th->stats.latency_max = latency;
+      }
+      th->stats.latency_last = latency;
+    }
+    th->stats.transactions += nb;
+    th->stats.ioctls += nb_ioctls;
+    if (batch_failed && nb > 1) {
+      th->stats.batch_errors++;
+    }
+    pthread_mutex_unlock(&th->mutex);
   }
   return NULL;
 }
-#pragma GCC diagnostic pop
 
 #if USE_I2C0
 struct i2c_errors i2c0_errors;
@@ -214,14 +366,12 @@ void i2c0_hw_init(void)
   i2c0.submit = i2c_linux_submit;
   i2c0.setbitrate = i2c_linux_setbitrate;
 
-  i2c0.reg_addr = (void *)open("/dev/i2c-0", O_RDWR);
+  i2c0.reg_addr = (void *)(intptr_t)open("/dev/i2c-0", O_RDWR);
   i2c0.errors = &i2c0_errors;
 
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c0_errors);
 
-  pthread_mutex_init(&i2c0_thread.mutex, NULL);
-  pthread_cond_init(&i2c0_thread.condition, NULL);
   i2c0.init_struct = (void *)(&i2c0_thread);
 
   i2c_arch_init(&i2c0);
@@ -238,14 +388,12 @@ void i2c1_hw_init(void)
   i2c1.submit = i2c_linux_submit;
   i2c1.setbitrate = i2c_linux_setbitrate;
 
-  i2c1.reg_addr = (void *)open("/dev/i2c-1", O_RDWR);
+  i2c1.reg_addr = (void *)(intptr_t)open("/dev/i2c-1", O_RDWR);
   i2c1.errors = &i2c1_errors;
 
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c1_errors);
 
-  pthread_mutex_init(&i2c1_thread.mutex, NULL);
-  pthread_cond_init(&i2c1_thread.condition, NULL);
   i2c1.init_struct = (void *)(&i2c1_thread);
 
   i2c_arch_init(&i2c1);
@@ -262,14 +410,12 @@ void i2c2_hw_init(void)
   i2c2.submit = i2c_linux_submit;
   i2c2.setbitrate = i2c_linux_setbitrate;
 
-  i2c2.reg_addr = (void *)open("/dev/i2c-2", O_RDWR);
+  i2c2.reg_addr = (void *)(intptr_t)open("/dev/i2c-2", O_RDWR);
   i2c2.errors = &i2c2_errors;
 
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c2_errors);
 
-  pthread_mutex_init(&i2c2_thread.mutex, NULL);
-  pthread_cond_init(&i2c2_thread.condition, NULL);
   i2c2.init_struct = (void *)(&i2c2_thread);
 
   i2c_arch_init(&i2c2);
@@ -286,14 +432,12 @@ void i2c3_hw_init(void)
   i2c3.submit = i2c_linux_submit;
   i2c3.setbitrate = i2c_linux_setbitrate;
 
-  i2c3.reg_addr = (void *)open("/dev/i2c-3", O_RDWR);
+  i2c3.reg_addr = (void *)(intptr_t)open("/dev/i2c-3", O_RDWR);
   i2c3.errors = &i2c3_errors;
 
   /* zeros error counter */
   ZEROS_ERR_COUNTER(i2c3_errors);
 
-  pthread_mutex_init(&i2c3_thread.mutex, NULL);
-  pthread_cond_init(&i2c3_thread.condition, NULL);
   i2c3.init_struct = (void *)(&i2c3_thread);
 
   i2c_arch_init(&i2c3);
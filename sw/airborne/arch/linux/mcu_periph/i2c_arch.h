@@ -28,6 +28,40 @@
 #ifndef LINUX_MCU_PERIPH_I2C_ARCH_H
 #define LINUX_MCU_PERIPH_I2C_ARCH_H
 
+#include "std.h"
+
+struct i2c_periph;
+struct i2c_msg;
+
+/** Transfer function of a bus, ioctl(fd, I2C_RDWR) by default.
+ *  Can be replaced, e.g. by a fake i2c-dev for tests.
+ *  @return negative value on error (with errno set)
+ */
+typedef int (*i2c_linux_xfer_fn)(int fd, struct i2c_msg *msgs, unsigned int nb);
+
+/** Statistics of a bus */
+struct i2c_linux_stats {
+  uint32_t transactions;    ///< number of transactions done
+  uint32_t ioctls;          ///< number of I2C_RDWR calls
+  uint32_t batch_errors;    ///< number of failed batches of more than one transaction
+  uint32_t errors;          ///< number of failed transactions
+  uint32_t latency_last;    ///< submit to completion time of the last transaction (us)
+  uint32_t latency_max;     ///< max submit to completion time (us)
+  uint64_t latency_sum;     ///< sum of the submit to completion times (us)
+};
+
+/** Set the priority of a device (8 bit address), default 0.
+ *  Queued transactions of higher priority devices are done first,
+ *  e.g. motor controllers sharing a bus with sensors.
+ */
+extern void i2c_linux_set_priority(struct i2c_periph *p, uint8_t slave_addr, uint8_t prio);
+
+/** Set the transfer function of a bus, NULL for the default ioctl */
+extern void i2c_linux_set_xfer(struct i2c_periph *p, i2c_linux_xfer_fn xfer);
+
+/** Get a copy of the statistics of a bus */
+extern void i2c_linux_get_stats(struct i2c_periph *p, struct i2c_linux_stats *stats);
+
 #if USE_I2C0
 extern void i2c0_hw_init(void);
 #endif /* USE_I2C0 */
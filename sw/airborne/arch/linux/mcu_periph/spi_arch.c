@@ -21,6 +21,15 @@
 /**
  * @file arch/linux/mcu_periph/spi_arch.c
  * Handling of SPI hardware for Linux.
+ *
+ * Transactions are queued by spi_submit in a lock-free queue (multiple
+ * producers, so that it can be called from any thread) and done by one worker
+ * thread per bus. All the transactions queued when the worker wakes up are
+ * coalesced in a single SPI_IOC_MESSAGE(N) ioctl.
+ * The transaction status is updated by the worker thread, the after_cb callbacks
+ * are called from the main loop by spi_event.
+ * A transaction with an after_cb holds a slot of the completion queue from
+ * spi_submit until its callback is called, so completions are never dropped.
  */
 
 #include <stdio.h>
@@ -28,80 +37,366 @@
 #include <stdlib.h>
 #include <fcntl.h>
 #include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
 
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
 
 #include "mcu_periph/spi.h"
+#include "rt_priority.h"
 #include BOARD_CONFIG
 
+#ifndef SPI_THREAD_PRIO
+#define SPI_THREAD_PRIO 10
+#endif
 
-void spi_init_slaves(void)
+/** Max number of transactions in one ioctl */
+#ifndef SPI_LINUX_MAX_BATCH
+#define SPI_LINUX_MAX_BATCH 8
+#endif
+
+/** Length of the submission and completion queues, power of 2 */
+#ifndef SPI_LINUX_QUEUE_LEN
+#define SPI_LINUX_QUEUE_LEN 16
+#endif
+
+#if (SPI_LINUX_QUEUE_LEN & (SPI_LINUX_QUEUE_LEN - 1)) != 0
+#error "SPI_LINUX_QUEUE_LEN must be a power of 2"
+#endif
+
+#define SPI_LINUX_QUEUE_MASK (SPI_LINUX_QUEUE_LEN - 1)
+
+/** Max number of SPI buses */
+#define SPI_LINUX_NB_BUS 5
+
+/** Cell of the submission queue, seq is used to synchronize producers and consumer */
+struct spi_linux_cell {
+  uint32_t seq;
+  struct spi_transaction *t;
+};
+
+/** Private structure of a SPI bus */
+struct spi_linux_bus {
+  int fd;
+  uint32_t speed;
+  spi_linux_xfer_fn xfer;
+  /* submission queue, any thread -> worker */
+  struct spi_linux_cell sub[SPI_LINUX_QUEUE_LEN];
+  uint32_t sub_head;
+  uint32_t sub_tail;
+  sem_t sem;
+  /* completion queue, worker -> main loop */
+  struct spi_transaction *done[SPI_LINUX_QUEUE_LEN];
+  uint32_t done_head;
+  uint32_t done_tail;
+  uint32_t done_reserved;   ///< transactions with after_cb submitted and not called back
+  /* temp buffers for transactions with different input/output length */
+  uint8_t *scratch;
+  size_t scratch_len;
+  pthread_t thread;
+  struct spi_linux_stats stats;
+};
+
+static struct spi_linux_bus *spi_linux_buses[SPI_LINUX_NB_BUS];
+
+static int spi_linux_ioctl(int fd, struct spi_ioc_transfer *xfers, unsigned int nb)
 {
-  /* for now we assume that each SPI device has it's SLAVE CS already set up
-   * e.g. in pin muxing of BBB
-   */
+  return ioctl(fd, SPI_IOC_MESSAGE(nb), xfers);
+}
+
+static bool spi_linux_push(struct spi_linux_bus *b, struct spi_transaction *t)
+{
+  struct spi_linux_cell *cell;
+  uint32_t pos = __atomic_load_n(&b->sub_head, __ATOMIC_RELAXED);
+  for (;;) {
+    cell = &b->sub[pos & SPI_LINUX_QUEUE_MASK];
+    uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    int32_t dif = (int32_t)(seq - pos);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&b->sub_head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if (dif < 0) {
+      return false; // full
+    } else {
+      pos = __atomic_load_n(&b->sub_head, __ATOMIC_RELAXED);
+    }
+  }
+  cell->t = t;
+  __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static struct spi_transaction *spi_linux_pop(struct spi_linux_bus *b)
+{
+  uint32_t pos = b->sub_tail;
+  struct spi_linux_cell *cell = &b->sub[pos & SPI_LINUX_QUEUE_MASK];
+  uint32_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+  if ((int32_t)(seq - (pos + 1)) < 0) {
+    return NULL; // empty
+  }
+  struct spi_transaction *t = cell->t;
+  __atomic_store_n(&cell->seq, pos + SPI_LINUX_QUEUE_LEN, __ATOMIC_RELEASE);
+  b->sub_tail = pos + 1;
+  return t;
+}
+
+/* completion of a transaction, from the worker thread
+ * there is always room in the completion queue, reserved by spi_submit */
+static void spi_linux_complete(struct spi_linux_bus *b, struct spi_transaction *t, enum SPITransactionStatus status)
+{
+  /* make the received data visible before the status */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  t->status = status;
+  if (t->after_cb == NULL) {
+    return;
+  }
+  uint32_t head = __atomic_load_n(&b->done_head, __ATOMIC_RELAXED);
+  b->done[head & SPI_LINUX_QUEUE_MASK] = t;
+  __atomic_store_n(&b->done_head, head + 1, __ATOMIC_RELEASE);
 }
 
+/* temp buffers size needed by a transaction */
+static size_t spi_linux_scratch_size(struct spi_transaction *t)
+{
+  uint16_t len = Max(t->input_length, t->output_length);
+  size_t size = 0;
+  if (len > t->output_length) {
+    size += len;
+  }
+  if (len > t->input_length) {
+    size += len;
+  }
+  return size;
+}
+
+/*
+ * Do a batch of transactions in one ioctl
+ */
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wcast-qual"
-bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
+static void spi_linux_transfer(struct spi_linux_bus *b, struct spi_transaction **batch,
+                               struct spi_ioc_transfer *xfers, uint8_t nb)
 {
-  int fd = (int)p->reg_addr;
+  uint8_t i;
+  size_t size = 0;
+  for (i = 0; i < nb; i++) {
+    size += spi_linux_scratch_size(batch[i]);
+  }
+  if (size > b->scratch_len) {
+    uint8_t *scratch = realloc(b->scratch, size);
+    if (scratch == NULL) {
+      for (i = 0; i < nb; i++) {
+        spi_linux_complete(b, batch[i], SPITransFailed);
+      }
+      __atomic_fetch_add(&b->stats.errors, nb, __ATOMIC_RELAXED);
+      return;
+    }
+    b->scratch = scratch;
+    b->scratch_len = size;
+  }
 
-  struct spi_ioc_transfer xfer;
-  memset(&xfer, 0, sizeof xfer);
+  uint8_t *tmp = b->scratch;
+  uint8_t *rx_tmp[SPI_LINUX_MAX_BATCH];
+  memset(xfers, 0, nb * sizeof(struct spi_ioc_transfer));
+  for (i = 0; i < nb; i++) {
+    struct spi_transaction *t = batch[i];
+    /* length in bytes of transaction */
+    uint16_t len = Max(t->input_length, t->output_length);
+
+    /* handle transactions with different input/output length */
+    if (len > t->output_length) {
+      /* copy bytes to transmit to larger buffer, rest filled with zero */
+      memcpy(tmp, (void *)t->output_buf, t->output_length);
+      memset(tmp + t->output_length, 0, len - t->output_length);
+      xfers[i].tx_buf = (unsigned long)tmp;
+      tmp += len;
+    } else {
+      xfers[i].tx_buf = (unsigned long)t->output_buf;
+    }
+    if (len > t->input_length) {
+      rx_tmp[i] = tmp;
+      xfers[i].rx_buf = (unsigned long)tmp;
+      tmp += len;
+    } else {
+      rx_tmp[i] = NULL;
+      xfers[i].rx_buf = (unsigned long)t->input_buf;
+    }
+
+    xfers[i].len = len;
+    xfers[i].speed_hz = b->speed;
+    xfers[i].delay_usecs = 0;
+    if (t->dss == SPIDss16bit) {
+      xfers[i].bits_per_word = 16;
+    } else {
+      xfers[i].bits_per_word = 8;
+    }
+    if (t->select == SPISelectUnselect || t->select == SPIUnselect) {
+      xfers[i].cs_change = 1;
+    }
+    t->status = SPITransRunning;
+  }
 
-  /* length in bytes of transaction */
-  uint16_t buf_len = Max(t->input_length, t->output_length);
+  __atomic_fetch_add(&b->stats.ioctls, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&b->stats.transactions, nb, __ATOMIC_RELAXED);
+  if (b->xfer(b->fd, xfers, nb) < 0) {
+    __atomic_fetch_add(&b->stats.errors, nb, __ATOMIC_RELAXED);
+    for (i = 0; i < nb; i++) {
+      spi_linux_complete(b, batch[i], SPITransFailed);
+    }
+    return;
+  }
 
-  // temp buffers, used if necessary
-  uint8_t tx_buf[buf_len], rx_buf[buf_len];
-  memset(tx_buf, 0, buf_len);
-  memset(rx_buf, 0, buf_len);
+  for (i = 0; i < nb; i++) {
+    struct spi_transaction *t = batch[i];
+    /* copy received data if we had to use an extra rx_buffer */
+    if (rx_tmp[i] != NULL) {
+      memcpy((void *)t->input_buf, rx_tmp[i], t->input_length);
+    }
+    spi_linux_complete(b, t, SPITransSuccess);
+  }
+}
+#pragma GCC diagnostic pop
 
-  /* handle transactions with different input/output length */
-  if (buf_len > t->output_length) {
-    /* copy bytes to transmit to larger buffer, rest filled with zero */
-    memcpy(tx_buf, (void *)t->output_buf, t->output_length);
-    xfer.tx_buf = (unsigned long)tx_buf;
-  } else {
-    xfer.tx_buf = (unsigned long)t->output_buf;
+/*
+ * Transactions handler thread
+ */
+static void *spi_thread(void *data)
+{
+  struct spi_linux_bus *b = (struct spi_linux_bus *)data;
+  struct spi_transaction *batch[SPI_LINUX_MAX_BATCH];
+  struct spi_ioc_transfer xfers[SPI_LINUX_MAX_BATCH];
+
+  get_rt_prio(SPI_THREAD_PRIO);
+
+  while (1) {
+    /* wait for transactions */
+    if (sem_wait(&b->sem) != 0) {
+      continue;
+    }
+    /* drop the other wake ups before popping: a transaction submitted after
+     * this point posts again and is seen by the pops or the next wait */
+    while (sem_trywait(&b->sem) == 0);
+    /* transfer all queued transactions */
+    for (;;) {
+      uint8_t nb = 0;
+      struct spi_transaction *t;
+      while (nb < SPI_LINUX_MAX_BATCH && (t = spi_linux_pop(b)) != NULL) {
+        batch[nb++] = t;
+      }
+      if (nb == 0) {
+        break;
+      }
+      spi_linux_transfer(b, batch, xfers, nb);
+    }
   }
+  return NULL;
+}
 
-  if (buf_len > t->input_length) {
-    xfer.rx_buf = (unsigned long)rx_buf;
-  } else {
-    xfer.rx_buf = (unsigned long)t->input_buf;
+bool spi_linux_init_bus(struct spi_periph *p, int fd, uint32_t speed)
+{
+  uint8_t idx;
+  for (idx = 0; idx < SPI_LINUX_NB_BUS && spi_linux_buses[idx] != NULL; idx++);
+  if (idx == SPI_LINUX_NB_BUS) {
+    return false;
+  }
+  struct spi_linux_bus *b = calloc(1, sizeof(struct spi_linux_bus));
+  if (b == NULL) {
+    return false;
   }
+  b->fd = fd;
+  b->speed = speed;
+  b->xfer = spi_linux_ioctl;
+  uint32_t i;
+  for (i = 0; i < SPI_LINUX_QUEUE_LEN; i++) {
+    b->sub[i].seq = i;
+  }
+  sem_init(&b->sem, 0, 0);
+  if (pthread_create(&b->thread, NULL, spi_thread, (void *)b) != 0) {
+    fprintf(stderr, "spi_linux_init_bus: Could not create SPI thread.\n");
+    free(b);
+    return false;
+  }
+#ifndef __APPLE__
+  pthread_setname_np(b->thread, "spi");
+#endif
+  spi_linux_buses[idx] = b;
+  p->reg_addr = (void *)(intptr_t)fd;
+  p->init_struct = (void *)b;
+  return true;
+}
 
-  xfer.len = buf_len;
-  /* fixed speed of 1Mhz for now, use SPIClockDiv?? */
-  xfer.speed_hz = (uint32_t)p->init_struct;
-  xfer.delay_usecs = 0;
-  if (t->dss == SPIDss16bit) {
-    xfer.bits_per_word = 16;
-  } else {
-    xfer.bits_per_word = 8;
+void spi_linux_set_xfer(struct spi_periph *p, spi_linux_xfer_fn xfer)
+{
+  struct spi_linux_bus *b = (struct spi_linux_bus *)p->init_struct;
+  if (b != NULL) {
+    b->xfer = (xfer != NULL) ? xfer : spi_linux_ioctl;
   }
-  if (t->select == SPISelectUnselect || t->select == SPIUnselect) {
-    xfer.cs_change = 1;
+}
+
+struct spi_linux_stats *spi_linux_get_stats(struct spi_periph *p)
+{
+  struct spi_linux_bus *b = (struct spi_linux_bus *)p->init_struct;
+  return (b != NULL) ? &b->stats : NULL;
+}
+
+void spi_event(void)
+{
+  uint8_t i;
+  for (i = 0; i < SPI_LINUX_NB_BUS && spi_linux_buses[i] != NULL; i++) {
+    struct spi_linux_bus *b = spi_linux_buses[i];
+    uint32_t tail = __atomic_load_n(&b->done_tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&b->done_head, __ATOMIC_ACQUIRE);
+    while (tail != head) {
+      struct spi_transaction *t = b->done[tail & SPI_LINUX_QUEUE_MASK];
+      tail++;
+      __atomic_store_n(&b->done_tail, tail, __ATOMIC_RELEASE);
+      /* release the slot before the callback, which may submit again */
+      __atomic_fetch_sub(&b->done_reserved, 1, __ATOMIC_RELEASE);
+      t->after_cb(t);
+    }
   }
+}
 
-  if (ioctl(fd, SPI_IOC_MESSAGE(1), &xfer) < 0) {
+void spi_init_slaves(void)
+{
+  /* for now we assume that each SPI device has it's SLAVE CS already set up
+   * e.g. in pin muxing of BBB
+   */
+}
+
+bool spi_submit(struct spi_periph *p, struct spi_transaction *t)
+{
+  struct spi_linux_bus *b = (struct spi_linux_bus *)p->init_struct;
+  if (b == NULL) {
     t->status = SPITransFailed;
     return false;
   }
-
-  /* copy received data if we had to use an extra rx_buffer */
-  if (buf_len > t->input_length) {
-    memcpy((void *)t->input_buf, rx_buf, t->input_length);
+  if (t->before_cb != NULL) {
+    t->before_cb(t);
   }
-
-  t->status = SPITransSuccess;
+  /* reserve a completion slot, until the after_cb is called */
+  if (t->after_cb != NULL &&
+      __atomic_fetch_add(&b->done_reserved, 1, __ATOMIC_ACQUIRE) >= SPI_LINUX_QUEUE_LEN) {
+    __atomic_fetch_sub(&b->done_reserved, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&b->stats.queue_full, 1, __ATOMIC_RELAXED);
+    t->status = SPITransFailed;
+    return false;
+  }
+  t->status = SPITransPending;
+  if (!spi_linux_push(b, t)) {
+    if (t->after_cb != NULL) {
+      __atomic_fetch_sub(&b->done_reserved, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&b->stats.queue_full, 1, __ATOMIC_RELAXED);
+    t->status = SPITransFailed;
+    return false;
+  }
+  sem_post(&b->sem);
   return true;
 }
-#pragma GCC diagnostic pop
 
 bool spi_lock(struct spi_periph *p, uint8_t slave)
 {
@@ -141,9 +436,9 @@ void spi0_arch_init(void)
   if (fd < 0) {
     perror("Could not open SPI device /dev/spidev1.0");
     spi0.reg_addr = NULL;
+    spi0.init_struct = NULL;
     return;
   }
-  spi0.reg_addr = (void *)fd;
 
   /* spi mode */
   unsigned char spi_mode = SPI0_MODE;
@@ -168,7 +463,10 @@ void spi0_arch_init(void)
   if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed) < 0) {
     perror("SPI0: can't set max speed hz");
   }
-  spi0.init_struct = (void *)SPI0_MAX_SPEED_HZ;
+
+  if (!spi_linux_init_bus(&spi0, fd, SPI0_MAX_SPEED_HZ)) {
+    fprintf(stderr, "SPI0: can't start SPI engine\n");
+  }
 }
 #endif /* USE_SPI0 */
 
@@ -197,9 +495,9 @@ void spi1_arch_init(void)
   if (fd < 0) {
     perror("Could not open SPI device /dev/spidev1.1");
     spi1.reg_addr = NULL;
+    spi1.init_struct = NULL;
     return;
   }
-  spi1.reg_addr = (void *)fd;
 
   /* spi mode */
   unsigned char spi_mode = SPI1_MODE;
@@ -215,7 +513,7 @@ void spi1_arch_init(void)
 
   /* bits per word default to 8 */
   unsigned char spi_bits_per_word = SPI1_BITS_PER_WORD;
-  if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &spi_bits_per_word) < 0) {r
+  if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &spi_bits_per_word) < 0) {
     perror("SPI1: can't set bits per word");
   }
 
@@ -224,6 +522,9 @@ void spi1_arch_init(void)
   if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &spi_speed) < 0) {
     perror("SPI1: can't set max speed hz");
   }
-  spi1.init_struct = (void *)SPI1_MAX_SPEED_HZ;
+
+  if (!spi_linux_init_bus(&spi1, fd, SPI1_MAX_SPEED_HZ)) {
+    fprintf(stderr, "SPI1: can't start SPI engine\n");
+  }
 }
 #endif /* USE_SPI1 */
@@ -26,5 +26,39 @@
 #ifndef SPI_ARCH_H
 #define SPI_ARCH_H
 
+#include "std.h"
+
+struct spi_periph;
+struct spi_ioc_transfer;
+
+/** Completion callbacks are called by spi_event from the main loop */
+#define SPI_ARCH_HAS_EVENT 1
+
+extern void spi_event(void);
+
+/** Transfer function of a bus, ioctl(fd, SPI_IOC_MESSAGE(nb), xfers) by default.
+ *  Can be replaced, e.g. by a fake spidev for tests.
+ *  @return negative value on error
+ */
+typedef int (*spi_linux_xfer_fn)(int fd, struct spi_ioc_transfer *xfers, unsigned int nb);
+
+/** Statistics of a bus */
+struct spi_linux_stats {
+  uint32_t transactions;    ///< number of transactions done
+  uint32_t ioctls;          ///< number of SPI_IOC_MESSAGE calls
+  uint32_t errors;          ///< number of failed transactions
+  uint32_t queue_full;      ///< number of transactions rejected (submission or completion queue full)
+};
+
+/** Start the engine of a bus on an opened spidev (done by spiX_arch_init)
+ * @return false if the worker thread can't be started
+ */
+extern bool spi_linux_init_bus(struct spi_periph *p, int fd, uint32_t speed);
+
+/** Set the transfer function of a bus, NULL for the default ioctl */
+extern void spi_linux_set_xfer(struct spi_periph *p, spi_linux_xfer_fn xfer);
+
+extern struct spi_linux_stats *spi_linux_get_stats(struct spi_periph *p);
+
 
 #endif // SPI_ARCH_H
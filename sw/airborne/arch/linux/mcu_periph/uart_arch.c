@@ -320,6 +320,14 @@ uint8_t uart_getch(struct uart_periph *p)
   return ret;
 }
 
+uint16_t uart_get_bytes(struct uart_periph *p, uint8_t *buf, uint16_t len)
+{
+  pthread_mutex_lock(&uart_mutex);
+  uint16_t n = uart_rx_buf_extract(p, buf, len);
+  pthread_mutex_unlock(&uart_mutex);
+  return n;
+}
+
 int uart_char_available(struct uart_periph *p)
 {
   pthread_mutex_lock(&uart_mutex);
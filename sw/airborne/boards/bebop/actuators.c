@@ -63,6 +63,8 @@ void actuators_bebop_init(void)
   /* Initialize the I2C connection */
   actuators_bebop.i2c_trans.slave_addr = ACTUATORS_BEBOP_ADDR;
   actuators_bebop.i2c_trans.status = I2CTransDone;
+  /* motor commands before the sensors sharing the bus */
+  i2c_linux_set_priority(&i2c1, ACTUATORS_BEBOP_ADDR, 1);
   actuators_bebop.led = 0;
 
 #if PERIODIC_TELEMETRY
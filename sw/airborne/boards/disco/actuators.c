@@ -86,6 +86,8 @@ void actuators_disco_init(void)
   /* Initialize the I2C connection */
   actuators_disco.i2c_trans.slave_addr = ACTUATORS_DISCO_ADDR;
   actuators_disco.i2c_trans.status = I2CTransDone;
+  /* motor commands before the sensors sharing the bus */
+  i2c_linux_set_priority(&i2c1, ACTUATORS_DISCO_ADDR, 1);
   actuators_disco.motor_rpm = 0;
   int i = 0;
   for (i = 0; i < ACTUATORS_DISCO_PWM_NB; i++) {
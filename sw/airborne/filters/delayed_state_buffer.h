@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file filters/delayed_state_buffer.h
+ * @brief Delayed state buffer for measurement lag compensation.
+ *
+ * Generic ring buffer storing, for each filter step, a snapshot of the
+ * filter state before the step, the inputs of the step (propagation input
+ * and measurements applied during the step) and a timestamp.
+ *
+ * A delayed measurement is fused by:
+ *  - finding the step it belongs to (delayed_state_buffer_find)
+ *  - going back to the end of that step (delayed_state_buffer_rewind)
+ *  - applying the measurement and recording it in the step inputs
+ *  - replaying the following steps up to now (delayed_state_buffer_replay),
+ *    which also corrects the stored snapshots for later delayed measurements
+ *
+ * State and input types are defined by the filter, storage is provided
+ * by the caller (see DELAYED_STATE_BUFFER_DEF) so no allocation is done.
+ * The step function is called through a pointer, but since all functions
+ * are static inline it is usually inlined when the pointer is a constant.
+ */
+
+#ifndef DELAYED_STATE_BUFFER_H
+#define DELAYED_STATE_BUFFER_H
+
+#include "std.h"
+#include <string.h>
+
+/** Run one filter step: propagate state with input, then apply the measurements recorded in input */
+typedef void (*delayed_state_step_fn)(void *state, void *input);
+
+struct DelayedStateBuffer {
+  uint8_t *state;       ///< state snapshots before each step
+  uint8_t *input;       ///< inputs of each step
+  uint32_t *stamp;      ///< start time of each step (us)
+  uint16_t size;        ///< number of slots
+  uint16_t state_size;  ///< size of a state in bytes
+  uint16_t input_size;  ///< size of an input in bytes
+  uint16_t head;        ///< slot of the last step
+  uint16_t count;       ///< number of valid slots
+};
+
+/** Define the static storage of a delayed state buffer */
+#define DELAYED_STATE_BUFFER_DEF(_name, _size, _state_type, _input_type) \
+  static _state_type _name##_state[_size];                              \
+  static _input_type _name##_input[_size];                              \
+  static uint32_t _name##_stamp[_size];
+
+/** Init a delayed state buffer with storage defined by DELAYED_STATE_BUFFER_DEF */
+#define DELAYED_STATE_BUFFER_INIT(_buf, _name, _size) \
+  delayed_state_buffer_init(_buf, _name##_state, _name##_input, _name##_stamp, _size, \
+                            sizeof(_name##_state[0]), sizeof(_name##_input[0]))
+
+static inline void delayed_state_buffer_init(struct DelayedStateBuffer *b, void *state, void *input,
+    uint32_t *stamp, uint16_t size, uint16_t state_size, uint16_t input_size)
+{
+  b->state = (uint8_t *)state;
+  b->input = (uint8_t *)input;
+  b->stamp = stamp;
+  b->size = size;
+  b->state_size = state_size;
+  b->input_size = input_size;
+  b->head = size - 1;
+  b->count = 0;
+}
+
+/** Drop all history (e.g. after a filter reset) */
+static inline void delayed_state_buffer_reset(struct DelayedStateBuffer *b)
+{
+  b->count = 0;
+}
+
+/** Slot index of a step
+ * @param age number of steps back from the last one (0 is the last step)
+ */
+static inline uint16_t delayed_state_buffer_slot(struct DelayedStateBuffer *b, uint16_t age)
+{
+  return (b->head >= age) ? b->head - age : b->head + b->size - age;
+}
+
+static inline void *delayed_state_buffer_state(struct DelayedStateBuffer *b, uint16_t age)
+{
+  return b->state + (uint32_t)delayed_state_buffer_slot(b, age) * b->state_size;
+}
+
+static inline void *delayed_state_buffer_input(struct DelayedStateBuffer *b, uint16_t age)
+{
+  return b->input + (uint32_t)delayed_state_buffer_slot(b, age) * b->input_size;
+}
+
+/** Start a new step
+ *  Stores a snapshot of the state before the step, overwriting the oldest step if full.
+ * @param stamp start time of the step (us)
+ * @param state current filter state
+ * @return input of the new step, to be filled by the caller
+ */
+static inline void *delayed_state_buffer_push(struct DelayedStateBuffer *b, uint32_t stamp, const void *state)
+{
+  b->head = (b->head + 1 == b->size) ? 0 : b->head + 1;
+  if (b->count < b->size) {
+    b->count++;
+  }
+  b->stamp[b->head] = stamp;
+  memcpy(b->state + (uint32_t)b->head * b->state_size, state, b->state_size);
+  return b->input + (uint32_t)b->head * b->input_size;
+}
+
+/** Input of the current step, or NULL if empty */
+static inline void *delayed_state_buffer_last_input(struct DelayedStateBuffer *b)
+{
+  if (b->count == 0) {
+    return NULL;
+  }
+  return delayed_state_buffer_input(b, 0);
+}
+
+/** Find the step containing a given time
+ *  The age is first estimated from the mean step period,
+ *  then corrected on the timestamps, so the lookup is O(1) for steps
+ *  at a regular rate.
+ * @param stamp time of the measurement (us)
+ * @return age of the step, or -1 if older than the buffer or in the future
+ */
+static inline int32_t delayed_state_buffer_find(struct DelayedStateBuffer *b, uint32_t stamp)
+{
+  if (b->count == 0) {
+    return -1;
+  }
+  uint32_t last = b->stamp[b->head];
+  uint32_t first = b->stamp[delayed_state_buffer_slot(b, b->count - 1)];
+  // unsigned differences handle timer wrap around
+  if (last - stamp > last - first) {
+    return (stamp - last < 0x80000000u) ? 0 : -1;
+  }
+  int32_t age = 0;
+  if (b->count > 1) {
+    uint32_t period = (last - first) / (b->count - 1);
+    if (period > 0) {
+      age = (int32_t)((last - stamp + period - 1) / period);
+    }
+    Bound(age, 0, b->count - 1);
+  }
+  // step age starts at or before stamp
+  while (age < b->count - 1 && last - b->stamp[delayed_state_buffer_slot(b, age)] < last - stamp) {
+    age++;
+  }
+  // step age - 1 starts after stamp
+  while (age > 0 && last - b->stamp[delayed_state_buffer_slot(b, age - 1)] >= last - stamp) {
+    age--;
+  }
+  return age;
+}
+
+/** Go back to the end of a past step
+ *  The state is restored from the snapshot of the step and the step is run again.
+ * @param age age of the step
+ * @param state filter state, overwritten
+ * @param step filter step function
+ */
+static inline void delayed_state_buffer_rewind(struct DelayedStateBuffer *b, uint16_t age, void *state,
+    delayed_state_step_fn step)
+{
+  memcpy(state, delayed_state_buffer_state(b, age), b->state_size);
+  step(state, delayed_state_buffer_input(b, age));
+}
+
+/** Replay the steps following a past step up to now
+ *  The snapshots of the replayed steps are updated with the new states.
+ * @param age age of the step the state is at the end of
+ * @param state filter state, at the end of step age before the call, current after
+ * @param step filter step function
+ */
+static inline void delayed_state_buffer_replay(struct DelayedStateBuffer *b, uint16_t age, void *state,
+    delayed_state_step_fn step)
+{
+  while (age > 0) {
+    age--;
+    memcpy(delayed_state_buffer_state(b, age), state, b->state_size);
+    step(state, delayed_state_buffer_input(b, age));
+  }
+}
+
+#endif /* DELAYED_STATE_BUFFER_H */
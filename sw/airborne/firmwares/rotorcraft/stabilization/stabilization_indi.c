@@ -59,6 +59,7 @@ static void lms_estimation(void);
 static void get_actuator_state(void);
 static void calc_g1_element(float dx_error, int8_t i, int8_t j, float mu_extra);
 static void calc_g2_element(float dx_error, int8_t j, float mu_extra);
+static void calc_g1g2(void);
 static void calc_g1g2_pseudo_inv(void);
 static void bound_g_mat(void);
 
@@ -110,6 +111,11 @@ static float Wv[INDI_OUTPUTS] = STABILIZATION_INDI_WLS_PRIORITIES;
 static float Wv[INDI_OUTPUTS] = {1000, 1000, 1, 100};
 #endif
 
+#if !STABILIZATION_INDI_ALLOCATION_PSEUDO_INVERSE
+// Factorisation of the allocation problem, only valid while g1g2 and Wv don't change
+static struct WlsCache wls_cache;
+#endif
+
 // variables needed for control
 float actuator_state_filt_vect[INDI_NUM_ACT];
 struct FloatRates angular_accel_ref = {0., 0., 0.};
@@ -215,8 +221,9 @@ void stabilization_indi_init(void)
   float_vect_zero(estimation_rate_dd, INDI_NUM_ACT);
   float_vect_zero(actuator_state_filt_vect, INDI_NUM_ACT);
 
-  //Calculate G1G2_PSEUDO_INVERSE
-  calc_g1g2_pseudo_inv();
+  //Calculate G1G2 and G1G2_PSEUDO_INVERSE
+  calc_g1g2();
+  stabilization_indi_g1g2_updated();
 
   // Initialize the array of pointers to the rows of g1g2
   uint8_t i;
@@ -421,7 +428,7 @@ static void stabilization_indi_calc_cmd(struct Int32Quat *att_err, bool rate_con
 
   // WLS Control Allocator
   num_iter =
-    wls_alloc(indi_du, indi_v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+    wls_alloc_cached(&wls_cache, indi_du, indi_v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
 #endif
 
   // Add the increments to the actuators
@@ -656,17 +663,29 @@ void lms_estimation(void)
 
 #if STABILIZATION_INDI_ALLOCATION_PSEUDO_INVERSE
   // Calculate the inverse of (G1+G2)
+  calc_g1g2();
   calc_g1g2_pseudo_inv();
 #endif
 }
 
 /**
- * Function that calculates the pseudo-inverse of (G1+G2).
+ * Function that must be called after changing g1g2 (e.g. by scheduling),
+ * to update what the allocation derives from it.
  */
-void calc_g1g2_pseudo_inv(void)
+void stabilization_indi_g1g2_updated(void)
 {
+#if STABILIZATION_INDI_ALLOCATION_PSEUDO_INVERSE
+  calc_g1g2_pseudo_inv();
+#else
+  wls_cache_invalidate(&wls_cache);
+#endif
+}
 
-  //sum of G1 and G2
+/**
+ * Function that calculates the sum of G1 and G2.
+ */
+void calc_g1g2(void)
+{
   int8_t i;
   int8_t j;
   for (i = 0; i < INDI_OUTPUTS; i++) {
@@ -678,6 +697,14 @@ void calc_g1g2_pseudo_inv(void)
       }
     }
   }
+}
+
+/**
+ * Function that calculates the pseudo-inverse of (G1+G2).
+ */
+void calc_g1g2_pseudo_inv(void)
+{
+  int8_t i;
 
   //G1G2*transpose(G1G2)
   //calculate matrix multiplication of its transpose INDI_OUTPUTSxnum_act x num_actxINDI_OUTPUTS
@@ -109,7 +109,7 @@ void qr_solve_wrapper(int m, int n, float** A, float* b, float* x) {
  *
  * @return Number of iterations, -1 upon failure
  */
-int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
+static int wls_alloc_run(struct WlsCache* cache, float* u, float* v, float* umin, float* umax, float** B,
     float* u_guess, float* W_init, float* Wv, float* Wu, float* up,
     float gamma_sq, int imax) {
   // allocate variables, use defaults where parameters are set to 0
@@ -170,20 +170,45 @@ int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
     }
   }
 
-  // fill up A, A_free, b and d
+  // fill up A, unless it is already in the cache
+  if (cache && cache->valid) {
+    memcpy(A, cache->A, sizeof(A));
+  } else {
+    for (int i = 0; i < n_v; i++) {
+      for (int j = 0; j < n_u; j++) {
+        // If Wv is a NULL pointer, use Wv = identity
+        A[i][j] = Wv ? gamma_sq * Wv[i] * B[i][j] : gamma_sq * B[i][j];
+      }
+    }
+    for (int i = n_v; i < n_c; i++) {
+      memset(A[i], 0, n_u * sizeof(float));
+      A[i][i - n_v] = Wu ? Wu[i - n_v] : 1.0;
+    }
+    if (cache) {
+      // factorize A with all the controls free, as done by qr_solve
+      memcpy(cache->A, A, sizeof(A));
+      int k = 0;
+      for (int j = 0; j < n_u; j++) {
+        for (int i = 0; i < n_c; i++) {
+          cache->a_qr[k++] = A[i][j];
+        }
+      }
+      float tol = r8_epsilon() / r8mat_amax(n_c, n_u, cache->a_qr);
+      dqrank(cache->a_qr, n_c, n_c, n_u, tol, &cache->kr, cache->jpvt, cache->qraux);
+      cache->valid = true;
+    }
+  }
+
+  // fill up b and d
   for (int i = 0; i < n_v; i++) {
     // If Wv is a NULL pointer, use Wv = identity
     b[i] = Wv ? gamma_sq * Wv[i] * v[i] : gamma_sq * v[i];
     d[i] = b[i];
     for (int j = 0; j < n_u; j++) {
-      // If Wv is a NULL pointer, use Wv = identity
-      A[i][j] = Wv ? gamma_sq * Wv[i] * B[i][j] : gamma_sq * B[i][j];
       d[i] -= A[i][j] * u[j];
     }
   }
   for (int i = n_v; i < n_c; i++) {
-    memset(A[i], 0, n_u * sizeof(float));
-    A[i][i - n_v] = Wu ? Wu[i - n_v] : 1.0;
     b[i] = up ? (Wu ? Wu[i-n_v] * up[i-n_v] : up[i-n_v]) : 0;
     d[i] = b[i] - A[i][i - n_v] * u[i - n_v];
   }
@@ -205,7 +230,16 @@ int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
     }
 
 
-    if (n_free) {
+    if (cache && n_free == n_u) {
+      // All variables free, solve with the cached factorisation of A
+      // and reorder the solution as the free indices
+      float p_all[CA_N_U];
+      float rsd[CA_N_C];
+      dqrlss(cache->a_qr, n_c, n_c, n_u, cache->kr, d, p_all, rsd, cache->jpvt, cache->qraux);
+      for (int i = 0; i < n_free; i++) {
+        p_free[i] = p_all[free_index[i]];
+      }
+    } else if (n_free) {
       // Still free variables left, calculate corresponding solution
 
       // use a solver to find the solution to A_free*p_free = d
@@ -314,6 +348,18 @@ int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
   return -1;
 }
 
+int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
+    float* u_guess, float* W_init, float* Wv, float* Wu, float* up,
+    float gamma_sq, int imax) {
+  return wls_alloc_run(NULL, u, v, umin, umax, B, u_guess, W_init, Wv, Wu, up, gamma_sq, imax);
+}
+
+int wls_alloc_cached(struct WlsCache* cache, float* u, float* v, float* umin, float* umax, float** B,
+    float* u_guess, float* W_init, float* Wv, float* Wu, float* up,
+    float gamma_sq, int imax) {
+  return wls_alloc_run(cache, u, v, umin, umax, B, u_guess, W_init, Wv, Wu, up, gamma_sq, imax);
+}
+
 #if WLS_VERBOSE
 void print_in_and_outputs(int n_c, int n_free, float** A_free_ptr, float* d, float* p_free) {
 
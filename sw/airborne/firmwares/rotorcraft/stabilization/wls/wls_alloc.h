@@ -20,6 +20,26 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include "std.h"
+
+/**
+ * @brief Factorisation of the allocation problem with all the controls free
+ *
+ * The weighted matrix A = [gamma_sq Wv B; Wu] and its QR factorisation only
+ * depend on B and on the weights. When they are kept in a cache, the
+ * iterations with all the controls free (always the first one, and the
+ * only one when nothing saturates) just solve with the stored factors.
+ * The cache must be invalidated when B or the weights change.
+ */
+struct WlsCache {
+  float A[CA_N_U + CA_N_V][CA_N_U];       ///< weighted matrix
+  float a_qr[(CA_N_U + CA_N_V) * CA_N_U]; ///< QR factors of A (dqrdc format)
+  float qraux[CA_N_U];
+  int jpvt[CA_N_U];
+  int kr;                                 ///< numerical rank of A
+  bool valid;
+};
+
 /**
  * @brief Wrapper for qr solve
  *
@@ -59,3 +79,24 @@ void qr_solve_wrapper(int m, int n, float** A, float* b, float* x);
 int wls_alloc(float* u, float* v, float* umin, float* umax, float** B,
               float* u_guess, float* W_init, float* Wv, float* Wu,
               float* ud, float gamma, int imax);
+
+/**
+ * @brief active set algorithm for control allocation, with a cached factorisation
+ *
+ * Same as wls_alloc, the matrix A and its factorisation are computed from B
+ * and the weights only if the cache is not valid.
+ *
+ * @param cache The cache of the factorisation
+ *
+ * @return Number of iterations, -1 upon failure
+ */
+int wls_alloc_cached(struct WlsCache* cache, float* u, float* v, float* umin, float* umax, float** B,
+                     float* u_guess, float* W_init, float* Wv, float* Wu,
+                     float* ud, float gamma, int imax);
+
+/**
+ * @brief Invalidate the cache, to be called when B or the weights change
+ */
+static inline void wls_cache_invalidate(struct WlsCache* cache) {
+  cache->valid = false;
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_geodetic_batch.c
+ * @brief Geodetic conversions of arrays of points.
+ *
+ * For a point at (lat, lon, alt) and a reference at (lat0, lon0, alt0),
+ * with dlat = lat - lat0, dlon = lon - lon0, N the prime vertical radius
+ * and e2 the first eccentricity squared, the ENU coordinates are:
+ *
+ *   east  = (N + alt) cos(lat) sin(dlon)
+ *   north = (N + alt) (sin(dlat) + sin(lat0) cos(lat) (1 - cos(dlon)))
+ *           - e2 cos(lat0) (N sin(lat) - N0 sin(lat0))
+ *   up    = (N - N0) + (alt - alt0)
+ *           - (N + alt) ((1 - cos(dlat)) + cos(lat0) cos(lat) (1 - cos(dlon)))
+ *           - e2 sin(lat0) (N sin(lat) - N0 sin(lat0))
+ *
+ * All the differences are computed directly from the angle differences,
+ * so no large numbers are subtracted.
+ */
+
+#include "math/pprz_geodetic_batch.h"
+#include <math.h>
+
+// FIXME : make an ellipsoid struct
+#define BATCH_WGS84_A 6378137.0               /* earth semimajor axis in meters */
+#define BATCH_WGS84_F (1. / 298.257223563)    /* reciprocal flattening          */
+#define BATCH_WGS84_E2 (2. * BATCH_WGS84_F - BATCH_WGS84_F * BATCH_WGS84_F)
+
+/** Number of Bowring iterations in lla_of_ecef_batch_f/_d */
+#define BATCH_BOWRING_ITER 2
+
+void ltp_batch_def_from_lla_f(struct LtpBatchDef_f *def, struct LlaCoor_f *lla)
+{
+  def->lat0 = lla->lat;
+  def->lon0 = lla->lon;
+  def->alt0 = lla->alt;
+  def->sin_lat0 = sinf(lla->lat);
+  def->cos_lat0 = cosf(lla->lat);
+  def->chi0 = sqrtf(1.f - (float)BATCH_WGS84_E2 * def->sin_lat0 * def->sin_lat0);
+  def->n0 = (float)BATCH_WGS84_A / def->chi0;
+}
+
+void ltp_batch_def_from_lla_d(struct LtpBatchDef_d *def, struct LlaCoor_d *lla)
+{
+  def->lat0 = lla->lat;
+  def->lon0 = lla->lon;
+  def->alt0 = lla->alt;
+  def->sin_lat0 = sin(lla->lat);
+  def->cos_lat0 = cos(lla->lat);
+  def->chi0 = sqrt(1. - BATCH_WGS84_E2 * def->sin_lat0 * def->sin_lat0);
+  def->n0 = BATCH_WGS84_A / def->chi0;
+
+  struct LtpDef_d ltp;
+  ltp_def_from_lla_d(&ltp, lla);
+  VECT3_COPY(def->ecef0, ltp.ecef);
+  RMAT_COPY(def->ltp_of_ecef, ltp.ltp_of_ecef);
+}
+
+/** Longitude difference wrapped to [-pi, pi]
+ *  2pi is split in a float part and a residual so that the wrap
+ *  does not lose the resolution of the difference near the 180deg meridian
+ */
+static inline float wrap_dlon_f(float lon, float lon0)
+{
+  const float two_pi_hi = 6.28318548202514648f;
+  const float two_pi_lo = -1.74845553e-07f;
+  const float k = rintf((lon - lon0) * (float)(1. / (2. * M_PI)));
+  return ((lon - k * two_pi_hi) - lon0) - k * two_pi_lo;
+}
+
+/** Common part of the float LLA to ENU kernels,
+ *  from the sine and cosine of the half angle differences
+ */
+static inline void enu_of_half_angles_f(float *east, float *north, float *up,
+                                        const struct LtpBatchDef_f *def, float alt,
+                                        float s_dlat2, float c_dlat2, float s_dlon2, float c_dlon2)
+{
+  const float e2 = (float)BATCH_WGS84_E2;
+  const float sin_dlat = 2.f * s_dlat2 * c_dlat2;
+  const float omc_dlat = 2.f * s_dlat2 * s_dlat2;   // 1 - cos(dlat)
+  const float sin_dlon = 2.f * s_dlon2 * c_dlon2;
+  const float omc_dlon = 2.f * s_dlon2 * s_dlon2;   // 1 - cos(dlon)
+
+  // sin(lat) - sin(lat0) and cos(lat) from the reference
+  const float dsin_lat = def->cos_lat0 * sin_dlat - def->sin_lat0 * omc_dlat;
+  const float sin_lat = def->sin_lat0 + dsin_lat;
+  const float cos_lat = def->cos_lat0 * (1.f - omc_dlat) - def->sin_lat0 * sin_dlat;
+
+  const float chi = sqrtf(1.f - e2 * sin_lat * sin_lat);
+  const float n = (float)BATCH_WGS84_A / chi;
+  // N - N0 without cancellation
+  const float dn = (float)BATCH_WGS84_A * e2 * dsin_lat * (sin_lat + def->sin_lat0) /
+                   (chi * def->chi0 * (chi + def->chi0));
+  const float nh = n + alt;
+  // N sin(lat) - N0 sin(lat0)
+  const float dnsin = dn * sin_lat + def->n0 * dsin_lat;
+
+  *east = nh * cos_lat * sin_dlon;
+  *north = nh * (sin_dlat + def->sin_lat0 * cos_lat * omc_dlon) - e2 * def->cos_lat0 * dnsin;
+  *up = dn + (alt - def->alt0) - nh * (omc_dlat + def->cos_lat0 * cos_lat * omc_dlon)
+        - e2 * def->sin_lat0 * dnsin;
+}
+
+void enu_of_lla_batch_f(struct Vect3Array_f *enu, struct LtpBatchDef_f *def,
+                        struct LlaArray_f *lla, uint32_t n)
+{
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    const float dlat2 = (lla->lat[i] - def->lat0) * 0.5f;
+    const float dlon2 = wrap_dlon_f(lla->lon[i], def->lon0) * 0.5f;
+    enu_of_half_angles_f(&enu->x[i], &enu->y[i], &enu->z[i], def, lla->alt[i],
+                         sinf(dlat2), cosf(dlat2), sinf(dlon2), cosf(dlon2));
+  }
+}
+
+void enu_of_lla_batch_fast_f(struct Vect3Array_f *enu, struct LtpBatchDef_f *def,
+                             struct LlaArray_f *lla, uint32_t n)
+{
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    // half angles are below 0.025 rad, truncation error of the series below 1e-13
+    const float x = (lla->lat[i] - def->lat0) * 0.5f;
+    const float y = wrap_dlon_f(lla->lon[i], def->lon0) * 0.5f;
+    const float x2 = x * x;
+    const float y2 = y * y;
+    const float s_x = x * (1.f - x2 * (1.f / 6.f) * (1.f - x2 * (1.f / 20.f)));
+    const float c_x = 1.f - x2 * 0.5f * (1.f - x2 * (1.f / 12.f));
+    const float s_y = y * (1.f - y2 * (1.f / 6.f) * (1.f - y2 * (1.f / 20.f)));
+    const float c_y = 1.f - y2 * 0.5f * (1.f - y2 * (1.f / 12.f));
+    enu_of_half_angles_f(&enu->x[i], &enu->y[i], &enu->z[i], def, lla->alt[i], s_x, c_x, s_y, c_y);
+  }
+}
+
+void enu_of_lla_batch_d(struct Vect3Array_d *enu, struct LtpBatchDef_d *def,
+                        struct LlaArray_d *lla, uint32_t n)
+{
+  const double e2 = BATCH_WGS84_E2;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    const double dlat = lla->lat[i] - def->lat0;
+    const double dlon = lla->lon[i] - def->lon0;
+    const double sin_dlat = sin(dlat);
+    const double omc_dlat = 2. * sin(dlat * 0.5) * sin(dlat * 0.5);
+    const double sin_dlon = sin(dlon);
+    const double omc_dlon = 2. * sin(dlon * 0.5) * sin(dlon * 0.5);
+
+    const double dsin_lat = def->cos_lat0 * sin_dlat - def->sin_lat0 * omc_dlat;
+    const double sin_lat = def->sin_lat0 + dsin_lat;
+    const double cos_lat = def->cos_lat0 * (1. - omc_dlat) - def->sin_lat0 * sin_dlat;
+
+    const double chi = sqrt(1. - e2 * sin_lat * sin_lat);
+    const double dn = BATCH_WGS84_A * e2 * dsin_lat * (sin_lat + def->sin_lat0) /
+                      (chi * def->chi0 * (chi + def->chi0));
+    const double nh = BATCH_WGS84_A / chi + lla->alt[i];
+    const double dnsin = dn * sin_lat + def->n0 * dsin_lat;
+
+    enu->x[i] = nh * cos_lat * sin_dlon;
+    enu->y[i] = nh * (sin_dlat + def->sin_lat0 * cos_lat * omc_dlon) - e2 * def->cos_lat0 * dnsin;
+    enu->z[i] = dn + (lla->alt[i] - def->alt0) - nh * (omc_dlat + def->cos_lat0 * cos_lat * omc_dlon)
+                - e2 * def->sin_lat0 * dnsin;
+  }
+}
+
+void enu_of_ecef_batch_d(struct Vect3Array_d *enu, struct LtpBatchDef_d *def,
+                         struct Vect3Array_d *ecef, uint32_t n)
+{
+  const double *m = def->ltp_of_ecef.m;
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    const double dx = ecef->x[i] - def->ecef0.x;
+    const double dy = ecef->y[i] - def->ecef0.y;
+    const double dz = ecef->z[i] - def->ecef0.z;
+    enu->x[i] = m[0] * dx + m[1] * dy;
+    enu->y[i] = m[3] * dx + m[4] * dy + m[5] * dz;
+    enu->z[i] = m[6] * dx + m[7] * dy + m[8] * dz;
+  }
+}
+
+void lla_of_ecef_batch_d(struct LlaArray_d *lla, struct Vect3Array_d *ecef, uint32_t n)
+{
+  const double a = BATCH_WGS84_A;
+  const double b = a * (1. - BATCH_WGS84_F);
+  const double e2 = BATCH_WGS84_E2;
+  const double ep2 = e2 / (1. - e2);
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    const double z = ecef->z[i];
+    const double p = sqrt(ecef->x[i] * ecef->x[i] + ecef->y[i] * ecef->y[i]);
+    // parametric latitude as (num, den) pair, initial guess from a sphere
+    double num_b = a * z;
+    double den_b = b * p;
+    double num_lat = 0., den_lat = 1.;
+    int k;
+    for (k = 0; k < BATCH_BOWRING_ITER; k++) {
+      const double inv = 1. / sqrt(num_b * num_b + den_b * den_b);
+      const double sb = num_b * inv;
+      const double cb = den_b * inv;
+      num_lat = z + ep2 * b * sb * sb * sb;
+      den_lat = p - e2 * a * cb * cb * cb;
+      // tan(beta) = (1 - f) tan(lat)
+      num_b = b * num_lat;
+      den_b = a * den_lat;
+    }
+    const double inv = 1. / sqrt(num_lat * num_lat + den_lat * den_lat);
+    const double sin_lat = num_lat * inv;
+    const double cos_lat = den_lat * inv;
+    lla->lat[i] = atan2(num_lat, den_lat);
+    lla->lon[i] = atan2(ecef->y[i], ecef->x[i]);
+    lla->alt[i] = p * cos_lat + z * sin_lat - a * sqrt(1. - e2 * sin_lat * sin_lat);
+  }
+}
+
+void lla_of_ecef_batch_f(struct LlaArray_f *lla, struct Vect3Array_f *ecef, uint32_t n)
+{
+  const float a = (float)BATCH_WGS84_A;
+  const float b = (float)(BATCH_WGS84_A * (1. - BATCH_WGS84_F));
+  const float e2 = (float)BATCH_WGS84_E2;
+  const float ep2 = (float)(BATCH_WGS84_E2 / (1. - BATCH_WGS84_E2));
+  uint32_t i;
+  for (i = 0; i < n; i++) {
+    const float z = ecef->z[i];
+    const float p = sqrtf(ecef->x[i] * ecef->x[i] + ecef->y[i] * ecef->y[i]);
+    // same iteration as lla_of_ecef_batch_d, pairs are normalised by a
+    // so that the squares stay within float range
+    float num_b = z;
+    float den_b = (1.f - (float)BATCH_WGS84_F) * p;
+    float num_lat = 0.f, den_lat = 1.f;
+    int k;
+    for (k = 0; k < BATCH_BOWRING_ITER; k++) {
+      const float inv = 1.f / sqrtf(num_b * num_b + den_b * den_b);
+      const float sb = num_b * inv;
+      const float cb = den_b * inv;
+      num_lat = z + ep2 * b * sb * sb * sb;
+      den_lat = p - e2 * a * cb * cb * cb;
+      num_b = (1.f - (float)BATCH_WGS84_F) * num_lat;
+      den_b = den_lat;
+    }
+    const float inv = 1.f / sqrtf(num_lat * num_lat + den_lat * den_lat);
+    const float sin_lat = num_lat * inv;
+    const float cos_lat = den_lat * inv;
+    lla->lat[i] = atan2f(num_lat, den_lat);
+    lla->lon[i] = atan2f(ecef->y[i], ecef->x[i]);
+    lla->alt[i] = p * cos_lat + z * sin_lat - a * sqrtf(1.f - e2 * sin_lat * sin_lat);
+  }
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_geodetic_batch.h
+ * @brief Geodetic conversions of arrays of points.
+ *
+ * Points are passed as structure of arrays (one array per coordinate)
+ * so that the loops can be vectorised by the compiler.
+ * The local tangent plane reference terms are computed once
+ * in a LtpBatchDef and shared by all the points.
+ *
+ * The LLA to ENU kernels are written relative to the reference
+ * (latitude and longitude differences), which avoids the cancellation
+ * of large ECEF coordinates and makes the float version usable
+ * without going through doubles.
+ *
+ * @addtogroup math_geodetic
+ * @{
+ * @addtogroup math_geodetic_batch Batch geodetic functions
+ * @{
+ */
+
+#ifndef PPRZ_GEODETIC_BATCH_H
+#define PPRZ_GEODETIC_BATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+#include "math/pprz_geodetic_float.h"
+#include "math/pprz_geodetic_double.h"
+
+/** Max latitude/longitude difference to the reference (rad)
+ *  for which the fast kernels keep their error bound.
+ *  0.05 rad is about 300km at the equator.
+ */
+#define GEODETIC_BATCH_FAST_MAX_ANGLE 0.05f
+
+/** Array of LLA points (float) */
+struct LlaArray_f {
+  float *lat;   ///< in radians
+  float *lon;   ///< in radians
+  float *alt;   ///< in meters above WGS84 reference ellipsoid
+};
+
+/** Array of LLA points (double) */
+struct LlaArray_d {
+  double *lat;  ///< in radians
+  double *lon;  ///< in radians
+  double *alt;  ///< in meters above WGS84 reference ellipsoid
+};
+
+/** Array of cartesian points (float), ENU or ECEF */
+struct Vect3Array_f {
+  float *x;
+  float *y;
+  float *z;
+};
+
+/** Array of cartesian points (double), ENU or ECEF */
+struct Vect3Array_d {
+  double *x;
+  double *y;
+  double *z;
+};
+
+/** Reference terms of a local tangent plane (float) */
+struct LtpBatchDef_f {
+  float lat0;       ///< reference latitude (rad)
+  float lon0;       ///< reference longitude (rad)
+  float alt0;       ///< reference altitude (m)
+  float sin_lat0;
+  float cos_lat0;
+  float chi0;       ///< sqrt(1 - e^2 sin^2(lat0))
+  float n0;         ///< prime vertical radius of curvature at lat0
+};
+
+/** Reference terms of a local tangent plane (double) */
+struct LtpBatchDef_d {
+  double lat0;      ///< reference latitude (rad)
+  double lon0;      ///< reference longitude (rad)
+  double alt0;      ///< reference altitude (m)
+  double sin_lat0;
+  double cos_lat0;
+  double chi0;      ///< sqrt(1 - e^2 sin^2(lat0))
+  double n0;        ///< prime vertical radius of curvature at lat0
+  struct EcefCoor_d ecef0;        ///< reference in ECEF
+  struct DoubleRMat ltp_of_ecef;  ///< rotation from ECEF to ENU
+};
+
+extern void ltp_batch_def_from_lla_f(struct LtpBatchDef_f *def, struct LlaCoor_f *lla);
+extern void ltp_batch_def_from_lla_d(struct LtpBatchDef_d *def, struct LlaCoor_d *lla);
+
+/** ENU of LLA points (float)
+ *  Uses libm trigonometry, valid for any distance to the reference.
+ */
+extern void enu_of_lla_batch_f(struct Vect3Array_f *enu, struct LtpBatchDef_f *def,
+                               struct LlaArray_f *lla, uint32_t n);
+
+/** ENU of LLA points (float), fast version
+ *  Trigonometric functions of the differences to the reference are replaced
+ *  by polynomials, the loop only contains arithmetic and sqrtf.
+ *  Only valid for latitude and longitude differences to the reference
+ *  below GEODETIC_BATCH_FAST_MAX_ANGLE (the longitude difference is wrapped
+ *  to +-pi first, so the reference may be close to the 180deg meridian), where the polynomial error is
+ *  below 1e-3m and the result is as accurate as enu_of_lla_batch_f
+ *  (within 0.1m of the double version, against about 1.5m for enu_of_lla_point_f).
+ */
+extern void enu_of_lla_batch_fast_f(struct Vect3Array_f *enu, struct LtpBatchDef_f *def,
+                                    struct LlaArray_f *lla, uint32_t n);
+
+/** ENU of LLA points (double) */
+extern void enu_of_lla_batch_d(struct Vect3Array_d *enu, struct LtpBatchDef_d *def,
+                               struct LlaArray_d *lla, uint32_t n);
+
+/** ENU of ECEF points (double) */
+extern void enu_of_ecef_batch_d(struct Vect3Array_d *enu, struct LtpBatchDef_d *def,
+                                struct Vect3Array_d *ecef, uint32_t n);
+
+/** LLA of ECEF points (double)
+ *  Uses a fixed number of Bowring iterations on the latitude,
+ *  computed on sine/cosine pairs so that only the final angles need atan2.
+ *  Error is below 1e-9 rad and 1e-4 m for altitudes within +-100km
+ *  of the ellipsoid.
+ */
+extern void lla_of_ecef_batch_d(struct LlaArray_d *lla, struct Vect3Array_d *ecef, uint32_t n);
+
+/** LLA of ECEF points (float)
+ *  Same kernel as lla_of_ecef_batch_d. Accuracy is limited by the float
+ *  resolution of the ECEF input (about 0.5m at the earth surface).
+ */
+extern void lla_of_ecef_batch_f(struct LlaArray_f *lla, struct Vect3Array_f *ecef, uint32_t n);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_GEODETIC_BATCH_H */
+/** @}*/
+/** @}*/
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_geodetic_geoid.c
+ * @brief Geoid separation from a regular lat/lon grid.
+ */
+
+#include "math/pprz_geodetic_geoid.h"
+#include "math/pprz_algebra_float.h"
+
+#define GEOID_GRID_ONE (1 << GEOID_GRID_FRAC_BITS)
+
+int32_t geoid_grid_get_i(const struct GeoidGrid *g, int32_t lat, int32_t lon)
+{
+  const uint32_t step = (uint32_t)g->step;
+  const uint32_t frac_div = step >> GEOID_GRID_FRAC_BITS;
+
+  // row and fraction, clamped to the poles
+  int32_t y = lat + 900000000;
+  Bound(y, 0, (int32_t)(step * (g->nb_lat - 1)) - 1);
+  uint16_t iy = (uint32_t)y / step;
+  int32_t fy = ((uint32_t)y % step) / frac_div;
+  BoundUpper(fy, GEOID_GRID_ONE);
+
+  // column and fraction, wrapping around at 180deg
+  uint32_t x = (uint32_t)lon + 1800000000u;
+  uint16_t ix = (x / step) % g->nb_lon;
+  int32_t fx = (x % step) / frac_div;
+  BoundUpper(fx, GEOID_GRID_ONE);
+  uint16_t ix2 = (ix + 1 == g->nb_lon) ? 0 : ix + 1;
+
+  const int16_t *r0 = &g->data[iy * g->nb_lon];
+  const int16_t *r1 = r0 + g->nb_lon;
+  // interpolate along the rows, in cm * GEOID_GRID_ONE (no shift of negative heights)
+  int32_t h0 = r0[ix] * GEOID_GRID_ONE + (r0[ix2] - r0[ix]) * fx;
+  int32_t h1 = r1[ix] * GEOID_GRID_ONE + (r1[ix2] - r1[ix]) * fx;
+  int32_t h = h0 + (int32_t)(((int64_t)(h1 - h0) * fy) >> GEOID_GRID_FRAC_BITS);
+  // cm << FRAC_BITS to mm, rounded
+  return (h * 10 + (GEOID_GRID_ONE / 2)) >> GEOID_GRID_FRAC_BITS;
+}
+
+float geoid_grid_get_f(const struct GeoidGrid *g, float lat, float lon)
+{
+  int32_t lat_i = (int32_t)(DegOfRad(lat) * 1e7f);
+  int32_t lon_i = (int32_t)(DegOfRad(lon) * 1e7f);
+  return (float)geoid_grid_get_i(g, lat_i, lon_i) / 1000.f;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_geodetic_geoid.h
+ * @brief Geoid separation from a regular lat/lon grid.
+ *
+ * The grid is generated from the EGM96 model bundled in data/srtm
+ * by sw/tools/generators/gen_geoid.py, with a configurable resolution.
+ * Lookup is a constant time bilinear interpolation in fixed point,
+ * so that the same code can be used on board and in host tools.
+ *
+ * @addtogroup math_geodetic
+ * @{
+ * @addtogroup math_geodetic_geoid Geoid grid
+ * @{
+ */
+
+#ifndef PPRZ_GEODETIC_GEOID_H
+#define PPRZ_GEODETIC_GEOID_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+
+/** Number of bits of the interpolation coefficients */
+#define GEOID_GRID_FRAC_BITS 10
+
+/** Geoid separation grid
+ *  Rows go from south (-90deg) to north (+90deg),
+ *  columns from west (-180deg) eastward, wrapping around.
+ */
+struct GeoidGrid {
+  const int16_t *data;  ///< geoid separation in cm, nb_lat rows of nb_lon values
+  uint16_t nb_lat;      ///< number of rows, (180deg / step) + 1
+  uint16_t nb_lon;      ///< number of columns, 360deg / step
+  int32_t step;         ///< grid step in 1e7deg
+};
+
+/** Get ellipsoid/geoid separation.
+ * @param[in] g geoid grid
+ * @param[in] lat Latitude in 1e7deg
+ * @param[in] lon Longitude in 1e7deg
+ * @return geoid separation in mm
+ */
+extern int32_t geoid_grid_get_i(const struct GeoidGrid *g, int32_t lat, int32_t lon);
+
+/** Get ellipsoid/geoid separation.
+ * @param[in] g geoid grid
+ * @param[in] lat Latitude in rad
+ * @param[in] lon Longitude in rad
+ * @return geoid separation in m
+ */
+extern float geoid_grid_get_f(const struct GeoidGrid *g, float lat, float lon);
+
+/** Geoid grid of the aircraft, provided by the geoid module
+ *  (or by the application for host tools)
+ */
+extern const struct GeoidGrid geoid_grid;
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_GEODETIC_GEOID_H */
+/** @}*/
+/** @}*/
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_geodetic_mag_tile.c
+ * @brief Cached local tile of the WMM2020 geomagnetic field.
+ */
+
+#include "math/pprz_geodetic_mag_tile.h"
+
+#define MAG_TILE_IDX(_ia, _ilat, _ilon) (((_ia) * MAG_TILE_NB_LAT + (_ilat)) * MAG_TILE_NB_LON + (_ilon))
+
+void mag_tile_service_init(struct MagTileService *s, double sdate)
+{
+  s->tile[0].valid = false;
+  s->tile[1].valid = false;
+  s->active = 0;
+  s->next_node = 0;
+  s->building = false;
+  s->nb_evals = 0;
+  s->nb_swaps = 0;
+  s->nmax = extrapsh(sdate, GEO_EPOCH, NMAX_1, NMAX_2, s->gh);
+}
+
+bool mag_tile_service_request(struct MagTileService *s, double lat, double lon, double alt)
+{
+  if (s->building) {
+    return false;
+  }
+  struct MagTile *t = &s->tile[s->active ^ 1];
+  t->valid = false;
+  t->dlat = MAG_TILE_SPAN_LAT / (MAG_TILE_NB_LAT - 1);
+  t->dlon = MAG_TILE_SPAN_LON / (MAG_TILE_NB_LON - 1);
+  t->dalt = MAG_TILE_SPAN_ALT / (MAG_TILE_NB_ALT - 1);
+  t->lat0 = lat - MAG_TILE_SPAN_LAT / 2.;
+  t->lon0 = lon - MAG_TILE_SPAN_LON / 2.;
+  t->alt0 = alt - MAG_TILE_SPAN_ALT / 2.;
+  s->next_node = 0;
+  s->building = true;
+  return true;
+}
+
+bool mag_tile_service_step(struct MagTileService *s, uint16_t max_nodes)
+{
+  if (!s->building) {
+    return false;
+  }
+  struct MagTile *t = &s->tile[s->active ^ 1];
+  uint16_t n;
+  for (n = 0; n < max_nodes && s->next_node < MAG_TILE_NB_NODES; n++, s->next_node++) {
+    uint16_t ilon = s->next_node % MAG_TILE_NB_LON;
+    uint16_t ilat = (s->next_node / MAG_TILE_NB_LON) % MAG_TILE_NB_LAT;
+    uint16_t ia = s->next_node / (MAG_TILE_NB_LON * MAG_TILE_NB_LAT);
+    double x, y, z;
+    mag_calc(1, t->lat0 + ilat * t->dlat, t->lon0 + ilon * t->dlon, t->alt0 + ia * t->dalt,
+             s->nmax, s->gh, &x, &y, &z, IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+    VECT3_ASSIGN(t->node[s->next_node], x, y, z);
+    s->nb_evals++;
+  }
+  if (s->next_node < MAG_TILE_NB_NODES) {
+    return false;
+  }
+  // tile complete, swap
+  t->valid = true;
+  s->active ^= 1;
+  s->building = false;
+  s->nb_swaps++;
+  return true;
+}
+
+bool mag_tile_contains(const struct MagTile *t, double lat, double lon, double alt, float margin)
+{
+  if (!t->valid) {
+    return false;
+  }
+  double half_lat = MAG_TILE_SPAN_LAT / 2.;
+  double half_lon = MAG_TILE_SPAN_LON / 2.;
+  double half_alt = MAG_TILE_SPAN_ALT / 2.;
+  return (fabs(lat - (t->lat0 + half_lat)) <= margin * half_lat &&
+          fabs(lon - (t->lon0 + half_lon)) <= margin * half_lon &&
+          fabs(alt - (t->alt0 + half_alt)) <= margin * half_alt);
+}
+
+/** Grid cell index and fractional position along one axis, clamped to the tile */
+static inline uint16_t mag_tile_cell(double x, float dx, uint16_t nb, float *frac)
+{
+  float u = (float)x / dx;
+  if (u <= 0.f) {
+    *frac = 0.f;
+    return 0;
+  }
+  if (u >= (float)(nb - 1)) {
+    *frac = 1.f;
+    return nb - 2;
+  }
+  uint16_t i = (uint16_t)u;
+  *frac = u - (float)i;
+  return i;
+}
+
+bool mag_tile_get_field(const struct MagTile *t, double lat, double lon, double alt, struct FloatVect3 *field)
+{
+  return mag_tile_get_field_grad(t, lat, lon, alt, field, NULL);
+}
+
+bool mag_tile_get_field_grad(const struct MagTile *t, double lat, double lon, double alt,
+                             struct FloatVect3 *field, struct FloatVect3 *grad)
+{
+  if (!t->valid) {
+    return false;
+  }
+  float fa, flat, flon;
+  uint16_t ia = mag_tile_cell(alt - t->alt0, t->dalt, MAG_TILE_NB_ALT, &fa);
+  uint16_t ilat = mag_tile_cell(lat - t->lat0, t->dlat, MAG_TILE_NB_LAT, &flat);
+  uint16_t ilon = mag_tile_cell(lon - t->lon0, t->dlon, MAG_TILE_NB_LON, &flon);
+
+  // derivatives of the interpolation along each axis, in nT per grid cell
+  struct FloatVect3 d_alt, d_lat, d_lon;
+  FLOAT_VECT3_ZERO(*field);
+  FLOAT_VECT3_ZERO(d_alt);
+  FLOAT_VECT3_ZERO(d_lat);
+  FLOAT_VECT3_ZERO(d_lon);
+  uint8_t c;
+  for (c = 0; c < 8; c++) {
+    uint8_t da = (c >> 2) & 1, dlat = (c >> 1) & 1, dlon = c & 1;
+    float wa = da ? fa : 1.f - fa;
+    float wlat = dlat ? flat : 1.f - flat;
+    float wlon = dlon ? flon : 1.f - flon;
+    const struct FloatVect3 *n = &t->node[MAG_TILE_IDX(ia + da, ilat + dlat, ilon + dlon)];
+    VECT3_ADD_SCALED(*field, *n, wa * wlat * wlon);
+    if (grad != NULL) {
+      VECT3_ADD_SCALED(d_alt, *n, (da ? 1.f : -1.f) * wlat * wlon);
+      VECT3_ADD_SCALED(d_lat, *n, (dlat ? 1.f : -1.f) * wa * wlon);
+      VECT3_ADD_SCALED(d_lon, *n, (dlon ? 1.f : -1.f) * wa * wlat);
+    }
+  }
+  if (grad != NULL) {
+    // cell sizes in meters, spherical earth of the model reference radius
+    const float m_lat = RadOfDeg(t->dlat) * MAG_TILE_EARTH_RADIUS;
+    const float m_lon = RadOfDeg(t->dlon) * MAG_TILE_EARTH_RADIUS * cosf(RadOfDeg((float)lat));
+    const float m_alt = t->dalt * 1000.f;
+    VECT3_SDIV(grad[0], d_lat, m_lat);
+    if (fabsf(m_lon) > 1.f) {
+      VECT3_SDIV(grad[1], d_lon, m_lon);
+    } else {
+      FLOAT_VECT3_ZERO(grad[1]);
+    }
+    VECT3_SDIV(grad[2], d_alt, -m_alt);
+  }
+  return true;
+}
+
+bool mag_tile_service_get_field(struct MagTileService *s, double lat, double lon, double alt,
+                                struct FloatVect3 *field)
+{
+  const struct MagTile *t = &s->tile[s->active];
+  if (!mag_tile_contains(t, lat, lon, alt, MAG_TILE_MARGIN)) {
+    mag_tile_service_request(s, lat, lon, alt);
+  }
+  if (!mag_tile_contains(t, lat, lon, alt, 1.f)) {
+    return false;
+  }
+  return mag_tile_get_field(t, lat, lon, alt, field);
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_geodetic_mag_tile.h
+ * @brief Cached local tile of the WMM2020 geomagnetic field.
+ *
+ * The full spherical harmonic expansion (mag_calc) is evaluated on a small
+ * lat/lon/alt grid around the current position. Lookups are then done
+ * by trilinear interpolation in constant time.
+ * A new tile is built in the background, a few grid nodes per call,
+ * and swapped in when complete, so that the field never goes stale
+ * on long range flights.
+ *
+ * Units are the same as for mag_calc:
+ * latitude and longitude in decimal degrees, altitude in km,
+ * field in nT (north, east, down).
+ * The spatial gradient of the field is given by the derivative of the
+ * interpolation, in nT/m along north, east and down.
+ *
+ * @addtogroup math_geodetic
+ * @{
+ * @addtogroup math_geodetic_wmm
+ * @{
+ */
+
+#ifndef PPRZ_GEODETIC_MAG_TILE_H
+#define PPRZ_GEODETIC_MAG_TILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+#include "math/pprz_algebra_float.h"
+#include "math/pprz_geodetic_wmm2020.h"
+
+/** Number of grid nodes along latitude */
+#ifndef MAG_TILE_NB_LAT
+#define MAG_TILE_NB_LAT 3
+#endif
+
+/** Number of grid nodes along longitude */
+#ifndef MAG_TILE_NB_LON
+#define MAG_TILE_NB_LON 3
+#endif
+
+/** Number of grid nodes along altitude */
+#ifndef MAG_TILE_NB_ALT
+#define MAG_TILE_NB_ALT 2
+#endif
+
+/** Latitude extent of a tile in degrees */
+#ifndef MAG_TILE_SPAN_LAT
+#define MAG_TILE_SPAN_LAT 1.
+#endif
+
+/** Longitude extent of a tile in degrees */
+#ifndef MAG_TILE_SPAN_LON
+#define MAG_TILE_SPAN_LON 1.
+#endif
+
+/** Altitude extent of a tile in km */
+#ifndef MAG_TILE_SPAN_ALT
+#define MAG_TILE_SPAN_ALT 4.
+#endif
+
+/** Fraction of the half span from the tile center
+ *  beyond which a new tile is requested
+ */
+#ifndef MAG_TILE_MARGIN
+#define MAG_TILE_MARGIN 0.5
+#endif
+
+/** Earth radius used to convert the gradient to nT/m (WMM reference radius, m) */
+#define MAG_TILE_EARTH_RADIUS 6371200.f
+
+#define MAG_TILE_NB_NODES (MAG_TILE_NB_LAT * MAG_TILE_NB_LON * MAG_TILE_NB_ALT)
+
+/** Field sampled on a regular lat/lon/alt grid */
+struct MagTile {
+  double lat0;        ///< latitude of the south edge (deg)
+  double lon0;        ///< longitude of the west edge (deg)
+  double alt0;        ///< altitude of the lower edge (km)
+  float dlat;         ///< grid spacing in latitude (deg)
+  float dlon;         ///< grid spacing in longitude (deg)
+  float dalt;         ///< grid spacing in altitude (km)
+  struct FloatVect3 node[MAG_TILE_NB_NODES];  ///< field at grid nodes (nT), alt major, then lat, then lon
+  bool valid;
+};
+
+/** Double buffered tile cache */
+struct MagTileService {
+  struct MagTile tile[2];
+  uint8_t active;           ///< index of the tile used for lookups
+  uint16_t next_node;       ///< next node to evaluate in the tile being built
+  bool building;            ///< true while a new tile is being built
+  double gh[MAXCOEFF];      ///< WMM coefficients extrapolated to the current date
+  int16_t nmax;             ///< max degree of the expansion
+  uint32_t nb_evals;        ///< total number of mag_calc calls
+  uint32_t nb_swaps;        ///< total number of completed tiles
+};
+
+/** Initialize the tile service for a given date
+ * @param s tile service
+ * @param sdate date in decimal year
+ */
+extern void mag_tile_service_init(struct MagTileService *s, double sdate);
+
+/** Request a new tile centered on a position
+ *  Does nothing if a tile is already being built.
+ * @return true if a new tile build was started
+ */
+extern bool mag_tile_service_request(struct MagTileService *s, double lat, double lon, double alt);
+
+/** Evaluate at most max_nodes grid nodes of the tile being built
+ * @return true if a new tile was completed and is now active
+ */
+extern bool mag_tile_service_step(struct MagTileService *s, uint16_t max_nodes);
+
+/** Get the interpolated field at a position from the active tile
+ *  A new tile is requested when the position gets close to the tile edge
+ *  (see MAG_TILE_MARGIN).
+ * @param field output field (nT)
+ * @return false if no valid tile covers the position
+ */
+extern bool mag_tile_service_get_field(struct MagTileService *s, double lat, double lon, double alt,
+                                       struct FloatVect3 *field);
+
+/** Check if a position is within a given fraction of the half span from the tile center */
+extern bool mag_tile_contains(const struct MagTile *t, double lat, double lon, double alt, float margin);
+
+/** Trilinear interpolation of the field inside a tile
+ *  Positions outside the tile are clamped to its boundary.
+ * @param field output field (nT)
+ * @return false if the tile is not valid
+ */
+extern bool mag_tile_get_field(const struct MagTile *t, double lat, double lon, double alt, struct FloatVect3 *field);
+
+/** Trilinear interpolation of the field and its gradient inside a tile
+ *  The gradient is constant inside a grid cell.
+ *  Positions outside the tile are clamped to its boundary.
+ * @param field output field (nT)
+ * @param grad output derivatives of the field along north, east and down (nT/m), NULL if not needed
+ * @return false if the tile is not valid
+ */
+extern bool mag_tile_get_field_grad(const struct MagTile *t, double lat, double lon, double alt,
+                                    struct FloatVect3 *field, struct FloatVect3 *grad);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_GEODETIC_MAG_TILE_H */
+/** @}*/
+/** @}*/
@@ -34,6 +34,9 @@
  *
  * rows are from -180 to +170 starting north +90 to south-90
  *
+ * If USE_GEOID_GRID is defined (geoid module), the finer grid generated
+ * from EGM96 (see pprz_geodetic_geoid.h) is used instead.
+ *
  * @addtogroup math_geodetic
  * @{
  * @addtogroup math_geodetic_wgs84 WGS-84 Geoid
@@ -49,6 +52,10 @@ extern "C" {
 
 #include "std.h"
 
+#if USE_GEOID_GRID
+#include "math/pprz_geodetic_geoid.h"
+#endif
+
 static const int8_t pprz_geodetic_wgs84_int[19][36] = {
   {13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13},
   {3, 1, -2, -3, -3, -3, -1, 3, 1, 5, 9, 11, 19, 27, 31, 34, 33, 34, 33, 34, 28, 23, 17, 13, 9, 4, 4, 1, -2, -2, 0, 2, 3, 2, 1, 1},
@@ -80,6 +87,9 @@ static const int8_t pprz_geodetic_wgs84_int[19][36] = {
  */
 static inline int32_t wgs84_ellipsoid_to_geoid_i(int32_t lat, int32_t lon)
 {
+#if USE_GEOID_GRID
+  return geoid_grid_get_i(&geoid_grid, lat, lon);
+#endif
   float x = (180.0f + (float)lon / 1e7) / 10.0f;
   Bound(x, 0.0f, 35.99999f);
   float y = (90.0f - (float)lat / 1e7) / 10.0f;
@@ -105,6 +115,9 @@ static inline int32_t wgs84_ellipsoid_to_geoid_i(int32_t lat, int32_t lon)
  */
 static inline float wgs84_ellipsoid_to_geoid_f(float lat, float lon)
 {
+#if USE_GEOID_GRID
+  return geoid_grid_get_f(&geoid_grid, lat, lon);
+#endif
   float x = (180.0f + DegOfRad(lon)) / 10.0f;
   Bound(x, 0.0f, 35.99999f);
   float y = (90.0f - DegOfRad(lat)) / 10.0f;
@@ -132,7 +132,6 @@ int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t n
   int npq;
   int ios;
   double argument;
-  double power;
   a2 = 40680631.59;            /* WGS84 */
   b2 = 40408299.98;            /* WGS84 */
   ios = 0;
@@ -181,6 +180,8 @@ int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t n
   }
 
   ratio = earths_radius / r;
+  /* ratio^(n+2) is updated incrementally for each degree n */
+  rr = ratio * ratio;
   argument = 3.0;
   aa = sqrt(argument);
   p[1] = 2.0 * slat;
@@ -196,9 +197,7 @@ int16_t mag_calc(int16_t igdgc, double flat, double flon, double elev, int16_t n
     if (n < m) {
       m = 0;
       n = n + 1;
-      argument = ratio;
-      power =  n + 2;
-      rr = pow(argument, power);
+      rr = rr * ratio;
       fn = n;
     }
     fm = m;
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_integrator_float.h
+ * @brief Fixed-step integrators with caller provided workspace (float version)
+ *
+ * Same model interface as the Runge-Kutta library (pprz_rk_float.h),
+ * but the state is integrated in place and the intermediate vectors
+ * are taken from a workspace provided by the caller (usually a static array
+ * sized with the INTEGRATOR_*_WS_SIZE macros), so no stack allocation
+ * depends on the state dimension.
+ * All functions are static inline: with a constant dimension and model
+ * the loops are unrolled and the model can be inlined by the compiler.
+ *
+ * Also provides semi-implicit Euler for position/velocity pairs
+ * and exponential map quaternion integration.
+ */
+
+#ifndef PPRZ_INTEGRATOR_FLOAT_H
+#define PPRZ_INTEGRATOR_FLOAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "math/pprz_algebra_float.h"
+
+/** Workspace sizes (in floats) for a state of dimension n */
+#define INTEGRATOR_EULER_WS_SIZE(_n) (_n)
+#define INTEGRATOR_HEUN_WS_SIZE(_n) (2 * (_n))
+#define INTEGRATOR_RK4_WS_SIZE(_n) (3 * (_n))
+
+/** Model function, same as the Runge-Kutta library
+ *  computes o = f(x, u)
+ */
+typedef void (*integrator_model_float)(float *o, const float *x, const int n, const float *u, const int m);
+
+/** Explicit Euler step
+ *
+ * x = x + dt * f(x, u)
+ *
+ * @param x state, integrated in place
+ * @param n state dimension
+ * @param u command vector
+ * @param m command dimension
+ * @param f model function
+ * @param dt integration step
+ * @param ws workspace of INTEGRATOR_EULER_WS_SIZE(n) floats
+ */
+static inline void integrator_euler_float(float *x, const int n, const float *u, const int m,
+    integrator_model_float f, const float dt, float *ws)
+{
+  int i;
+  f(ws, x, n, u, m);
+  for (i = 0; i < n; i++) {
+    x[i] += dt * ws[i];
+  }
+}
+
+/** Heun step
+ *
+ * aka explicit trapezoidal rule, second order
+ *
+ * k1 = f(x, u)
+ * k2 = f(x + dt * k1, u)
+ * x = x + (dt / 2) * (k1 + k2)
+ *
+ * @param x state, integrated in place
+ * @param n state dimension
+ * @param u command vector
+ * @param m command dimension
+ * @param f model function
+ * @param dt integration step
+ * @param ws workspace of INTEGRATOR_HEUN_WS_SIZE(n) floats
+ */
+static inline void integrator_heun_float(float *x, const int n, const float *u, const int m,
+    integrator_model_float f, const float dt, float *ws)
+{
+  float *k = ws;
+  float *tmp = ws + n;
+  int i;
+  f(k, x, n, u, m);
+  for (i = 0; i < n; i++) {
+    tmp[i] = x[i] + dt * k[i];
+    x[i] += (dt / 2.f) * k[i];
+  }
+  f(k, tmp, n, u, m);
+  for (i = 0; i < n; i++) {
+    x[i] += (dt / 2.f) * k[i];
+  }
+}
+
+/** Fourth-Order Runge-Kutta step
+ *
+ * k1 = f(x, u)
+ * k2 = f(x + dt * (k1 / 2), u)
+ * k3 = f(x + dt * (k2 / 2), u)
+ * k4 = f(x + dt * k3, u)
+ * x = x + (dt / 6) * (k1 + 2 * (k2 + k3) + k4)
+ *
+ * @param x state, integrated in place
+ * @param n state dimension
+ * @param u command vector
+ * @param m command dimension
+ * @param f model function
+ * @param dt integration step
+ * @param ws workspace of INTEGRATOR_RK4_WS_SIZE(n) floats
+ */
+static inline void integrator_rk4_float(float *x, const int n, const float *u, const int m,
+    integrator_model_float f, const float dt, float *ws)
+{
+  float *k = ws;
+  float *sum = ws + n;
+  float *tmp = ws + 2 * n;
+  const float dt2 = dt / 2.f;
+  int i;
+
+  // k1
+  f(k, x, n, u, m);
+  for (i = 0; i < n; i++) {
+    sum[i] = k[i];
+    tmp[i] = x[i] + dt2 * k[i];
+  }
+  // k2
+  f(k, tmp, n, u, m);
+  for (i = 0; i < n; i++) {
+    sum[i] += 2.f * k[i];
+    tmp[i] = x[i] + dt2 * k[i];
+  }
+  // k3
+  f(k, tmp, n, u, m);
+  for (i = 0; i < n; i++) {
+    sum[i] += 2.f * k[i];
+    tmp[i] = x[i] + dt * k[i];
+  }
+  // k4
+  f(k, tmp, n, u, m);
+  for (i = 0; i < n; i++) {
+    x[i] += (dt / 6.f) * (sum[i] + k[i]);
+  }
+}
+
+/** Semi-implicit (symplectic) Euler step
+ *
+ * v = v + dt * a
+ * p = p + dt * v
+ *
+ * Same cost as explicit Euler, but bounded energy error
+ * for oscillating systems.
+ *
+ * @param pos position, integrated in place
+ * @param vel velocity, integrated in place
+ * @param accel acceleration
+ * @param n dimension
+ * @param dt integration step
+ */
+static inline void integrator_semi_implicit_euler_float(float *pos, float *vel, const float *accel,
+    const int n, const float dt)
+{
+  int i;
+  for (i = 0; i < n; i++) {
+    vel[i] += dt * accel[i];
+    pos[i] += dt * vel[i];
+  }
+}
+
+/** Exponential map quaternion integration with constant rotational velocity
+ *
+ * q = q * exp(omega * dt / 2)
+ *
+ * Same result as float_quat_integrate, but sin and cos are replaced
+ * by their Taylor expansion for small rotations (error below float
+ * resolution for a rotation less than 0.1 rad per step).
+ * The norm of the quaternion is preserved (up to rounding errors).
+ *
+ * @param q quaternion, integrated in place
+ * @param omega rotational velocity in body frame
+ * @param dt integration step
+ */
+static inline void integrator_quat_exp_float(struct FloatQuat *q, const struct FloatRates *omega, const float dt)
+{
+  const float a2 = 0.25f * dt * dt * (omega->p * omega->p + omega->q * omega->q + omega->r * omega->r);
+  float ca, sa_ov_no;
+  if (a2 < 0.01f) {
+    // cos(a) and sin(a)/a to the 4th order
+    ca = 1.f - a2 * (0.5f - a2 * (1.f / 24.f));
+    sa_ov_no = 0.5f * dt * (1.f - a2 * ((1.f / 6.f) - a2 * (1.f / 120.f)));
+  } else {
+    const float a = sqrtf(a2);
+    ca = cosf(a);
+    sa_ov_no = 0.5f * dt * sinf(a) / a;
+  }
+  const float dp = sa_ov_no * omega->p;
+  const float dq = sa_ov_no * omega->q;
+  const float dr = sa_ov_no * omega->r;
+  const float qi = q->qi;
+  const float qx = q->qx;
+  const float qy = q->qy;
+  const float qz = q->qz;
+  q->qi = ca * qi - dp * qx - dq * qy - dr * qz;
+  q->qx = dp * qi + ca * qx + dr * qy - dq * qz;
+  q->qy = dq * qi - dr * qx + ca * qy + dp * qz;
+  q->qz = dr * qi + dq * qx - dp * qy + ca * qz;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_INTEGRATOR_FLOAT_H */
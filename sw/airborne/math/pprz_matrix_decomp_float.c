@@ -121,6 +121,83 @@ void pprz_qr_float(float **Q, float **R, float **in, int m, int n)
   float_mat_transpose_square(Q, m);
 }
 
+/** In-place QR decomposition, upper triangular factor only
+ *
+ * @param a input matrix [m x n], replaced by R in its first n rows (zero below)
+ * @param m number of rows of the input matrix
+ * @param n number of columns of the input matrix
+ */
+void pprz_qr_r_float(float **a, int m, int n)
+{
+  int i, j, k;
+  for (k = 0; k < n && k < m; k++) {
+    // Householder vector stored in column k below the diagonal
+    float norm = 0.f;
+    for (i = k; i < m; i++) {
+      norm += a[i][k] * a[i][k];
+    }
+    norm = sqrtf(norm);
+    if (norm == 0.f) {
+      continue;
+    }
+    const float alpha = a[k][k] > 0.f ? -norm : norm;
+    // |v|^2 / 2 with v = x - alpha e_k
+    const float h = norm * norm - alpha * a[k][k];
+    a[k][k] -= alpha;
+    for (j = k + 1; j < n; j++) {
+      float s = 0.f;
+      for (i = k; i < m; i++) {
+        s += a[i][k] * a[i][j];
+      }
+      s /= h;
+      for (i = k; i < m; i++) {
+        a[i][j] -= s * a[i][k];
+      }
+    }
+    a[k][k] = alpha;
+    for (i = k + 1; i < m; i++) {
+      a[i][k] = 0.f;
+    }
+  }
+  // positive diagonal, R^T R is unchanged by flipping the sign of a row
+  for (k = 0; k < n && k < m; k++) {
+    if (a[k][k] < 0.f) {
+      for (j = k; j < n; j++) {
+        a[k][j] = -a[k][j];
+      }
+    }
+  }
+}
+
+/** Rank-1 update or downdate of a Cholesky factor
+ *
+ * @param R upper triangular factor [n x n]
+ * @param v vector [n], destroyed
+ * @param n dimension of the matrix
+ * @param downdate true for a downdate
+ * @return false if the downdated matrix is not positive definite
+ */
+bool pprz_cholupdate_float(float **R, float *v, int n, bool downdate)
+{
+  const float sign = downdate ? -1.f : 1.f;
+  int j, k;
+  for (k = 0; k < n; k++) {
+    const float r2 = R[k][k] * R[k][k] + sign * v[k] * v[k];
+    if (!(r2 > 0.f) || R[k][k] == 0.f) {
+      return false;
+    }
+    const float r = sqrtf(r2);
+    const float c = r / R[k][k];
+    const float s = v[k] / R[k][k];
+    R[k][k] = r;
+    for (j = k + 1; j < n; j++) {
+      R[k][j] = (R[k][j] + sign * s * v[j]) / c;
+      v[j] = c * v[j] - s * R[k][j];
+    }
+  }
+  return true;
+}
+
 /** Some SVD decomposition utility macros and functions
 */
 
@@ -57,6 +57,32 @@ void pprz_cholesky_float(float **out, float **in, int n);
  */
 void pprz_qr_float(float **Q, float **R, float **in, int m, int n);
 
+/** In-place QR decomposition, upper triangular factor only
+ *
+ * Householder reflections applied directly to the input,
+ * without building Q nor any temporary matrix.
+ * The diagonal of R is made non-negative, so that for a square-root
+ * factorization (A^T A = R^T R) the result is the Cholesky factor.
+ *
+ * @param a input matrix [m x n], replaced by R in its first n rows (zero below)
+ * @param m number of rows of the input matrix
+ * @param n number of columns of the input matrix
+ */
+void pprz_qr_r_float(float **a, int m, int n);
+
+/** Rank-1 update or downdate of a Cholesky factor
+ *
+ * With P = R^T R, compute in place the factor of P + v v^T (update)
+ * or P - v v^T (downdate).
+ *
+ * @param R upper triangular factor [n x n]
+ * @param v vector [n], destroyed
+ * @param n dimension of the matrix
+ * @param downdate true for a downdate
+ * @return false if the downdated matrix is not positive definite, R is then invalid
+ */
+bool pprz_cholupdate_float(float **R, float *v, int n, bool downdate);
+
 /** SVD decomposition
  *
  * --------------------------------------------------------------------- *
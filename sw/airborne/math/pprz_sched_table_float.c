@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_sched_table_float.c
+ * @brief Multi-dimensional breakpoint tables for gain scheduling.
+ *
+ */
+
+#include "pprz_sched_table_float.h"
+#include <math.h>
+
+void sched_table_init_f(struct SchedTableFloat *t, const float *data, uint16_t size, float *out)
+{
+  t->data = data;
+  t->out = out;
+  t->size = size;
+  t->nb_dim = 0;
+  t->valid = false;
+}
+
+bool sched_table_add_axis_f(struct SchedTableFloat *t, const float *points, uint8_t nb, float threshold)
+{
+  if (t->nb_dim >= SCHED_TABLE_MAX_DIM || nb == 0) {
+    return false;
+  }
+  struct SchedAxisFloat *a = &t->axis[t->nb_dim++];
+  a->points = points;
+  a->nb = nb;
+  a->threshold = threshold;
+  a->last = 0.f;
+  t->valid = false;
+  return true;
+}
+
+uint8_t sched_axis_find_f(const struct SchedAxisFloat *a, float x, float *frac)
+{
+  if (a->nb < 2 || x <= a->points[0]) {
+    *frac = 0.f;
+    return 0;
+  }
+  if (x >= a->points[a->nb - 1]) {
+    *frac = 1.f;
+    return a->nb - 2;
+  }
+  // tables are small, a linear search is enough
+  uint8_t i = 0;
+  while (x > a->points[i + 1]) {
+    i++;
+  }
+  *frac = (x - a->points[i]) / (a->points[i + 1] - a->points[i]);
+  return i;
+}
+
+void sched_table_interp_f(struct SchedTableFloat *t, const float *vars, float *out)
+{
+  uint32_t stride[SCHED_TABLE_MAX_DIM];
+  float frac[SCHED_TABLE_MAX_DIM];
+  uint32_t base = 0, s = t->size;
+  uint8_t d;
+  uint16_t k;
+
+  for (d = 0; d < t->nb_dim; d++) {
+    base += sched_axis_find_f(&t->axis[d], vars[d], &frac[d]) * s;
+    stride[d] = s;
+    s *= t->axis[d].nb;
+  }
+
+  for (k = 0; k < t->size; k++) {
+    out[k] = 0.f;
+  }
+  // weighted sum of the corners of the cell, skipping the ones with a zero weight
+  // (variables on a breakpoint or clamped, axes with a single breakpoint)
+  for (uint32_t c = 0; c < (1u << t->nb_dim); c++) {
+    float w = 1.f;
+    uint32_t offset = base;
+    for (d = 0; d < t->nb_dim; d++) {
+      if (c & (1u << d)) {
+        w *= frac[d];
+        offset += stride[d];
+      } else {
+        w *= 1.f - frac[d];
+      }
+    }
+    if (w == 0.f) {
+      continue;
+    }
+    const float *v = &t->data[offset];
+    for (k = 0; k < t->size; k++) {
+      out[k] += w * v[k];
+    }
+  }
+}
+
+bool sched_table_update_f(struct SchedTableFloat *t, const float *vars)
+{
+  uint8_t d;
+  if (t->valid) {
+    for (d = 0; d < t->nb_dim; d++) {
+      if (fabsf(vars[d] - t->axis[d].last) > t->axis[d].threshold) {
+        break;
+      }
+    }
+    if (d == t->nb_dim) {
+      return false;
+    }
+  }
+  for (d = 0; d < t->nb_dim; d++) {
+    t->axis[d].last = vars[d];
+  }
+  sched_table_interp_f(t, vars, t->out);
+  t->valid = true;
+  return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_sched_table_float.h
+ * @brief Multi-dimensional breakpoint tables for gain scheduling.
+ *
+ * A table holds a vector of values (e.g. a gain set or an effectiveness
+ * matrix) at each point of a grid of breakpoints (e.g. airspeed x transition
+ * x battery voltage), with the first axis varying fastest in the data.
+ * The values are interpolated multi-linearly, the scheduling variables
+ * being clamped to the range of each axis.
+ *
+ * sched_table_update_f only interpolates again when one of the variables
+ * moved by more than the threshold of its axis since the last interpolation,
+ * and tells the caller if the output changed, so that anything derived from
+ * it (e.g. an inverse) is only recomputed when needed.
+ */
+
+#ifndef PPRZ_SCHED_TABLE_FLOAT_H
+#define PPRZ_SCHED_TABLE_FLOAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+
+/** Max number of scheduling variables */
+#ifndef SCHED_TABLE_MAX_DIM
+#define SCHED_TABLE_MAX_DIM 3
+#endif
+
+struct SchedAxisFloat {
+  const float *points;    ///< breakpoints, strictly increasing
+  uint8_t nb;             ///< number of breakpoints
+  float threshold;        ///< change of the variable triggering a new interpolation
+  float last;             ///< variable at the last interpolation
+};
+
+struct SchedTableFloat {
+  const float *data;      ///< size values per grid point, first axis varying fastest
+  float *out;             ///< interpolated values
+  uint16_t size;          ///< number of values per grid point
+  uint8_t nb_dim;         ///< number of axes
+  bool valid;             ///< out is up to date with the last variables
+  struct SchedAxisFloat axis[SCHED_TABLE_MAX_DIM];
+};
+
+/** Initialize a table without axes
+ * @param t table
+ * @param data values of all the grid points
+ * @param size number of values per grid point
+ * @param out output buffer of size values
+ */
+extern void sched_table_init_f(struct SchedTableFloat *t, const float *data, uint16_t size, float *out);
+
+/** Add a scheduling variable, in the order of the data layout
+ * @param t table
+ * @param points breakpoints, strictly increasing
+ * @param nb number of breakpoints (at least 1)
+ * @param threshold change of the variable below which the table is not interpolated again
+ * @return false if the max number of axes is reached
+ */
+extern bool sched_table_add_axis_f(struct SchedTableFloat *t, const float *points, uint8_t nb, float threshold);
+
+/** Interpolate the table if one of the variables changed by more than its threshold
+ * @param t table
+ * @param vars scheduling variables, one per axis
+ * @return true if the output was updated
+ */
+extern bool sched_table_update_f(struct SchedTableFloat *t, const float *vars);
+
+/** Interpolate the table unconditionally
+ * @param t table
+ * @param vars scheduling variables, one per axis
+ * @param out output buffer of t->size values
+ */
+extern void sched_table_interp_f(struct SchedTableFloat *t, const float *vars, float *out);
+
+/** Find the interval of a breakpoint axis
+ * @param a axis
+ * @param x variable
+ * @param frac position of x in the interval [0, 1], clamped
+ * @return index of the lower breakpoint of the interval
+ */
+extern uint8_t sched_axis_find_f(const struct SchedAxisFloat *a, float x, float *frac);
+
+/** Force the interpolation at the next update (e.g. after changing the data) */
+static inline void sched_table_invalidate_f(struct SchedTableFloat *t)
+{
+  t->valid = false;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_SCHED_TABLE_FLOAT_H */
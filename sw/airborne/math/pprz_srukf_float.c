@@ -0,0 +1,307 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_srukf_float.c
+ * @brief Square-root unscented Kalman filter with a fixed size workspace.
+ *
+ * Van der Merwe, Wan, "The square-root unscented Kalman filter for state and
+ * parameter-estimation", ICASSP 2001.
+ */
+
+#include "pprz_srukf_float.h"
+#include "pprz_algebra_float.h"
+#include "pprz_matrix_decomp_float.h"
+#include <math.h>
+#include <string.h>
+
+bool srukf_init(struct SrUkfFloat *ukf, uint8_t n, uint8_t m, srukf_process_f f, srukf_measure_f h, void *user)
+{
+  if (n == 0 || n > SRUKF_MAX_N || m > SRUKF_MAX_M) {
+    return false;
+  }
+  memset(ukf, 0, sizeof(struct SrUkfFloat));
+  ukf->n = n;
+  ukf->m = m;
+  ukf->f = f;
+  ukf->h = h;
+  ukf->user = user;
+  srukf_set_params(ukf, 0.5f, 2.f, 0.f);
+  return true;
+}
+
+void srukf_set_params(struct SrUkfFloat *ukf, float alpha, float beta, float kappa)
+{
+  const float lambda = alpha * alpha * (ukf->n + kappa) - ukf->n;
+  ukf->gamma = sqrtf(ukf->n + lambda);
+  ukf->wm0 = lambda / (ukf->n + lambda);
+  ukf->wc0 = ukf->wm0 + 1.f - alpha * alpha + beta;
+  ukf->wi = 1.f / (2.f * (ukf->n + lambda));
+}
+
+void srukf_set_state(struct SrUkfFloat *ukf, const float *x0, const float *p0)
+{
+  for (uint8_t i = 0; i < ukf->n; i++) {
+    ukf->x[i] = x0[i];
+    for (uint8_t j = 0; j < ukf->n; j++) {
+      ukf->S[i][j] = i == j ? sqrtf(p0[i]) : 0.f;
+    }
+  }
+  ukf->ws.propagated = false;
+}
+
+void srukf_set_process_noise(struct SrUkfFloat *ukf, const float *q)
+{
+  for (uint8_t i = 0; i < ukf->n; i++) {
+    for (uint8_t j = 0; j < ukf->n; j++) {
+      ukf->Qs[i][j] = i == j ? sqrtf(q[i]) : 0.f;
+    }
+  }
+}
+
+void srukf_set_measurement_noise(struct SrUkfFloat *ukf, const float *r)
+{
+  for (uint8_t i = 0; i < ukf->m; i++) {
+    for (uint8_t j = 0; j < ukf->m; j++) {
+      ukf->Rs[i][j] = i == j ? sqrtf(r[i]) : 0.f;
+    }
+  }
+}
+
+/* sigma point k of x and S, the columns of S^T being the rows of S */
+static void sigma_point(struct SrUkfFloat *ukf, float *p, uint8_t k)
+{
+  const uint8_t n = ukf->n;
+  for (uint8_t i = 0; i < n; i++) {
+    p[i] = ukf->x[i];
+  }
+  if (k == 0) {
+    return;
+  }
+  const float g = k <= n ? ukf->gamma : -ukf->gamma;
+  const float *s = ukf->S[(k - 1) % n];
+  for (uint8_t i = 0; i < n; i++) {
+    p[i] += g * s[i];
+  }
+}
+
+/* rank-1 correction of the central sigma point with weight wc0
+ * (usually negative, hence a downdate), a failure keeps the factor given by the QR
+ */
+static bool central_update(struct SrUkfFloat *ukf, float **R, float **backup, float *d, int n)
+{
+  const float w = sqrtf(fabsf(ukf->wc0));
+  for (int i = 0; i < n; i++) {
+    d[i] *= w;
+  }
+  float_mat_copy(backup, R, n, n);
+  if (!pprz_cholupdate_float(R, d, n, ukf->wc0 < 0.f)) {
+    float_mat_copy(R, backup, n, n);
+    ukf->nb_fail++;
+    return false;
+  }
+  return true;
+}
+
+bool srukf_predict(struct SrUkfFloat *ukf, float dt)
+{
+  struct SrUkfWorkspace *ws = &ukf->ws;
+  const uint8_t n = ukf->n;
+  const uint8_t nb = 2 * n + 1;
+  uint8_t i, k;
+  MAKE_MATRIX_PTR(A, ws->A, SRUKF_MAX_SIGMA - 1 + SRUKF_MAX_NM);
+  MAKE_MATRIX_PTR(S, ukf->S, SRUKF_MAX_N);
+  MAKE_MATRIX_PTR(B, ws->S, SRUKF_MAX_N);
+
+  if (ukf->f == NULL) {
+    // constant state: S = qr([S; Qs])
+    for (k = 0; k < n; k++) {
+      for (i = 0; i < n; i++) {
+        A[k][i] = ukf->S[k][i];
+        A[n + k][i] = ukf->Qs[k][i];
+      }
+    }
+    pprz_qr_r_float(A, 2 * n, n);
+    float_mat_copy(S, A, n, n);
+    ws->propagated = false;
+    return true;
+  }
+
+  // propagate the sigma points and compute their mean
+  float mean[SRUKF_MAX_N] = { 0.f };
+  for (k = 0; k < nb; k++) {
+    sigma_point(ukf, ws->v, k);
+    ukf->f(ws->X[k], ws->v, dt, ukf->user);
+    const float w = k == 0 ? ukf->wm0 : ukf->wi;
+    for (i = 0; i < n; i++) {
+      mean[i] += w * ws->X[k][i];
+    }
+  }
+  memcpy(ukf->x, mean, n * sizeof(float));
+
+  // S = qr([sqrt(wi) (X_1..2n - x); Qs])
+  const float sw = sqrtf(ukf->wi);
+  for (k = 1; k < nb; k++) {
+    for (i = 0; i < n; i++) {
+      A[k - 1][i] = sw * (ws->X[k][i] - ukf->x[i]);
+    }
+  }
+  for (k = 0; k < n; k++) {
+    for (i = 0; i < n; i++) {
+      A[nb - 1 + k][i] = ukf->Qs[k][i];
+    }
+  }
+  pprz_qr_r_float(A, nb - 1 + n, n);
+  float_mat_copy(S, A, n, n);
+
+  for (i = 0; i < n; i++) {
+    ws->v[i] = ws->X[0][i] - ukf->x[i];
+  }
+  ws->propagated = true;
+  return central_update(ukf, S, B, ws->v, n);
+}
+
+bool srukf_update(struct SrUkfFloat *ukf, const float *z)
+{
+  struct SrUkfWorkspace *ws = &ukf->ws;
+  const uint8_t n = ukf->n;
+  const uint8_t m = ukf->m;
+  const uint8_t nb = 2 * n + 1;
+  uint8_t i, j, k;
+  MAKE_MATRIX_PTR(A, ws->A, SRUKF_MAX_SIGMA - 1 + SRUKF_MAX_NM);
+  MAKE_MATRIX_PTR(S, ukf->S, SRUKF_MAX_N);
+  MAKE_MATRIX_PTR(B, ws->S, SRUKF_MAX_N);
+  MAKE_MATRIX_PTR(Sy, ws->Sy, SRUKF_MAX_M);
+
+  // sigma points of the current state, unless the propagated ones are available
+  if (!ws->propagated) {
+    for (k = 0; k < nb; k++) {
+      sigma_point(ukf, ws->X[k], k);
+    }
+  }
+  ws->propagated = false;
+
+  // expected measurement
+  for (i = 0; i < m; i++) {
+    ws->y[i] = 0.f;
+  }
+  for (k = 0; k < nb; k++) {
+    ukf->h(ws->Y[k], ws->X[k], ukf->user);
+    const float w = k == 0 ? ukf->wm0 : ukf->wi;
+    for (i = 0; i < m; i++) {
+      ws->y[i] += w * ws->Y[k][i];
+    }
+  }
+
+  // Sy = qr([sqrt(wi) (Y_1..2n - y); Rs]) and central point
+  const float sw = sqrtf(ukf->wi);
+  for (k = 1; k < nb; k++) {
+    for (i = 0; i < m; i++) {
+      A[k - 1][i] = sw * (ws->Y[k][i] - ws->y[i]);
+    }
+  }
+  for (k = 0; k < m; k++) {
+    for (i = 0; i < m; i++) {
+      A[nb - 1 + k][i] = ukf->Rs[k][i];
+    }
+  }
+  pprz_qr_r_float(A, nb - 1 + m, m);
+  float_mat_copy(Sy, A, m, m);
+  for (i = 0; i < m; i++) {
+    ws->v[i] = ws->Y[0][i] - ws->y[i];
+  }
+  bool res = central_update(ukf, Sy, A, ws->v, m);
+
+  // cross covariance
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < m; j++) {
+      ws->Pxy[i][j] = 0.f;
+    }
+  }
+  for (k = 0; k < nb; k++) {
+    const float w = k == 0 ? ukf->wc0 : ukf->wi;
+    for (i = 0; i < n; i++) {
+      const float dx = w * (ws->X[k][i] - ukf->x[i]);
+      for (j = 0; j < m; j++) {
+        ws->Pxy[i][j] += dx * (ws->Y[k][j] - ws->y[j]);
+      }
+    }
+  }
+
+  // K = Pxy (Sy^T Sy)^-1, row by row: Sy^T u = Pxy^T then Sy k = u,
+  // u being the row of U = K Sy^T
+  for (i = 0; i < n; i++) {
+    float *u = ws->U[i];
+    float *g = ws->Pxy[i];
+    for (j = 0; j < m; j++) {
+      float s = g[j];
+      for (k = 0; k < j; k++) {
+        s -= ws->Sy[k][j] * u[k];
+      }
+      u[j] = s / ws->Sy[j][j];
+    }
+    for (j = m; j-- > 0;) {
+      float s = u[j];
+      for (k = j + 1; k < m; k++) {
+        s -= ws->Sy[j][k] * g[k];
+      }
+      g[j] = s / ws->Sy[j][j];
+    }
+  }
+
+  // state correction
+  for (j = 0; j < m; j++) {
+    ws->y[j] = z[j] - ws->y[j];
+  }
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < m; j++) {
+      ukf->x[i] += ws->Pxy[i][j] * ws->y[j];
+    }
+  }
+
+  // P = P - U U^T, one downdate per column of U
+  float_mat_copy(B, S, n, n);
+  for (j = 0; j < m; j++) {
+    for (i = 0; i < n; i++) {
+      ws->v[i] = ws->U[i][j];
+    }
+    if (!pprz_cholupdate_float(S, ws->v, n, true)) {
+      float_mat_copy(S, B, n, n);
+      ukf->nb_fail++;
+      return false;
+    }
+  }
+  return res;
+}
+
+void srukf_get_cov(struct SrUkfFloat *ukf, float *P)
+{
+  const uint8_t n = ukf->n;
+  for (uint8_t i = 0; i < n; i++) {
+    for (uint8_t j = i; j < n; j++) {
+      float s = 0.f;
+      for (uint8_t k = 0; k <= i; k++) {
+        s += ukf->S[k][i] * ukf->S[k][j];
+      }
+      P[i * n + j] = s;
+      P[j * n + i] = s;
+    }
+  }
+}
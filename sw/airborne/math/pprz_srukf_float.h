@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_srukf_float.h
+ * @brief Square-root unscented Kalman filter with a fixed size workspace.
+ *
+ * Generic engine for small nonlinear estimators (e.g. wind, magnetometer
+ * calibration), the process and measurement models being given as callbacks.
+ * The covariance is propagated as its upper triangular square root S
+ * (P = S^T S): the time and measurement updates use an in-place QR of the
+ * weighted sigma point deviations and rank-1 updates of S, so that no full
+ * Cholesky factorization is needed and P stays positive definite.
+ *
+ * All the memory is part of the filter structure, sized at compile time by
+ * SRUKF_MAX_N and SRUKF_MAX_M, nothing large is allocated on the stack.
+ * When a downdate of S fails (loss of positive definiteness because of
+ * rounding), the last valid factor is kept, which over-estimates the
+ * covariance rather than corrupting it, and nb_fail is incremented.
+ *
+ * Sigma points: scaled unscented transform with alpha, beta, kappa.
+ * The propagated sigma points are reused by the measurement update following
+ * a time update. Without process model (f == NULL) the state is constant
+ * and the time update only adds the process noise.
+ */
+
+#ifndef PPRZ_SRUKF_FLOAT_H
+#define PPRZ_SRUKF_FLOAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+
+/** Max state dimension */
+#ifndef SRUKF_MAX_N
+#define SRUKF_MAX_N 12
+#endif
+
+/** Max measurement dimension */
+#ifndef SRUKF_MAX_M
+#define SRUKF_MAX_M 6
+#endif
+
+#define SRUKF_MAX_SIGMA (2 * SRUKF_MAX_N + 1)
+#define SRUKF_MAX_NM (SRUKF_MAX_N > SRUKF_MAX_M ? SRUKF_MAX_N : SRUKF_MAX_M)
+
+/** Process model
+ * @param x_next state at the end of the step
+ * @param x state at the beginning of the step
+ * @param dt time step
+ * @param user user data of the filter
+ */
+typedef void (*srukf_process_f)(float *x_next, const float *x, float dt, void *user);
+
+/** Measurement model
+ * @param y expected measurement
+ * @param x state
+ * @param user user data of the filter
+ */
+typedef void (*srukf_measure_f)(float *y, const float *x, void *user);
+
+struct SrUkfWorkspace {
+  float X[SRUKF_MAX_SIGMA][SRUKF_MAX_N];        ///< sigma points
+  float Y[SRUKF_MAX_SIGMA][SRUKF_MAX_M];        ///< sigma points through the measurement model
+  float A[SRUKF_MAX_SIGMA - 1 + SRUKF_MAX_NM][SRUKF_MAX_NM]; ///< compound matrix of the QR
+  float Sy[SRUKF_MAX_M][SRUKF_MAX_M];           ///< square root of the innovation covariance
+  float Pxy[SRUKF_MAX_N][SRUKF_MAX_M];          ///< cross covariance, then gain
+  float U[SRUKF_MAX_N][SRUKF_MAX_M];            ///< K Sy^T, downdates of S
+  float S[SRUKF_MAX_N][SRUKF_MAX_N];            ///< last valid factor during the downdates
+  float y[SRUKF_MAX_M];                         ///< expected measurement
+  float v[SRUKF_MAX_NM];                        ///< temporary vector
+  bool propagated;                              ///< X holds the sigma points of the last time update
+};
+
+struct SrUkfFloat {
+  uint8_t n;                                    ///< state dimension
+  uint8_t m;                                    ///< measurement dimension
+  float x[SRUKF_MAX_N];                         ///< state
+  float S[SRUKF_MAX_N][SRUKF_MAX_N];            ///< upper triangular square root of the covariance
+  float Qs[SRUKF_MAX_N][SRUKF_MAX_N];           ///< upper triangular square root of the process noise
+  float Rs[SRUKF_MAX_M][SRUKF_MAX_M];           ///< upper triangular square root of the measurement noise
+  float gamma;                                  ///< sigma point spread
+  float wm0, wc0;                               ///< weights of the central sigma point
+  float wi;                                     ///< weight of the other sigma points
+  srukf_process_f f;                            ///< process model, NULL for a constant state
+  srukf_measure_f h;                            ///< measurement model
+  void *user;                                   ///< user data passed to the models
+  uint32_t nb_fail;                             ///< number of failed downdates
+  struct SrUkfWorkspace ws;
+};
+
+/** Initialize a filter, with zero state and covariance and alpha = 0.5, beta = 2, kappa = 0
+ * @param ukf filter
+ * @param n state dimension
+ * @param m measurement dimension
+ * @param f process model, NULL for a constant state
+ * @param h measurement model
+ * @param user user data passed to the models
+ * @return false if the dimensions are too large
+ */
+extern bool srukf_init(struct SrUkfFloat *ukf, uint8_t n, uint8_t m, srukf_process_f f, srukf_measure_f h, void *user);
+
+/** Set the sigma point parameters
+ * @param ukf filter
+ * @param alpha spread of the sigma points
+ * @param beta prior knowledge of the distribution (2 for gaussian)
+ * @param kappa secondary scaling parameter
+ */
+extern void srukf_set_params(struct SrUkfFloat *ukf, float alpha, float beta, float kappa);
+
+/** Set the state and a diagonal covariance
+ * @param ukf filter
+ * @param x0 state [n]
+ * @param p0 covariance diagonal [n]
+ */
+extern void srukf_set_state(struct SrUkfFloat *ukf, const float *x0, const float *p0);
+
+/** Set a diagonal process noise
+ * @param ukf filter
+ * @param q process noise variances [n]
+ */
+extern void srukf_set_process_noise(struct SrUkfFloat *ukf, const float *q);
+
+/** Set a diagonal measurement noise
+ * @param ukf filter
+ * @param r measurement noise variances [m]
+ */
+extern void srukf_set_measurement_noise(struct SrUkfFloat *ukf, const float *r);
+
+/** Time update
+ * @param ukf filter
+ * @param dt time step
+ * @return false if the covariance could not be downdated
+ */
+extern bool srukf_predict(struct SrUkfFloat *ukf, float dt);
+
+/** Measurement update
+ * @param ukf filter
+ * @param z measurement [m]
+ * @return false if the covariance could not be downdated
+ */
+extern bool srukf_update(struct SrUkfFloat *ukf, const float *z);
+
+/** Get the covariance
+ * @param ukf filter
+ * @param P covariance [n x n], row major
+ */
+extern void srukf_get_cov(struct SrUkfFloat *ukf, float *P);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_SRUKF_FLOAT_H */
@@ -167,3 +167,120 @@ float covariance_f(float *arr1, float *arr2, uint32_t n_elements)
   }
   return (sumXY / n_elements - sumX * sumY / (n_elements * n_elements));
 }
+
+/*********
+ * Streaming statistics
+ *********/
+
+static void moments_clear(struct MovingMomentsFloat *m)
+{
+  m->n = 0;
+  m->mean_x = 0.f;
+  m->mean_y = 0.f;
+  m->m2_x = 0.f;
+  m->m2_y = 0.f;
+  m->c_xy = 0.f;
+}
+
+/** Welford update with a new sample */
+static void moments_add(struct MovingMomentsFloat *m, float x, float y)
+{
+  m->n++;
+  const float dx = x - m->mean_x;
+  const float dy = y - m->mean_y;
+  m->mean_x += dx / m->n;
+  m->mean_y += dy / m->n;
+  m->m2_x += dx * (x - m->mean_x);
+  m->m2_y += dy * (y - m->mean_y);
+  m->c_xy += dx * (y - m->mean_y);
+}
+
+/** Update of a full window, new sample (x, y) replacing (x_old, y_old)
+ *  C' = C + (x - mx)(y - my') - (x_old - mx)(y_old - my')
+ *  with mx the old mean of x and my' the new mean of y
+ */
+static void moments_replace(struct MovingMomentsFloat *m, float x, float y, float x_old, float y_old)
+{
+  const float mean_x = m->mean_x + (x - x_old) / m->n;
+  const float mean_y = m->mean_y + (y - y_old) / m->n;
+  m->m2_x += (x - m->mean_x) * (x - mean_x) - (x_old - m->mean_x) * (x_old - mean_x);
+  m->m2_y += (y - m->mean_y) * (y - mean_y) - (y_old - m->mean_y) * (y_old - mean_y);
+  m->c_xy += (x - m->mean_x) * (y - mean_y) - (x_old - m->mean_x) * (y_old - mean_y);
+  m->mean_x = mean_x;
+  m->mean_y = mean_y;
+  // rounding may make the sums of squares slightly negative
+  if (m->m2_x < 0.f) { m->m2_x = 0.f; }
+  if (m->m2_y < 0.f) { m->m2_y = 0.f; }
+}
+
+void init_moving_stats_f(struct MovingStatsFloat *s, float *x, float *y, uint32_t size)
+{
+  s->x = x;
+  s->y = y;
+  s->size = size;
+  s->idx = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    x[i] = 0.f;
+    y[i] = 0.f;
+  }
+  moments_clear(&s->m);
+  moments_clear(&s->shadow);
+}
+
+void update_moving_stats_f(struct MovingStatsFloat *s, float x, float y)
+{
+  if (s->m.n < s->size) {
+    moments_add(&s->m, x, y);
+  } else {
+    moments_replace(&s->m, x, y, s->x[s->idx], s->y[s->idx]);
+  }
+  s->x[s->idx] = x;
+  s->y[s->idx] = y;
+  s->idx = (s->idx + 1) % s->size;
+
+  // re-centring: after a full window, the moments accumulated without removal replace the running ones
+  moments_add(&s->shadow, x, y);
+  if (s->shadow.n == s->size) {
+    s->m = s->shadow;
+    moments_clear(&s->shadow);
+  }
+}
+
+/** Index in the buffers of the sample received lag updates ago */
+static inline uint32_t moving_stats_past_idx(struct MovingStatsFloat *s, uint32_t lag)
+{
+  return (s->idx + s->size - 1 - (lag % s->size)) % s->size;
+}
+
+float moving_stats_past_x_f(struct MovingStatsFloat *s, uint32_t lag)
+{
+  return s->x[moving_stats_past_idx(s, lag)];
+}
+
+float moving_stats_past_y_f(struct MovingStatsFloat *s, uint32_t lag)
+{
+  return s->y[moving_stats_past_idx(s, lag)];
+}
+
+float moving_stats_lag_covariance_f(struct MovingStatsFloat *s, uint32_t lag)
+{
+  if (s->m.n <= lag) {
+    return 0.f;
+  }
+  const uint32_t n = s->m.n - lag;
+  // index of the oldest pair: x is the oldest sample of the window, y is lag samples later
+  const uint32_t ix = (s->idx + s->size - s->m.n) % s->size;
+  const uint32_t iy = (ix + lag) % s->size;
+  float mean_x = 0.f, mean_y = 0.f;
+  for (uint32_t i = 0; i < n; i++) {
+    mean_x += s->x[(ix + i) % s->size];
+    mean_y += s->y[(iy + i) % s->size];
+  }
+  mean_x /= n;
+  mean_y /= n;
+  float c = 0.f;
+  for (uint32_t i = 0; i < n; i++) {
+    c += (s->x[(ix + i) % s->size] - mean_x) * (s->y[(iy + i) % s->size] - mean_y);
+  }
+  return c / n;
+}
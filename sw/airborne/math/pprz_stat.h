@@ -98,6 +98,100 @@ extern float variance_f(float *array, uint32_t n_elements);
  */
 extern float covariance_f(float *array1, float *array2, uint32_t n_elements);
 
+/*********
+ * Streaming statistics
+ *********/
+
+/** Moments of a set of pairs of samples (x, y) */
+struct MovingMomentsFloat {
+  uint32_t n;           ///< number of samples
+  float mean_x;
+  float mean_y;
+  float m2_x;           ///< sum of (x - mean_x)^2
+  float m2_y;           ///< sum of (y - mean_y)^2
+  float c_xy;           ///< sum of (x - mean_x)(y - mean_y)
+};
+
+/** Statistics of two variables over a sliding window
+ *  Mean, variance and covariance of the last size samples, updated in
+ *  constant time with Welford updates (adding the new sample and removing the
+ *  oldest one). To bound the rounding drift of the removals, the moments are
+ *  also accumulated from zero without removals; after a full window, these
+ *  replace the running moments (re-centring), still in constant time.
+ *  The samples are kept in ring buffers given by the user.
+ */
+struct MovingStatsFloat {
+  float *x;                           ///< ring buffer of x samples (size)
+  float *y;                           ///< ring buffer of y samples (size)
+  uint32_t size;                      ///< window size
+  uint32_t idx;                       ///< index of the next sample in the buffers
+  struct MovingMomentsFloat m;        ///< moments of the window
+  struct MovingMomentsFloat shadow;   ///< moments of the samples since the last re-centring
+};
+
+/** Init sliding window statistics
+ *  The buffers are cleared.
+ *  @param s statistics
+ *  @param x buffer of size elements for x
+ *  @param y buffer of size elements for y, must not be x
+ *  @param size window size (> 0)
+ */
+extern void init_moving_stats_f(struct MovingStatsFloat *s, float *x, float *y, uint32_t size);
+
+/** Add a pair of samples, removing the oldest one if the window is full */
+extern void update_moving_stats_f(struct MovingStatsFloat *s, float x, float y);
+
+/** Get a past sample of x
+ *  @param lag number of updates ago (0 for the last sample), taken modulo the window size
+ *  @return sample, 0 if not received yet
+ */
+extern float moving_stats_past_x_f(struct MovingStatsFloat *s, uint32_t lag);
+
+/** Get a past sample of y, see moving_stats_past_x_f */
+extern float moving_stats_past_y_f(struct MovingStatsFloat *s, uint32_t lag);
+
+/** Covariance of the past x and the current y over the window
+ *  cov(x[t - lag], y[t]) over the n - lag pairs of the window,
+ *  computed with two passes over the buffers (linear time).
+ *  @param lag delay of x (samples)
+ *  @return covariance, 0 if the window has no more than lag samples
+ */
+extern float moving_stats_lag_covariance_f(struct MovingStatsFloat *s, uint32_t lag);
+
+/** Number of samples in the window */
+static inline uint32_t moving_stats_nb_f(struct MovingStatsFloat *s)
+{
+  return s->m.n;
+}
+
+static inline float moving_stats_mean_x_f(struct MovingStatsFloat *s)
+{
+  return s->m.mean_x;
+}
+
+static inline float moving_stats_mean_y_f(struct MovingStatsFloat *s)
+{
+  return s->m.mean_y;
+}
+
+/** Variance of x over the window, same normalization as variance_f */
+static inline float moving_stats_variance_x_f(struct MovingStatsFloat *s)
+{
+  return s->m.n > 0 ? s->m.m2_x / s->m.n : 0.f;
+}
+
+/** Variance of y over the window, same normalization as variance_f */
+static inline float moving_stats_variance_y_f(struct MovingStatsFloat *s)
+{
+  return s->m.n > 0 ? s->m.m2_y / s->m.n : 0.f;
+}
+
+/** Covariance of x and y over the window, same normalization as covariance_f */
+static inline float moving_stats_covariance_f(struct MovingStatsFloat *s)
+{
+  return s->m.n > 0 ? s->m.c_xy / s->m.n : 0.f;
+}
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,279 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_trig_float.c
+ * @brief Paparazzi floating point trig functions with selectable implementation.
+ *
+ */
+
+#include "pprz_trig_float.h"
+#include "pprz_trig_int.h"
+#include "pprz_algebra_int.h"
+
+/** pi/2 in three parts for the Cody-Waite reduction,
+ *  j * PI_2_A and j * PI_2_B are exact for |j| < 2^16 */
+#define PI_2_A 1.5703125f
+#define PI_2_B 4.837512969970703125e-4f
+#define PI_2_C 7.54978995489188216e-8f
+
+#define TAN_PI_8 0.414213562f
+
+/** sin on [0, pi/2], PPRZ_TRIG_FLOAT_LUT_SIZE + 1 points */
+static const float trig_lut_sin[PPRZ_TRIG_FLOAT_LUT_SIZE + 1] = {
+  0.00000000e+00f, 6.13588465e-03f, 1.22715383e-02f, 1.84067299e-02f, 2.45412285e-02f, 3.06748032e-02f,
+  3.68072229e-02f, 4.29382569e-02f, 4.90676743e-02f, 5.51952443e-02f, 6.13207363e-02f, 6.74439196e-02f,
+  7.35645636e-02f, 7.96824380e-02f, 8.57973123e-02f, 9.19089565e-02f, 9.80171403e-02f, 1.04121634e-01f,
+  1.10222207e-01f, 1.16318631e-01f, 1.22410675e-01f, 1.28498111e-01f, 1.34580709e-01f, 1.40658239e-01f,
+  1.46730474e-01f, 1.52797185e-01f, 1.58858143e-01f, 1.64913120e-01f, 1.70961889e-01f, 1.77004220e-01f,
+  1.83039888e-01f, 1.89068664e-01f, 1.95090322e-01f, 2.01104635e-01f, 2.07111376e-01f, 2.13110320e-01f,
+  2.19101240e-01f, 2.25083911e-01f, 2.31058108e-01f, 2.37023606e-01f, 2.42980180e-01f, 2.48927606e-01f,
+  2.54865660e-01f, 2.60794118e-01f, 2.66712757e-01f, 2.72621355e-01f, 2.78519689e-01f, 2.84407537e-01f,
+  2.90284677e-01f, 2.96150888e-01f, 3.02005949e-01f, 3.07849640e-01f, 3.13681740e-01f, 3.19502031e-01f,
+  3.25310292e-01f, 3.31106306e-01f, 3.36889853e-01f, 3.42660717e-01f, 3.48418680e-01f, 3.54163525e-01f,
+  3.59895037e-01f, 3.65612998e-01f, 3.71317194e-01f, 3.77007410e-01f, 3.82683432e-01f, 3.88345047e-01f,
+  3.93992040e-01f, 3.99624200e-01f, 4.05241314e-01f, 4.10843171e-01f, 4.16429560e-01f, 4.22000271e-01f,
+  4.27555093e-01f, 4.33093819e-01f, 4.38616239e-01f, 4.44122145e-01f, 4.49611330e-01f, 4.55083587e-01f,
+  4.60538711e-01f, 4.65976496e-01f, 4.71396737e-01f, 4.76799230e-01f, 4.82183772e-01f, 4.87550160e-01f,
+  4.92898192e-01f, 4.98227667e-01f, 5.03538384e-01f, 5.08830143e-01f, 5.14102744e-01f, 5.19355990e-01f,
+  5.24589683e-01f, 5.29803625e-01f, 5.34997620e-01f, 5.40171473e-01f, 5.45324988e-01f, 5.50457973e-01f,
+  5.55570233e-01f, 5.60661576e-01f, 5.65731811e-01f, 5.70780746e-01f, 5.75808191e-01f, 5.80813958e-01f,
+  5.85797857e-01f, 5.90759702e-01f, 5.95699304e-01f, 6.00616479e-01f, 6.05511041e-01f, 6.10382806e-01f,
+  6.15231591e-01f, 6.20057212e-01f, 6.24859488e-01f, 6.29638239e-01f, 6.34393284e-01f, 6.39124445e-01f,
+  6.43831543e-01f, 6.48514401e-01f, 6.53172843e-01f, 6.57806693e-01f, 6.62415778e-01f, 6.66999922e-01f,
+  6.71558955e-01f, 6.76092704e-01f, 6.80600998e-01f, 6.85083668e-01f, 6.89540545e-01f, 6.93971461e-01f,
+  6.98376249e-01f, 7.02754744e-01f, 7.07106781e-01f, 7.11432196e-01f, 7.15730825e-01f, 7.20002508e-01f,
+  7.24247083e-01f, 7.28464390e-01f, 7.32654272e-01f, 7.36816569e-01f, 7.40951125e-01f, 7.45057785e-01f,
+  7.49136395e-01f, 7.53186799e-01f, 7.57208847e-01f, 7.61202385e-01f, 7.65167266e-01f, 7.69103338e-01f,
+  7.73010453e-01f, 7.76888466e-01f, 7.80737229e-01f, 7.84556597e-01f, 7.88346428e-01f, 7.92106577e-01f,
+  7.95836905e-01f, 7.99537269e-01f, 8.03207531e-01f, 8.06847554e-01f, 8.10457198e-01f, 8.14036330e-01f,
+  8.17584813e-01f, 8.21102515e-01f, 8.24589303e-01f, 8.28045045e-01f, 8.31469612e-01f, 8.34862875e-01f,
+  8.38224706e-01f, 8.41554977e-01f, 8.44853565e-01f, 8.48120345e-01f, 8.51355193e-01f, 8.54557988e-01f,
+  8.57728610e-01f, 8.60866939e-01f, 8.63972856e-01f, 8.67046246e-01f, 8.70086991e-01f, 8.73094978e-01f,
+  8.76070094e-01f, 8.79012226e-01f, 8.81921264e-01f, 8.84797098e-01f, 8.87639620e-01f, 8.90448723e-01f,
+  8.93224301e-01f, 8.95966250e-01f, 8.98674466e-01f, 9.01348847e-01f, 9.03989293e-01f, 9.06595705e-01f,
+  9.09167983e-01f, 9.11706032e-01f, 9.14209756e-01f, 9.16679060e-01f, 9.19113852e-01f, 9.21514039e-01f,
+  9.23879533e-01f, 9.26210242e-01f, 9.28506080e-01f, 9.30766961e-01f, 9.32992799e-01f, 9.35183510e-01f,
+  9.37339012e-01f, 9.39459224e-01f, 9.41544065e-01f, 9.43593458e-01f, 9.45607325e-01f, 9.47585591e-01f,
+  9.49528181e-01f, 9.51435021e-01f, 9.53306040e-01f, 9.55141168e-01f, 9.56940336e-01f, 9.58703475e-01f,
+  9.60430519e-01f, 9.62121404e-01f, 9.63776066e-01f, 9.65394442e-01f, 9.66976471e-01f, 9.68522094e-01f,
+  9.70031253e-01f, 9.71503891e-01f, 9.72939952e-01f, 9.74339383e-01f, 9.75702130e-01f, 9.77028143e-01f,
+  9.78317371e-01f, 9.79569766e-01f, 9.80785280e-01f, 9.81963869e-01f, 9.83105487e-01f, 9.84210092e-01f,
+  9.85277642e-01f, 9.86308097e-01f, 9.87301418e-01f, 9.88257568e-01f, 9.89176510e-01f, 9.90058210e-01f,
+  9.90902635e-01f, 9.91709754e-01f, 9.92479535e-01f, 9.93211949e-01f, 9.93906970e-01f, 9.94564571e-01f,
+  9.95184727e-01f, 9.95767414e-01f, 9.96312612e-01f, 9.96820299e-01f, 9.97290457e-01f, 9.97723067e-01f,
+  9.98118113e-01f, 9.98475581e-01f, 9.98795456e-01f, 9.99077728e-01f, 9.99322385e-01f, 9.99529418e-01f,
+  9.99698819e-01f, 9.99830582e-01f, 9.99924702e-01f, 9.99981175e-01f, 1.00000000e+00f
+};
+
+/** atan on [0, 1], PPRZ_TRIG_FLOAT_LUT_SIZE + 1 points */
+static const float trig_lut_atan[PPRZ_TRIG_FLOAT_LUT_SIZE + 1] = {
+  0.00000000e+00f, 3.90623013e-03f, 7.81234106e-03f, 1.17182136e-02f, 1.56237286e-02f, 1.95287670e-02f,
+  2.34332099e-02f, 2.73369383e-02f, 3.12398334e-02f, 3.51417768e-02f, 3.90426500e-02f, 4.29423347e-02f,
+  4.68407129e-02f, 5.07376669e-02f, 5.46330792e-02f, 5.85268326e-02f, 6.24188100e-02f, 6.63088949e-02f,
+  7.01969711e-02f, 7.40829225e-02f, 7.79666338e-02f, 8.18479898e-02f, 8.57268758e-02f, 8.96031775e-02f,
+  9.34767812e-02f, 9.73475735e-02f, 1.01215442e-01f, 1.05080273e-01f, 1.08941957e-01f, 1.12800381e-01f,
+  1.16655435e-01f, 1.20507010e-01f, 1.24354995e-01f, 1.28199281e-01f, 1.32039762e-01f, 1.35876328e-01f,
+  1.39708874e-01f, 1.43537294e-01f, 1.47361481e-01f, 1.51181332e-01f, 1.54996742e-01f, 1.58807608e-01f,
+  1.62613829e-01f, 1.66415301e-01f, 1.70211925e-01f, 1.74003601e-01f, 1.77790229e-01f, 1.81571711e-01f,
+  1.85347950e-01f, 1.89118849e-01f, 1.92884312e-01f, 1.96644245e-01f, 2.00398554e-01f, 2.04147145e-01f,
+  2.07889927e-01f, 2.11626809e-01f, 2.15357700e-01f, 2.19082511e-01f, 2.22801154e-01f, 2.26513541e-01f,
+  2.30219587e-01f, 2.33919206e-01f, 2.37612314e-01f, 2.41298827e-01f, 2.44978663e-01f, 2.48651741e-01f,
+  2.52317981e-01f, 2.55977303e-01f, 2.59629629e-01f, 2.63274883e-01f, 2.66912988e-01f, 2.70543868e-01f,
+  2.74167451e-01f, 2.77783663e-01f, 2.81392433e-01f, 2.84993689e-01f, 2.88587362e-01f, 2.92173383e-01f,
+  2.95751686e-01f, 2.99322203e-01f, 3.02884868e-01f, 3.06439619e-01f, 3.09986391e-01f, 3.13525123e-01f,
+  3.17055753e-01f, 3.20578222e-01f, 3.24092470e-01f, 3.27598441e-01f, 3.31096077e-01f, 3.34585322e-01f,
+  3.38066123e-01f, 3.41538425e-01f, 3.45002177e-01f, 3.48457327e-01f, 3.51903825e-01f, 3.55341622e-01f,
+  3.58770670e-01f, 3.62190922e-01f, 3.65602332e-01f, 3.69004855e-01f, 3.72398447e-01f, 3.75783065e-01f,
+  3.79158669e-01f, 3.82525217e-01f, 3.85882669e-01f, 3.89230988e-01f, 3.92570135e-01f, 3.95900074e-01f,
+  3.99220770e-01f, 4.02532187e-01f, 4.05834293e-01f, 4.09127055e-01f, 4.12410442e-01f, 4.15684422e-01f,
+  4.18948967e-01f, 4.22204048e-01f, 4.25449637e-01f, 4.28685708e-01f, 4.31912235e-01f, 4.35129194e-01f,
+  4.38336560e-01f, 4.41534311e-01f, 4.44722424e-01f, 4.47900879e-01f, 4.51069656e-01f, 4.54228735e-01f,
+  4.57378099e-01f, 4.60517729e-01f, 4.63647609e-01f, 4.66767724e-01f, 4.69878058e-01f, 4.72978598e-01f,
+  4.76069330e-01f, 4.79150243e-01f, 4.82221324e-01f, 4.85282564e-01f, 4.88333951e-01f, 4.91375478e-01f,
+  4.94407135e-01f, 4.97428916e-01f, 5.00440813e-01f, 5.03442821e-01f, 5.06434934e-01f, 5.09417149e-01f,
+  5.12389460e-01f, 5.15351866e-01f, 5.18304364e-01f, 5.21246951e-01f, 5.24179629e-01f, 5.27102395e-01f,
+  5.30015251e-01f, 5.32918198e-01f, 5.35811238e-01f, 5.38694373e-01f, 5.41567605e-01f, 5.44430940e-01f,
+  5.47284381e-01f, 5.50127933e-01f, 5.52961602e-01f, 5.55785394e-01f, 5.58599315e-01f, 5.61403374e-01f,
+  5.64197577e-01f, 5.66981934e-01f, 5.69756453e-01f, 5.72521145e-01f, 5.75276018e-01f, 5.78021084e-01f,
+  5.80756354e-01f, 5.83481839e-01f, 5.86197551e-01f, 5.88903504e-01f, 5.91599710e-01f, 5.94286183e-01f,
+  5.96962937e-01f, 5.99629987e-01f, 6.02287346e-01f, 6.04935031e-01f, 6.07573058e-01f, 6.10201443e-01f,
+  6.12820202e-01f, 6.15429353e-01f, 6.18028912e-01f, 6.20618899e-01f, 6.23199330e-01f, 6.25770225e-01f,
+  6.28331602e-01f, 6.30883482e-01f, 6.33425883e-01f, 6.35958826e-01f, 6.38482330e-01f, 6.40996418e-01f,
+  6.43501109e-01f, 6.45996425e-01f, 6.48482388e-01f, 6.50959019e-01f, 6.53426341e-01f, 6.55884377e-01f,
+  6.58333148e-01f, 6.60772679e-01f, 6.63202993e-01f, 6.65624112e-01f, 6.68036062e-01f, 6.70438866e-01f,
+  6.72832548e-01f, 6.75217133e-01f, 6.77592646e-01f, 6.79959111e-01f, 6.82316555e-01f, 6.84665002e-01f,
+  6.87004478e-01f, 6.89335010e-01f, 6.91656622e-01f, 6.93969341e-01f, 6.96273194e-01f, 6.98568208e-01f,
+  7.00854408e-01f, 7.03131822e-01f, 7.05400477e-01f, 7.07660400e-01f, 7.09911618e-01f, 7.12154160e-01f,
+  7.14388052e-01f, 7.16613323e-01f, 7.18830000e-01f, 7.21038111e-01f, 7.23237685e-01f, 7.25428749e-01f,
+  7.27611333e-01f, 7.29785464e-01f, 7.31951171e-01f, 7.34108483e-01f, 7.36257429e-01f, 7.38398037e-01f,
+  7.40530337e-01f, 7.42654356e-01f, 7.44770126e-01f, 7.46877674e-01f, 7.48977029e-01f, 7.51068222e-01f,
+  7.53151281e-01f, 7.55226236e-01f, 7.57293116e-01f, 7.59351951e-01f, 7.61402770e-01f, 7.63445603e-01f,
+  7.65480479e-01f, 7.67507428e-01f, 7.69526480e-01f, 7.71537665e-01f, 7.73541012e-01f, 7.75536550e-01f,
+  7.77524310e-01f, 7.79504322e-01f, 7.81476615e-01f, 7.83441219e-01f, 7.85398163e-01f
+};
+
+/** Reduce x to r in [-pi/4, pi/4] with x = r + q * pi/2
+ * @return quadrant q modulo 4
+ */
+static inline int32_t trig_reduce(float x, float *r)
+{
+  const int32_t j = (int32_t)(x * (float)M_2_PI + (x < 0.f ? -0.5f : 0.5f));
+  const float fj = (float)j;
+  *r = ((x - fj * PI_2_A) - fj * PI_2_B) - fj * PI_2_C;
+  return j & 3;
+}
+
+/** Generate the sin, cos and sincos functions of an implementation
+ *  from its _sin and _cos kernels valid on [-pi/4, pi/4]
+ */
+#define TRIG_FLOAT_SINCOS(_impl)                                      \
+  float pprz_sinf_##_impl(float x)                                    \
+  {                                                                   \
+    float r;                                                          \
+    const int32_t q = trig_reduce(x, &r);                             \
+    const float v = (q & 1) ? _impl##_cos(r) : _impl##_sin(r);        \
+    return (q & 2) ? -v : v;                                          \
+  }                                                                   \
+  float pprz_cosf_##_impl(float x)                                    \
+  {                                                                   \
+    float r;                                                          \
+    const int32_t q = trig_reduce(x, &r);                             \
+    const float v = (q & 1) ? _impl##_sin(r) : _impl##_cos(r);        \
+    return ((q + 1) & 2) ? -v : v;                                    \
+  }                                                                   \
+  void pprz_sincosf_##_impl(float x, float *s, float *c)              \
+  {                                                                   \
+    float r;                                                          \
+    const int32_t q = trig_reduce(x, &r);                             \
+    const float sr = _impl##_sin(r);                                  \
+    const float cr = _impl##_cos(r);                                  \
+    *s = (q & 1) ? cr : sr;                                           \
+    *c = (q & 1) ? sr : cr;                                           \
+    if (q & 2) { *s = -*s; }                                          \
+    if ((q + 1) & 2) { *c = -*c; }                                    \
+  }
+
+/** Unfold the atan of the smallest ratio t = min(|x|,|y|) / max(|x|,|y|) */
+static inline float atan2_unfold(float a, float y, float x)
+{
+  if (fabsf(y) > fabsf(x)) {
+    a = (float)M_PI_2 - a;
+  }
+  if (signbit(x)) {
+    a = (float)M_PI - a;
+  }
+  return signbit(y) ? -a : a;
+}
+
+static inline float atan2_ratio(float y, float x)
+{
+  const float ax = fabsf(x);
+  const float ay = fabsf(y);
+  if (ay > ax) {
+    return ax / ay;
+  }
+  return (ax > 0.f) ? ay / ax : 0.f;
+}
+
+/*
+ * Minimax polynomials (Cephes), error ~1e-7 on [-pi/4, pi/4]
+ */
+
+static inline float poly_sin(float r)
+{
+  const float z = r * r;
+  return r + r * z * ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f);
+}
+
+static inline float poly_cos(float r)
+{
+  const float z = r * r;
+  return 1.f - 0.5f * z + z * z * ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f);
+}
+
+TRIG_FLOAT_SINCOS(poly)
+
+float pprz_atan2f_poly(float y, float x)
+{
+  float t = atan2_ratio(y, x);
+  float a = 0.f;
+  if (t > TAN_PI_8) {
+    t = (t - 1.f) / (t + 1.f);
+    a = (float)M_PI_4;
+  }
+  const float z = t * t;
+  a += t + t * z * (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z - 3.33329491539e-1f);
+  return atan2_unfold(a, y, x);
+}
+
+/*
+ * Look-up tables, interpolation error h^2/8 * max|f''|
+ */
+
+static inline float lut_interp(const float *tab, float f)
+{
+  int32_t i = (int32_t)f;
+  if (i >= PPRZ_TRIG_FLOAT_LUT_SIZE) {
+    i = PPRZ_TRIG_FLOAT_LUT_SIZE - 1;
+  }
+  return tab[i] + (f - i) * (tab[i + 1] - tab[i]);
+}
+
+static inline float lut_sin(float r)
+{
+  const float k = PPRZ_TRIG_FLOAT_LUT_SIZE / (float)M_PI_2;
+  return (r < 0.f) ? -lut_interp(trig_lut_sin, -r * k) : lut_interp(trig_lut_sin, r * k);
+}
+
+static inline float lut_cos(float r)
+{
+  const float k = PPRZ_TRIG_FLOAT_LUT_SIZE / (float)M_PI_2;
+  return lut_interp(trig_lut_sin, ((float)M_PI_2 - fabsf(r)) * k);
+}
+
+TRIG_FLOAT_SINCOS(lut)
+
+float pprz_atan2f_lut(float y, float x)
+{
+  const float a = lut_interp(trig_lut_atan, atan2_ratio(y, x) * PPRZ_TRIG_FLOAT_LUT_SIZE);
+  return atan2_unfold(a, y, x);
+}
+
+/*
+ * Fixed point tables, error dominated by the angle resolution (2^-13 rad)
+ */
+
+static inline int32_t int_angle(float r)
+{
+  return (int32_t)(r * (1 << INT32_ANGLE_FRAC) + (r < 0.f ? -0.5f : 0.5f));
+}
+
+static inline float int_sin(float r)
+{
+  return TRIG_FLOAT_OF_BFP(pprz_itrig_sin(int_angle(r)));
+}
+
+static inline float int_cos(float r)
+{
+  return TRIG_FLOAT_OF_BFP(pprz_itrig_cos(int_angle(r)));
+}
+
+TRIG_FLOAT_SINCOS(int)
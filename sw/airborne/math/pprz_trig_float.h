@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file pprz_trig_float.h
+ * @brief Paparazzi floating point trig functions with selectable implementation.
+ *
+ * pprz_sinf, pprz_cosf, pprz_sincosf and pprz_atan2f are mapped at compile
+ * time to one of the following implementations:
+ *  - default: libm (sinf, cosf, atan2f)
+ *  - PPRZ_TRIG_FLOAT_USE_POLY: minimax polynomials after reduction to [-pi/4, pi/4]
+ *  - PPRZ_TRIG_FLOAT_USE_LUT: flat tables (1 kB each) with linear interpolation
+ *  - PPRZ_TRIG_FLOAT_USE_INT: fixed point sine table of pprz_trig_int.h,
+ *    including its compressed variants (PPRZ_TRIG_INT_COMPR_FLASH)
+ *
+ * All implementations are always compiled and can be called directly
+ * (e.g. pprz_sinf_lut), which is used by the benchmarks
+ * (tests/math/test_pprz_trig.c on the host, test_math_trig_bench on the targets).
+ *
+ * The max absolute errors PPRZ_TRIG_FLOAT_xxx_ERR hold for sin and cos with
+ * |x| <= PPRZ_TRIG_FLOAT_RANGE and for atan2 on the whole plane.
+ * The integer implementation has no atan2 of matching accuracy and uses the
+ * polynomial one.
+ */
+
+#ifndef PPRZ_TRIG_FLOAT_H
+#define PPRZ_TRIG_FLOAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "std.h"
+#include <math.h>
+
+/** Range of the sin and cos error bounds (rad) */
+#define PPRZ_TRIG_FLOAT_RANGE 1000.f
+
+/** Max absolute error of each implementation */
+#define PPRZ_TRIG_FLOAT_LIBM_ERR  1e-6f
+#define PPRZ_TRIG_FLOAT_POLY_ERR  1e-6f
+#define PPRZ_TRIG_FLOAT_LUT_ERR   5e-6f
+#define PPRZ_TRIG_FLOAT_INT_ERR   2e-4f
+
+/** Number of intervals of the LUT implementation */
+#define PPRZ_TRIG_FLOAT_LUT_SIZE  256
+
+/* libm */
+static inline float pprz_sinf_libm(float x) { return sinf(x); }
+static inline float pprz_cosf_libm(float x) { return cosf(x); }
+static inline float pprz_atan2f_libm(float y, float x) { return atan2f(y, x); }
+static inline void pprz_sincosf_libm(float x, float *s, float *c)
+{
+  *s = sinf(x);
+  *c = cosf(x);
+}
+
+/* minimax polynomials */
+extern float pprz_sinf_poly(float x);
+extern float pprz_cosf_poly(float x);
+extern void pprz_sincosf_poly(float x, float *s, float *c);
+extern float pprz_atan2f_poly(float y, float x);
+
+/* look-up tables with linear interpolation */
+extern float pprz_sinf_lut(float x);
+extern float pprz_cosf_lut(float x);
+extern void pprz_sincosf_lut(float x, float *s, float *c);
+extern float pprz_atan2f_lut(float y, float x);
+
+/* fixed point tables */
+extern float pprz_sinf_int(float x);
+extern float pprz_cosf_int(float x);
+extern void pprz_sincosf_int(float x, float *s, float *c);
+#define pprz_atan2f_int pprz_atan2f_poly
+
+#if defined(PPRZ_TRIG_FLOAT_USE_POLY)
+#define PPRZ_TRIG_FLOAT_IMPL(_f) _f##_poly
+#define PPRZ_TRIG_FLOAT_ERR PPRZ_TRIG_FLOAT_POLY_ERR
+#elif defined(PPRZ_TRIG_FLOAT_USE_LUT)
+#define PPRZ_TRIG_FLOAT_IMPL(_f) _f##_lut
+#define PPRZ_TRIG_FLOAT_ERR PPRZ_TRIG_FLOAT_LUT_ERR
+#elif defined(PPRZ_TRIG_FLOAT_USE_INT)
+#define PPRZ_TRIG_FLOAT_IMPL(_f) _f##_int
+#define PPRZ_TRIG_FLOAT_ERR PPRZ_TRIG_FLOAT_INT_ERR
+#else
+#define PPRZ_TRIG_FLOAT_IMPL(_f) _f##_libm
+#define PPRZ_TRIG_FLOAT_ERR PPRZ_TRIG_FLOAT_LIBM_ERR
+#endif
+
+/** Common API, see above for the implementation selection */
+#define pprz_sinf PPRZ_TRIG_FLOAT_IMPL(pprz_sinf)
+#define pprz_cosf PPRZ_TRIG_FLOAT_IMPL(pprz_cosf)
+#define pprz_sincosf PPRZ_TRIG_FLOAT_IMPL(pprz_sincosf)
+#define pprz_atan2f PPRZ_TRIG_FLOAT_IMPL(pprz_atan2f)
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* PPRZ_TRIG_FLOAT_H */
@@ -856,20 +856,30 @@ inline int16_t pprz_trig_int_f(int32_t angle)
 
 #endif // PPRZ_TRIG_INT_COMPR_FLASH
 
+/** Rounded angles for the reduction (INT32_ANGLE_PI and INT32_ANGLE_2_PI are
+ *  truncated, which adds up to 2.3e-4 rad of error at each folding) */
+#define TRIG_INT_PI_2 ((int32_t)(M_PI_2 * (1 << INT32_ANGLE_FRAC) + 0.5))
+#define TRIG_INT_PI   ((int32_t)(M_PI * (1 << INT32_ANGLE_FRAC) + 0.5))
+#define TRIG_INT_2_PI ((int32_t)(2. * M_PI * (1 << INT32_ANGLE_FRAC) + 0.5))
+
+#define TRIG_INT_NORMALIZE(_a) {                     \
+    while ((_a) > TRIG_INT_PI)  (_a) -= TRIG_INT_2_PI; \
+    while ((_a) < -TRIG_INT_PI) (_a) += TRIG_INT_2_PI; \
+  }
+
 int32_t pprz_itrig_sin(int32_t angle)
 {
 #if defined(PPRZ_TRIG_INT_USE_FLOAT)
   float tmp;
   tmp = ANGLE_FLOAT_OF_BFP(angle);
   tmp = sinf(tmp);
-  angle = ANGLE_BFP_OF_REAL(tmp);
-  return angle;
+  return TRIG_BFP_OF_REAL(tmp);
 #else
-  INT32_ANGLE_NORMALIZE(angle);
-  if (angle > INT32_ANGLE_PI_2) {
-    angle = INT32_ANGLE_PI - angle;
-  } else if (angle < -INT32_ANGLE_PI_2) {
-    angle = -INT32_ANGLE_PI - angle;
+  TRIG_INT_NORMALIZE(angle);
+  if (angle > TRIG_INT_SIZE - 1) {
+    angle = Min(TRIG_INT_PI - angle, TRIG_INT_SIZE - 1);
+  } else if (angle < -(TRIG_INT_SIZE - 1)) {
+    angle = Max(-TRIG_INT_PI - angle, -(TRIG_INT_SIZE - 1));
   }
   if (angle >= 0) {
 #if defined(PPRZ_TRIG_INT_COMPR_FLASH)
@@ -887,7 +897,7 @@ int32_t pprz_itrig_sin(int32_t angle)
 
 int32_t pprz_itrig_cos(int32_t angle)
 {
-  return pprz_itrig_sin(angle + INT32_ANGLE_PI_2);
+  return pprz_itrig_sin(angle + TRIG_INT_PI_2);
 }
 
 
@@ -928,11 +938,13 @@ int32_t int32_atan2_2(int32_t y, int32_t x)
   if (x >= 0) {
     r = ((x - abs_y) << R_FRAC) / (x + abs_y);
     int32_t r2 = (r * r) >> R_FRAC;
-    int32_t tmp1 = ((r2 * (int32_t)ANGLE_BFP_OF_REAL(0.1963)) >> INT32_ANGLE_FRAC) - ANGLE_BFP_OF_REAL(0.9817);
+    int32_t tmp1 = ((r2 * (int32_t)ANGLE_BFP_OF_REAL(0.1963)) >> R_FRAC) - ANGLE_BFP_OF_REAL(0.9817);
     a = ((tmp1 * r) >> R_FRAC) + c1;
   } else {
     r = ((x + abs_y) << R_FRAC) / (abs_y - x);
-    a = c2 - ((c1 * r) >> R_FRAC);
+    int32_t r2 = (r * r) >> R_FRAC;
+    int32_t tmp1 = ((r2 * (int32_t)ANGLE_BFP_OF_REAL(0.1963)) >> R_FRAC) - ANGLE_BFP_OF_REAL(0.9817);
+    a = ((tmp1 * r) >> R_FRAC) + c2;
   }
   if (y < 0) {
     return -a;  // negate if in quad III or IV
@@ -263,6 +263,9 @@ void mcu_event(void)
 #if USING_SOFTI2C
   softi2c_event();
 #endif
+#if USE_SPI && SPI_ARCH_HAS_EVENT
+  spi_event();
+#endif
 
 #if USE_USB_SERIAL
   VCOM_event();
@@ -292,6 +292,11 @@ int WEAK uart_char_available(struct uart_periph *p)
   return available;
 }
 
+uint16_t WEAK uart_get_bytes(struct uart_periph *p, uint8_t *buf, uint16_t len)
+{
+  return uart_rx_buf_extract(p, buf, len);
+}
+
 void WEAK uart_arch_init(void)
 {
 }
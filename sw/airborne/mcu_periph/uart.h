@@ -31,6 +31,7 @@
 #include "mcu_periph/uart_arch.h"
 #include "pprzlink/pprzlink_device.h"
 #include "std.h"
+#include <string.h>
 
 #ifndef UART_RX_BUFFER_SIZE
 #if defined STM32F4 || defined STM32F7 //the F4 and F7 have enough memory
@@ -110,6 +111,35 @@ extern uint8_t uart_getch(struct uart_periph *p);
  */
 extern int uart_char_available(struct uart_periph *p);
 
+/**
+ * Get several bytes from the receive buffer.
+ * Reads a whole span of received data at once instead of one call
+ * to uart_getch per byte.
+ * @param p uart peripheral
+ * @param buf output buffer
+ * @param len max number of bytes to read
+ * @return number of bytes read
+ */
+extern uint16_t uart_get_bytes(struct uart_periph *p, uint8_t *buf, uint16_t len);
+
+/**
+ * Copy bytes from the receive buffer, without locking.
+ * To be used by the arch implementations of uart_get_bytes.
+ */
+static inline uint16_t uart_rx_buf_extract(struct uart_periph *p, uint8_t *buf, uint16_t len)
+{
+  int available = p->rx_insert_idx - p->rx_extract_idx;
+  if (available < 0) {
+    available += UART_RX_BUFFER_SIZE;
+  }
+  const uint16_t n = Min(len, (uint16_t)available);
+  const uint16_t first = Min(n, UART_RX_BUFFER_SIZE - p->rx_extract_idx);
+  memcpy(buf, &p->rx_buf[p->rx_extract_idx], first);
+  memcpy(buf + first, p->rx_buf, n - first);
+  p->rx_extract_idx = (p->rx_extract_idx + n) % UART_RX_BUFFER_SIZE;
+  return n;
+}
+
 
 extern void uart_arch_init(void);
 
@@ -35,7 +35,17 @@
 #include "generated/airframe.h"
 #include "subsystems/ahrs/ahrs_magnetic_field_model.h"
 #include "subsystems/datalink/telemetry.h"
+
+// Use the generic square-root UKF instead of TRICAL, with the same model
+#ifndef MAG_CALIB_UKF_SRUKF
+#define MAG_CALIB_UKF_SRUKF FALSE
+#endif
+
+#if MAG_CALIB_UKF_SRUKF
+#include "math/pprz_srukf_float.h"
+#else
 #include "TRICAL.h"
+#endif
 
 //
 // Try to print warnings to user for bad configuration
@@ -116,11 +126,47 @@ PRINT_CONFIG_VAR(MAG_CALIB_UKF_HOTSTART)
 #endif
 PRINT_CONFIG_VAR(MAG_CALIB_UKF_HOTSTART_SAVE_FILE)
 
+#if MAG_CALIB_UKF_SRUKF
+
+#if SRUKF_MAX_N < 12
+#error "mag_calib_ukf needs SRUKF_MAX_N >= 12"
+#endif
+
+/** Initial variance of the bias */
+#ifndef MAG_CALIB_UKF_P0_BIAS
+#define MAG_CALIB_UKF_P0_BIAS 1.0f
+#endif
+PRINT_CONFIG_VAR(MAG_CALIB_UKF_P0_BIAS)
+
+/** Initial variance of the scale factors */
+#ifndef MAG_CALIB_UKF_P0_SCALE
+#define MAG_CALIB_UKF_P0_SCALE 0.1f
+#endif
+PRINT_CONFIG_VAR(MAG_CALIB_UKF_P0_SCALE)
+
+/** Process noise variance, allows slow changes of the calibration */
+#ifndef MAG_CALIB_UKF_PROCESS_NOISE
+#define MAG_CALIB_UKF_PROCESS_NOISE 1e-8f
+#endif
+PRINT_CONFIG_VAR(MAG_CALIB_UKF_PROCESS_NOISE)
+
+#endif
+
 bool mag_calib_ukf_reset_state = false;
 bool mag_calib_ukf_send_state = false;
 struct Int32Vect3 calibrated_mag;
 
+#if MAG_CALIB_UKF_SRUKF
+/* state: bias (3), scale factor matrix less identity (3x3, column major), constant
+ * measurement: calibrated measurement, compared to the expected field times the norm
+ */
+static struct SrUkfFloat mag_calib;
+static float mag_calib_raw[3];
+#define MAG_CALIB_STATE mag_calib.x
+#else
 static TRICAL_instance_t mag_calib;
+#define MAG_CALIB_STATE mag_calib.state
+#endif
 static abi_event mag_ev;
 static abi_event h_ev;
 
@@ -131,15 +177,83 @@ static FILE *fp;
 static char hotstart_file_name[512];
 #endif
 
+#if MAG_CALIB_UKF_SRUKF
+static void mag_calib_calibrate(const float *state, const float *measurement, float *calibrated)
+{
+  const float v[3] = {
+    measurement[0] - state[0],
+    measurement[1] - state[1],
+    measurement[2] - state[2]
+  };
+  for (int i = 0; i < 3; i++) {
+    calibrated[i] = v[i] + state[3 + i] * v[0] + state[6 + i] * v[1] + state[9 + i] * v[2];
+  }
+}
+
+static void mag_calib_measure(float *y, const float *x, void *user)
+{
+  mag_calib_calibrate(x, (const float *)user, y);
+}
+
+static void mag_calib_reset(void)
+{
+  static const float x0[12] = { 0.f };
+  float p0[12], q[12];
+  const float r[3] = {
+    MAG_CALIB_UKF_NOISE_RMS * MAG_CALIB_UKF_NOISE_RMS,
+    MAG_CALIB_UKF_NOISE_RMS * MAG_CALIB_UKF_NOISE_RMS,
+    MAG_CALIB_UKF_NOISE_RMS * MAG_CALIB_UKF_NOISE_RMS
+  };
+  for (int i = 0; i < 12; i++) {
+    p0[i] = i < 3 ? MAG_CALIB_UKF_P0_BIAS : MAG_CALIB_UKF_P0_SCALE;
+    q[i] = MAG_CALIB_UKF_PROCESS_NOISE;
+  }
+  srukf_set_state(&mag_calib, x0, p0);
+  srukf_set_process_noise(&mag_calib, q);
+  srukf_set_measurement_noise(&mag_calib, r);
+}
+
+static void mag_calib_estimate(float *measurement, float *expected_field)
+{
+  float z[3];
+  for (int i = 0; i < 3; i++) {
+    mag_calib_raw[i] = measurement[i];
+    z[i] = expected_field[i] * MAG_CALIB_UKF_NORM;
+  }
+  srukf_predict(&mag_calib, 0.f);
+  srukf_update(&mag_calib, z);
+}
+#else
+static void mag_calib_calibrate(const float *state __attribute__((unused)), float *measurement, float *calibrated)
+{
+  TRICAL_measurement_calibrate(&mag_calib, measurement, calibrated);
+}
+
+static void mag_calib_reset(void)
+{
+  TRICAL_reset(&mag_calib);
+}
+
+static void mag_calib_estimate(float *measurement, float *expected_field)
+{
+  TRICAL_estimate_update(&mag_calib, measurement, expected_field);
+}
+#endif
+
 void mag_calib_ukf_init(void)
 {
+#if MAG_CALIB_UKF_SRUKF
+  srukf_init(&mag_calib, 12, 3, NULL, mag_calib_measure, mag_calib_raw);
+  mag_calib_reset();
+#else
   TRICAL_init(&mag_calib);
   TRICAL_norm_set(&mag_calib, MAG_CALIB_UKF_NORM);
   TRICAL_noise_set(&mag_calib, MAG_CALIB_UKF_NOISE_RMS);
+#endif
   mag_calib_hotstart_read();
 #ifdef MAG_CALIB_UKF_INITIAL_STATE
   float initial_state[12] = MAG_CALIB_UKF_INITIAL_STATE;
-  memcpy(&mag_calib.state, &initial_state, 12 * sizeof(float));
+  memcpy(MAG_CALIB_STATE, &initial_state, 12 * sizeof(float));
 #endif
   AbiBindMsgIMU_MAG_INT32(MAG_CALIB_UKF_ABI_BIND_ID, &mag_ev, mag_calib_ukf_run);
   AbiBindMsgGEO_MAG(ABI_BROADCAST, &h_ev, mag_calib_update_field);    ///< GEO_MAG_SENDER_ID is defined in geo_mag.c so unknown
@@ -159,7 +273,7 @@ void mag_calib_ukf_run(uint8_t sender_id, uint32_t stamp, struct Int32Vect3 *mag
       mag_calib_ukf_send_state = false;
     }
     if (mag_calib_ukf_reset_state) {
-      TRICAL_reset(&mag_calib);
+      mag_calib_reset();
       mag_calib_ukf_reset_state = false;
     }
     /** Update magnetometer UKF and calibrate measurement **/
@@ -173,8 +287,8 @@ void mag_calib_ukf_run(uint8_t sender_id, uint32_t stamp, struct Int32Vect3 *mag
       measurement[0] = MAG_FLOAT_OF_BFP(mag->x);
       measurement[1] = MAG_FLOAT_OF_BFP(mag->y);
       measurement[2] = MAG_FLOAT_OF_BFP(mag->z);
-      TRICAL_estimate_update(&mag_calib, measurement, expected_mag_field);
-      TRICAL_measurement_calibrate(&mag_calib, measurement, calibrated_measurement);
+      mag_calib_estimate(measurement, expected_mag_field);
+      mag_calib_calibrate(MAG_CALIB_STATE, measurement, calibrated_measurement);
       /** Save calibrated result **/
       calibrated_mag.x = (int32_t) MAG_BFP_OF_REAL(calibrated_measurement[0]);
       calibrated_mag.y = (int32_t) MAG_BFP_OF_REAL(calibrated_measurement[1]);
@@ -185,7 +299,7 @@ void mag_calib_ukf_run(uint8_t sender_id, uint32_t stamp, struct Int32Vect3 *mag
 
       /** Debug print */
       VERBOSE_PRINT("magnetometer measurement (x: %4.2f  y: %4.2f  z: %4.2f) norm: %4.2f\n", measurement[0], measurement[1], measurement[2], hypot(hypot(measurement[0], measurement[1]), measurement[2]));
-      VERBOSE_PRINT("magnetometer bias_f      (x: %4.2f  y: %4.2f  z: %4.2f)\n", mag_calib.state[0], mag_calib.state[1],  mag_calib.state[2]);
+      VERBOSE_PRINT("magnetometer bias_f      (x: %4.2f  y: %4.2f  z: %4.2f)\n", MAG_CALIB_STATE[0], MAG_CALIB_STATE[1],  MAG_CALIB_STATE[2]);
       VERBOSE_PRINT("expected measurement     (x: %4.2f  y: %4.2f  z: %4.2f) norm: %4.2f\n", expected_mag_field[0], expected_mag_field[1], expected_mag_field[2], hypot(hypot(expected_mag_field[0], expected_mag_field[1]), expected_mag_field[2]));
       VERBOSE_PRINT("calibrated   measurement (x: %4.2f  y: %4.2f  z: %4.2f) norm: %4.2f\n\n", calibrated_measurement[0], calibrated_measurement[1], calibrated_measurement[2], hypot(hypot(calibrated_measurement[0], calibrated_measurement[1]), calibrated_measurement[2]));
       /** Forward calibrated data */
@@ -209,7 +323,7 @@ void mag_calib_update_field(uint8_t __attribute__((unused)) sender_id, struct Fl
 
 void mag_calib_send_state(void)
 {
-  DOWNLINK_SEND_PAYLOAD_FLOAT(DefaultChannel, DefaultDevice, 12, mag_calib.state);
+  DOWNLINK_SEND_PAYLOAD_FLOAT(DefaultChannel, DefaultDevice, 12, MAG_CALIB_STATE);
 }
 
 void mag_calib_hotstart_read(void)
@@ -218,17 +332,17 @@ void mag_calib_hotstart_read(void)
   snprintf(hotstart_file_name, 512, "%s", STRINGIFY(MAG_CALIB_UKF_HOTSTART_SAVE_FILE));
   fp = fopen(hotstart_file_name, "r");
   if (fp != NULL) {
-    fread(mag_calib.state, sizeof(float), 12, fp);
+    fread(MAG_CALIB_STATE, sizeof(float), 12, fp);
     fclose(fp);
     VERBOSE_PRINT("Loaded initial state from disk:\n"
                   "bias  {%4.2f, %4.2f, %4.2f}\n"
                   "scale {%4.2f, %4.2f, %4.2f}\n"
                   "      {%4.2f, %4.2f, %4.2f}\n"
                   "      {%4.2f, %4.2f, %4.2f}\n",
-                  mag_calib.state[0], mag_calib.state[1],  mag_calib.state[2],
-                  mag_calib.state[3], mag_calib.state[4],  mag_calib.state[5],
-                  mag_calib.state[6], mag_calib.state[7],  mag_calib.state[8],
-                  mag_calib.state[9], mag_calib.state[10], mag_calib.state[11]
+                  MAG_CALIB_STATE[0], MAG_CALIB_STATE[1],  MAG_CALIB_STATE[2],
+                  MAG_CALIB_STATE[3], MAG_CALIB_STATE[4],  MAG_CALIB_STATE[5],
+                  MAG_CALIB_STATE[6], MAG_CALIB_STATE[7],  MAG_CALIB_STATE[8],
+                  MAG_CALIB_STATE[9], MAG_CALIB_STATE[10], MAG_CALIB_STATE[11]
                  );
   }
 #endif
@@ -239,17 +353,17 @@ void mag_calib_hotstart_write(void)
 #if USE_MAGNETOMETER && MAG_CALIB_UKF_HOTSTART
   fp = fopen(hotstart_file_name, "w");
   if (fp != NULL) {
-    fwrite(mag_calib.state, sizeof(float), 12, fp);
+    fwrite(MAG_CALIB_STATE, sizeof(float), 12, fp);
     fclose(fp);
     VERBOSE_PRINT("Wrote current state to disk:\n"
                   "bias  {%4.2f, %4.2f, %4.2f}\n"
                   "scale {%4.2f, %4.2f, %4.2f}\n"
                   "      {%4.2f, %4.2f, %4.2f}\n"
                   "      {%4.2f, %4.2f, %4.2f}\n",
-                  mag_calib.state[0], mag_calib.state[1],  mag_calib.state[2],
-                  mag_calib.state[3], mag_calib.state[4],  mag_calib.state[5],
-                  mag_calib.state[6], mag_calib.state[7],  mag_calib.state[8],
-                  mag_calib.state[9], mag_calib.state[10], mag_calib.state[11]
+                  MAG_CALIB_STATE[0], MAG_CALIB_STATE[1],  MAG_CALIB_STATE[2],
+                  MAG_CALIB_STATE[3], MAG_CALIB_STATE[4],  MAG_CALIB_STATE[5],
+                  MAG_CALIB_STATE[6], MAG_CALIB_STATE[7],  MAG_CALIB_STATE[8],
+                  MAG_CALIB_STATE[9], MAG_CALIB_STATE[10], MAG_CALIB_STATE[11]
                  );
   }
 #endif
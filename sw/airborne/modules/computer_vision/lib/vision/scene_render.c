@@ -0,0 +1,453 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/computer_vision/lib/vision/scene_render.c
+ * CPU renderer of simple synthetic scenes for simulated cameras.
+ */
+
+#include "scene_render.h"
+#include "undistortion.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+/** Beyond this distance, the ground is drawn with its mean color (m) */
+#ifndef SCENE_RENDER_FAR
+#define SCENE_RENDER_FAR 500.f
+#endif
+
+static const struct SceneColor scene_black = { 0, 128, 128 };
+
+/** Render state of one image, shared by the threads */
+struct render_job {
+  const struct SceneRender *scene;
+  const struct SceneCamera *cam;
+  const float *r;                                 ///< ltp_to_cam, row major
+  struct FloatVect3 pos;
+  float inv_cell;                                 ///< inverse of the ground cell size
+  struct FloatVect3 box_pos[SCENE_RENDER_MAX_BOXES];  ///< camera position in the box frames
+  struct FloatVect3 box_dir[SCENE_RENDER_MAX_BOXES];  ///< unit vector to the box in camera frame
+  float box_cos[SCENE_RENDER_MAX_BOXES];  ///< cos and sin of the half angle of the box bounding sphere,
+  float box_sin[SCENE_RENDER_MAX_BOXES];  ///< cos < -1 if the camera is in the sphere
+  uint8_t *buf;
+  int nb_tiles;
+  atomic_int next_tile;
+};
+
+void scene_render_init(struct SceneRender *scene)
+{
+  scene->nb_boxes = 0;
+  scene->ground_cell = 0.25f;
+  scene->seed = 0x5eed;
+  scene->ground = (struct SceneColor) { 110, 118, 124 };
+  scene->sky = (struct SceneColor) { 200, 150, 110 };
+}
+
+bool scene_render_add_box(struct SceneRender *scene, struct FloatVect3 *center, struct FloatVect3 *half,
+                          float psi, struct SceneColor color)
+{
+  if (scene->nb_boxes >= SCENE_RENDER_MAX_BOXES) {
+    return false;
+  }
+  struct SceneBox *b = &scene->boxes[scene->nb_boxes++];
+  b->center = *center;
+  b->half = *half;
+  b->cpsi = cosf(psi);
+  b->spsi = sinf(psi);
+  b->color = color;
+  return true;
+}
+
+bool scene_render_add_pole(struct SceneRender *scene, float x, float y, float width, float height,
+                           struct SceneColor color)
+{
+  struct FloatVect3 c = { x, y, -height / 2.f };
+  struct FloatVect3 h = { width / 2.f, width / 2.f, height / 2.f };
+  return scene_render_add_box(scene, &c, &h, 0.f, color);
+}
+
+bool scene_render_add_wall(struct SceneRender *scene, float x1, float y1, float x2, float y2,
+                           float height, float thickness, struct SceneColor color)
+{
+  const float dx = x2 - x1;
+  const float dy = y2 - y1;
+  const float len = sqrtf(dx * dx + dy * dy);
+  const int nb = Max((int)ceilf(len / SCENE_RENDER_WALL_SEGMENT), 1);
+  if (scene->nb_boxes + nb > SCENE_RENDER_MAX_BOXES) {
+    return false;
+  }
+  // segments of equal length, sharing their end faces
+  struct FloatVect3 h = { len / nb / 2.f, thickness / 2.f, height / 2.f };
+  for (int i = 0; i < nb; i++) {
+    const float k = (i + 0.5f) / nb;
+    struct FloatVect3 c = { x1 + k * dx, y1 + k * dy, -height / 2.f };
+    scene_render_add_box(scene, &c, &h, atan2f(dy, dx), color);
+  }
+  return true;
+}
+
+bool scene_render_add_gate(struct SceneRender *scene, struct FloatVect3 *center, float psi, float size,
+                           float bar, struct SceneColor color)
+{
+  // lateral axis of the gate, normal to its heading
+  const float lx = -sinf(psi);
+  const float ly = cosf(psi);
+  const float o = size / 2.f + bar / 2.f;
+  const float bottom = center->z + o;
+  const bool stand = bottom + bar / 2.f < 0.f;
+  if (scene->nb_boxes + 4 + (stand ? 1 : 0) > SCENE_RENDER_MAX_BOXES) {
+    return false;
+  }
+  struct FloatVect3 c, h;
+  // posts, covering the corners
+  VECT3_ASSIGN(h, bar / 2.f, bar / 2.f, size / 2.f + bar);
+  VECT3_ASSIGN(c, center->x + lx * o, center->y + ly * o, center->z);
+  scene_render_add_box(scene, &c, &h, psi, color);
+  VECT3_ASSIGN(c, center->x - lx * o, center->y - ly * o, center->z);
+  scene_render_add_box(scene, &c, &h, psi, color);
+  // top and bottom bars
+  VECT3_ASSIGN(h, bar / 2.f, size / 2.f, bar / 2.f);
+  VECT3_ASSIGN(c, center->x, center->y, center->z - o);
+  scene_render_add_box(scene, &c, &h, psi, color);
+  VECT3_ASSIGN(c, center->x, center->y, bottom);
+  scene_render_add_box(scene, &c, &h, psi, color);
+  if (stand) {
+    const struct SceneColor grey = { 90, 128, 128 };
+    scene_render_add_pole(scene, center->x, center->y, bar, -(bottom + bar / 2.f), grey);
+  }
+  return true;
+}
+
+void scene_render_default(struct SceneRender *scene)
+{
+  const struct SceneColor orange = { 146, 53, 193 };
+  const struct SceneColor red = { 82, 90, 240 };
+  const struct SceneColor white = { 220, 128, 128 };
+  const struct SceneColor wall = { 150, 160, 110 };
+  struct FloatVect3 c;
+
+  // a loop of four gates around (5, 5)
+  VECT3_ASSIGN(c, 5.f, 0.f, -1.5f);
+  scene_render_add_gate(scene, &c, 0.f, 1.4f, 0.15f, orange);
+  VECT3_ASSIGN(c, 10.f, 5.f, -1.5f);
+  scene_render_add_gate(scene, &c, M_PI_2, 1.4f, 0.15f, orange);
+  VECT3_ASSIGN(c, 5.f, 10.f, -1.5f);
+  scene_render_add_gate(scene, &c, M_PI, 1.4f, 0.15f, orange);
+  VECT3_ASSIGN(c, 0.f, 5.f, -1.5f);
+  scene_render_add_gate(scene, &c, -M_PI_2, 1.4f, 0.15f, orange);
+  // poles inside the loop
+  scene_render_add_pole(scene, 3.f, 3.f, 0.2f, 3.f, red);
+  scene_render_add_pole(scene, 7.f, 7.f, 0.2f, 3.f, white);
+  scene_render_add_pole(scene, 3.f, 7.f, 0.2f, 3.f, red);
+  scene_render_add_pole(scene, 7.f, 3.f, 0.2f, 3.f, white);
+  // walls around the course
+  scene_render_add_wall(scene, -10.f, -10.f, 20.f, -10.f, 4.f, 0.3f, wall);
+  scene_render_add_wall(scene, 20.f, -10.f, 20.f, 20.f, 4.f, 0.3f, wall);
+  scene_render_add_wall(scene, 20.f, 20.f, -10.f, 20.f, 4.f, 0.3f, wall);
+  scene_render_add_wall(scene, -10.f, 20.f, -10.f, -10.f, 4.f, 0.3f, wall);
+}
+
+int scene_camera_init(struct SceneCamera *cam, uint16_t w, uint16_t h, float fx, float fy, float cx, float cy,
+                      float k)
+{
+  const float K[9] = { fx, 0.f, cx, 0.f, fy, cy, 0.f, 0.f, 1.f };
+  cam->w = w & ~1;
+  cam->h = h;
+  cam->tiles_x = (cam->w + SCENE_RENDER_TILE_SIZE - 1) / SCENE_RENDER_TILE_SIZE;
+  cam->tiles_y = (cam->h + SCENE_RENDER_TILE_SIZE - 1) / SCENE_RENDER_TILE_SIZE;
+  cam->rays = malloc(sizeof(float) * 3 * cam->w * cam->h);
+  cam->cones = malloc(sizeof(struct SceneTileCone) * cam->tiles_x * cam->tiles_y);
+  if (cam->rays == NULL || cam->cones == NULL) {
+    scene_camera_free(cam);
+    return -1;
+  }
+  float *ray = cam->rays;
+  for (int y = 0; y < cam->h; y++) {
+    for (int x = 0; x < cam->w; x++, ray += 3) {
+      float x_nd, y_nd, x_n = 0.f, y_n = 0.f;
+      pixels_to_normalized(x, y, &x_nd, &y_nd, K);
+      if ((x_nd != 0.f || y_nd != 0.f) && !Dhane_undistortion(x_nd, y_nd, &x_n, &y_n, k)) {
+        // outside of the lens
+        ray[0] = ray[1] = ray[2] = 0.f;
+        continue;
+      }
+      ray[0] = x_n;
+      ray[1] = y_n;
+      ray[2] = 1.f;
+    }
+  }
+
+  // bounding cone of the rays of each tile: mean direction and widest angle
+  struct SceneTileCone *cone = cam->cones;
+  for (int ty = 0; ty < cam->tiles_y; ty++) {
+    for (int tx = 0; tx < cam->tiles_x; tx++, cone++) {
+      const int x0 = tx * SCENE_RENDER_TILE_SIZE, x1 = Min(x0 + SCENE_RENDER_TILE_SIZE, cam->w);
+      const int y0 = ty * SCENE_RENDER_TILE_SIZE, y1 = Min(y0 + SCENE_RENDER_TILE_SIZE, cam->h);
+      struct FloatVect3 a = { 0.f, 0.f, 0.f };
+      for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+          ray = &cam->rays[3 * (y * cam->w + x)];
+          const float n = sqrtf(ray[0] * ray[0] + ray[1] * ray[1] + ray[2] * ray[2]);
+          if (n > 0.f) {
+            a.x += ray[0] / n;
+            a.y += ray[1] / n;
+            a.z += ray[2] / n;
+          }
+        }
+      }
+      const float na = sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+      if (na == 0.f) {
+        cone->cos = 2.f;
+        cone->sin = 0.f;
+        continue;
+      }
+      VECT3_SDIV(cone->axis, a, na);
+      float c = 1.f;
+      for (int y = y0; y < y1; y++) {
+        for (int x = x0; x < x1; x++) {
+          ray = &cam->rays[3 * (y * cam->w + x)];
+          const float n = sqrtf(ray[0] * ray[0] + ray[1] * ray[1] + ray[2] * ray[2]);
+          if (n > 0.f) {
+            c = Min(c, (ray[0] * cone->axis.x + ray[1] * cone->axis.y + ray[2] * cone->axis.z) / n);
+          }
+        }
+      }
+      // keep a margin for the rounding errors
+      c = Max(c - 1e-4f, -1.f);
+      cone->cos = c;
+      cone->sin = sqrtf(1.f - c * c);
+    }
+  }
+  return 0;
+}
+
+void scene_camera_free(struct SceneCamera *cam)
+{
+  free(cam->rays);
+  free(cam->cones);
+  cam->rays = NULL;
+  cam->cones = NULL;
+}
+
+static inline uint32_t cell_hash(int32_t ix, int32_t iy, uint32_t seed)
+{
+  uint32_t h = ((uint32_t)ix * 0x8da6b343u) ^ ((uint32_t)iy * 0xd8163841u) ^ seed;
+  h ^= h >> 15;
+  h *= 0x2c1b3c6du;
+  h ^= h >> 12;
+  return h;
+}
+
+/** floorf without the libm call */
+static inline int32_t floor_i32(float x)
+{
+  const int32_t i = (int32_t)x;
+  return i - (x < i);
+}
+
+static inline uint8_t clamp_u8(int v)
+{
+  return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+/** Ground texture: random cells on a large checkerboard */
+static inline struct SceneColor ground_color(const struct SceneRender *s, float inv_cell, float x, float y)
+{
+  const int32_t ix = floor_i32(x * inv_cell);
+  const int32_t iy = floor_i32(y * inv_cell);
+  const uint32_t h = cell_hash(ix, iy, s->seed);
+  const int checker = (((ix >> 3) ^ (iy >> 3)) & 1) ? 20 : -20;
+  struct SceneColor c;
+  c.y = clamp_u8(s->ground.y + checker + (int)(h & 63) - 32);
+  c.u = clamp_u8(s->ground.u + (int)((h >> 8) & 7) - 4);
+  c.v = clamp_u8(s->ground.v + (int)((h >> 12) & 7) - 4);
+  return c;
+}
+
+/** Update the entry and exit distances of a ray with one slab of a box */
+static inline void box_slab(float o, float d, float h, int axis, float *tmin, float *tmax, int *face)
+{
+  const float inv = 1.f / d;
+  float t1 = (-h - o) * inv;
+  float t2 = (h - o) * inv;
+  if (t1 > t2) {
+    float t = t1;
+    t1 = t2;
+    t2 = t;
+  }
+  if (t1 > *tmin) {
+    *tmin = t1;
+    *face = axis;
+  }
+  if (t2 < *tmax) {
+    *tmax = t2;
+  }
+}
+
+static inline struct SceneColor render_pixel(const struct render_job *job, const float *ray, const uint8_t *boxes,
+                                      int nb_boxes)
+{
+  if (ray[2] == 0.f) {
+    return scene_black;
+  }
+  const struct SceneRender *s = job->scene;
+  const float *r = job->r;
+  // ray in NED, transposed rotation
+  const float dx = r[0] * ray[0] + r[3] * ray[1] + r[6] * ray[2];
+  const float dy = r[1] * ray[0] + r[4] * ray[1] + r[7] * ray[2];
+  const float dz = r[2] * ray[0] + r[5] * ray[1] + r[8] * ray[2];
+
+  float t_best = INFINITY;
+  int hit = -1;   // -1 sky, -2 ground, else box index
+  int hit_face = 0;
+  if (dz > 0.f && job->pos.z < 0.f) {
+    t_best = -job->pos.z / dz;
+    hit = -2;
+  }
+  for (int k = 0; k < nb_boxes; k++) {
+    const int i = boxes[k];
+    const struct SceneBox *b = &s->boxes[i];
+    const struct FloatVect3 *o = &job->box_pos[i];
+    float tmin = -INFINITY, tmax = t_best;
+    int face = 0;
+    box_slab(o->x, b->cpsi * dx + b->spsi * dy, b->half.x, 0, &tmin, &tmax, &face);
+    box_slab(o->y, -b->spsi * dx + b->cpsi * dy, b->half.y, 1, &tmin, &tmax, &face);
+    box_slab(o->z, dz, b->half.z, 2, &tmin, &tmax, &face);
+    if (tmin <= tmax && tmax > 0.f) {
+      t_best = tmin > 0.f ? tmin : 0.f;
+      hit = i;
+      hit_face = face;
+    }
+  }
+
+  if (hit == -1) {
+    return s->sky;
+  } else if (hit == -2) {
+    if (t_best > SCENE_RENDER_FAR) {
+      return s->ground;
+    }
+    return ground_color(s, job->inv_cell, job->pos.x + t_best * dx, job->pos.y + t_best * dy);
+  }
+  // flat shading, the top faces are the brightest
+  static const int shade[3] = { 205, 166, 256 };
+  struct SceneColor c = s->boxes[hit].color;
+  c.y = (c.y * shade[hit_face]) >> 8;
+  return c;
+}
+
+/** Select the boxes whose bounding sphere is in the ray cone of a tile */
+static int tile_boxes(const struct render_job *job, const struct SceneTileCone *cone, uint8_t *boxes)
+{
+  if (cone->cos > 1.f) {
+    return 0;
+  }
+  int nb = 0;
+  for (int i = 0; i < job->scene->nb_boxes; i++) {
+    // cos and sin of the sum of the half angles, the cones overlap if larger than pi
+    const float c = cone->cos * job->box_cos[i] - cone->sin * job->box_sin[i];
+    const float s = cone->sin * job->box_cos[i] + cone->cos * job->box_sin[i];
+    if (job->box_cos[i] < -1.f || s < 0.f || VECT3_DOT_PRODUCT(cone->axis, job->box_dir[i]) >= c) {
+      boxes[nb++] = i;
+    }
+  }
+  return nb;
+}
+
+static void *render_worker(void *arg)
+{
+  struct render_job *job = (struct render_job *)arg;
+  const struct SceneCamera *cam = job->cam;
+  uint8_t boxes[SCENE_RENDER_MAX_BOXES];
+  int tile;
+  while ((tile = atomic_fetch_add(&job->next_tile, 1)) < job->nb_tiles) {
+    const int nb_boxes = tile_boxes(job, &cam->cones[tile], boxes);
+    const int x0 = (tile % cam->tiles_x) * SCENE_RENDER_TILE_SIZE;
+    const int x1 = Min(x0 + SCENE_RENDER_TILE_SIZE, cam->w);
+    const int y0 = (tile / cam->tiles_x) * SCENE_RENDER_TILE_SIZE;
+    const int y1 = Min(y0 + SCENE_RENDER_TILE_SIZE, cam->h);
+    for (int y = y0; y < y1; y++) {
+      const float *ray = &cam->rays[3 * (y * cam->w + x0)];
+      uint8_t *out = &job->buf[2 * (y * cam->w + x0)];
+      for (int x = x0; x < x1; x += 2, ray += 6, out += 4) {
+        const struct SceneColor c0 = render_pixel(job, ray, boxes, nb_boxes);
+        const struct SceneColor c1 = render_pixel(job, ray + 3, boxes, nb_boxes);
+        out[0] = (c0.u + c1.u + 1) >> 1;
+        out[1] = c0.y;
+        out[2] = (c0.v + c1.v + 1) >> 1;
+        out[3] = c1.y;
+      }
+    }
+  }
+  return NULL;
+}
+
+void scene_render(struct SceneRender *scene, struct SceneCamera *cam, struct FloatVect3 *pos,
+                  struct FloatRMat *ltp_to_cam, uint8_t *buf, uint8_t nb_threads)
+{
+  struct render_job job;
+  job.scene = scene;
+  job.cam = cam;
+  job.r = ltp_to_cam->m;
+  job.pos = *pos;
+  job.inv_cell = 1.f / scene->ground_cell;
+  job.buf = buf;
+  job.nb_tiles = cam->tiles_x * cam->tiles_y;
+  atomic_init(&job.next_tile, 0);
+  // camera position in the frame of each box and bounding sphere, constant over the image
+  for (int i = 0; i < scene->nb_boxes; i++) {
+    const struct SceneBox *b = &scene->boxes[i];
+    const float x = pos->x - b->center.x;
+    const float y = pos->y - b->center.y;
+    job.box_pos[i].x = b->cpsi * x + b->spsi * y;
+    job.box_pos[i].y = -b->spsi * x + b->cpsi * y;
+    job.box_pos[i].z = pos->z - b->center.z;
+    struct FloatVect3 v, v_cam;
+    VECT3_DIFF(v, b->center, *pos);
+    MAT33_VECT3_MUL(v_cam, *ltp_to_cam, v);
+    const float dist = float_vect3_norm(&v_cam);
+    const float r = sqrtf(VECT3_NORM2(b->half));
+    if (dist <= r) {
+      job.box_cos[i] = -2.f;
+      job.box_sin[i] = 0.f;
+      continue;
+    }
+    VECT3_SDIV(job.box_dir[i], v_cam, dist);
+    job.box_sin[i] = r / dist;
+    job.box_cos[i] = sqrtf(1.f - job.box_sin[i] * job.box_sin[i]);
+  }
+
+  // the calling thread renders too, tiles are shared on demand
+  pthread_t threads[SCENE_RENDER_MAX_THREADS];
+  int nb = 0;
+  nb_threads = Min(nb_threads, SCENE_RENDER_MAX_THREADS);
+  while (nb + 1 < nb_threads && nb + 1 < job.nb_tiles) {
+    if (pthread_create(&threads[nb], NULL, render_worker, &job) != 0) {
+      break;
+    }
+    nb++;
+  }
+  render_worker(&job);
+  for (int i = 0; i < nb; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/computer_vision/lib/vision/scene_render.h
+ * CPU renderer of simple synthetic scenes for simulated cameras.
+ *
+ * The scene is a textured ground plane (z = 0) with boxes on it, from which
+ * poles, walls and gates are built. Positions are in the local NED frame (m).
+ * Each pixel is ray cast through the camera model (pinhole plus the Dhane
+ * fisheye model of undistortion.h), so the output only depends on the scene
+ * and the camera pose. The image is cut in tiles of rows rendered by
+ * several threads, with the same result for any number of threads.
+ * Images are written in UYVY (YUV422) like the video devices.
+ */
+
+#ifndef SCENE_RENDER_H
+#define SCENE_RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "math/pprz_algebra_float.h"
+
+/** Max number of boxes in a scene (up to 256) */
+#ifndef SCENE_RENDER_MAX_BOXES
+#define SCENE_RENDER_MAX_BOXES 128
+#endif
+
+/** Max length of the boxes of a wall, long walls are split for the culling of the tiles (m) */
+#ifndef SCENE_RENDER_WALL_SEGMENT
+#define SCENE_RENDER_WALL_SEGMENT 4.f
+#endif
+
+/** Size of the square tiles rendered by a thread in one go (pixels, even) */
+#ifndef SCENE_RENDER_TILE_SIZE
+#define SCENE_RENDER_TILE_SIZE 16
+#endif
+
+/** Max number of render threads */
+#ifndef SCENE_RENDER_MAX_THREADS
+#define SCENE_RENDER_MAX_THREADS 16
+#endif
+
+struct SceneColor {
+  uint8_t y;
+  uint8_t u;
+  uint8_t v;
+};
+
+/** Box rotated around the vertical axis */
+struct SceneBox {
+  struct FloatVect3 center;   ///< center (NED, m)
+  struct FloatVect3 half;     ///< half sizes along the box axes (m)
+  float cpsi, spsi;           ///< cos and sin of the heading of the box x axis
+  struct SceneColor color;
+};
+
+struct SceneRender {
+  struct SceneBox boxes[SCENE_RENDER_MAX_BOXES];
+  uint16_t nb_boxes;
+  float ground_cell;            ///< size of the ground texture cells (m)
+  uint32_t seed;                ///< seed of the ground texture
+  struct SceneColor ground;     ///< mean ground color
+  struct SceneColor sky;
+};
+
+/** Cone containing the rays of a tile, to skip the boxes out of the tile */
+struct SceneTileCone {
+  struct FloatVect3 axis;       ///< unit vector in camera frame
+  float cos, sin;               ///< of the half angle, cos > 1 if the tile is outside the lens
+};
+
+/** Camera model, with the ray of each pixel computed once */
+struct SceneCamera {
+  uint16_t w;                   ///< image width (even)
+  uint16_t h;                   ///< image height
+  float *rays;                  ///< (x, y, 1) ray in camera frame per pixel, (0, 0, 0) outside the lens
+  uint16_t tiles_x, tiles_y;    ///< number of tiles
+  struct SceneTileCone *cones;  ///< ray cone of each tile, row major
+};
+
+/** Init an empty scene (ground only) */
+extern void scene_render_init(struct SceneRender *scene);
+
+/** Add a box
+ * @param psi heading of the box x axis (rad)
+ * @return false if the scene is full
+ */
+extern bool scene_render_add_box(struct SceneRender *scene, struct FloatVect3 *center, struct FloatVect3 *half,
+                                 float psi, struct SceneColor color);
+
+/** Add a pole of square section standing on the ground */
+extern bool scene_render_add_pole(struct SceneRender *scene, float x, float y, float width, float height,
+                                  struct SceneColor color);
+
+/** Add a wall standing on the ground, from (x1, y1) to (x2, y2)
+ * @return false if the scene is full (no segment added)
+ */
+extern bool scene_render_add_wall(struct SceneRender *scene, float x1, float y1, float x2, float y2,
+                                  float height, float thickness, struct SceneColor color);
+
+/** Add a square gate made of four bars
+ * @param center center of the opening (NED, m)
+ * @param psi heading of the gate normal (rad)
+ * @param size inner size of the opening (m)
+ * @param bar width of the bars (m)
+ * @return false if the scene is full (no bar added)
+ */
+extern bool scene_render_add_gate(struct SceneRender *scene, struct FloatVect3 *center, float psi, float size,
+                                  float bar, struct SceneColor color);
+
+/** Fill a scene with a small course of gates, poles and walls around the origin */
+extern void scene_render_default(struct SceneRender *scene);
+
+/** Compute the rays of a camera
+ * @param w image width, rounded down to an even number
+ * @param h image height
+ * @param fx, fy focal lengths (pixels)
+ * @param cx, cy image center (pixels)
+ * @param k Dhane distortion parameter (1 for a pinhole camera)
+ * @return 0 on success, -1 if out of memory
+ */
+extern int scene_camera_init(struct SceneCamera *cam, uint16_t w, uint16_t h, float fx, float fy, float cx, float cy,
+                             float k);
+extern void scene_camera_free(struct SceneCamera *cam);
+
+/** Render an image
+ * @param pos camera position (NED, m)
+ * @param ltp_to_cam rotation from NED to camera frame (x right, y down, z along the optical axis)
+ * @param buf UYVY output, 2 * w * h bytes
+ * @param nb_threads number of render threads (1 renders in the calling thread)
+ */
+extern void scene_render(struct SceneRender *scene, struct SceneCamera *cam, struct FloatVect3 *pos,
+                         struct FloatRMat *ltp_to_cam, uint8_t *buf, uint8_t nb_threads);
+
+#endif /* SCENE_RENDER_H */
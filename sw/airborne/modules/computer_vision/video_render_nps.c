@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/computer_vision/video_render_nps.c
+ * Synthetic cameras for NPS without an external simulator.
+ */
+
+#include "modules/computer_vision/video_render_nps.h"
+#include "modules/computer_vision/video_thread_nps.h"
+#include "modules/computer_vision/cv.h"
+#include "modules/computer_vision/lib/vision/image.h"
+#include "nps_fdm.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/** Number of render threads */
+#ifndef VIDEO_RENDER_NPS_NB_THREADS
+#define VIDEO_RENDER_NPS_NB_THREADS 4
+#endif
+
+/** Fill the scene with the default course of gates, poles and walls */
+#ifndef VIDEO_RENDER_NPS_DEFAULT_SCENE
+#define VIDEO_RENDER_NPS_DEFAULT_SCENE TRUE
+#endif
+
+struct SceneRender video_render_nps_scene;
+
+struct render_camera {
+  struct video_config_t *dev;
+  struct SceneCamera cam;
+  struct FloatRMat body_to_cam;
+  struct image_t img;
+  double next_time;         ///< simulation time of the next frame (s)
+};
+
+static struct render_camera render_cams[VIDEO_THREAD_MAX_CAMERAS];
+
+/** Camera looking forward: x right, y down, z forward */
+static const struct FloatRMat mount_front = {{ 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 1.f, 0.f, 0.f }};
+/** Camera looking down, top of the image forward */
+static const struct FloatRMat mount_bottom = {{ 0.f, 1.f, 0.f, -1.f, 0.f, 0.f, 0.f, 0.f, 1.f }};
+
+/** Find or set up the render state of a registered camera */
+static struct render_camera *get_render_camera(struct video_config_t *dev)
+{
+  for (int i = 0; i < VIDEO_THREAD_MAX_CAMERAS; i++) {
+    struct render_camera *rc = &render_cams[i];
+    if (rc->dev == dev) {
+      return rc;
+    }
+    if (rc->dev != NULL) {
+      continue;
+    }
+    struct camera_intrinsics_t *ci = &dev->camera_intrinsics;
+    if (scene_camera_init(&rc->cam, dev->output_size.w, dev->output_size.h,
+                          ci->focal_x, ci->focal_y, ci->center_x, ci->center_y, ci->Dhane_k) != 0) {
+      return NULL;
+    }
+    image_create(&rc->img, rc->cam.w, rc->cam.h, IMAGE_YUV422);
+    rc->body_to_cam = strncmp(dev->dev_name, "bottom", 6) == 0 ? mount_bottom : mount_front;
+    rc->next_time = fdm.time;
+    rc->dev = dev;
+    printf("[video_render_nps] Rendering %s (%dx%d).\n", dev->dev_name, rc->cam.w, rc->cam.h);
+    return rc;
+  }
+  return NULL;
+}
+
+void video_render_nps_init(void)
+{
+  scene_render_init(&video_render_nps_scene);
+#if VIDEO_RENDER_NPS_DEFAULT_SCENE
+  scene_render_default(&video_render_nps_scene);
+#endif
+}
+
+bool video_render_nps_set_mount(struct video_config_t *dev, struct FloatRMat *body_to_cam)
+{
+  struct render_camera *rc = get_render_camera(dev);
+  if (rc == NULL) {
+    return false;
+  }
+  rc->body_to_cam = *body_to_cam;
+  return true;
+}
+
+void video_render_nps_periodic(void)
+{
+  struct FloatQuat q = {
+    fdm.ltpprz_to_body_quat.qi, fdm.ltpprz_to_body_quat.qx,
+    fdm.ltpprz_to_body_quat.qy, fdm.ltpprz_to_body_quat.qz
+  };
+  struct FloatRMat ltp_to_body, ltp_to_cam;
+  float_rmat_of_quat(&ltp_to_body, &q);
+  struct FloatVect3 pos = { fdm.ltpprz_pos.x, fdm.ltpprz_pos.y, fdm.ltpprz_pos.z };
+
+  for (int i = 0; i < VIDEO_THREAD_MAX_CAMERAS && cameras[i] != NULL; i++) {
+    struct render_camera *rc = get_render_camera(cameras[i]);
+    if (rc == NULL || fdm.time < rc->next_time) {
+      continue;
+    }
+    const uint16_t fps = cameras[i]->fps > 0 ? cameras[i]->fps : VIDEO_RENDER_NPS_FPS;
+    rc->next_time += 1. / fps;
+    if (rc->next_time < fdm.time) {
+      rc->next_time = fdm.time; // don't render missed frames
+    }
+
+    float_rmat_comp(&ltp_to_cam, &ltp_to_body, &rc->body_to_cam);
+    scene_render(&video_render_nps_scene, &rc->cam, &pos, &ltp_to_cam, rc->img.buf, VIDEO_RENDER_NPS_NB_THREADS);
+
+    rc->img.ts.tv_sec = (time_t)fdm.time;
+    rc->img.ts.tv_usec = (fdm.time - rc->img.ts.tv_sec) * 1e6;
+    rc->img.pprz_ts = fdm.time * 1e6;
+    rc->img.eulers.phi = fdm.ltpprz_to_body_eulers.phi;
+    rc->img.eulers.theta = fdm.ltpprz_to_body_eulers.theta;
+    rc->img.eulers.psi = fdm.ltpprz_to_body_eulers.psi;
+    rc->img.buf_idx = 0; // unused
+    cv_run_device(cameras[i], &rc->img);
+  }
+}
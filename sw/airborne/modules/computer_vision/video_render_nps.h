@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/computer_vision/video_render_nps.h
+ * Synthetic cameras for NPS without an external simulator.
+ *
+ * The cameras registered in video_thread_nps are rendered from the fdm pose
+ * with the CPU renderer of lib/vision/scene_render.h, and the images are
+ * passed to the vision modules with cv_run_device like the Gazebo cameras.
+ * Time stamps come from the simulation time, so a simulation runs the same
+ * way when it is faster than real time.
+ */
+
+#ifndef VIDEO_RENDER_NPS_H
+#define VIDEO_RENDER_NPS_H
+
+#include "peripherals/video_device.h"
+#include "modules/computer_vision/lib/vision/scene_render.h"
+
+/** Frame rate of the cameras without fps setting, and of the periodic function (Hz) */
+#ifndef VIDEO_RENDER_NPS_FPS
+#define VIDEO_RENDER_NPS_FPS 30
+#endif
+
+/** Scene of the simulation, can be modified by other modules after init */
+extern struct SceneRender video_render_nps_scene;
+
+extern void video_render_nps_init(void);
+extern void video_render_nps_periodic(void);
+
+/** Set the orientation of a camera in the body frame
+ *  By default, cameras look forward, except the bottom camera looking down.
+ * @param body_to_cam rotation from body to camera frame (x right, y down, z along the optical axis)
+ * @return false if the camera is not registered
+ */
+extern bool video_render_nps_set_mount(struct video_config_t *dev, struct FloatRMat *body_to_cam);
+
+#endif /* VIDEO_RENDER_NPS_H */
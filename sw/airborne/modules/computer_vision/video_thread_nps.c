@@ -23,7 +23,7 @@
  * Video thread dummy for simulation. *
  *
  * Keeps track of added devices, which can be referenced by simulation code
- * such as in simulator/nps/fdm_gazebo.c.
+ * such as in simulator/nps/fdm_gazebo.c or modules/computer_vision/video_render_nps.c.
  */
 
 // Own header
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/core/state_conversion.c"
+ * Eager computation of the state representations used by the airframe
+ */
+
+#include "generated/airframe.h"
+#include "modules/core/state_conversion.h"
+
+/** Position conversions, indexed by representation */
+static void (*const pos_calc[POS_REPR_NB])(void) = {
+  stateCalcPositionEcef_i,
+  stateCalcPositionNed_i,
+  stateCalcPositionEnu_i,
+  stateCalcPositionLla_i,
+  NULL, /* no UTM int */
+  stateCalcPositionEcef_f,
+  stateCalcPositionNed_f,
+  stateCalcPositionEnu_f,
+  stateCalcPositionLla_f,
+  stateCalcPositionUtm_f
+};
+
+/** Speed conversions, indexed by representation */
+static void (*const speed_calc[SPEED_REPR_NB])(void) = {
+  stateCalcSpeedEcef_i,
+  stateCalcSpeedNed_i,
+  stateCalcSpeedEnu_i,
+  stateCalcHorizontalSpeedNorm_i,
+  stateCalcHorizontalSpeedDir_i,
+  stateCalcSpeedEcef_f,
+  stateCalcSpeedNed_f,
+  stateCalcSpeedEnu_f,
+  stateCalcHorizontalSpeedNorm_f,
+  stateCalcHorizontalSpeedDir_f
+};
+
+void state_conversion_periodic(void)
+{
+  uint8_t i;
+  for (i = 0; i < POS_REPR_NB; i++) {
+    if (bit_is_set((STATE_EAGER_POS), i) && pos_calc[i] != NULL) {
+      pos_calc[i]();
+    }
+  }
+  for (i = 0; i < SPEED_REPR_NB; i++) {
+    if (bit_is_set((STATE_EAGER_SPEED), i)) {
+      speed_calc[i]();
+    }
+  }
+}
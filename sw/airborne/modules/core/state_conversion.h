@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/core/state_conversion.h"
+ * Eager computation of the state representations used by the airframe
+ *
+ * The representations listed in STATE_EAGER_POS and STATE_EAGER_SPEED
+ * (bit masks of POS_* and SPEED_* from state.h) are computed at each
+ * main loop, so that the conversions are not done in the middle of a
+ * control loop or a telemetry callback.
+ */
+
+#ifndef STATE_CONVERSION_H
+#define STATE_CONVERSION_H
+
+#include "state.h"
+
+/** Position representations to compute at each loop */
+#ifndef STATE_EAGER_POS
+#define STATE_EAGER_POS 0
+#endif
+
+/** Speed representations to compute at each loop */
+#ifndef STATE_EAGER_SPEED
+#define STATE_EAGER_SPEED 0
+#endif
+
+extern void state_conversion_periodic(void);
+
+#endif /* STATE_CONVERSION_H */
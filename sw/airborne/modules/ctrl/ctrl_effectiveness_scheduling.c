@@ -20,7 +20,26 @@
  */
 
 /** @file modules/ctrl/ctrl_effectiveness_scheduling.c
- * Module that interpolates gainsets in flight based on the transition percentage
+ * Module that interpolates the control effectiveness in flight, based on the
+ * transition percentage, and optionally on the airspeed and battery voltage.
+ *
+ * By default, the effectiveness is interpolated between the hover
+ * (STABILIZATION_INDI_G1_xxx) and forward (FWD_G1_xxx) matrices.
+ * With CTRL_EFF_SCHED_G1, a G1 matrix is given for each point of a grid of
+ * breakpoints along the axes that are defined, in this order, the first one
+ * varying fastest in CTRL_EFF_SCHED_G1:
+ *  - CTRL_EFF_SCHED_TRANSITION_POINTS: transition percentage (0 - 100)
+ *  - CTRL_EFF_SCHED_AIRSPEED_POINTS: airspeed (m/s)
+ *  - CTRL_EFF_SCHED_VOLTAGE_POINTS: supply voltage (V)
+ * G2 (STABILIZATION_INDI_G2) is the same for all points.
+ *
+ * The effectiveness is only interpolated again when a scheduling variable
+ * changed by more than its threshold, and the allocation then updates its
+ * pseudo-inverse or factorisation.
+ *
+ * With the pseudo-inverse allocation, the adaptive INDI (LMS estimation) also
+ * writes g1g2: the scheduling is then paused while indi_use_adaptive is set,
+ * and the table is interpolated again when it is cleared.
  */
 
 #include "modules/ctrl/ctrl_effectiveness_scheduling.h"
@@ -29,51 +48,133 @@
 #include "generated/airframe.h"
 #include "state.h"
 #include "subsystems/radio_control.h"
+#include "subsystems/electrical.h"
+#include "math/pprz_sched_table_float.h"
 
-#if STABILIZATION_INDI_ALLOCATION_PSEUDO_INVERSE
-#error "You need to use WLS control allocation for this module"
+#if STABILIZATION_INDI_ALLOCATION_PSEUDO_INVERSE && STABILIZATION_INDI_USE_ADAPTIVE
+#error "The adaptive INDI with pseudo-inverse allocation overwrites the scheduled effectiveness, use WLS allocation"
+#endif
+
+/** Changes of the scheduling variables below which the effectiveness is not updated */
+#ifndef CTRL_EFF_SCHED_TRANSITION_THRESHOLD
+#define CTRL_EFF_SCHED_TRANSITION_THRESHOLD 0.f
+#endif
+#ifndef CTRL_EFF_SCHED_AIRSPEED_THRESHOLD
+#define CTRL_EFF_SCHED_AIRSPEED_THRESHOLD 0.f
+#endif
+#ifndef CTRL_EFF_SCHED_VOLTAGE_THRESHOLD
+#define CTRL_EFF_SCHED_VOLTAGE_THRESHOLD 0.f
 #endif
 
+#define CTRL_EFF_SCHED_SIZE (INDI_OUTPUTS * INDI_NUM_ACT)
 
-static float g1g2_forward[INDI_OUTPUTS][INDI_NUM_ACT] = {FWD_G1_ROLL,
-                                                  FWD_G1_PITCH, FWD_G1_YAW, FWD_G1_THRUST
-                                                 };
+#define NB_OF(_t) (sizeof(_t) / sizeof(_t[0]))
 
-static float g1g2_hover[INDI_OUTPUTS][INDI_NUM_ACT] = {STABILIZATION_INDI_G1_ROLL,
-                                                STABILIZATION_INDI_G1_PITCH, STABILIZATION_INDI_G1_YAW, STABILIZATION_INDI_G1_THRUST
-                                               };
+#ifdef CTRL_EFF_SCHED_G1
+static float g1g2_table[] = CTRL_EFF_SCHED_G1;
+#else
+// interpolation between the hover and forward matrices
+static float g1g2_table[2][INDI_OUTPUTS][INDI_NUM_ACT] = {
+  {
+    STABILIZATION_INDI_G1_ROLL, STABILIZATION_INDI_G1_PITCH,
+    STABILIZATION_INDI_G1_YAW, STABILIZATION_INDI_G1_THRUST
+  },
+  { FWD_G1_ROLL, FWD_G1_PITCH, FWD_G1_YAW, FWD_G1_THRUST }
+};
+#define CTRL_EFF_SCHED_TRANSITION_POINTS { 0.f, 100.f }
+#endif
+
+#ifdef CTRL_EFF_SCHED_TRANSITION_POINTS
+static const float transition_points[] = CTRL_EFF_SCHED_TRANSITION_POINTS;
+#define NB_TRANSITION_POINTS NB_OF(transition_points)
+#else
+#define NB_TRANSITION_POINTS 1
+#endif
+#ifdef CTRL_EFF_SCHED_AIRSPEED_POINTS
+static const float airspeed_points[] = CTRL_EFF_SCHED_AIRSPEED_POINTS;
+#define NB_AIRSPEED_POINTS NB_OF(airspeed_points)
+#else
+#define NB_AIRSPEED_POINTS 1
+#endif
+#ifdef CTRL_EFF_SCHED_VOLTAGE_POINTS
+static const float voltage_points[] = CTRL_EFF_SCHED_VOLTAGE_POINTS;
+#define NB_VOLTAGE_POINTS NB_OF(voltage_points)
+#else
+#define NB_VOLTAGE_POINTS 1
+#endif
+
+#define NB_GRID_POINTS (NB_TRANSITION_POINTS * NB_AIRSPEED_POINTS * NB_VOLTAGE_POINTS)
+
+_Static_assert(sizeof(g1g2_table) == NB_GRID_POINTS * CTRL_EFF_SCHED_SIZE * sizeof(float),
+               "CTRL_EFF_SCHED_G1 needs a G1 matrix for each point of the scheduling grid");
 
 static float g2_both[INDI_NUM_ACT] = STABILIZATION_INDI_G2; //scaled by INDI_G_SCALING
 
+static struct SchedTableFloat g1g2_sched;
+
 //Get the specified gains in the gainlibrary
 void ctrl_eff_scheduling_init(void)
 {
-  //sum of G1 and G2
+  //sum of G1 and G2 for each grid point
+  float *g = (float *)g1g2_table;
+  uint16_t k;
   int8_t i;
   int8_t j;
-  for (i = 0; i < INDI_OUTPUTS; i++) {
-    for (j = 0; j < INDI_NUM_ACT; j++) {
-      if (i != 2) {
-        g1g2_hover[i][j] = g1g2_hover[i][j] / INDI_G_SCALING;
-        g1g2_forward[i][j] = g1g2_forward[i][j] / INDI_G_SCALING;
-      } else {
-        g1g2_forward[i][j] = (g1g2_forward[i][j] + g2_both[j]) / INDI_G_SCALING;
-        g1g2_hover[i][j] = (g1g2_hover[i][j] + g2_both[j]) / INDI_G_SCALING;
+  for (k = 0; k < NB_GRID_POINTS; k++) {
+    for (i = 0; i < INDI_OUTPUTS; i++) {
+      for (j = 0; j < INDI_NUM_ACT; j++) {
+        if (i != 2) {
+          *g = *g / INDI_G_SCALING;
+        } else {
+          *g = (*g + g2_both[j]) / INDI_G_SCALING;
+        }
+        g++;
       }
     }
   }
+
+  // the table is interpolated directly in g1g2
+  sched_table_init_f(&g1g2_sched, (const float *)g1g2_table, CTRL_EFF_SCHED_SIZE, g1g2[0]);
+#ifdef CTRL_EFF_SCHED_TRANSITION_POINTS
+  sched_table_add_axis_f(&g1g2_sched, transition_points, NB_TRANSITION_POINTS,
+                         CTRL_EFF_SCHED_TRANSITION_THRESHOLD);
+#endif
+#ifdef CTRL_EFF_SCHED_AIRSPEED_POINTS
+  sched_table_add_axis_f(&g1g2_sched, airspeed_points, NB_AIRSPEED_POINTS,
+                         CTRL_EFF_SCHED_AIRSPEED_THRESHOLD);
+#endif
+#ifdef CTRL_EFF_SCHED_VOLTAGE_POINTS
+  sched_table_add_axis_f(&g1g2_sched, voltage_points, NB_VOLTAGE_POINTS,
+                         CTRL_EFF_SCHED_VOLTAGE_THRESHOLD);
+#endif
 }
 
 void ctrl_eff_scheduling_periodic(void)
 {
-  // Go from transition percentage to ratio
-  float ratio = FLOAT_OF_BFP(transition_percentage, INT32_PERCENTAGE_FRAC) / 100;
+  float vars[SCHED_TABLE_MAX_DIM];
+  uint8_t n = 0;
 
-  int8_t i;
-  int8_t j;
-  for (i = 0; i < INDI_OUTPUTS; i++) {
-    for (j = 0; j < INDI_NUM_ACT; j++) {
-      g1g2[i][j] = (g1g2_hover[i][j] * (1.0 - ratio) + g1g2_forward[i][j] * ratio);
-    }
+#ifdef CTRL_EFF_SCHED_TRANSITION_POINTS
+  vars[n++] = FLOAT_OF_BFP(transition_percentage, INT32_PERCENTAGE_FRAC);
+#endif
+#ifdef CTRL_EFF_SCHED_AIRSPEED_POINTS
+  vars[n++] = stateGetAirspeed_f();
+#endif
+#ifdef CTRL_EFF_SCHED_VOLTAGE_POINTS
+  vars[n++] = electrical.vsupply;
+#endif
+  (void) n;
+
+#if STABILIZATION_INDI_ALLOCATION_PSEUDO_INVERSE
+  // g1g2 belongs to the LMS estimation, start from the table again after it
+  if (indi_use_adaptive) {
+    sched_table_invalidate_f(&g1g2_sched);
+    return;
+  }
+#endif
+
+  // Interpolate only if the operating point moved, and update the allocation then
+  if (sched_table_update_f(&g1g2_sched, vars)) {
+    stabilization_indi_g1g2_updated();
   }
 }
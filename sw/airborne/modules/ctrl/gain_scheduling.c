@@ -27,6 +27,7 @@
 
 // #include "state.h"
 #include "math/pprz_algebra_int.h"
+#include "math/pprz_sched_table_float.h"
 #include "subsystems/radio_control.h"
 
 #ifndef NUMBER_OF_GAINSETS
@@ -56,6 +57,8 @@ struct Int32AttitudeGains gainlibrary[NUMBER_OF_GAINSETS];
 
 float scheduling_points[NUMBER_OF_GAINSETS] = SCHEDULING_POINTS;
 
+static const struct SchedAxisFloat scheduling_axis = { scheduling_points, NUMBER_OF_GAINSETS, 0.f, 0.f };
+
 //Get the specified gains in the gainlibrary
 void gain_scheduling_init(void)
 {
@@ -96,32 +99,25 @@ void gain_scheduling_periodic(void)
 {
 
 #if NUMBER_OF_GAINSETS > 1
-  uint8_t section = 0;
-
-  //Find out between which gainsets to interpolate
-  while (FLOAT_OF_BFP(SCHEDULING_VARIABLE, SCHEDULING_VARIABLE_FRAC) > scheduling_points[section]) {
-    section++;
-    if (section == NUMBER_OF_GAINSETS) { break; }
-  }
+  //Find out between which gainsets to interpolate, and the ratio between the scheduling points
+  float frac;
+  uint8_t section = sched_axis_find_f(&scheduling_axis, FLOAT_OF_BFP(SCHEDULING_VARIABLE, SCHEDULING_VARIABLE_FRAC),
+                                      &frac);
 
   //Get pointers for the two gainsets and the stabilization_gains
   struct Int32AttitudeGains *ga, *gb, *gblend;
 
   gblend = &stabilization_gains;
 
-  if (section == 0) {
-    set_gainset(0);
-  } else if (section == NUMBER_OF_GAINSETS) {
-    set_gainset(NUMBER_OF_GAINSETS - 1);
+  if (frac == 0.f) {
+    set_gainset(section);
+  } else if (frac == 1.f) {
+    set_gainset(section + 1);
   } else {
-    ga = &gainlibrary[section - 1];
-    gb = &gainlibrary[section];
-
-    //Calculate the ratio between the scheduling points
-    int32_t ratio;
-    ratio = BFP_OF_REAL((FLOAT_OF_BFP(SCHEDULING_VARIABLE,
-                                      SCHEDULING_VARIABLE_FRAC) - scheduling_points[section - 1]) / (scheduling_points[section] -
-                                          scheduling_points[section - 1]), INT32_RATIO_FRAC);
+    ga = &gainlibrary[section];
+    gb = &gainlibrary[section + 1];
+
+    int32_t ratio = BFP_OF_REAL(frac, INT32_RATIO_FRAC);
 
     int64_t g1, g2, gbl;
 
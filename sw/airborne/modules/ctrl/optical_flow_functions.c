@@ -44,6 +44,27 @@ uint32_t ind_histZ;
 uint8_t cov_array_filledZ;
 
 
+/**
+ * Clear the histories and their covariance statistics
+ */
+void reset_OFhistory(struct OFhistory *history)
+{
+  init_moving_stats_f(&history->cov_input, history->input, history->OF, COV_WINDOW_SIZE);
+  init_moving_stats_f(&history->cov_past, history->past_OF, history->OF_past_pair, COV_WINDOW_SIZE);
+}
+
+/**
+ * Add samples to the histories
+ * @param[in] input: the current (normalized) input
+ * @param[in] OF: the current optical flow measurement
+ */
+static void update_OFhistory(struct OFhistory *history, float input, float OF)
+{
+  update_moving_stats_f(&history->cov_input, input, OF);
+  float past_OF = moving_stats_past_y_f(&history->cov_input, OF_COV_DELAY_STEPS);
+  update_moving_stats_f(&history->cov_past, past_OF, OF);
+}
+
 /**
  * Set the covariance of the divergence and the thrust / past divergence
  * This funciton should only be called once per time step
@@ -53,24 +74,17 @@ float set_cov_div(bool cov_method, struct OFhistory *history, struct DesiredInpu
 {
   float cov_div = 0;
   // histories and cov detection:
-
-  history->OF[ind_histZ] = of_hover.divergence;
-
   float normalized_thrust = (float)(100.0 * inputs->thrust / MAX_PPRZ);
-  history->input[ind_histZ] = normalized_thrust;
-
-  int ind_past = ind_histZ - OF_COV_DELAY_STEPS;
-  while (ind_past < 0) { ind_past += COV_WINDOW_SIZE; }
-  history->past_OF[ind_histZ] = history->OF[ind_past];
+  update_OFhistory(history, normalized_thrust, of_hover.divergence);
 
   // determine the covariance for hover detection:
   // only take covariance into account if there are enough samples in the histories:
   if (cov_method == 0 && cov_array_filledZ > 0) {
     // TODO: step in hover set point causes an incorrectly perceived covariance
-    cov_div = covariance_f(history->input, history->OF, COV_WINDOW_SIZE);
+    cov_div = moving_stats_covariance_f(&history->cov_input);
   } else if (cov_method == 1 && cov_array_filledZ > 1) {
     // todo: delay steps should be invariant to the run frequency
-    cov_div = covariance_f(history->past_OF, history->OF, COV_WINDOW_SIZE);
+    cov_div = moving_stats_covariance_f(&history->cov_past);
   }
 
   if (cov_array_filledZ < 2 && ind_histZ + 1 == COV_WINDOW_SIZE) {
@@ -90,30 +104,21 @@ void set_cov_flow(bool cov_method, struct OFhistory *historyX, struct OFhistory
                   struct FloatVect3 *covs)
 {
   // histories and cov detection:
-  historyX->OF[ind_histXY] = of_hover.flowX;
-  historyY->OF[ind_histXY] = of_hover.flowY;
-
-  int ind_past = ind_histXY - OF_COV_DELAY_STEPS;
-  while (ind_past < 0) { ind_past += COV_WINDOW_SIZE; }
-  historyX->past_OF[ind_histXY] = historyX->OF[ind_past];
-  historyY->past_OF[ind_histXY] = historyY->OF[ind_past];
   float normalized_phi = (float)(100.0 * inputs->phi / OFH_MAXBANK);
   float normalized_theta = (float)(100.0 * inputs->theta / OFH_MAXBANK);
-  historyX->input[ind_histXY] = normalized_phi;
-  historyY->input[ind_histXY] = normalized_theta;
+  update_OFhistory(historyX, normalized_phi, of_hover.flowX);
+  update_OFhistory(historyY, normalized_theta, of_hover.flowY);
 
   //   determine the covariance for hover detection:
   //   only take covariance into account if there are enough samples in the histories:
   if (cov_method == 0 && cov_array_filledXY > 0) {
     //    // TODO: step in hover set point causes an incorrectly perceived covariance
-    covs->x = covariance_f(historyX->input, historyX->OF, COV_WINDOW_SIZE);
-    covs->y = covariance_f(historyY->input, historyY->OF, COV_WINDOW_SIZE);
+    covs->x = moving_stats_covariance_f(&historyX->cov_input);
+    covs->y = moving_stats_covariance_f(&historyY->cov_input);
   } else if (cov_method == 1 && cov_array_filledXY > 1) {
-    if (cov_array_filledXY > 1) {
-      // todo: delay steps should be invariant to the run frequency
-      covs->x = covariance_f(historyX->past_OF, historyX->OF, COV_WINDOW_SIZE);
-      covs->y = covariance_f(historyY->past_OF, historyY->OF, COV_WINDOW_SIZE);
-    }
+    // todo: delay steps should be invariant to the run frequency
+    covs->x = moving_stats_covariance_f(&historyX->cov_past);
+    covs->y = moving_stats_covariance_f(&historyY->cov_past);
   }
 
   if (cov_array_filledXY < 2 && ind_histXY + 1 == COV_WINDOW_SIZE) {
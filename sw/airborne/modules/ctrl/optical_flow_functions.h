@@ -23,6 +23,7 @@
 
 #include "std.h"
 #include "math/pprz_algebra_float.h"
+#include "math/pprz_stat.h"
 
 struct GainsPID {
   float P;             ///< P-gain for control
@@ -38,6 +39,9 @@ struct OFhistory {
   float input[COV_WINDOW_SIZE];
   float OF[COV_WINDOW_SIZE];
   float past_OF[COV_WINDOW_SIZE];
+  float OF_past_pair[COV_WINDOW_SIZE];  ///< OF samples paired with past_OF
+  struct MovingStatsFloat cov_input;    ///< statistics of input and OF
+  struct MovingStatsFloat cov_past;     ///< statistics of past_OF and OF
 };
 
 struct OpticalFlowHoverControl {
@@ -72,6 +76,7 @@ extern uint8_t cov_array_filledZ;
 
 struct OpticalFlowHover of_hover;
 
+extern void reset_OFhistory(struct OFhistory *history);
 extern float set_cov_div(bool cov_method, struct OFhistory *history, struct DesiredInputs *inputs);
 extern void set_cov_flow(bool cov_method, struct OFhistory *historyX, struct OFhistory *historyY,
                          struct DesiredInputs *inputs, struct FloatVect3 *covs);
@@ -373,14 +373,8 @@ static void reset_horizontal_vars(void)
   covariances.x = 0.0f;
   covariances.y = 0.0f;
 
-  for (uint16_t i = 0; i < COV_WINDOW_SIZE; i++) {
-    historyX.OF[i] = 0.0f;
-    historyY.OF[i] = 0.0f;
-    historyX.past_OF[i] = 0.0f;
-    historyY.past_OF[i] = 0.0f;
-    historyX.input[i] = 0.0f;
-    historyY.input[i] = 0.0f;
-  }
+  reset_OFhistory(&historyX);
+  reset_OFhistory(&historyY);
 
   of_hover.flowX = 0;
   of_hover.flowY = 0;
@@ -399,11 +393,7 @@ static void reset_vertical_vars(void)
   divergence_vision = 0;
   of_hover.divergence = 0;
 
-  for (uint16_t i = 0; i < COV_WINDOW_SIZE; i++) {
-    historyZ.OF[i] = 0.0f;
-    historyZ.past_OF[i] = 0.0f;
-    historyZ.input[i] = 0.0f;
-  }
+  reset_OFhistory(&historyZ);
 
   ind_histZ = 0;
 
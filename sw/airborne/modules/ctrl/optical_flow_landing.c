@@ -179,10 +179,14 @@ static uint32_t final_landing_procedure(void);
 
 // resetting all variables to be called for instance when starting up / re-entering module
 static void reset_all_vars(void);
+static void reset_cov_window(void);
 
 float thrust_history[OFL_COV_WINDOW_SIZE];
 float divergence_history[OFL_COV_WINDOW_SIZE];
 float past_divergence_history[OFL_COV_WINDOW_SIZE];
+float divergence_past_pair[OFL_COV_WINDOW_SIZE];   ///< divergence samples paired with past_divergence_history
+struct MovingStatsFloat cov_thrust_div;             ///< statistics of thrust and divergence
+struct MovingStatsFloat cov_past_div;               ///< statistics of past and current divergence
 uint32_t ind_hist;
 uint8_t cov_array_filled;
 
@@ -237,6 +241,28 @@ void vertical_ctrl_module_init(void)
   register_periodic_telemetry(DefaultPeriodic, PPRZ_MSG_ID_DIVERGENCE, send_divergence);
 }
 
+/**
+ * Restart the covariance histories with the current window size
+ */
+static void reset_cov_window(void)
+{
+  ind_hist = 0;
+  cov_array_filled = 0;
+  init_moving_stats_f(&cov_thrust_div, thrust_history, divergence_history, of_landing_ctrl.window_size);
+  init_moving_stats_f(&cov_past_div, past_divergence_history, divergence_past_pair, of_landing_ctrl.window_size);
+}
+
+/**
+ * Set the number of time steps of the covariance window
+ * Bounded by the size of the histories, the window is restarted with the new size.
+ */
+void optical_flow_landing_SetWindowSize(float window_size)
+{
+  Bound(window_size, 1, OFL_COV_WINDOW_SIZE);
+  of_landing_ctrl.window_size = (uint32_t)window_size;
+  reset_cov_window();
+}
+
 /**
  * Reset all variables:
  */
@@ -256,13 +282,7 @@ static void reset_all_vars(void)
   vision_time = get_sys_time_float();
   prev_vision_time = vision_time;
 
-  ind_hist = 0;
-  cov_array_filled = 0;
-  uint32_t i;
-  for (i = 0; i < OFL_COV_WINDOW_SIZE; i++) {
-    thrust_history[i] = 0;
-    divergence_history[i] = 0;
-  }
+  reset_cov_window();
 
   landing = false;
 
@@ -518,23 +538,19 @@ uint32_t final_landing_procedure()
 void set_cov_div(int32_t thrust)
 {
   // histories and cov detection:
-  divergence_history[ind_hist] = of_landing_ctrl.divergence;
-
   normalized_thrust = (float)(thrust / (MAX_PPRZ / 100));
-  thrust_history[ind_hist] = normalized_thrust;
-
-  int ind_past = ind_hist - of_landing_ctrl.delay_steps;
-  while (ind_past < 0) { ind_past += of_landing_ctrl.window_size; }
-  past_divergence_history[ind_hist] = divergence_history[ind_past];
+  update_moving_stats_f(&cov_thrust_div, normalized_thrust, of_landing_ctrl.divergence);
+  float past_divergence = moving_stats_past_y_f(&cov_thrust_div, of_landing_ctrl.delay_steps);
+  update_moving_stats_f(&cov_past_div, past_divergence, of_landing_ctrl.divergence);
 
   // determine the covariance for landing detection:
   // only take covariance into account if there are enough samples in the histories:
   if (of_landing_ctrl.COV_METHOD == 0 && cov_array_filled > 0) {
     // TODO: step in landing set point causes an incorrectly perceived covariance
-    cov_div = covariance_f(thrust_history, divergence_history, of_landing_ctrl.window_size);
+    cov_div = moving_stats_covariance_f(&cov_thrust_div);
   } else if (of_landing_ctrl.COV_METHOD == 1 && cov_array_filled > 1) {
     // todo: delay steps should be invariant to the run frequency
-    cov_div = covariance_f(past_divergence_history, divergence_history, of_landing_ctrl.window_size);
+    cov_div = moving_stats_covariance_f(&cov_past_div);
   }
 
   if (cov_array_filled < 2 && ind_hist + 1 == of_landing_ctrl.window_size) {
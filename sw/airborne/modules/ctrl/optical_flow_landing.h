@@ -79,6 +79,9 @@ struct OpticalFlowLanding {
 
 extern struct OpticalFlowLanding of_landing_ctrl;
 
+/** Setting handler of the covariance window size (bounded to [1, OFL_COV_WINDOW_SIZE]) */
+extern void optical_flow_landing_SetWindowSize(float window_size);
+
 // Without optitrack set to: GUIDANCE_H_MODE_ATTITUDE
 // With optitrack set to: GUIDANCE_H_MODE_HOVER / NAV
 #define GUIDANCE_H_MODE_MODULE_SETTING GUIDANCE_H_MODE_NAV
@@ -163,3 +163,31 @@ void gec_counter_to_bytes(uint32_t n, uint8_t *bytes)
   bytes[1] = (n >> 8) & 0xFF;
   bytes[0] = n & 0xFF;
 }
+
+bool gec_counter_is_valid(struct gec_sym_key *key, uint32_t counter)
+{
+  if (counter > key->counter) {
+    return true;
+  }
+  uint32_t diff = key->counter - counter;
+  if (diff == 0 || diff > GEC_REPLAY_WINDOW) {
+    return false;
+  }
+  return !(key->replay_mask & (1u << (diff - 1)));
+}
+
+void gec_counter_update(struct gec_sym_key *key, uint32_t counter)
+{
+  if (counter > key->counter) {
+    uint32_t shift = counter - key->counter;
+    // the previous last counter becomes bit shift-1
+    key->replay_mask = (shift < 32) ? ((key->replay_mask << shift) | (1u << (shift - 1))) :
+                       ((shift == 32) ? (1u << 31) : 0);
+    key->counter = counter;
+  } else if (counter < key->counter) {
+    uint32_t diff = key->counter - counter;
+    if (diff <= 32) {
+      key->replay_mask |= 1u << (diff - 1);
+    }
+  }
+}
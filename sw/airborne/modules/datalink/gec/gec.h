@@ -38,6 +38,8 @@
 
 #define PPRZ_MSG_TYPE_PLAINTEXT 0xaa
 #define PPRZ_MSG_TYPE_ENCRYPTED 0x55
+// several messages with the same auth data in one encrypted frame
+#define PPRZ_MSG_TYPE_BATCH 0x5a
 // index of encrypted/payload byte
 #define PPRZ_GEC_IDX 0
 // index of the beginning of the counter
@@ -62,6 +64,17 @@
 // basepoint value for the scalar curve multiplication
 #define PPRZ_CURVE_BASEPOINT 9
 
+/** Number of counters below the last received one that are still accepted,
+ *  so that reordered frames are not dropped (max 32, 0 for strictly increasing counters)
+ */
+#ifndef GEC_REPLAY_WINDOW
+#define GEC_REPLAY_WINDOW 32
+#endif
+
+#if GEC_REPLAY_WINDOW > 32
+#error "GEC_REPLAY_WINDOW is limited to 32 by the size of the replay mask"
+#endif
+
 typedef unsigned char ed25519_signature[64];
 
 struct gec_privkey {
@@ -77,6 +90,7 @@ struct gec_sym_key {
   uint8_t key[PPRZ_KEY_LEN];
   uint8_t nonce[PPRZ_NONCE_LEN];
   uint32_t counter; bool ready;
+  uint32_t replay_mask; ///< bit i set if counter-i-1 has been received (rx only)
 };
 
 typedef enum {
@@ -135,4 +149,12 @@ void gec_derive_key_material(struct gec_sts_ctx *sts, uint8_t *z);
 void gec_counter_to_bytes(uint32_t n, uint8_t *bytes);
 uint32_t gec_bytes_to_counter(uint8_t *bytes);
 
+/** Check a received counter against the replay window
+ *  @return true if the counter has not been received yet and is not too old
+ */
+bool gec_counter_is_valid(struct gec_sym_key *key, uint32_t counter);
+
+/** Mark a counter as received, to be called after a successful decryption */
+void gec_counter_update(struct gec_sym_key *key, uint32_t counter);
+
 #endif /* SPPRZ_GEC_H */
@@ -67,8 +67,20 @@
 #define GEC_UPDATE_DL TRUE
 #endif
 
+// length of an encrypted frame for a given plaintext length
+#define GEC_FRAME_LEN(_mlen) (PPRZ_CIPH_IDX + (_mlen) + PPRZ_MAC_LEN)
+// max length of a batched frame
+#define GEC_BATCH_FRAME_MAX Min(GEC_BATCH_MTU, TRANSPORT_PAYLOAD_LEN)
+// min length of a message in a batch (CLASS/MSG_ID)
+#define GEC_BATCH_MSG_MIN_LEN (PPRZ_PLAINTEXT_MSG_MIN_LEN - 1 - PPRZ_AUTH_LEN)
+
 struct gec_transport gec_tp;
 
+#if GEC_BATCH
+static bool gec_batch_add(struct link_device *dev);
+static void gec_batch_send(void);
+#endif
+
 #if PERIODIC_TELEMETRY
 #include "subsystems/datalink/telemetry.h"
 
@@ -178,6 +190,10 @@ static int check_available_space(struct pprzlink_msg *msg, long *fd,
                                  uint16_t bytes)
 {
   if (get_trans(msg)->sts.protocol_stage == CRYPTO_OK) {
+#if GEC_BATCH
+    // the queued messages may be sent with this one
+    bytes += get_trans(msg)->batch.len;
+#endif
     return get_trans(msg)->pprz_tp.trans_tx.check_available_space(msg, fd,
            bytes);
   }
@@ -195,6 +211,11 @@ static void end_message(struct pprzlink_msg *msg, long fd)
 {
   switch (gec_tp.sts.protocol_stage) {
     case CRYPTO_OK:
+#if GEC_BATCH
+      if (gec_batch_add(msg->dev)) {
+        break;
+      }
+#endif
       if (gec_encrypt_message(gec_tp.tx_msg, &gec_tp.tx_msg_idx)) {
         gec_encapsulate_and_send_msg(msg, fd);
       }
@@ -271,6 +292,11 @@ static void end_message(struct gec_transport *trans, struct link_device *dev,
 {
   switch (gec_tp.sts.protocol_stage) {
     case CRYPTO_OK:
+#if GEC_BATCH
+      if (gec_batch_add(dev)) {
+        break;
+      }
+#endif
       if (gec_encrypt_message(gec_tp.tx_msg, &gec_tp.tx_msg_idx)) {
         gec_encapsulate_and_send_msg(trans, dev, fd);
       }
@@ -309,6 +335,10 @@ static int check_available_space(
   struct link_device *dev, long *fd, uint16_t bytes)
 {
   if (trans->sts.protocol_stage == CRYPTO_OK) {
+#if GEC_BATCH
+    // the queued messages may be sent with this one
+    bytes += trans->batch.len;
+#endif
     return trans->pprz_tp.trans_tx.check_available_space(trans, dev, fd, bytes);
   }
   return 0;
@@ -357,6 +387,42 @@ void gec_dl_init(void)
 #endif
 }
 
+/**
+ * Encrypt a plaintext (CLASS/MSG_ID .. MSG_PAYLOAD, or a batch of messages)
+ * and build the frame (CRYPTO_BYTE, COUNTER, AUTH, CIPHERTEXT, TAG).
+ * The ciphertext and tag are written in place in the frame.
+ * plain is either at the ciphertext index of the frame (encryption in place)
+ * or doesn't overlap the frame, the same goes for auth at the auth index.
+ */
+static bool gec_encrypt_frame(uint8_t *frame, uint8_t *frame_len, uint8_t type,
+                              uint8_t *auth, uint8_t *plain, uint32_t mlen)
+{
+  if (GEC_FRAME_LEN(mlen) > Min(TRANSPORT_PAYLOAD_LEN, UINT8_MAX)) {
+    return false;
+  }
+  // increment counter and update nonce
+  uint32_t counter = gec_tp.sts.tx_sym_key.counter + 1;
+  gec_counter_to_bytes(counter, &frame[PPRZ_CNTR_IDX]);
+  memcpy(gec_tp.sts.tx_sym_key.nonce, &frame[PPRZ_CNTR_IDX], sizeof(uint32_t));
+  if (auth != &frame[PPRZ_AUTH_IDX]) {
+    memcpy(&frame[PPRZ_AUTH_IDX], auth, PPRZ_AUTH_LEN);
+  }
+
+  uint32_t res = Hacl_Chacha20Poly1305_aead_encrypt(&frame[PPRZ_CIPH_IDX],
+                 &frame[PPRZ_CIPH_IDX + mlen], plain, mlen, &frame[PPRZ_AUTH_IDX],
+                 PPRZ_AUTH_LEN, gec_tp.sts.tx_sym_key.key, gec_tp.sts.tx_sym_key.nonce);
+
+  if (res == 0) {
+    frame[PPRZ_GEC_IDX] = type;  // CRYPTO_BYTE
+    *frame_len = GEC_FRAME_LEN(mlen);
+    gec_tp.sts.tx_sym_key.counter = counter;  // update counter
+    return true;
+  } else {
+    gec_tp.sts.encrypt_err++;
+    return false;
+  }
+}
+
 /**
  * Attempts message encryption
  * Adds crypto_byte, counter and tag
@@ -374,42 +440,52 @@ bool gec_encrypt_message(uint8_t *buf, uint8_t *payload_len)
     return false;
   }
 
-  // increment counter
-  uint32_t counter = gec_tp.sts.tx_sym_key.counter + 1;
-  // convert to bytes
-  uint8_t counter_as_bytes[4];
-  gec_counter_to_bytes(counter, counter_as_bytes);
-  // update nonce
-  memcpy(gec_tp.sts.tx_sym_key.nonce, counter_as_bytes, sizeof(uint32_t));
-
-  // update intermediate fields
-  uint8_t auth[PPRZ_AUTH_LEN];
-  memcpy(auth, buf, PPRZ_AUTH_LEN);
-  uint8_t tag[PPRZ_MAC_LEN];
-  uint8_t ciphertext[TRANSPORT_PAYLOAD_LEN - PPRZ_CRYPTO_OVERHEAD];
   uint32_t mlen = *payload_len - PPRZ_AUTH_LEN;  // at least CLASS_BYTE and MSG_ID
+  if (GEC_FRAME_LEN(mlen) > Min(TRANSPORT_PAYLOAD_LEN, UINT8_MAX)) {
+    return false;
+  }
+  // move the message to its place in the frame (AUTH, PLAINTEXT), it is then encrypted in place
+  memmove(&buf[PPRZ_AUTH_IDX], buf, *payload_len);
 
-  uint32_t res = Hacl_Chacha20Poly1305_aead_encrypt(ciphertext, tag,
-                 &buf[PPRZ_AUTH_LEN], mlen, auth,
-                 PPRZ_AUTH_LEN, gec_tp.sts.tx_sym_key.key, gec_tp.sts.tx_sym_key.nonce);
+  return gec_encrypt_frame(buf, payload_len, PPRZ_MSG_TYPE_ENCRYPTED, &buf[PPRZ_AUTH_IDX],
+                           &buf[PPRZ_CIPH_IDX], mlen);
+}
 
+/**
+ * Check the counter and decrypt a frame (CRYPTO_BYTE .. TAG)
+ * Returns the plaintext (CLASS/MSG_ID .. MSG_PAYLOAD, or a batch of messages),
+ * the frame is not modified.
+ */
+static bool gec_decrypt_frame(uint8_t *buf, uint8_t len, uint8_t *plain, uint32_t *mlen)
+{
+  if (len < PPRZ_ENCRYPTED_MSG_MIN_LEN) {
+    return false;
+  }
+  if (!gec_tp.sts.rx_sym_key.ready) {
+    // the rx key is not ready yet
+    return false;
+  }
+  // first check the message counter against the replay window
+  uint32_t counter = gec_bytes_to_counter(&buf[PPRZ_CNTR_IDX]);
+  if (!gec_counter_is_valid(&gec_tp.sts.rx_sym_key, counter)) {
+    gec_tp.sts.rx_counter_err++;
+    return false;
+  }
+  // update nonce with 4 counter bytes
+  memcpy(gec_tp.sts.rx_sym_key.nonce, &buf[PPRZ_CNTR_IDX], sizeof(uint32_t));
+  // payload - CRYPTO_BYTE(1) - COUNTER(4) - AUTH_DATA - TAG(16)
+  *mlen = len - PPRZ_CIPH_IDX - PPRZ_MAC_LEN;
+
+  // try decryption, res == 0 means all good
+  uint32_t res = Hacl_Chacha20Poly1305_aead_decrypt(plain, &buf[PPRZ_CIPH_IDX],
+                 *mlen, &buf[len - PPRZ_MAC_LEN], &buf[PPRZ_AUTH_IDX],
+                 PPRZ_AUTH_LEN, gec_tp.sts.rx_sym_key.key,
+                 gec_tp.sts.rx_sym_key.nonce);
   if (res == 0) {
-    memset(buf, 0, TRANSPORT_PAYLOAD_LEN);  // reset  whole buffer
-    *payload_len = 0;
-    buf[PPRZ_GEC_IDX] = PPRZ_MSG_TYPE_ENCRYPTED;  // CRYPTO_BYTE
-    *payload_len += 1;
-    memcpy(&buf[PPRZ_CNTR_IDX], counter_as_bytes, sizeof(uint32_t));  // counter
-    *payload_len += sizeof(uint32_t);
-    memcpy(&buf[PPRZ_AUTH_IDX], auth, PPRZ_AUTH_LEN);  // auth data
-    *payload_len += PPRZ_AUTH_LEN;
-    memcpy(&buf[PPRZ_CIPH_IDX], ciphertext, mlen);  // ciphertext
-    *payload_len += mlen;
-    memcpy(&buf[PPRZ_CIPH_IDX + mlen], tag, PPRZ_MAC_LEN);  // tag
-    *payload_len += PPRZ_MAC_LEN;
-    gec_tp.sts.tx_sym_key.counter = counter;  // update counter
+    gec_counter_update(&gec_tp.sts.rx_sym_key, counter);
     return true;
   } else {
-    gec_tp.sts.encrypt_err++;
+    gec_tp.sts.decrypt_err++;
     return false;
   }
 }
@@ -439,63 +515,125 @@ bool gec_decrypt_message(uint8_t *buf, volatile uint8_t *payload_len)
       }
       return false;
       break;
-    case PPRZ_MSG_TYPE_ENCRYPTED:
-      // attempt decryption
-      if (*payload_len < PPRZ_ENCRYPTED_MSG_MIN_LEN) {
-        return false;
-      }
-      if (!gec_tp.sts.rx_sym_key.ready) {
-        // the rx key is not ready yet
-        return false;
-      }
-      // first check the message counter
-      uint32_t counter = gec_bytes_to_counter(&buf[PPRZ_CNTR_IDX]);
-      // check against the saved counter
-      if (counter <= gec_tp.sts.rx_sym_key.counter) {
-        gec_tp.sts.rx_counter_err++;
+    case PPRZ_MSG_TYPE_ENCRYPTED: {
+      uint8_t plaintext[TRANSPORT_PAYLOAD_LEN - PPRZ_CRYPTO_OVERHEAD];
+      uint32_t mlen;
+      if (!gec_decrypt_frame(buf, *payload_len, plaintext, &mlen)) {
         return false;
       }
-      // update nonce with 4 counter bytes
-      memcpy(gec_tp.sts.rx_sym_key.nonce, &buf[PPRZ_CNTR_IDX],
-             sizeof(uint32_t));
-      // update intermediate fields
       uint8_t auth[PPRZ_AUTH_LEN];
       memcpy(auth, &buf[PPRZ_AUTH_IDX], PPRZ_AUTH_LEN);
-      uint8_t tag[PPRZ_MAC_LEN];
-      memcpy(tag, &buf[*payload_len - PPRZ_MAC_LEN], PPRZ_MAC_LEN);
-      uint8_t ciphertext[TRANSPORT_PAYLOAD_LEN - PPRZ_CRYPTO_OVERHEAD];
-      // payload - AUTH_DATA(2) - TAG(16) - CRYPTO_BYTE(1) - COUNTER(4) = payload_len - 23
-      uint32_t mlen = *payload_len - PPRZ_CRYPTO_OVERHEAD - 1 - PPRZ_AUTH_LEN;  // don't forget to count for CRYPTO_BYTE
-      memcpy(ciphertext, &buf[PPRZ_CIPH_IDX], mlen);
-      uint8_t plaintext[TRANSPORT_PAYLOAD_LEN - PPRZ_CRYPTO_OVERHEAD];
-
-      // try decryption
-      uint32_t res = Hacl_Chacha20Poly1305_aead_decrypt(plaintext, ciphertext,
-                     mlen, tag, auth,
-                     PPRZ_AUTH_LEN, gec_tp.sts.rx_sym_key.key,
-                     gec_tp.sts.rx_sym_key.nonce);
-
-      // res == 0 means all good
-      if (res == 0) {
-        memset(buf, 0, TRANSPORT_PAYLOAD_LEN);  // reset  whole buffer
-        *payload_len = 0;
-        memcpy(buf, auth, PPRZ_AUTH_LEN);  // copy auth data
-        *payload_len += PPRZ_AUTH_LEN;
-        memcpy(&buf[PPRZ_AUTH_LEN], plaintext, mlen);  // copy plaintext
-        *payload_len += mlen;
-        gec_tp.sts.rx_sym_key.counter = counter;  // update counter
-        return true;
-      } else {
-        gec_tp.sts.decrypt_err++;
-        return false;
-      }
-      break;
+      memset(buf, 0, TRANSPORT_PAYLOAD_LEN);  // reset  whole buffer
+      memcpy(buf, auth, PPRZ_AUTH_LEN);  // copy auth data
+      memcpy(&buf[PPRZ_AUTH_LEN], plaintext, mlen);  // copy plaintext
+      *payload_len = PPRZ_AUTH_LEN + mlen;
+      return true;
+    }
     default:
       break;
   }
   return false;
 }
 
+#if GEC_BATCH
+/**
+ * Queue the message of the tx buffer (SENDER_ID .. MSG_PAYLOAD) in the batch
+ * The queued messages are sent first if the new one doesn't fit
+ * or has different auth data.
+ * Returns false if the message is too long to be batched.
+ */
+static bool gec_batch_add(struct link_device *dev)
+{
+  struct gec_batch *b = &gec_tp.batch;
+  if (gec_tp.tx_msg_idx <= PPRZ_MSG_ID) {
+    return true; // invalid message, dropped
+  }
+  uint8_t n = gec_tp.tx_msg_idx - PPRZ_AUTH_LEN;
+  if (GEC_FRAME_LEN(1 + n) > GEC_BATCH_FRAME_MAX) {
+    // send the queued messages first to keep the order
+    gec_batch_send();
+    return false;
+  }
+  if (b->nb > 0 && (dev != b->dev || memcmp(b->auth, gec_tp.tx_msg, PPRZ_AUTH_LEN) != 0 ||
+                    GEC_FRAME_LEN(b->len + 1 + n) > GEC_BATCH_FRAME_MAX)) {
+    gec_batch_send();
+  }
+  if (b->nb == 0) {
+    memcpy(b->auth, gec_tp.tx_msg, PPRZ_AUTH_LEN);
+    b->dev = dev;
+  }
+  b->buf[b->len] = n;
+  memcpy(&b->buf[b->len + 1], &gec_tp.tx_msg[PPRZ_AUTH_LEN], n);
+  b->len += 1 + n;
+  b->nb++;
+  return true;
+}
+
+/**
+ * Encrypt the queued messages in one frame and send it
+ * The frame is built in its own buffer as the tx buffer may hold a message.
+ */
+static void gec_batch_send(void)
+{
+  struct gec_batch *b = &gec_tp.batch;
+  uint8_t frame[TRANSPORT_PAYLOAD_LEN];
+  uint8_t len;
+  if (b->nb > 0 && gec_tp.sts.tx_sym_key.ready &&
+      gec_encrypt_frame(frame, &len, PPRZ_MSG_TYPE_BATCH, b->auth, b->buf, b->len)) {
+#if PPRZLINK_DEFAULT_VER == 2
+    struct pprzlink_msg msg;
+    msg.trans = &gec_tp.trans_tx;
+    msg.dev = b->dev;
+    gec_tp.pprz_tp.trans_tx.start_message(&msg, _FD, len);
+    gec_tp.pprz_tp.trans_tx.put_bytes(&msg, _FD, DL_TYPE_UINT8, DL_FORMAT_SCALAR, frame, len);
+    gec_tp.pprz_tp.trans_tx.end_message(&msg, _FD);
+#else
+    gec_tp.pprz_tp.trans_tx.start_message(&gec_tp, b->dev, _FD, len);
+    gec_tp.pprz_tp.trans_tx.put_bytes(&gec_tp, b->dev, _FD, DL_TYPE_UINT8, DL_FORMAT_SCALAR, frame, len);
+    gec_tp.pprz_tp.trans_tx.end_message(&gec_tp, b->dev, _FD);
+#endif
+    b->nb_frames++;
+    b->nb_msgs += b->nb;
+  }
+  b->len = 0;
+  b->nb = 0;
+}
+
+/**
+ * Decrypt a batched frame and pass each message to the datalink
+ */
+static void gec_parse_batch(uint8_t *buf, uint8_t len)
+{
+  uint8_t plaintext[TRANSPORT_PAYLOAD_LEN];
+  uint32_t mlen, i = 0;
+  if (!gec_decrypt_frame(buf, len, plaintext, &mlen)) {
+    return;
+  }
+  while (i < mlen) {
+    uint8_t n = plaintext[i];
+    if (n < GEC_BATCH_MSG_MIN_LEN || i + 1 + n > mlen) {
+      break; // malformed batch
+    }
+    // rebuild the message (SENDER_ID .. MSG_PAYLOAD)
+    memcpy(dl_buffer, &buf[PPRZ_AUTH_IDX], PPRZ_AUTH_LEN);
+    memcpy(&dl_buffer[PPRZ_AUTH_LEN], &plaintext[i + 1], n);
+    dl_msg_available = true;
+    DlCheckAndParse(&DOWNLINK_DEVICE.device, &gec_tp.trans_tx, dl_buffer,
+                    &dl_msg_available, GEC_UPDATE_DL);
+    i += 1 + n;
+  }
+}
+#endif
+
+void gec_dl_flush(void)
+{
+#if GEC_BATCH
+  PPRZ_MUTEX_LOCK(gec_tp.mtx_tx);
+  gec_batch_send();
+  PPRZ_MUTEX_UNLOCK(gec_tp.mtx_tx);
+#endif
+}
+
 /**
  * Parse incoming message bytes (PPRZ_STX..CHCKSUM B) and returns a new decrypted message if it is available.
  * While the status != Crypto_OK no message is returned, and all logic is handled internally.
@@ -527,6 +665,9 @@ bool gec_decrypt_message(uint8_t *buf, volatile uint8_t *payload_len)
  */
 void gec_dl_event(void)
 {
+  // send the messages queued since the last event
+  gec_dl_flush();
+
   // strip PPRZ_STX, MSG_LEN, and CHEKSUM, return (CRYPTO_BYTE..MSG_PAYLOAD)
   pprz_check_and_parse(&DOWNLINK_DEVICE.device, &gec_tp.pprz_tp,
                        gec_tp.pprz_tp.trans_rx.payload, (bool *) &gec_tp.trans_rx.msg_received);
@@ -534,6 +675,12 @@ void gec_dl_event(void)
   if (gec_tp.trans_rx.msg_received) {  // self.rx.parse_byte(b)
     switch (gec_tp.sts.protocol_stage) {
       case CRYPTO_OK:
+#if GEC_BATCH
+        if (gec_tp.pprz_tp.trans_rx.payload[PPRZ_GEC_IDX] == PPRZ_MSG_TYPE_BATCH) {
+          gec_parse_batch(gec_tp.pprz_tp.trans_rx.payload, gec_tp.pprz_tp.trans_rx.payload_len);
+          break;
+        }
+#endif
         // decrypt message
         // if successfull return the message (sender_ID .. MSG_payload)
         if (gec_decrypt_message(gec_tp.pprz_tp.trans_rx.payload,
@@ -45,6 +45,20 @@
 #define KEY_EXCHANGE_MSG_ID_GCS 159
 #define WHITELIST_LEN 20
 
+/** Pack several messages in one encrypted frame
+ *  The ground side must support the PPRZ_MSG_TYPE_BATCH frames.
+ */
+#ifndef GEC_BATCH
+#define GEC_BATCH FALSE
+#endif
+
+/** Max size of a batched frame (bytes of pprz payload, crypto overhead included)
+ *  default is the largest pprz payload (255 bytes frame minus STX, LEN and checksum)
+ */
+#ifndef GEC_BATCH_MTU
+#define GEC_BATCH_MTU 251
+#endif
+
 /**
  * Whitelist for sending and receiving
  * unencrypted messages
@@ -66,6 +80,21 @@ struct message_buffer {
   bool message_ready;
 };
 
+/**
+ * Messages waiting to be encrypted in the same frame
+ * Each message is stored as (LEN, CLASS/MSG_ID .. MSG_PAYLOAD),
+ * the auth data (source and destination ID) is common to all messages.
+ */
+struct gec_batch {
+  uint8_t buf[TRANSPORT_PAYLOAD_LEN];
+  uint8_t len;
+  uint8_t nb;                 ///< number of messages in buf
+  uint8_t auth[2];
+  struct link_device *dev;    ///< device of the queued messages
+  uint32_t nb_frames;         ///< sent frames
+  uint32_t nb_msgs;           ///< sent messages
+};
+
 struct gec_transport {
   // pprz encapsulation layer
   struct pprz_transport pprz_tp;
@@ -82,6 +111,7 @@ struct gec_transport {
   // ecnryption primitives
   struct gec_sts_ctx sts;
   struct gec_whitelist whitelist;
+  struct gec_batch batch;
 
   // optional mutex
   PPRZ_MUTEX(mtx_tx);
@@ -113,6 +143,9 @@ bool gec_is_in_the_whitelist(struct gec_whitelist *whitelist, uint8_t id);
 bool gec_decrypt_message(uint8_t *buf, volatile uint8_t *payload_len);
 bool gec_encrypt_message(uint8_t *buf, uint8_t *payload_len);
 
+/** Encrypt and send the queued messages (if GEC_BATCH) */
+void gec_dl_flush(void);
+
 void gec_process_msg1(uint8_t *buf);
 bool gec_process_msg3(uint8_t *buf);
 
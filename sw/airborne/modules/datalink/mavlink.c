@@ -64,10 +64,6 @@
 mavlink_system_t mavlink_system;
 
 static uint8_t mavlink_params_idx = NB_SETTING; /**< Transmitting parameters index */
-/** mavlink parameter names.
- * 16 chars + 1 NULL termination.
- */
-static char mavlink_param_names[NB_SETTING][16 + 1] = SETTINGS_NAMES_SHORT;
 static uint8_t custom_version[8]; /**< first 8 bytes (16 chars) of GIT SHA1 */
 
 mavlink_mission_mgr mission_mgr;
@@ -174,29 +170,12 @@ void mavlink_periodic(void)
   mavlink_mission_periodic();
 }
 
+/** Find a setting from its parameter id (short name, 16 chars, not always NULL terminated)
+ * @return index of the setting or -1 if not found
+ */
 static int16_t settings_idx_from_param_id(char *param_id)
 {
-  int i, j;
-  int16_t settings_idx = -1;
-
-  // Go trough all the settings to search the ID
-  for (i = 0; i < NB_SETTING; i++) {
-    for (j = 0; j < 16; j++) {
-      if (mavlink_param_names[i][j] != param_id[j]) {
-        break;
-      }
-
-      if (mavlink_param_names[i][j] == '\0') {
-        settings_idx = i;
-        return settings_idx;
-      }
-    }
-
-    if (mavlink_param_names[i][j] == '\0') {
-      break;
-    }
-  }
-  return settings_idx;
+  return settings_idx_from_short_name(param_id);
 }
 
 /**
@@ -270,7 +249,7 @@ void mavlink_common_message_handler(const mavlink_message_t *msg)
       // Send message only if the param_index was found (Coverity Scan)
       if (cmd.param_index > -1) {
         mavlink_msg_param_value_send(MAVLINK_COMM_0,
-                                     mavlink_param_names[cmd.param_index],
+                                     settings_get_short_name(cmd.param_index),
                                      settings_get_value(cmd.param_index),
                                      MAV_PARAM_TYPE_REAL32,
                                      NB_SETTING,
@@ -292,12 +271,16 @@ void mavlink_common_message_handler(const mavlink_message_t *msg)
         if (idx >= 0) {
           // Only write if new value is NOT "not-a-number"
           // AND is NOT infinity
+          // AND is within the range of the setting
+          const struct SettingMeta *meta = settings_get_meta(idx);
           if (set.param_type == MAV_PARAM_TYPE_REAL32 &&
-              !isnan(set.param_value) && !isinf(set.param_value)) {
+              !isnan(set.param_value) && !isinf(set.param_value) &&
+              set.param_value >= Min(meta->min, meta->max) &&
+              set.param_value <= Max(meta->min, meta->max)) {
             DlSetting(idx, set.param_value);
             // Report back new value
             mavlink_msg_param_value_send(MAVLINK_COMM_0,
-                                         mavlink_param_names[idx],
+                                         settings_get_short_name(idx),
                                          settings_get_value(idx),
                                          MAV_PARAM_TYPE_REAL32,
                                          NB_SETTING,
@@ -612,7 +595,7 @@ static void mavlink_send_params(struct transport_tx *trans, struct link_device *
   }
 
   mavlink_msg_param_value_send(MAVLINK_COMM_0,
-                               mavlink_param_names[mavlink_params_idx],
+                               settings_get_short_name(mavlink_params_idx),
                                settings_get_value(mavlink_params_idx),
                                MAV_PARAM_TYPE_REAL32,
                                NB_SETTING,
@@ -28,6 +28,7 @@
 
 #include "modules/geo_mag/geo_mag.h"
 #include "math/pprz_geodetic_wmm2020.h"
+#include "math/pprz_geodetic_mag_tile.h"
 #include "math/pprz_algebra_double.h"
 #include "subsystems/gps.h"
 #include "subsystems/abi.h"
@@ -40,32 +41,91 @@
 #define GEO_MAG_SENDER_ID 1
 #endif
 
+/** Continuously update the field from a cached local tile
+ *  instead of computing it once at startup
+ */
+#ifndef GEO_MAG_USE_TILE
+#define GEO_MAG_USE_TILE FALSE
+#endif
+
+/** Number of tile grid nodes evaluated per event call */
+#ifndef GEO_MAG_TILE_NODES_PER_STEP
+#define GEO_MAG_TILE_NODES_PER_STEP 1
+#endif
+
 struct GeoMag geo_mag;
 
+#if GEO_MAG_USE_TILE
+static struct MagTileService geo_mag_tile;
+static bool geo_mag_tile_init;
+#endif
+
+/** Current date in decimal year, for example 2015.68 */
+static double geo_mag_sdate(void)
+{
+  return GPS_EPOCH_BEGIN +
+         (double)gps.week / WEEKS_IN_YEAR +
+         (double)gps.tow / 1000 / SECS_IN_YEAR;
+}
+
+static void geo_mag_send(void)
+{
+  // send as normalized float vector via ABI
+  struct FloatVect3 h = { .x = geo_mag.vect.x,
+                          .y = geo_mag.vect.y,
+                          .z = geo_mag.vect.z };
+  float_vect3_normalize(&h);
+  AbiSendMsgGEO_MAG(GEO_MAG_SENDER_ID, &h);
+}
+
 void geo_mag_init(void)
 {
   geo_mag.calc_once = false;
   geo_mag.ready = false;
+#if GEO_MAG_USE_TILE
+  geo_mag_tile_init = false;
+#endif
 }
 
 void geo_mag_periodic(void)
 {
+#if GEO_MAG_USE_TILE
+  if (GpsFixValid()) {
+    if (!geo_mag_tile_init) {
+      mag_tile_service_init(&geo_mag_tile, geo_mag_sdate());
+      geo_mag_tile_init = true;
+    }
+    struct FloatVect3 field;
+    if (mag_tile_service_get_field(&geo_mag_tile,
+                                   (double)gps.lla_pos.lat / 1e7,
+                                   (double)gps.lla_pos.lon / 1e7,
+                                   (double)gps.lla_pos.alt / 1e6, &field)) {
+      VECT3_COPY(geo_mag.vect, field);
+      geo_mag_send();
+      geo_mag.ready = true;
+    }
+  }
+#else
   //FIXME: kill_throttle has no place  in a geomag module
   if (!geo_mag.ready && GpsFixValid() && autopilot_throttle_killed()) {
     geo_mag.calc_once = true;
   }
+#endif
 }
 
 void geo_mag_event(void)
 {
+#if GEO_MAG_USE_TILE
+  // build the next tile in the background, a few nodes at a time
+  if (geo_mag_tile_init) {
+    mag_tile_service_step(&geo_mag_tile, GEO_MAG_TILE_NODES_PER_STEP);
+  }
+#endif
   if (geo_mag.calc_once) {
     double gha[MAXCOEFF]; // Geomag global variables
     int32_t nmax;
 
-    /* Current date in decimal year, for example 2015.68 */
-    double sdate = GPS_EPOCH_BEGIN +
-                   (double)gps.week / WEEKS_IN_YEAR +
-                   (double)gps.tow / 1000 / SECS_IN_YEAR;
+    double sdate = geo_mag_sdate();
 
     /* LLA Position in decimal degrees and altitude in km */
     double latitude = (double)gps.lla_pos.lat / 1e7;
@@ -79,12 +139,7 @@ void geo_mag_event(void)
              &geo_mag.vect.x, &geo_mag.vect.y, &geo_mag.vect.z,
              IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
 
-    // send as normalized float vector via ABI
-    struct FloatVect3 h = { .x = geo_mag.vect.x,
-                            .y = geo_mag.vect.y,
-                            .z = geo_mag.vect.z };
-    float_vect3_normalize(&h);
-    AbiSendMsgGEO_MAG(GEO_MAG_SENDER_ID, &h);
+    geo_mag_send();
 
     geo_mag.ready = true;
   }
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/geoid/geoid.c
+ * @brief Geoid separation grid generated at build time from EGM96.
+ *
+ * The grid data is generated in the aircraft generated directory
+ * by sw/tools/generators/gen_geoid.py (see Makefile.ac).
+ */
+
+#include "modules/geoid/geoid.h"
+#include "generated/geoid_grid.h"
+
+const struct GeoidGrid geoid_grid = {
+  .data = geoid_grid_data,
+  .nb_lat = GEOID_GRID_NB_LAT,
+  .nb_lon = GEOID_GRID_NB_LON,
+  .step = GEOID_GRID_STEP
+};
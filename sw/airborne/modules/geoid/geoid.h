@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file modules/geoid/geoid.h
+ * @brief Geoid separation grid generated at build time from EGM96.
+ *
+ * When this module is loaded, wgs84_ellipsoid_to_geoid_i/_f
+ * use the generated grid instead of the 10 degrees WGS84 table.
+ */
+
+#ifndef GEOID_H
+#define GEOID_H
+
+#include "math/pprz_geodetic_geoid.h"
+
+#endif /* GEOID_H */
@@ -21,17 +21,21 @@
  */
 
 #include <math.h>
+#include <string.h>
 #include "std.h"
 
 #include "modules/guidance/gvf/gvf.h"
 #include "modules/guidance/gvf/trajectories/gvf_ellipse.h"
 #include "modules/guidance/gvf/trajectories/gvf_line.h"
 #include "modules/guidance/gvf/trajectories/gvf_sin.h"
+#include "modules/guidance/gvf/trajectories/gvf_traj.h"
+#include "modules/guidance/gvf/trajectories/gvf_path.h"
 
 #include "firmwares/fixedwing/nav.h"
 #include "subsystems/navigation/common_nav.h"
 #include "firmwares/fixedwing/stabilization/stabilization_attitude.h"
 #include "autopilot.h"
+#include "subsystems/datalink/downlink.h"
 
 // Control
 gvf_con gvf_control;
@@ -40,6 +44,42 @@ gvf_con gvf_control;
 gvf_tra gvf_trajectory;
 gvf_seg gvf_segment;
 
+// Path followed by gvf_path_follow
+struct gvf_path gvf_nav_path;
+
+/** Geometry of the last segment, only computed when its end points change */
+static struct {
+  bool valid;
+  float x1, y1, x2, y2;
+  float alpha;  ///< heading of the segment
+  float cosb;   ///< rotation aligning the segment with the x axis
+  float sinb;
+  float zxr;    ///< length of the segment along the rotated x axis
+} gvf_seg_geom;
+
+static void gvf_segment_geometry(float x1, float y1, float x2, float y2)
+{
+  if (gvf_seg_geom.valid && gvf_seg_geom.x1 == x1 && gvf_seg_geom.y1 == y1
+      && gvf_seg_geom.x2 == x2 && gvf_seg_geom.y2 == y2) {
+    return;
+  }
+
+  float zx = x2 - x1;
+  float zy = y2 - y1;
+
+  float beta = atan2f(zy, zx);
+  gvf_seg_geom.cosb = cosf(-beta);
+  gvf_seg_geom.sinb = sinf(-beta);
+  gvf_seg_geom.zxr = zx * gvf_seg_geom.cosb - zy * gvf_seg_geom.sinb;
+  gvf_seg_geom.alpha = atanf(zx / zy);
+
+  gvf_seg_geom.x1 = x1;
+  gvf_seg_geom.y1 = y1;
+  gvf_seg_geom.x2 = x2;
+  gvf_seg_geom.y2 = y2;
+  gvf_seg_geom.valid = true;
+}
+
 #if PERIODIC_TELEMETRY
 #include "subsystems/datalink/telemetry.h"
 static void send_gvf(struct transport_tx *trans, struct link_device *dev)
@@ -96,15 +136,11 @@ static int out_of_segment_area(float x1, float y1, float x2, float y2, float d1,
   float px = p->x - x1;
   float py = p->y - y1;
 
-  float zx = x2 - x1;
   float zy = y2 - y1;
-  float alpha = atan2f(zy, zx);
-
-  float cosa = cosf(-alpha);
-  float sina = sinf(-alpha);
 
-  float pxr = px * cosa - py * sina;
-  float zxr = zx * cosa - zy * sina;
+  gvf_segment_geometry(x1, y1, x2, y2);
+  float pxr = px * gvf_seg_geom.cosb - py * gvf_seg_geom.sinb;
+  float zxr = gvf_seg_geom.zxr;
 
   int s = 0;
 
@@ -127,6 +163,7 @@ void gvf_init(void)
   gvf_control.kn = 1;
   gvf_control.s = 1;
   gvf_trajectory.type = NONE;
+  gvf_path_init(&gvf_nav_path);
 
 #if PERIODIC_TELEMETRY
   register_periodic_telemetry(DefaultPeriodic, PPRZ_MSG_ID_GVF, send_gvf);
@@ -215,10 +252,8 @@ static void gvf_line(float a, float b, float heading)
   struct gvf_grad grad_line;
   struct gvf_Hess Hess_line;
 
-  gvf_trajectory.type = 0;
-  gvf_trajectory.p[0] = a;
-  gvf_trajectory.p[1] = b;
-  gvf_trajectory.p[2] = heading;
+  float p[GVF_LINE_NB_PARAM] = {a, b, heading};
+  gvf_traj_set(&gvf_trajectory, LINE, p);
 
   gvf_line_info(&e, &grad_line, &Hess_line);
   gvf_control.ke = gvf_line_par.ke;
@@ -239,22 +274,17 @@ bool gvf_line_XY_heading(float a, float b, float heading)
 
 bool gvf_line_XY1_XY2(float x1, float y1, float x2, float y2)
 {
-  float zx = x2 - x1;
   float zy = y2 - y1;
 
-  float alpha = atanf(zx / zy);
-
-  float beta = atan2f(zy, zx);
-  float cosb = cosf(-beta);
-  float sinb = sinf(-beta);
-  float zxr = zx * cosb - zy * sinb;
+  gvf_segment_geometry(x1, y1, x2, y2);
+  float zxr = gvf_seg_geom.zxr;
   if((zxr > 0 && zy > 0) || (zxr < 0 && zy < 0)) {
       gvf_set_direction(1);
   } else {
       gvf_set_direction(-1);
   }
 
-  gvf_line(x1, y1, alpha);
+  gvf_line(x1, y1, gvf_seg_geom.alpha);
 
   horizontal_mode = HORIZONTAL_MODE_ROUTE;
   gvf_segment.seg = 1;
@@ -283,11 +313,8 @@ bool gvf_segment_loop_XY1_XY2(float x1, float y1, float x2, float y2, float d1,
     gvf_control.s = s;
   }
 
-  float zx = x2 - x1;
-  float zy = y2 - y1;
-  float alpha = atanf(zx / zy);
-
-  gvf_line(x1, y1, alpha);
+  gvf_segment_geometry(x1, y1, x2, y2);
+  gvf_line(x1, y1, gvf_seg_geom.alpha);
 
   horizontal_mode = HORIZONTAL_MODE_ROUTE;
   gvf_segment.seg = 1;
@@ -315,14 +342,9 @@ bool gvf_segment_XY1_XY2(float x1, float y1, float x2, float y2)
   float px = p->x - x1;
   float py = p->y - y1;
 
-  float zx = x2 - x1;
-  float zy = y2 - y1;
-
-  float beta = atan2f(zy, zx);
-  float cosb = cosf(-beta);
-  float sinb = sinf(-beta);
-  float zxr = zx * cosb - zy * sinb;
-  float pxr = px * cosb - py * sinb;
+  gvf_segment_geometry(x1, y1, x2, y2);
+  float zxr = gvf_seg_geom.zxr;
+  float pxr = px * gvf_seg_geom.cosb - py * gvf_seg_geom.sinb;
 
   if((zxr > 0 && pxr > zxr) || (zxr < 0 && pxr < zxr)) {
       return false;
@@ -359,19 +381,16 @@ bool gvf_ellipse_XY(float x, float y, float a, float b, float alpha)
   struct gvf_grad grad_ellipse;
   struct gvf_Hess Hess_ellipse;
 
-  gvf_trajectory.type = 1;
-  gvf_trajectory.p[0] = x;
-  gvf_trajectory.p[1] = y;
-  gvf_trajectory.p[2] = a;
-  gvf_trajectory.p[3] = b;
-  gvf_trajectory.p[4] = alpha;
+  float p[GVF_ELLIPSE_NB_PARAM] = {x, y, a, b, alpha};
 
   // SAFE MODE
   if (a < 1 || b < 1) {
-    gvf_trajectory.p[2] = 60;
-    gvf_trajectory.p[3] = 60;
+    p[2] = 60;
+    p[3] = 60;
   }
 
+  gvf_traj_set(&gvf_trajectory, ELLIPSE, p);
+
   if (gvf_trajectory.p[2] == gvf_trajectory.p[3]) {
     horizontal_mode = HORIZONTAL_MODE_CIRCLE;
   } else {
@@ -403,13 +422,8 @@ bool gvf_sin_XY_alpha(float a, float b, float alpha, float w, float off, float A
   struct gvf_grad grad_line;
   struct gvf_Hess Hess_line;
 
-  gvf_trajectory.type = 2;
-  gvf_trajectory.p[0] = a;
-  gvf_trajectory.p[1] = b;
-  gvf_trajectory.p[2] = alpha;
-  gvf_trajectory.p[3] = w;
-  gvf_trajectory.p[4] = off;
-  gvf_trajectory.p[5] = A;
+  float p[GVF_SIN_NB_PARAM] = {a, b, alpha, w, off, A};
+  gvf_traj_set(&gvf_trajectory, SIN, p);
 
   gvf_sin_info(&e, &grad_line, &Hess_line);
   gvf_control.ke = gvf_sin_par.ke;
@@ -452,3 +466,116 @@ bool gvf_sin_wp_alpha(uint8_t wp, float alpha, float w, float off, float A)
   return true;
 }
 
+// PATH
+
+bool gvf_path_follow(struct gvf_path *path)
+{
+  if (path->nb == 0) {
+    return false;
+  }
+
+  struct EnuCoor_f *p = stateGetPositionEnu_f();
+  bool running = gvf_path_update(path, p->x, p->y);
+  const struct gvf_path_seg *seg = &path->seg[path->active];
+
+  float e;
+  struct gvf_grad grad_path;
+  struct gvf_Hess Hess_path;
+
+  // trajectory of the active segment, from the terms cached in the table
+  gvf_path_seg_traj(seg, &gvf_trajectory);
+  gvf_set_direction(seg->s);
+  gvf_traj_eval(&gvf_trajectory, p->x, p->y, &e, &grad_path, &Hess_path);
+
+  if (seg->type == GVF_PATH_LINE) {
+    gvf_control.ke = gvf_line_par.ke;
+    gvf_control_2D(1e-2 * gvf_line_par.ke, gvf_line_par.kn, e, &grad_path, &Hess_path);
+
+    horizontal_mode = HORIZONTAL_MODE_ROUTE;
+    gvf_segment.seg = 1;
+    gvf_segment.x1 = seg->x;
+    gvf_segment.y1 = seg->y;
+    gvf_segment.x2 = seg->x + seg->len * seg->sina;
+    gvf_segment.y2 = seg->y + seg->len * seg->cosa;
+  } else {
+    gvf_control.ke = gvf_ellipse_par.ke;
+    gvf_control_2D(gvf_ellipse_par.ke, gvf_ellipse_par.kn, e, &grad_path, &Hess_path);
+
+    horizontal_mode = HORIZONTAL_MODE_CIRCLE;
+    gvf_segment.seg = 0;
+  }
+
+  gvf_control.error = e;
+
+  return running;
+}
+
+/** Waypoints gvf_nav_path was last built from by gvf_path_wps */
+static struct {
+  bool valid;   ///< the waypoints make a path
+  uint8_t first_wp;
+  uint8_t nb_wp;
+  float x[GVF_PATH_MAX_SEG + 1];
+  float y[GVF_PATH_MAX_SEG + 1];
+} gvf_nav_wps;
+
+static void gvf_path_wps_error(const char *msg)
+{
+#if DOWNLINK
+  DOWNLINK_SEND_INFO_MSG(DefaultChannel, DefaultDevice, strlen(msg), msg);
+#else
+  (void) msg;
+#endif
+}
+
+bool gvf_path_wps(uint8_t first_wp, uint8_t nb_wp)
+{
+  if (nb_wp < 2) {
+    return false;
+  }
+
+  // the table is only built again if the waypoints changed,
+  // and an invalid set of waypoints is only reported once
+  bool changed = gvf_nav_wps.first_wp != first_wp || gvf_nav_wps.nb_wp != nb_wp;
+  if (nb_wp > GVF_PATH_MAX_SEG + 1) {
+    if (changed) {
+      gvf_nav_wps.valid = false;
+      gvf_nav_wps.first_wp = first_wp;
+      gvf_nav_wps.nb_wp = nb_wp;
+      gvf_path_wps_error("gvf_path_wps: too many waypoints");
+    }
+    return false;
+  }
+  for (uint8_t i = 0; !changed && i < nb_wp; i++) {
+    changed = gvf_nav_wps.x[i] != waypoints[first_wp + i].x
+              || gvf_nav_wps.y[i] != waypoints[first_wp + i].y;
+  }
+
+  if (changed) {
+    gvf_nav_wps.first_wp = first_wp;
+    gvf_nav_wps.nb_wp = nb_wp;
+    for (uint8_t i = 0; i < nb_wp; i++) {
+      gvf_nav_wps.x[i] = waypoints[first_wp + i].x;
+      gvf_nav_wps.y[i] = waypoints[first_wp + i].y;
+    }
+
+    uint8_t active = gvf_nav_path.active;
+    gvf_path_start(&gvf_nav_path, gvf_nav_wps.x[0], gvf_nav_wps.y[0]);
+    gvf_nav_wps.valid = true;
+    for (uint8_t i = 1; i < nb_wp; i++) {
+      // zero length segments (coincident waypoints) are rejected
+      gvf_nav_wps.valid &= gvf_path_add_point(&gvf_nav_path, gvf_nav_wps.x[i], gvf_nav_wps.y[i]);
+    }
+    if (!gvf_nav_wps.valid) {
+      gvf_path_init(&gvf_nav_path);
+      gvf_path_wps_error("gvf_path_wps: coincident waypoints");
+    } else if (active < gvf_nav_path.nb) {
+      gvf_nav_path.active = active;
+    }
+  }
+
+  if (!gvf_nav_wps.valid) {
+    return false;
+  }
+  return gvf_path_follow(&gvf_nav_path);
+}
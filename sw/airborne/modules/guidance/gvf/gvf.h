@@ -55,9 +55,20 @@ enum trajectories {
   NONE = 255,
 };
 
+/** @typedef gvf_tra
+* @brief Trajectory being tracked
+* @param type Type of trajectory
+* @param p Parameters of the trajectory, depending on the type
+* @param cosa Cached cosine of the orientation of the trajectory
+* @param sina Cached sine of the orientation of the trajectory
+* @param k Other terms depending only on the parameters, cached by gvf_traj_set (see gvf_traj.h)
+*/
 typedef struct {
   enum trajectories type;
   float p[16];
+  float cosa;
+  float sina;
+  float k[5];
 } gvf_tra;
 
 /** @typedef gvf_seg
@@ -123,5 +134,11 @@ extern bool gvf_sin_wp1_wp2(uint8_t wp1, uint8_t wp2, float w, float off,
 extern bool gvf_sin_wp_alpha(uint8_t wp, float alpha, float w, float off,
                              float A);
 
+// Composite path (see trajectories/gvf_path.h)
+struct gvf_path;
+extern struct gvf_path gvf_nav_path;
+extern bool gvf_path_follow(struct gvf_path *path);
+extern bool gvf_path_wps(uint8_t first_wp, uint8_t nb_wp);
+
 
 #endif // GVF_H
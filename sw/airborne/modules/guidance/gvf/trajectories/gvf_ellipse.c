@@ -29,6 +29,7 @@
 
 #include "subsystems/navigation/common_nav.h"
 #include "gvf_ellipse.h"
+#include "gvf_traj.h"
 #include "generated/airframe.h"
 
 /*! Default gain ke for the ellipse trajectory */
@@ -63,33 +64,6 @@ gvf_ell_par gvf_ellipse_par = {GVF_ELLIPSE_KE, GVF_ELLIPSE_KN,
 void gvf_ellipse_info(float *phi, struct gvf_grad *grad,
                       struct gvf_Hess *hess)
 {
-
   struct EnuCoor_f *p = stateGetPositionEnu_f();
-  float px = p->x;
-  float py = p->y;
-  float wx = gvf_trajectory.p[0];
-  float wy = gvf_trajectory.p[1];
-  float a = gvf_trajectory.p[2];
-  float b = gvf_trajectory.p[3];
-  float alpha = gvf_trajectory.p[4];
-
-  float cosa = cosf(alpha);
-  float sina = sinf(alpha);
-
-  // Phi(x,y)
-  float xel = (px - wx) * cosa - (py - wy) * sina;
-  float yel = (px - wx) * sina + (py - wy) * cosa;
-  *phi = (xel / a) * (xel / a) + (yel / b) * (yel / b) - 1;
-
-  // grad Phi
-  grad->nx = (2 * xel / (a * a)) * cosa + (2 * yel / (b * b)) * sina;
-  grad->ny = (2 * yel / (b * b)) * cosa - (2 * xel / (a * a)) * sina;
-
-  // Hessian Phi
-  hess->H11 = 2 * (cosa * cosa / (a * a)
-                   + sina * sina / (b * b));
-  hess->H12 = 2 * sina * cosa * (1 / (b * b) - 1 / (a * a));
-  hess->H21 = hess->H12;
-  hess->H22 = 2 * (sina * sina / (a * a)
-                   + cosa * cosa / (b * b));
+  gvf_traj_eval(&gvf_trajectory, p->x, p->y, phi, grad, hess);
 }
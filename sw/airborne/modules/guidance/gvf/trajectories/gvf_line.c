@@ -29,6 +29,7 @@
 
 #include "subsystems/navigation/common_nav.h"
 #include "gvf_line.h"
+#include "gvf_traj.h"
 #include "generated/airframe.h"
 
 /*! Gain ke for the line trajectory*/
@@ -62,24 +63,6 @@ gvf_seg_par gvf_segment_par = {GVF_SEGMENT_D1, GVF_SEGMENT_D2};
 void gvf_line_info(float *phi, struct gvf_grad *grad,
                    struct gvf_Hess *hess)
 {
-
   struct EnuCoor_f *p = stateGetPositionEnu_f();
-  float px = p->x;
-  float py = p->y;
-  float a = gvf_trajectory.p[0];
-  float b = gvf_trajectory.p[1];
-  float alpha = gvf_trajectory.p[2];
-
-  // Phi(x,y)
-  *phi = -(px - a) * cosf(alpha) + (py - b) * sinf(alpha);
-
-  // grad Phi
-  grad->nx =  -cosf(alpha);
-  grad->ny =   sinf(alpha);
-
-  // Hessian Phi
-  hess->H11 = 0;
-  hess->H12 = 0;
-  hess->H21 = 0;
-  hess->H22 = 0;
+  gvf_traj_eval(&gvf_trajectory, p->x, p->y, phi, grad, hess);
 }
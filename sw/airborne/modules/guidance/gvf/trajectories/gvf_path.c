@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file gvf_path.c
+ *
+ *  Guidance algorithm based on vector fields
+ *  Composite paths made of a table of straight and circular segments
+ */
+
+#include "modules/guidance/gvf/trajectories/gvf_path.h"
+#include "modules/guidance/gvf/trajectories/gvf_traj.h"
+#include "math/pprz_trig_float.h"
+
+void gvf_path_init(struct gvf_path *path)
+{
+  path->nb = 0;
+  path->active = 0;
+  path->x_end = 0.f;
+  path->y_end = 0.f;
+  path->length = 0.f;
+}
+
+void gvf_path_start(struct gvf_path *path, float x, float y)
+{
+  gvf_path_init(path);
+  path->x_end = x;
+  path->y_end = y;
+}
+
+static struct gvf_path_seg *gvf_path_new_seg(struct gvf_path *path, enum gvf_path_seg_type type, float len)
+{
+  if (path->nb >= GVF_PATH_MAX_SEG || !(len > 0.f)) {
+    return NULL;
+  }
+  struct gvf_path_seg *seg = &path->seg[path->nb++];
+  seg->type = type;
+  seg->len = len;
+  seg->start = path->length;
+  path->length += len;
+  return seg;
+}
+
+bool gvf_path_add_line(struct gvf_path *path, float x1, float y1, float x2, float y2)
+{
+  const float zx = x2 - x1;
+  const float zy = y2 - y1;
+  struct gvf_path_seg *seg = gvf_path_new_seg(path, GVF_PATH_LINE, sqrtf(zx * zx + zy * zy));
+  if (seg == NULL) {
+    return false;
+  }
+  seg->s = 1;
+  seg->x = x1;
+  seg->y = y1;
+  seg->sina = zx / seg->len;
+  seg->cosa = zy / seg->len;
+  seg->alpha = pprz_atan2f(zx, zy);
+  path->x_end = x2;
+  path->y_end = y2;
+  return true;
+}
+
+bool gvf_path_add_arc(struct gvf_path *path, float cx, float cy, float r, float a0, float da)
+{
+  BoundAbs(da, 2.f * M_PI);
+  struct gvf_path_seg *seg = gvf_path_new_seg(path, GVF_PATH_ARC, r * fabsf(da));
+  if (seg == NULL) {
+    return false;
+  }
+  // the tangent of the ELLIPSE trajectory is clockwise for s = 1
+  seg->s = da > 0.f ? -1 : 1;
+  seg->x = cx;
+  seg->y = cy;
+  seg->r = r;
+  seg->a0 = a0;
+  seg->da = da;
+  float s, c;
+  pprz_sincosf(a0 + da, &s, &c);
+  path->x_end = cx + r * c;
+  path->y_end = cy + r * s;
+  return true;
+}
+
+bool gvf_path_add_point(struct gvf_path *path, float x, float y)
+{
+  return gvf_path_add_line(path, path->x_end, path->y_end, x, y);
+}
+
+bool gvf_path_add_turn(struct gvf_path *path, float x, float y, bool ccw)
+{
+  const float cx = 0.5f * (path->x_end + x);
+  const float cy = 0.5f * (path->y_end + y);
+  const float dx = path->x_end - cx;
+  const float dy = path->y_end - cy;
+  return gvf_path_add_arc(path, cx, cy, sqrtf(dx * dx + dy * dy), pprz_atan2f(dy, dx), ccw ? M_PI : -M_PI);
+}
+
+uint8_t gvf_path_find(const struct gvf_path *path, float s)
+{
+  if (path->nb == 0) {
+    return 0;
+  }
+  // last segment starting before s
+  uint8_t lo = 0, hi = path->nb - 1;
+  while (lo < hi) {
+    uint8_t mid = (lo + hi + 1) / 2;
+    if (path->seg[mid].start <= s) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+void gvf_path_point(const struct gvf_path *path, float s, float *x, float *y)
+{
+  if (path->nb == 0) {
+    *x = path->x_end;
+    *y = path->y_end;
+    return;
+  }
+  const struct gvf_path_seg *seg = &path->seg[gvf_path_find(path, s)];
+  float l = s - seg->start;
+  Bound(l, 0.f, seg->len);
+  if (seg->type == GVF_PATH_LINE) {
+    *x = seg->x + l * seg->sina;
+    *y = seg->y + l * seg->cosa;
+  } else {
+    float sa, ca;
+    pprz_sincosf(seg->a0 + (seg->da > 0.f ? l : -l) / seg->r, &sa, &ca);
+    *x = seg->x + seg->r * ca;
+    *y = seg->y + seg->r * sa;
+  }
+}
+
+float gvf_path_seg_progress(const struct gvf_path_seg *seg, float px, float py)
+{
+  if (seg->type == GVF_PATH_LINE) {
+    return (px - seg->x) * seg->sina + (py - seg->y) * seg->cosa;
+  }
+  // angle from the start point in the direction of the arc, in
+  // [m - 2pi, m[ with m in the middle of the part not covered by the arc
+  const float theta = pprz_atan2f(py - seg->y, px - seg->x);
+  float d = seg->da > 0.f ? theta - seg->a0 : seg->a0 - theta;
+  const float m = M_PI + 0.5f * fabsf(seg->da);
+  while (d >= m) {
+    d -= 2.f * M_PI;
+  }
+  while (d < m - 2.f * M_PI) {
+    d += 2.f * M_PI;
+  }
+  return seg->r * d;
+}
+
+void gvf_path_seg_traj(const struct gvf_path_seg *seg, gvf_tra *t)
+{
+  if (seg->type == GVF_PATH_LINE) {
+    t->type = LINE;
+    t->p[0] = seg->x;
+    t->p[1] = seg->y;
+    t->p[2] = seg->alpha;
+    t->cosa = seg->cosa;
+    t->sina = seg->sina;
+  } else {
+    // circle, same cached terms as gvf_traj_precompute with a = b = r and alpha = 0
+    const float k = 2.f / (seg->r * seg->r);
+    t->type = ELLIPSE;
+    t->p[0] = seg->x;
+    t->p[1] = seg->y;
+    t->p[2] = seg->r;
+    t->p[3] = seg->r;
+    t->p[4] = 0.f;
+    t->cosa = 1.f;
+    t->sina = 0.f;
+    t->k[0] = k;
+    t->k[1] = k;
+    t->k[2] = k;
+    t->k[3] = 0.f;
+    t->k[4] = k;
+  }
+}
+
+/* next active segment for a position, starting from the current one */
+static bool gvf_path_advance(const struct gvf_path *path, uint8_t *active, float px, float py)
+{
+  while (gvf_path_seg_progress(&path->seg[*active], px, py) >= path->seg[*active].len) {
+    if (*active + 1 >= path->nb) {
+      return false;
+    }
+    (*active)++;
+  }
+  return true;
+}
+
+bool gvf_path_update(struct gvf_path *path, float px, float py)
+{
+  if (path->nb == 0) {
+    return false;
+  }
+  return gvf_path_advance(path, &path->active, px, py);
+}
+
+void gvf_path_field(const struct gvf_path *path, float ke_line, float ke_arc, uint16_t n,
+                    const float *px, const float *py, float *mx, float *my, uint8_t *idx)
+{
+  if (path->nb == 0) {
+    return;
+  }
+  uint8_t active = path->active;
+  uint8_t traj_seg = active;
+  gvf_tra t;
+  gvf_path_seg_traj(&path->seg[active], &t);
+  for (uint16_t i = 0; i < n; i++) {
+    gvf_path_advance(path, &active, px[i], py[i]);
+    const struct gvf_path_seg *seg = &path->seg[active];
+    if (active != traj_seg) {
+      gvf_path_seg_traj(seg, &t);
+      traj_seg = active;
+    }
+    float e;
+    struct gvf_grad grad;
+    gvf_traj_eval(&t, px[i], py[i], &e, &grad, NULL);
+    gvf_field_dir(seg->type == GVF_PATH_LINE ? ke_line : ke_arc, seg->s, e, &grad, &mx[i], &my[i]);
+    if (idx) {
+      idx[i] = active;
+    }
+  }
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file gvf_path.h
+ *
+ *  Guidance algorithm based on vector fields
+ *  Composite paths made of a table of straight and circular segments
+ *
+ *  A path (polyline, survey sweeps with their turns, curves approximated by
+ *  lines and arcs, ...) is built once as a table of segments, with the
+ *  geometry and the cached trajectory terms of each segment. While
+ *  following it, the vehicle tracks the LINE or ELLIPSE trajectory of the
+ *  active segment, which is advanced when the vehicle passes its end.
+ *  The segment at a given arc length is found by binary search.
+ */
+
+#ifndef GVF_PATH_H
+#define GVF_PATH_H
+
+#include "modules/guidance/gvf/gvf.h"
+
+/** Max number of segments of a path */
+#ifndef GVF_PATH_MAX_SEG
+#define GVF_PATH_MAX_SEG 32
+#endif
+
+enum gvf_path_seg_type {
+  GVF_PATH_LINE,
+  GVF_PATH_ARC
+};
+
+/** @brief Segment of a path
+* @param type Straight line or arc of circle
+* @param s Direction of the field along the segment
+* @param x, y Start point of a line, center of an arc
+* @param cosa, sina Direction of a line is (sina, cosa), heading alpha from North
+* @param alpha Heading of a line
+* @param r Radius of an arc
+* @param a0 Angle of the start point of an arc, from East
+* @param da Signed angle swept by an arc, positive counter-clockwise
+* @param len Length of the segment
+* @param start Arc length of the path at the start of the segment
+*/
+struct gvf_path_seg {
+  enum gvf_path_seg_type type;
+  int8_t s;
+  float x;
+  float y;
+  float cosa;
+  float sina;
+  float alpha;
+  float r;
+  float a0;
+  float da;
+  float len;
+  float start;
+};
+
+struct gvf_path {
+  struct gvf_path_seg seg[GVF_PATH_MAX_SEG];
+  uint8_t nb;         ///< number of segments
+  uint8_t active;     ///< segment being followed
+  float x_end;        ///< end point of the last segment
+  float y_end;
+  float length;       ///< total length
+};
+
+/** Clear a path */
+extern void gvf_path_init(struct gvf_path *path);
+
+/** Start a path at a point, to add segments with gvf_path_add_point and gvf_path_add_turn */
+extern void gvf_path_start(struct gvf_path *path, float x, float y);
+
+/** Add a straight segment
+ * @return false if the table is full or the segment degenerated
+ */
+extern bool gvf_path_add_line(struct gvf_path *path, float x1, float y1, float x2, float y2);
+
+/** Add an arc of circle
+ * @param cx, cy center
+ * @param r radius
+ * @param a0 angle of the start point, from East (rad)
+ * @param da swept angle, positive counter-clockwise (rad)
+ * @return false if the table is full or the arc degenerated
+ */
+extern bool gvf_path_add_arc(struct gvf_path *path, float cx, float cy, float r, float a0, float da);
+
+/** Add a straight segment from the end of the path to a point */
+extern bool gvf_path_add_point(struct gvf_path *path, float x, float y);
+
+/** Add a half turn from the end of the path to a point, e.g. between two survey sweeps
+ * @param ccw turn counter-clockwise
+ */
+extern bool gvf_path_add_turn(struct gvf_path *path, float x, float y, bool ccw);
+
+/** Find the segment at an arc length (binary search)
+ * @return index of the segment, clamped to the path
+ */
+extern uint8_t gvf_path_find(const struct gvf_path *path, float s);
+
+/** Point of the path at an arc length */
+extern void gvf_path_point(const struct gvf_path *path, float s, float *x, float *y);
+
+/** Arc length of a position projected on a segment, from the start of the segment */
+extern float gvf_path_seg_progress(const struct gvf_path_seg *seg, float px, float py);
+
+/** Set the trajectory and direction of a segment, from its cached terms
+ * @param seg segment
+ * @param t trajectory (LINE or ELLIPSE)
+ */
+extern void gvf_path_seg_traj(const struct gvf_path_seg *seg, gvf_tra *t);
+
+/** Advance the active segment while the position is beyond its end
+ * @param path path
+ * @param px, py position w.r.t. HOME
+ * @return false when the end of the path is reached
+ */
+extern bool gvf_path_update(struct gvf_path *path, float px, float py);
+
+/**
+ * Evaluate the guiding vector field along a sequence of positions (e.g. a
+ * predicted track), the active segment being advanced from one position to
+ * the next as with gvf_path_update, without changing the path
+ * @param path path
+ * @param ke_line, ke_arc gains of the vector field, as given to gvf_control_2D
+ * @param n number of positions
+ * @param px, py positions w.r.t. HOME
+ * @param mx, my unit directions of the field
+ * @param idx segment of each position, can be NULL
+ */
+extern void gvf_path_field(const struct gvf_path *path, float ke_line, float ke_arc, uint16_t n,
+                           const float *px, const float *py, float *mx, float *my, uint8_t *idx);
+
+#endif // GVF_PATH_H
@@ -29,6 +29,7 @@
 
 #include "subsystems/navigation/common_nav.h"
 #include "gvf_sin.h"
+#include "gvf_traj.h"
 #include "generated/airframe.h"
 
 /*! Default gain ke for the sin trajectory*/
@@ -69,38 +70,6 @@ gvf_s_par gvf_sin_par = {GVF_SIN_KE, GVF_SIN_KN,
 void gvf_sin_info(float *phi, struct gvf_grad *grad,
                   struct gvf_Hess *hess)
 {
-
   struct EnuCoor_f *p = stateGetPositionEnu_f();
-  float px = p->x;
-  float py = p->y;
-  float a = gvf_trajectory.p[0];
-  float b = gvf_trajectory.p[1];
-  float alpha = gvf_trajectory.p[2];
-  float w = gvf_trajectory.p[3];
-  float off = gvf_trajectory.p[4];
-  float A = gvf_trajectory.p[5];
-
-  float cosa = cosf(alpha);
-  float sina = sinf(alpha);
-
-  // Phi(x,y)
-  float xs = (px - a) * sina - (py - b) * cosa;
-  float ys =  -(px - a) * cosa - (py - b) * sina;
-
-  // TODO Make it always in (-pi, pi] in an efficient way
-  float ang = (w * xs + off);
-  float cosang = cosf(ang);
-  float sinang = sinf(ang);
-
-  *phi = ys - A * sinang;
-
-  // grad Phi
-  grad->nx =  -cosa - A * w * sina * cosang;
-  grad->ny =  -sina + A * w * cosa * cosang;
-
-  // Hessian Phi
-  hess->H11 =  A * w * w * sina * sina * sinang;
-  hess->H12 = -A * w * w * sina * cosa * sinang;
-  hess->H21 = -A * w * w * cosa * sina * sinang;
-  hess->H22 =  A * w * w * cosa * cosa * sinang;
+  gvf_traj_eval(&gvf_trajectory, p->x, p->y, phi, grad, hess);
 }
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file gvf_traj.c
+ *
+ *  Guidance algorithm based on vector fields
+ *  Evaluation of the trajectories with cached parameter terms
+ */
+
+#include <string.h>
+#include "modules/guidance/gvf/trajectories/gvf_traj.h"
+#include "math/pprz_trig_float.h"
+
+static uint8_t gvf_traj_nb_param(enum trajectories type)
+{
+  switch (type) {
+    case LINE:
+      return GVF_LINE_NB_PARAM;
+    case ELLIPSE:
+      return GVF_ELLIPSE_NB_PARAM;
+    case SIN:
+      return GVF_SIN_NB_PARAM;
+    default:
+      return 0;
+  }
+}
+
+bool gvf_traj_set(gvf_tra *t, enum trajectories type, const float *p)
+{
+  uint8_t n = gvf_traj_nb_param(type);
+  if (t->type == type && memcmp(t->p, p, n * sizeof(float)) == 0) {
+    return false;
+  }
+  t->type = type;
+  memcpy(t->p, p, n * sizeof(float));
+  gvf_traj_precompute(t);
+  return true;
+}
+
+void gvf_traj_precompute(gvf_tra *t)
+{
+  switch (t->type) {
+    case LINE:
+      // p = {a, b, alpha}
+      pprz_sincosf(t->p[2], &t->sina, &t->cosa);
+      break;
+    case ELLIPSE: {
+      // p = {x, y, a, b, alpha}
+      pprz_sincosf(t->p[4], &t->sina, &t->cosa);
+      const float ia2 = 1.f / (t->p[2] * t->p[2]);
+      const float ib2 = 1.f / (t->p[3] * t->p[3]);
+      // gradient factors and constant Hessian
+      t->k[0] = 2.f * ia2;
+      t->k[1] = 2.f * ib2;
+      t->k[2] = 2.f * (t->cosa * t->cosa * ia2 + t->sina * t->sina * ib2);
+      t->k[3] = 2.f * t->sina * t->cosa * (ib2 - ia2);
+      t->k[4] = 2.f * (t->sina * t->sina * ia2 + t->cosa * t->cosa * ib2);
+      break;
+    }
+    case SIN: {
+      // p = {a, b, alpha, w, off, A}
+      pprz_sincosf(t->p[2], &t->sina, &t->cosa);
+      const float Aw = t->p[5] * t->p[3];
+      const float Aw2 = Aw * t->p[3];
+      // gradient factor and Hessian factors of sin(w * xs + off)
+      t->k[0] = Aw;
+      t->k[1] = Aw2 * t->sina * t->sina;
+      t->k[2] = -Aw2 * t->sina * t->cosa;
+      t->k[3] = Aw2 * t->cosa * t->cosa;
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static inline void gvf_line_eval(const gvf_tra *t, float px, float py, float *phi,
+                                 struct gvf_grad *grad, struct gvf_Hess *hess)
+{
+  // Phi(x,y)
+  *phi = -(px - t->p[0]) * t->cosa + (py - t->p[1]) * t->sina;
+
+  // grad Phi
+  grad->nx = -t->cosa;
+  grad->ny = t->sina;
+
+  // Hessian Phi
+  if (hess) {
+    hess->H11 = 0;
+    hess->H12 = 0;
+    hess->H21 = 0;
+    hess->H22 = 0;
+  }
+}
+
+static inline void gvf_ellipse_eval(const gvf_tra *t, float px, float py, float *phi,
+                                    struct gvf_grad *grad, struct gvf_Hess *hess)
+{
+  const float dx = px - t->p[0];
+  const float dy = py - t->p[1];
+
+  // Phi(x,y)
+  const float xel = dx * t->cosa - dy * t->sina;
+  const float yel = dx * t->sina + dy * t->cosa;
+  *phi = 0.5f * (xel * xel * t->k[0] + yel * yel * t->k[1]) - 1.f;
+
+  // grad Phi
+  const float gx = xel * t->k[0];
+  const float gy = yel * t->k[1];
+  grad->nx = gx * t->cosa + gy * t->sina;
+  grad->ny = gy * t->cosa - gx * t->sina;
+
+  // Hessian Phi
+  if (hess) {
+    hess->H11 = t->k[2];
+    hess->H12 = t->k[3];
+    hess->H21 = t->k[3];
+    hess->H22 = t->k[4];
+  }
+}
+
+static inline void gvf_sin_eval(const gvf_tra *t, float px, float py, float *phi,
+                                struct gvf_grad *grad, struct gvf_Hess *hess)
+{
+  const float dx = px - t->p[0];
+  const float dy = py - t->p[1];
+
+  // Phi(x,y)
+  const float xs = dx * t->sina - dy * t->cosa;
+  const float ys = -dx * t->cosa - dy * t->sina;
+
+  float sinang, cosang;
+  pprz_sincosf(t->p[3] * xs + t->p[4], &sinang, &cosang);
+
+  *phi = ys - t->p[5] * sinang;
+
+  // grad Phi
+  grad->nx = -t->cosa - t->k[0] * t->sina * cosang;
+  grad->ny = -t->sina + t->k[0] * t->cosa * cosang;
+
+  // Hessian Phi
+  if (hess) {
+    hess->H11 = t->k[1] * sinang;
+    hess->H12 = t->k[2] * sinang;
+    hess->H21 = hess->H12;
+    hess->H22 = t->k[3] * sinang;
+  }
+}
+
+void gvf_traj_eval(const gvf_tra *t, float px, float py, float *phi,
+                   struct gvf_grad *grad, struct gvf_Hess *hess)
+{
+  switch (t->type) {
+    case LINE:
+      gvf_line_eval(t, px, py, phi, grad, hess);
+      break;
+    case ELLIPSE:
+      gvf_ellipse_eval(t, px, py, phi, grad, hess);
+      break;
+    case SIN:
+      gvf_sin_eval(t, px, py, phi, grad, hess);
+      break;
+    default:
+      *phi = 0.f;
+      grad->nx = 0.f;
+      grad->ny = 0.f;
+      break;
+  }
+}
+
+/* one loop per trajectory type, so that the evaluation is inlined */
+#define GVF_TRAJ_FIELD_LOOP(_eval) {                              \
+    for (uint16_t i = 0; i < n; i++) {                            \
+      float e;                                                    \
+      struct gvf_grad grad;                                       \
+      _eval(t, px[i], py[i], &e, &grad, NULL);                    \
+      gvf_field_dir(ke, s, e, &grad, &mx[i], &my[i]);             \
+      if (phi) { phi[i] = e; }                                    \
+    }                                                             \
+  }
+
+void gvf_traj_field(const gvf_tra *t, float ke, int8_t s, uint16_t n,
+                    const float *px, const float *py, float *mx, float *my, float *phi)
+{
+  switch (t->type) {
+    case LINE:
+      GVF_TRAJ_FIELD_LOOP(gvf_line_eval);
+      break;
+    case ELLIPSE:
+      GVF_TRAJ_FIELD_LOOP(gvf_ellipse_eval);
+      break;
+    case SIN:
+      GVF_TRAJ_FIELD_LOOP(gvf_sin_eval);
+      break;
+    default:
+      GVF_TRAJ_FIELD_LOOP(gvf_traj_eval);
+      break;
+  }
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/** @file gvf_traj.h
+ *
+ *  Guidance algorithm based on vector fields
+ *  Evaluation of the trajectories with cached parameter terms
+ *
+ *  The terms of a trajectory that only depend on its parameters (rotation,
+ *  inverse axes, constant Hessian, ...) are computed by gvf_traj_set when the
+ *  parameters change, and not at each evaluation. Since the navigation
+ *  functions set their trajectory at each call, gvf_traj_set does nothing
+ *  when the parameters are the same.
+ *
+ *  The evaluations take the position as argument and don't depend on the
+ *  state, so that a planner can sample the field at any point, e.g. with
+ *  gvf_traj_field.
+ */
+
+#ifndef GVF_TRAJ_H
+#define GVF_TRAJ_H
+
+#include "modules/guidance/gvf/gvf.h"
+#include <math.h>
+
+/** Number of parameters of each trajectory type */
+#define GVF_LINE_NB_PARAM 3
+#define GVF_ELLIPSE_NB_PARAM 5
+#define GVF_SIN_NB_PARAM 6
+
+/**
+ * Set a trajectory and update its cached terms if the parameters changed
+ * @param t trajectory
+ * @param type type of trajectory
+ * @param p parameters, see gvf_line_info, gvf_ellipse_info and gvf_sin_info
+ * @return true if the trajectory changed
+ */
+extern bool gvf_traj_set(gvf_tra *t, enum trajectories type, const float *p);
+
+/**
+ * Compute the cached terms of a trajectory from its parameters
+ * @param t trajectory with its type and parameters set
+ */
+extern void gvf_traj_precompute(gvf_tra *t);
+
+/**
+ * Evaluate the trajectory at a position
+ * @param t trajectory
+ * @param px, py position w.r.t. HOME
+ * @param phi error signal
+ * @param grad gradient of phi
+ * @param hess Hessian of phi
+ */
+extern void gvf_traj_eval(const gvf_tra *t, float px, float py, float *phi,
+                          struct gvf_grad *grad, struct gvf_Hess *hess);
+
+/**
+ * Unit direction of the guiding vector field
+ * @param ke gain of the vector field, as given to gvf_control_2D
+ * @param s direction to be tracked
+ * @param phi error signal
+ * @param grad gradient of phi
+ * @param mx, my unit direction of the field
+ */
+static inline void gvf_field_dir(float ke, int8_t s, float phi, const struct gvf_grad *grad, float *mx, float *my)
+{
+  const float dx = s * grad->ny - ke * phi * grad->nx;
+  const float dy = -s * grad->nx - ke * phi * grad->ny;
+  const float n = sqrtf(dx * dx + dy * dy);
+  if (n > 0.f) {
+    *mx = dx / n;
+    *my = dy / n;
+  } else {
+    *mx = 0.f;
+    *my = 0.f;
+  }
+}
+
+/**
+ * Evaluate the guiding vector field of a trajectory at several positions
+ * @param t trajectory
+ * @param ke gain of the vector field, as given to gvf_control_2D
+ * @param s direction to be tracked
+ * @param n number of positions
+ * @param px, py positions w.r.t. HOME
+ * @param mx, my unit directions of the field
+ * @param phi error signals, can be NULL
+ */
+extern void gvf_traj_field(const gvf_tra *t, float ke, int8_t s, uint16_t n,
+                           const float *px, const float *py, float *mx, float *my, float *phi);
+
+#endif // GVF_TRAJ_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @file modules/loggers/sdlog_chibios/msg_pool.c
+ * @brief fixed size slab pools for the log messages
+ *
+ */
+#include "modules/loggers/sdlog_chibios/msg_pool.h"
+
+/** index of the end of a free list */
+#define MSG_POOL_NIL 0xFFFF
+
+#define ALIGN_UP(x) (((x) + MSG_POOL_ALIGN - 1) & ~((size_t) MSG_POOL_ALIGN - 1))
+
+/* a free slot holds the index of the next free slot in its first bytes */
+static inline uint16_t slotNext(const struct MsgPoolClass *c, const uint16_t idx)
+{
+  return *(volatile const uint16_t *)(c->base + (size_t) idx * c->size);
+}
+
+static inline void slotSetNext(struct MsgPoolClass *c, const uint16_t idx, const uint16_t next)
+{
+  *(volatile uint16_t *)(c->base + (size_t) idx * c->size) = next;
+}
+
+size_t msg_pool_mem_size(const uint16_t *sizes, const uint16_t *nbs, const uint8_t nbClass)
+{
+  size_t total = 0;
+  for (uint8_t i = 0; i < nbClass; i++) {
+    total += ALIGN_UP(sizes[i]) * nbs[i];
+  }
+  return total;
+}
+
+bool msg_pool_init(struct MsgPool *pool, void *mem, const size_t memSize,
+                   const uint16_t *sizes, const uint16_t *nbs, const uint8_t nbClass)
+{
+  pool->nbClass = 0;
+  pool->start = pool->end = mem;
+  atomic_init(&pool->oversize, 0);
+
+  if (mem == NULL || nbClass > MSG_POOL_MAX_CLASSES ||
+      msg_pool_mem_size(sizes, nbs, nbClass) > memSize) {
+    return false;
+  }
+  for (uint8_t i = 0; i < nbClass; i++) {
+    if (sizes[i] < sizeof(uint16_t) || nbs[i] >= MSG_POOL_NIL ||
+        ALIGN_UP(sizes[i]) > UINT16_MAX || (i > 0 && sizes[i] <= sizes[i - 1])) {
+      return false;
+    }
+  }
+
+  uint8_t *p = mem;
+  for (uint8_t i = 0; i < nbClass; i++) {
+    struct MsgPoolClass *c = &pool->cls[i];
+    c->base = p;
+    c->size = (uint16_t) ALIGN_UP(sizes[i]);
+    c->nb = nbs[i];
+    for (uint16_t j = 0; j < c->nb; j++) {
+      slotSetNext(c, j, (j + 1 < c->nb) ? (uint16_t)(j + 1) : MSG_POOL_NIL);
+    }
+    atomic_init(&c->head, c->nb > 0 ? 0 : MSG_POOL_NIL);
+    atomic_init(&c->used, 0);
+    atomic_init(&c->highWater, 0);
+    atomic_init(&c->failed, 0);
+    p += (size_t) c->size * c->nb;
+  }
+  pool->end = p;
+  pool->nbClass = nbClass;
+  return true;
+}
+
+static void *classPop(struct MsgPoolClass *c)
+{
+  uint_least32_t head = atomic_load_explicit(&c->head, memory_order_acquire);
+  uint_least32_t newHead;
+  uint16_t idx;
+  do {
+    idx = (uint16_t)(head & 0xFFFF);
+    if (idx == MSG_POOL_NIL) {
+      return NULL;
+    }
+    // the slot may be taken and written by another thread meanwhile,
+    // the tag change then makes the exchange fail
+    newHead = ((head + 0x10000) & 0xFFFF0000) | slotNext(c, idx);
+  } while (!atomic_compare_exchange_weak_explicit(&c->head, &head, newHead,
+           memory_order_acq_rel, memory_order_acquire));
+
+  const uint_least16_t used = (uint_least16_t)(atomic_fetch_add_explicit(&c->used, 1, memory_order_relaxed) + 1);
+  uint_least16_t hw = atomic_load_explicit(&c->highWater, memory_order_relaxed);
+  while (used > hw &&
+         !atomic_compare_exchange_weak_explicit(&c->highWater, &hw, used,
+             memory_order_relaxed, memory_order_relaxed));
+  return c->base + (size_t) idx * c->size;
+}
+
+void *msg_pool_alloc(struct MsgPool *pool, const size_t len)
+{
+  uint8_t first = 0;
+  while (first < pool->nbClass && pool->cls[first].size < len) {
+    first++;
+  }
+  if (first == pool->nbClass) {
+    atomic_fetch_add_explicit(&pool->oversize, 1, memory_order_relaxed);
+    return NULL;
+  }
+  for (uint8_t i = first; i < pool->nbClass; i++) {
+    void *slot = classPop(&pool->cls[i]);
+    if (slot != NULL) {
+      return slot;
+    }
+  }
+  atomic_fetch_add_explicit(&pool->cls[first].failed, 1, memory_order_relaxed);
+  return NULL;
+}
+
+bool msg_pool_free(struct MsgPool *pool, void *ptr)
+{
+  if (!msg_pool_owns(pool, ptr)) {
+    return false;
+  }
+  uint8_t i = 0;
+  while ((uint8_t *) ptr >= pool->cls[i].base + (size_t) pool->cls[i].size * pool->cls[i].nb) {
+    i++;
+  }
+  struct MsgPoolClass *c = &pool->cls[i];
+  const uint16_t idx = (uint16_t)(((uint8_t *) ptr - c->base) / c->size);
+
+  atomic_fetch_sub_explicit(&c->used, 1, memory_order_relaxed);
+  uint_least32_t head = atomic_load_explicit(&c->head, memory_order_relaxed);
+  uint_least32_t newHead;
+  do {
+    slotSetNext(c, idx, (uint16_t)(head & 0xFFFF));
+    newHead = ((head + 0x10000) & 0xFFFF0000) | idx;
+  } while (!atomic_compare_exchange_weak_explicit(&c->head, &head, newHead,
+           memory_order_release, memory_order_relaxed));
+  return true;
+}
+
+bool msg_pool_get_stats(struct MsgPool *pool, const uint8_t cls, struct MsgPoolStats *stats)
+{
+  if (cls >= pool->nbClass) {
+    return false;
+  }
+  struct MsgPoolClass *c = &pool->cls[cls];
+  stats->size = c->size;
+  stats->nb = c->nb;
+  stats->used = (uint16_t) atomic_load_explicit(&c->used, memory_order_relaxed);
+  stats->highWater = (uint16_t) atomic_load_explicit(&c->highWater, memory_order_relaxed);
+  stats->failed = (uint32_t) atomic_load_explicit(&c->failed, memory_order_relaxed);
+  return true;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @file modules/loggers/sdlog_chibios/msg_pool.h
+ * @brief fixed size slab pools for the log messages
+ *
+ * Messages are allocated in slots of a few size classes, each class being a
+ * lock-free free list (LIFO) of slots. Allocation and release take a constant
+ * time whatever the state of the pools, cannot fragment the memory and can be
+ * done concurrently by several threads (compare and swap on the list head,
+ * with a tag against the ABA problem).
+ * A request is served by the smallest class that fits, or by the next
+ * classes if it is empty. NULL is returned for oversize requests or when all
+ * fitting classes are empty, the caller then falls back to a general purpose
+ * allocator.
+ *
+ * Memory is given by the caller, the code has no ChibiOS dependency so that it
+ * can be tested on host.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** max number of size classes */
+#define MSG_POOL_MAX_CLASSES 8
+
+/** slot alignment */
+#define MSG_POOL_ALIGN 8
+
+/** one size class */
+struct MsgPoolClass {
+  uint8_t *base;              ///< first slot
+  uint16_t size;              ///< slot size, multiple of MSG_POOL_ALIGN
+  uint16_t nb;                ///< number of slots
+  atomic_uint_least32_t head; ///< (tag << 16) | index of the first free slot
+  atomic_uint_least16_t used; ///< number of allocated slots
+  atomic_uint_least16_t highWater; ///< max number of allocated slots
+  atomic_uint_least32_t failed;    ///< requests of this class not served by the pools
+};
+
+struct MsgPool {
+  struct MsgPoolClass cls[MSG_POOL_MAX_CLASSES];
+  uint8_t nbClass;
+  uint8_t *start;             ///< memory of the pools
+  uint8_t *end;
+  atomic_uint_least32_t oversize; ///< requests larger than the largest class
+};
+
+/** statistics of a class */
+struct MsgPoolStats {
+  uint16_t size;
+  uint16_t nb;
+  uint16_t used;
+  uint16_t highWater;
+  uint32_t failed;
+};
+
+/**
+ * @brief memory needed by the pools
+ * @param[in] sizes : slot size of each class, increasing
+ * @param[in] nbs : number of slots of each class
+ * @param[in] nbClass : number of classes
+ * @return  size in bytes
+ */
+size_t msg_pool_mem_size(const uint16_t *sizes, const uint16_t *nbs, const uint8_t nbClass);
+
+/**
+ * @brief initialise the pools
+ * @param[out] pool : pools
+ * @param[in] mem : memory of the pools, aligned on MSG_POOL_ALIGN
+ * @param[in] memSize : size of mem, at least msg_pool_mem_size
+ * @param[in] sizes : slot size of each class, increasing
+ * @param[in] nbs : number of slots of each class (< 65535)
+ * @param[in] nbClass : number of classes (<= MSG_POOL_MAX_CLASSES)
+ * @return  true if the pools are initialised, false if the parameters are invalid
+ *          (the pools are then empty and all requests are refused)
+ */
+bool msg_pool_init(struct MsgPool *pool, void *mem, const size_t memSize,
+                   const uint16_t *sizes, const uint16_t *nbs, const uint8_t nbClass);
+
+/**
+ * @brief allocate a slot
+ * @param[in] pool : pools
+ * @param[in] len : requested length
+ * @return  slot, NULL if no slot is available for this length
+ */
+void *msg_pool_alloc(struct MsgPool *pool, const size_t len);
+
+/**
+ * @brief test if a buffer belongs to the pools
+ */
+static inline bool msg_pool_owns(const struct MsgPool *pool, const void *ptr)
+{
+  return (const uint8_t *) ptr >= pool->start && (const uint8_t *) ptr < pool->end;
+}
+
+/**
+ * @brief release a slot
+ * @param[in] pool : pools
+ * @param[in] ptr : slot given by msg_pool_alloc
+ * @return  false if ptr does not belong to the pools (nothing is done)
+ */
+bool msg_pool_free(struct MsgPool *pool, void *ptr);
+
+/**
+ * @brief get the statistics of a class
+ * @param[in] pool : pools
+ * @param[in] cls : class index
+ * @param[out] stats : statistics
+ * @return  false if cls is not a valid class
+ */
+bool msg_pool_get_stats(struct MsgPool *pool, const uint8_t cls, struct MsgPoolStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
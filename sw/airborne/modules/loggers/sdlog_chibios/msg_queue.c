@@ -45,6 +45,44 @@ void    msgqueue_init(MsgQueue *que, tlsf_memory_heap_t *heap,
   chMBObjectInit(&que->mb, mb_buf, mb_size);
   memset(mb_buf, 0, mb_size * sizeof(msg_t));
   que->heap = heap;
+
+  // pools are taken from the heap so that messages are addressed the same way
+  void *mem = NULL;
+  size_t memSize = 0;
+#if MSGQ_USE_POOL
+  static const uint16_t sizes[] = MSGQ_POOL_SIZES;
+  static const uint16_t nbs[] = MSGQ_POOL_NB;
+  _Static_assert(sizeof(sizes) == sizeof(nbs), "MSGQ_POOL_SIZES and MSGQ_POOL_NB should have the same length");
+  memSize = msg_pool_mem_size(sizes, nbs, sizeof(sizes) / sizeof(sizes[0]));
+  mem = tlsf_memalign_r(heap, MSG_POOL_ALIGN, memSize);
+  if (!msg_pool_init(&que->pool, mem, memSize, sizes, nbs, sizeof(sizes) / sizeof(sizes[0]))) {
+    tlsf_free_r(heap, mem);
+    msg_pool_init(&que->pool, NULL, 0, NULL, NULL, 0);
+  }
+#else
+  msg_pool_init(&que->pool, mem, memSize, NULL, NULL, 0);
+#endif
+}
+
+void *msgqueue_malloc_before_send(MsgQueue *que, const uint16_t msgLen)
+{
+  void *msg = msg_pool_alloc(&que->pool, msgLen);
+  if (msg == NULL) {
+    msg = tlsf_malloc_r(que->heap, msgLen);
+  }
+  return msg;
+}
+
+void msgqueue_free_after_pop(MsgQueue *que, void *msg)
+{
+  if (!msg_pool_free(&que->pool, msg)) {
+    tlsf_free_r(que->heap, msg);
+  }
+}
+
+bool msgqueue_get_pool_stats(MsgQueue *que, const uint8_t cls, struct MsgPoolStats *stats)
+{
+  return msg_pool_get_stats(&que->pool, cls, stats);
 }
 
 bool    msgqueue_is_full(MsgQueue *que)
@@ -106,7 +144,7 @@ int32_t   msgqueue_send_timeout(MsgQueue *que, void *msg, const uint16_t msgLen,
 
 fail:
 
-  tlsf_free_r(que->heap, msg);
+  msgqueue_free_after_pop(que, msg);
 
   return  MsgQueue_MAILBOX_FULL;
 }
@@ -114,7 +152,7 @@ fail:
 int32_t   msgqueue_copy_send_timeout(MsgQueue *que, const void *msg, const uint16_t msgLen,
                                      const MsgQueueUrgency urgency, const systime_t timout)
 {
-  void *dst = tlsf_malloc_r(&MSGQ_HEAP, msgLen);
+  void *dst = msgqueue_malloc_before_send(que, msgLen);
 
   if (dst == NULL) {
     return MsgQueue_MAILBOX_FULL;
@@ -28,6 +28,7 @@
 #include <ch.h>
 #include <hal.h>
 #include "modules/tlsf/tlsf_malloc.h"
+#include "modules/loggers/sdlog_chibios/msg_pool.h"
 
 
 #ifdef __cplusplus
@@ -46,6 +47,25 @@ typedef enum {
 
 typedef enum { MsgQueue_REGULAR, MsgQueue_OUT_OF_BAND } MsgQueueUrgency;
 
+/*
+  Messages are allocated in the slab pools of the queue (see msg_pool.h),
+  the heap is only used for messages larger than the largest class or when the
+  pools are exhausted. The pools memory is taken from the heap at init.
+ */
+#ifndef MSGQ_USE_POOL
+#define MSGQ_USE_POOL TRUE
+#endif
+
+/** slot size of each class */
+#ifndef MSGQ_POOL_SIZES
+#define MSGQ_POOL_SIZES {16, 32, 64, 128}
+#endif
+
+/** number of slots of each class */
+#ifndef MSGQ_POOL_NB
+#define MSGQ_POOL_NB {16, 32, 32, 16}
+#endif
+
 typedef struct  MsgQueue MsgQueue;
 
 
@@ -76,6 +96,31 @@ bool msgqueue_is_full(MsgQueue *que);
 bool msgqueue_is_empty(MsgQueue *que);
 
 
+/**
+ * @brief allocate a buffer to be sent
+ * @details the buffer is taken from the pools, or from the heap if it does not fit
+ * @param[in]   que:  pointer to opaque MsgQueue object
+ * @param[in]   msgLen: length of buffer
+ * @return  buffer, NULL if no memory is available
+ */
+void *msgqueue_malloc_before_send(MsgQueue *que, const uint16_t msgLen);
+
+/**
+ * @brief free a buffer given by msgqueue_pop or msgqueue_malloc_before_send
+ * @param[in]   que:  pointer to opaque MsgQueue object
+ * @param[in]   msg:  buffer
+ */
+void msgqueue_free_after_pop(MsgQueue *que, void *msg);
+
+/**
+ * @brief get statistics of a pool class
+ * @param[in]   que:  pointer to opaque MsgQueue object
+ * @param[in]   cls:  class index
+ * @param[out]  stats: statistics
+ * @return  false if cls is not a valid class
+ */
+bool msgqueue_get_pool_stats(MsgQueue *que, const uint8_t cls, struct MsgPoolStats *stats);
+
 /**
  * @brief send a buffer previously allocated by msgqueue_malloc_before_send
  * @details deallocation is done by the caching thread which actually write data to sd card
@@ -225,6 +270,7 @@ const char *msgqueue_strerror(const MsgQueueStatus errno);
 struct MsgQueue {
   mailbox_t mb;
   tlsf_memory_heap_t *heap;
+  struct MsgPool pool;
 } ;
 
 
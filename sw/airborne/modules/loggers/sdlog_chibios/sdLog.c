@@ -97,6 +97,22 @@
 #error SDLOG_ALL_BUFFERS_SIZE / SDLOG_NUM_FILES should be a POWER OF 2
 #endif
 
+/*
+  When SDLOG_COMPRESS is set, the write buffer of each file holds a record delta
+  stream which is entropy coded as one block when the buffer is full or flushed.
+  Files are decoded on the ground with sw/logalizer/sdlog_unpack
+ */
+#ifndef SDLOG_COMPRESS
+#define SDLOG_COMPRESS FALSE
+#endif
+
+#if SDLOG_COMPRESS
+#include "modules/loggers/sdlog_chibios/sdLogCompress.h"
+#if SDLOG_WRITE_BUFFER_SIZE > SDLOG_BLOCK_MAX_LEN
+#error SDLOG_ALL_BUFFERS_SIZE / SDLOG_NUM_FILES cannot be > SDLOG_BLOCK_MAX_LEN when SDLOG_COMPRESS is set
+#endif
+#endif
+
 #ifdef SDLOG_NEED_QUEUE
 #include "modules/loggers/sdlog_chibios/msg_queue.h"
 
@@ -188,6 +204,39 @@ static void cleanQueue(const bool allQueue);
 static SdioError sdLogExpandLogFile(const FileDes fileObject, const size_t sizeInMo,
 				    const bool preallocate);
 
+#if SDLOG_COMPRESS
+/*
+  history of the records of the current block of each file, and buffers shared
+  by all files since blocks are coded one at a time by the logger thread
+ */
+static struct SdLogDeltaHistory deltaHistory[SDLOG_NUM_FILES];
+static struct SdLogCompressWork compressWork;
+static IN_DMA_SECTION_NOINIT(uint8_t compressBuffer[SDLOG_COMPRESS_BOUND(SDLOG_WRITE_BUFFER_SIZE)]);
+
+/**
+ * @brief code a delta stream as one block and write it
+ * @param[in] fd : file descriptor, its history is reset for the next block
+ * @param[in] fo : file
+ * @param[in] buffer : delta stream
+ * @param[in] len : delta stream length
+ * @param[out] bw : number of bytes written
+ * @return FatFS result, FR_DENIED if all the block was not written
+ */
+static FRESULT writeCompressedBlock(const FileDes fd, FIL *fo, const uint8_t *buffer,
+                                    const size_t len, UINT *bw)
+{
+  const size_t blockLen = sdLogCompressBlock(buffer, len, SDLOG_BLOCK_DELTA,
+                          compressBuffer, &compressWork);
+  sdLogDeltaReset(&deltaHistory[fd]);
+  const FRESULT rc = f_write(fo, compressBuffer, blockLen, bw);
+  nbBytesWritten += *bw;
+  if (rc == FR_OK && *bw != blockLen) {
+    return FR_DENIED;
+  }
+  return rc;
+}
+#endif
+
 #if (CH_KERNEL_MAJOR > 2)
 static void thdSdLog(void *arg) ;
 #else
@@ -368,7 +417,7 @@ SdioError sdLogCloseAllLogs(bool flush)
       }
     }
 
-    LogMessage *lm =  tlsf_malloc_r(&HEAP_DEFAULT, sizeof(LogMessage));
+    LogMessage *lm =  msgqueue_malloc_before_send(&messagesQueue, sizeof(LogMessage));
     if (lm == NULL) {
       return  storageStatus = SDLOG_MEMFULL;
     }
@@ -475,7 +524,7 @@ SdioError sdLogFlushLog(const FileDes fd)
   // give room to send a flush order if the queue is full
   cleanQueue(false);
 
-  LogMessage *lm =  tlsf_malloc_r(&HEAP_DEFAULT, sizeof(LogMessage));
+  LogMessage *lm =  msgqueue_malloc_before_send(&messagesQueue, sizeof(LogMessage));
   if (lm == NULL) {
     return storageStatus = SDLOG_MEMFULL;
   }
@@ -495,7 +544,7 @@ SdioError sdLogCloseLog(const FileDes fd)
   FD_CHECK(fd);
 
   cleanQueue(false);
-  LogMessage *lm =  tlsf_malloc_r(&HEAP_DEFAULT, sizeof(LogMessage));
+  LogMessage *lm =  msgqueue_malloc_before_send(&messagesQueue, sizeof(LogMessage));
   if (lm == NULL) {
     return storageStatus = SDLOG_MEMFULL;
   }
@@ -539,7 +588,7 @@ SdioError sdLogWriteRaw(const FileDes fd, const uint8_t *buffer, const size_t le
     return status;
   }
 
-  LogMessage *lm = tlsf_malloc_r(&HEAP_DEFAULT, logRawLen(len));
+  LogMessage *lm = msgqueue_malloc_before_send(&messagesQueue, logRawLen(len));
   if (lm == NULL) {
     return storageStatus = SDLOG_MEMFULL;
   }
@@ -557,14 +606,14 @@ SdioError sdLogWriteRaw(const FileDes fd, const uint8_t *buffer, const size_t le
 
 SdioError sdLogAllocSDB(SdLogBuffer **sdb, const size_t len)
 {
-  *sdb = tlsf_malloc_r(&HEAP_DEFAULT, logRawLen(len));
+  *sdb = msgqueue_malloc_before_send(&messagesQueue, sizeof(SdLogBuffer));
   if (*sdb == NULL) {
     return storageStatus = SDLOG_MEMFULL;
   }
 
-  LogMessage *lm = tlsf_malloc_r(&HEAP_DEFAULT, logRawLen(len));
+  LogMessage *lm = msgqueue_malloc_before_send(&messagesQueue, logRawLen(len));
   if (lm == NULL) {
-    tlsf_free_r(&HEAP_DEFAULT, *sdb);
+    msgqueue_free_after_pop(&messagesQueue, *sdb);
     return storageStatus = SDLOG_MEMFULL;
   }
 
@@ -621,10 +670,10 @@ SdioError sdLogWriteSDB(const FileDes fd, SdLogBuffer *sdb)
   goto exit;
 
 fail:
-  tlsf_free_r(&HEAP_DEFAULT, sdb->lm);
+  msgqueue_free_after_pop(&messagesQueue, sdb->lm);
 
 exit:
-  tlsf_free_r(&HEAP_DEFAULT, sdb);
+  msgqueue_free_after_pop(&messagesQueue, sdb);
   return storageStatus = status;
 }
 
@@ -637,7 +686,7 @@ SdioError sdLogWriteByte(const FileDes fd, const uint8_t value)
   LogMessage *lm;
 
   if (fileDes[fd].writeByteCache == NULL) {
-    lm = tlsf_malloc_r(&HEAP_DEFAULT, sizeof(LogMessage) + WRITE_BYTE_CACHE_SIZE);
+    lm = msgqueue_malloc_before_send(&messagesQueue, sizeof(LogMessage) + WRITE_BYTE_CACHE_SIZE);
     if (lm == NULL) {
       return storageStatus = SDLOG_MEMFULL;
     }
@@ -911,7 +960,7 @@ static void removeFromQueue(const size_t nbMsgToRFemove)
     if (retLen < 0) {
       break;
     }
-    tlsf_free_r(&HEAP_DEFAULT, lm);
+    msgqueue_free_after_pop(&messagesQueue, lm);
   }
 
   /* tlsf_stat_r (&HEAP_DEFAULT, &stat); */
@@ -954,6 +1003,29 @@ static msg_t thdSdLog(void *arg)
         case FCNTL_CLOSE: {
           const uint16_t curBufFill = perfBuffers[lm->op.fd].size;
           if (fileDes[lm->op.fd].inUse) {
+#if SDLOG_COMPRESS
+            uint16_t blockFill = curBufFill;
+            if (lm->op.fcntl == FCNTL_CLOSE && fileDes[lm->op.fd].tagAtClose) {
+              // end tag is part of the last block
+              if (blockFill + SDLOG_DELTA_BOUND(14) > SDLOG_WRITE_BUFFER_SIZE) {
+                writeCompressedBlock(lm->op.fd, fo, perfBuffer, blockFill, &bw);
+                blockFill = 0;
+              }
+              blockFill = (uint16_t)(blockFill + sdLogDeltaRecord(&deltaHistory[lm->op.fd],
+                                     (const uint8_t *) "\r\nEND_OF_LOG\r\n", 14,
+                                     &perfBuffer[blockFill]));
+            }
+            if (blockFill) {
+              writeCompressedBlock(lm->op.fd, fo, perfBuffer, blockFill, &bw);
+              perfBuffers[lm->op.fd].size = 0;
+            }
+            if (lm->op.fcntl ==  FCNTL_FLUSH) {
+              f_sync(fo);
+            } else { // close
+              f_close(fo);
+              fileDes[lm->op.fd].inUse = false; // store that file is closed
+            }
+#else
             if (curBufFill) {
               f_write(fo, perfBuffer, curBufFill, &bw);
               nbBytesWritten += bw;
@@ -969,12 +1041,13 @@ static msg_t thdSdLog(void *arg)
               f_close(fo);
               fileDes[lm->op.fd].inUse = false; // store that file is closed
             }
+#endif
           }
         }
         break;
 
         case FCNTL_EXIT:
-          tlsf_free_r(&HEAP_DEFAULT, lm); // to avoid a memory leak
+          msgqueue_free_after_pop(&messagesQueue, lm); // to avoid a memory leak
           chThdExit(storageStatus = SDLOG_NOTHREAD);
           break; /* To exit from thread when asked : chThdTerminate
       then send special message with FCNTL_EXIT   */
@@ -984,6 +1057,39 @@ static msg_t thdSdLog(void *arg)
           const uint16_t curBufFill = perfBuffers[lm->op.fd].size;
           if (fileDes[lm->op.fd].inUse) {
             const int32_t messLen = retLen - (int32_t)(sizeof(LogMessage));
+#if SDLOG_COMPRESS
+            // long raw messages are cut in several records
+            const uint8_t *rec = (const uint8_t *) lm->mess;
+            int32_t recRemain = messLen;
+            uint16_t blockFill = curBufFill;
+            while (recRemain > 0) {
+              const int32_t recLen = MIN(recRemain, SDLOG_WRITE_BUFFER_SIZE - SDLOG_DELTA_BOUND(0));
+              if (blockFill + SDLOG_DELTA_BOUND(recLen) > SDLOG_WRITE_BUFFER_SIZE) {
+                const FRESULT rc = writeCompressedBlock(lm->op.fd, fo, perfBuffer, blockFill, &bw);
+                blockFill = 0;
+                // if there an autoflush period specified, flush to the mass storage media
+                // if timer has expired and rearm.
+                if (fileDes[lm->op.fd].autoFlushPeriod) {
+                  const systime_t now = chVTGetSystemTimeX();
+                  if ((now - fileDes[lm->op.fd].lastFlushTs) >
+                      (fileDes[lm->op.fd].autoFlushPeriod * CH_CFG_ST_FREQUENCY)) {
+                    f_sync(fo);
+                    fileDes[lm->op.fd].lastFlushTs = now;
+                  }
+                }
+                if (rc == FR_DENIED) {
+                  chThdExit(storageStatus = SDLOG_FSFULL);
+                } else if (rc) {
+                  storageStatus = SDLOG_FATFS_ERROR;
+                }
+              }
+              blockFill = (uint16_t)(blockFill + sdLogDeltaRecord(&deltaHistory[lm->op.fd], rec,
+                                     (size_t) recLen, &perfBuffer[blockFill]));
+              rec += recLen;
+              recRemain -= recLen;
+            }
+            perfBuffers[lm->op.fd].size = blockFill;
+#else
             if (messLen < (SDLOG_WRITE_BUFFER_SIZE - curBufFill)) {
               // the buffer can accept this message
               memcpy(&(perfBuffer[curBufFill]), lm->mess, (size_t)(messLen));
@@ -1014,10 +1120,11 @@ static msg_t thdSdLog(void *arg)
               memcpy(perfBuffer, &(lm->mess[stayLen]), (uint32_t)(messLen - stayLen));
               perfBuffers[lm->op.fd].size = (uint16_t)(messLen - stayLen); // curBufFill
             }
+#endif
           }
         }
       }
-      tlsf_free_r(&HEAP_DEFAULT, lm);
+      msgqueue_free_after_pop(&messagesQueue, lm);
     } else {
       chThdExit(storageStatus = SDLOG_INTERNAL_ERROR);
     }
@@ -1062,5 +1169,10 @@ SdioError sdLogGetStorageStatus(void)
   return storageStatus;
 }
 
+bool sdLogGetPoolStats(const uint8_t cls, struct MsgPoolStats *stats)
+{
+  return msgqueue_get_pool_stats(&messagesQueue, cls, stats);
+}
+
 
 #endif
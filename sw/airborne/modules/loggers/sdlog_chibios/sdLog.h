@@ -30,6 +30,7 @@
 #include "mcuconf.h"
 
 #include <stdarg.h>
+#include "modules/loggers/sdlog_chibios/msg_pool.h"
 
 #define NUMBERLEN 4
 #define NUMBERMAX 9999
@@ -345,6 +346,15 @@ size_t sdLogGetNbBytesWrittenToStorage(void);
 */
 SdioError sdLogGetStorageStatus(void);
 
+/**
+ * @brief return statistics of a message pool class
+ * @param[in] cls : class index
+ * @param[out] stats : slot size, number of slots, occupancy, high-water mark
+ *             and number of allocations that fell back to the heap
+ * @return  false if cls is not a valid class
+*/
+bool sdLogGetPoolStats(const uint8_t cls, struct MsgPoolStats *stats);
+
 
 #endif
 
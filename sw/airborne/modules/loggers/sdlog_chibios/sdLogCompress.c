@@ -0,0 +1,420 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @file modules/loggers/sdlog_chibios/sdLogCompress.c
+ * @brief streaming compression for the SD logger
+ *
+ */
+#include "modules/loggers/sdlog_chibios/sdLogCompress.h"
+#include <string.h>
+
+#define MAX_CODE_LEN 15
+#define LENGTHS_LEN 128
+
+static uint16_t fletcher16(const uint8_t *data, size_t len)
+{
+  uint32_t s1 = 0, s2 = 0;
+  while (len > 0) {
+    // sums can't overflow on 4096 bytes, reduce after each chunk
+    size_t n = len > 4096 ? 4096 : len;
+    len -= n;
+    while (n--) {
+      s1 += *data++;
+      s2 += s1;
+    }
+    s1 %= 255;
+    s2 %= 255;
+  }
+  return (uint16_t)((s2 << 8) | s1);
+}
+
+/*
+#                 _____           _  _
+#                |  __ \         | || |
+#                | |  | |   ___  | || |_    __ _
+#                | |  | |  / _ \ | || __|  / _` |
+#                | |__| | |  __/ | || |_  | (_| |
+#                |_____/   \___| |_| \__|  \__,_|
+*/
+
+// history slot of the n-th previous record (n >= 1)
+static inline uint8_t historySlot(const struct SdLogDeltaHistory *hist, const uint8_t n)
+{
+  return (uint8_t)((hist->last + SDLOG_COMPRESS_HISTORY + 1 - n) % SDLOG_COMPRESS_HISTORY);
+}
+
+static void historyPush(struct SdLogDeltaHistory *hist, const uint8_t *rec, const size_t len)
+{
+  if (len <= SDLOG_COMPRESS_MAX_RECORD) {
+    hist->last = (uint8_t)((hist->last + 1) % SDLOG_COMPRESS_HISTORY);
+    memcpy(hist->rec[hist->last], rec, len);
+    hist->len[hist->last] = (uint16_t) len;
+  }
+}
+
+void sdLogDeltaReset(struct SdLogDeltaHistory *hist)
+{
+  for (uint8_t i = 0; i < SDLOG_COMPRESS_HISTORY; i++) {
+    hist->len[i] = 0;
+  }
+  hist->last = 0;
+}
+
+size_t sdLogDeltaRecord(struct SdLogDeltaHistory *hist, const uint8_t *rec, const size_t len, uint8_t *out)
+{
+  size_t n = 0;
+  if (len < 128) {
+    out[n++] = (uint8_t) len;
+  } else {
+    out[n++] = (uint8_t)(0x80 | (len >> 8));
+    out[n++] = (uint8_t)(len & 0xff);
+  }
+
+  // most similar record of the same length
+  uint8_t best = 0;
+  size_t bestDiff = len;
+  if (len <= SDLOG_COMPRESS_MAX_RECORD) {
+    for (uint8_t k = 1; k <= SDLOG_COMPRESS_HISTORY && bestDiff > 0; k++) {
+      const uint8_t slot = historySlot(hist, k);
+      if (hist->len[slot] != len) {
+        continue;
+      }
+      size_t diff = 0;
+      for (size_t i = 0; i < len && diff < bestDiff; i++) {
+        diff += (rec[i] != hist->rec[slot][i]);
+      }
+      if (diff < bestDiff) {
+        bestDiff = diff;
+        best = k;
+      }
+    }
+  }
+
+  out[n++] = best;
+  if (best) {
+    const uint8_t *ref = hist->rec[historySlot(hist, best)];
+    for (size_t i = 0; i < len; i++) {
+      out[n + i] = (uint8_t)(rec[i] - ref[i]);
+    }
+  } else {
+    memcpy(&out[n], rec, len);
+  }
+  historyPush(hist, rec, len);
+  return n + len;
+}
+
+int32_t sdLogUndeltaBlock(struct SdLogDeltaHistory *hist, const uint8_t *in, const size_t len,
+                          uint8_t *out, const size_t outSize)
+{
+  size_t ip = 0, op = 0;
+  sdLogDeltaReset(hist);
+  while (ip < len) {
+    size_t recLen = in[ip++];
+    if (recLen & 0x80) {
+      if (ip >= len) {
+        return -1;
+      }
+      recLen = ((recLen & 0x7f) << 8) | in[ip++];
+    }
+    if (ip >= len) {
+      return -1;
+    }
+    const uint8_t ref = in[ip++];
+    if (recLen > len - ip || recLen > outSize - op || ref > SDLOG_COMPRESS_HISTORY) {
+      return -1;
+    }
+    if (ref) {
+      const uint8_t slot = historySlot(hist, ref);
+      if (hist->len[slot] != recLen) {
+        return -1;
+      }
+      for (size_t i = 0; i < recLen; i++) {
+        out[op + i] = (uint8_t)(in[ip + i] + hist->rec[slot][i]);
+      }
+    } else {
+      memcpy(&out[op], &in[ip], recLen);
+    }
+    historyPush(hist, &out[op], recLen);
+    ip += recLen;
+    op += recLen;
+  }
+  return (int32_t) op;
+}
+
+/*
+#                 _    _            __    __
+#                | |  | |          / _|  / _|
+#                | |__| |  _   _  | |_  | |_   _ __ ___     __ _   _ __
+#                |  __  | | | | | |  _| |  _| | '_ ` _ \   / _` | | '_ \
+#                | |  | | | |_| | | |   | |   | | | | | | | (_| | | | | |
+#                |_|  |_|  \__,_| |_|   |_|   |_| |_| |_|  \__,_| |_| |_|
+*/
+
+/*
+  code lengths of a Huffman code limited to MAX_CODE_LEN bits
+  leaves sorted by weight and internal nodes created in increasing weight
+  order are merged with two queues, the weights are divided until the
+  longest code fits.
+ */
+static void buildLengths(struct SdLogCompressWork *w)
+{
+  size_t n = 0;
+  memset(w->lengths, 0, sizeof(w->lengths));
+  for (uint16_t s = 0; s < 256; s++) {
+    if (w->freq[s]) {
+      // insertion sort by frequency
+      size_t i = n++;
+      while (i > 0 && w->freq[w->sorted[i - 1]] > w->freq[s]) {
+        w->sorted[i] = w->sorted[i - 1];
+        i--;
+      }
+      w->sorted[i] = s;
+    }
+  }
+  if (n == 0) {
+    return;
+  }
+  if (n == 1) {
+    w->lengths[w->sorted[0]] = 1;
+    return;
+  }
+
+  for (uint8_t shift = 0;; shift++) {
+    // flatten the distribution, the order is unchanged
+    for (size_t i = 0; i < n; i++) {
+      w->weight[i] = shift ? ((w->freq[w->sorted[i]] >> shift) | 1) : w->freq[w->sorted[i]];
+    }
+    size_t leaf = 0, node = n;
+    for (size_t next = n; next < 2 * n - 1; next++) {
+      size_t pick[2];
+      for (uint8_t j = 0; j < 2; j++) {
+        if (leaf < n && (node >= next || w->weight[leaf] <= w->weight[node])) {
+          pick[j] = leaf++;
+        } else {
+          pick[j] = node++;
+        }
+      }
+      w->weight[next] = w->weight[pick[0]] + w->weight[pick[1]];
+      w->parent[pick[0]] = w->parent[pick[1]] = (uint16_t) next;
+    }
+    // depths, parents are always after their children (weight array is reused)
+    uint32_t maxDepth = 0;
+    w->weight[2 * n - 2] = 0;
+    for (size_t i = 2 * n - 2; i-- > 0;) {
+      w->weight[i] = w->weight[w->parent[i]] + 1;
+      if (i < n && w->weight[i] > maxDepth) {
+        maxDepth = w->weight[i];
+      }
+    }
+    if (maxDepth <= MAX_CODE_LEN) {
+      for (size_t i = 0; i < n; i++) {
+        w->lengths[w->sorted[i]] = (uint8_t) w->weight[i];
+      }
+      return;
+    }
+  }
+}
+
+// canonical codes, bit reversed for LSB first output
+static void buildCodes(struct SdLogCompressWork *w)
+{
+  uint16_t count[MAX_CODE_LEN + 1] = {0};
+  uint16_t next[MAX_CODE_LEN + 1];
+  for (uint16_t s = 0; s < 256; s++) {
+    count[w->lengths[s]]++;
+  }
+  count[0] = 0;
+  uint16_t code = 0;
+  for (uint8_t bits = 1; bits <= MAX_CODE_LEN; bits++) {
+    code = (uint16_t)((code + count[bits - 1]) << 1);
+    next[bits] = code;
+  }
+  for (uint16_t s = 0; s < 256; s++) {
+    const uint8_t len = w->lengths[s];
+    if (len) {
+      uint16_t c = next[len]++, r = 0;
+      for (uint8_t i = 0; i < len; i++) {
+        r = (uint16_t)((r << 1) | (c & 1));
+        c >>= 1;
+      }
+      w->code[s] = r;
+    }
+  }
+}
+
+size_t sdLogCompressBlock(const uint8_t *in, const size_t len, const uint8_t flags, uint8_t *out,
+                          struct SdLogCompressWork *work)
+{
+  if (len > SDLOG_BLOCK_MAX_LEN) {
+    return 0;
+  }
+
+  uint8_t *const data = out + SDLOG_BLOCK_HEADER_LEN;
+  size_t dataLen = len;
+  uint8_t blockFlags = flags & SDLOG_BLOCK_DELTA;
+
+  memset(work->freq, 0, sizeof(work->freq));
+  for (size_t i = 0; i < len; i++) {
+    work->freq[in[i]]++;
+  }
+  buildLengths(work);
+  // exact coded size, the data is stored if it doesn't compress
+  uint32_t bits = 0;
+  for (uint16_t s = 0; s < 256; s++) {
+    bits += work->freq[s] * work->lengths[s];
+  }
+  const size_t codedLen = LENGTHS_LEN + (bits + 7) / 8;
+
+  if (len > 0 && codedLen < len) {
+    buildCodes(work);
+    for (uint16_t s = 0; s < 256; s += 2) {
+      data[s / 2] = (uint8_t)(work->lengths[s] | (work->lengths[s + 1] << 4));
+    }
+    uint8_t *op = data + LENGTHS_LEN;
+    uint32_t acc = 0;
+    uint8_t nbits = 0;
+    for (size_t i = 0; i < len; i++) {
+      acc |= (uint32_t) work->code[in[i]] << nbits;
+      nbits = (uint8_t)(nbits + work->lengths[in[i]]);
+      while (nbits >= 8) {
+        *op++ = (uint8_t) acc;
+        acc >>= 8;
+        nbits = (uint8_t)(nbits - 8);
+      }
+    }
+    if (nbits) {
+      *op++ = (uint8_t) acc;
+    }
+    dataLen = codedLen;
+    blockFlags |= SDLOG_BLOCK_HUFFMAN;
+  } else {
+    // store the data
+    memcpy(data, in, len);
+  }
+
+  const uint16_t check = fletcher16(in, len);
+  out[0] = SDLOG_BLOCK_MAGIC0;
+  out[1] = SDLOG_BLOCK_MAGIC1;
+  out[2] = blockFlags;
+  out[3] = (uint8_t)(len & 0xff);
+  out[4] = (uint8_t)(len >> 8);
+  out[5] = (uint8_t)(dataLen & 0xff);
+  out[6] = (uint8_t)(dataLen >> 8);
+  out[7] = (uint8_t)(check & 0xff);
+  out[8] = (uint8_t)(check >> 8);
+  return SDLOG_BLOCK_HEADER_LEN + dataLen;
+}
+
+int32_t sdLogDecompressBlock(const uint8_t *blk, const size_t avail, uint8_t *out, size_t *consumed,
+                             uint8_t *flags)
+{
+  if (avail < SDLOG_BLOCK_HEADER_LEN) {
+    return -1;
+  }
+  if (blk[0] != SDLOG_BLOCK_MAGIC0 || blk[1] != SDLOG_BLOCK_MAGIC1) {
+    return -2;
+  }
+  *flags = blk[2];
+  const size_t rawLen = blk[3] | (blk[4] << 8);
+  const size_t dataLen = blk[5] | (blk[6] << 8);
+  const uint16_t check = (uint16_t)(blk[7] | (blk[8] << 8));
+  if (rawLen > SDLOG_BLOCK_MAX_LEN || dataLen > rawLen) {
+    return -2;
+  }
+  if (avail < SDLOG_BLOCK_HEADER_LEN + dataLen) {
+    return -1;
+  }
+  const uint8_t *data = blk + SDLOG_BLOCK_HEADER_LEN;
+
+  if (!(*flags & SDLOG_BLOCK_HUFFMAN)) {
+    if (dataLen != rawLen) {
+      return -2;
+    }
+    memcpy(out, data, rawLen);
+  } else {
+    if (dataLen < LENGTHS_LEN) {
+      return -2;
+    }
+    // canonical decoding tables
+    uint16_t count[MAX_CODE_LEN + 1] = {0};
+    uint16_t offs[MAX_CODE_LEN + 2];
+    uint8_t symbol[256];
+    for (uint16_t s = 0; s < 256; s++) {
+      count[(data[s / 2] >> ((s & 1) * 4)) & 0x0f]++;
+    }
+    count[0] = 0;
+    int32_t left = 1;
+    for (uint8_t len = 1; len <= MAX_CODE_LEN; len++) {
+      left = (left << 1) - count[len];
+      if (left < 0) {
+        return -2; // over subscribed code
+      }
+    }
+    offs[1] = 0;
+    for (uint8_t len = 1; len <= MAX_CODE_LEN; len++) {
+      offs[len + 1] = (uint16_t)(offs[len] + count[len]);
+    }
+    for (uint16_t s = 0; s < 256; s++) {
+      const uint8_t len = (data[s / 2] >> ((s & 1) * 4)) & 0x0f;
+      if (len) {
+        symbol[offs[len]++] = (uint8_t) s;
+      }
+    }
+
+    const uint8_t *ip = data + LENGTHS_LEN;
+    const uint8_t *const iend = data + dataLen;
+    uint32_t bitBuf = 0;
+    uint8_t bitCnt = 0;
+    for (size_t op = 0; op < rawLen; op++) {
+      int32_t code = 0, first = 0, index = 0;
+      uint8_t len;
+      for (len = 1; len <= MAX_CODE_LEN; len++) {
+        if (bitCnt == 0) {
+          if (ip >= iend) {
+            return -2;
+          }
+          bitBuf = *ip++;
+          bitCnt = 8;
+        }
+        code |= bitBuf & 1;
+        bitBuf >>= 1;
+        bitCnt--;
+        const int32_t n = count[len];
+        if (code - n < first) {
+          out[op] = symbol[index + (code - first)];
+          break;
+        }
+        index += n;
+        first = (first + n) << 1;
+        code <<= 1;
+      }
+      if (len > MAX_CODE_LEN) {
+        return -2; // incomplete code
+      }
+    }
+  }
+
+  if (fletcher16(out, rawLen) != check) {
+    return -2;
+  }
+  *consumed = SDLOG_BLOCK_HEADER_LEN + dataLen;
+  return (int32_t) rawLen;
+}
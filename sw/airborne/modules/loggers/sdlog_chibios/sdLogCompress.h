@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @file modules/loggers/sdlog_chibios/sdLogCompress.h
+ * @brief streaming compression for the SD logger
+ *
+ * Two stages tuned for binary telemetry, where most messages are close to
+ * a previous message of the same type (same header, slowly changing fields):
+ *  ° record delta : each message (record) is replaced by its byte difference with
+ *    the most similar of the last SDLOG_COMPRESS_HISTORY records of the same length,
+ *    which turns the repeated parts into zeros
+ *  ° block entropy coding : the delta stream is cut in blocks coded with a
+ *    Huffman code built for each block
+ * Blocks only contain whole records and the history is reset at each block,
+ * so that blocks are independent and a truncated or damaged log can be decoded
+ * up to its last complete block, or from the next valid block.
+ *
+ * Block layout (little endian):
+ *   'P' 'Z' flags rawLen(2) dataLen(2) check(2) data[dataLen]
+ *   flags : SDLOG_BLOCK_HUFFMAN if data is coded, else it is stored as is
+ *           SDLOG_BLOCK_DELTA if data is a record delta stream
+ *   rawLen : length of the block before entropy coding
+ *   check : fletcher16 of the block before entropy coding
+ *   coded data : 128 bytes of code lengths (4 bits per symbol) then the code bits
+ *
+ * Record layout in a delta stream:
+ *   len (1 byte if < 128, else 2 bytes, most significant bits first with bit 7 set)
+ *   ref (0: raw record, n: delta with the n-th previous record)
+ *   len bytes of data or of difference
+ *
+ * The code has no ChibiOS dependency so that it can be used by the
+ * host side tool (sw/logalizer/sdlog_unpack).
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SDLOG_BLOCK_MAGIC0 'P'
+#define SDLOG_BLOCK_MAGIC1 'Z'
+#define SDLOG_BLOCK_HEADER_LEN 9
+#define SDLOG_BLOCK_HUFFMAN 0x01
+#define SDLOG_BLOCK_DELTA 0x02
+
+/** max length of a block before entropy coding */
+#define SDLOG_BLOCK_MAX_LEN 32768
+
+/** number of previous records searched for the delta */
+#ifndef SDLOG_COMPRESS_HISTORY
+#define SDLOG_COMPRESS_HISTORY 8
+#endif
+
+/** max length of a record kept in the history, longer records are not delta coded */
+#ifndef SDLOG_COMPRESS_MAX_RECORD
+#define SDLOG_COMPRESS_MAX_RECORD 256
+#endif
+
+/** max length of a coded record */
+#define SDLOG_DELTA_BOUND(len) ((len) + 3)
+
+/** max length of a block for len bytes of data (worst case is a stored block) */
+#define SDLOG_COMPRESS_BOUND(len) ((len) + SDLOG_BLOCK_HEADER_LEN)
+
+/** last records of the current block */
+struct SdLogDeltaHistory {
+  uint8_t rec[SDLOG_COMPRESS_HISTORY][SDLOG_COMPRESS_MAX_RECORD];
+  uint16_t len[SDLOG_COMPRESS_HISTORY];
+  uint8_t last;               ///< index of the last record
+};
+
+/** work area of the entropy coder */
+struct SdLogCompressWork {
+  uint32_t freq[256];
+  uint16_t code[256];
+  uint8_t  lengths[256];
+  uint16_t sorted[256];
+  uint16_t parent[511];
+  uint32_t weight[511];
+};
+
+/**
+ * @brief forget the previous records, to be called at the beginning of each block
+ */
+void sdLogDeltaReset(struct SdLogDeltaHistory *hist);
+
+/**
+ * @brief code a record as a difference with a previous record
+ * @param[in] hist : history of the current block
+ * @param[in] rec : record
+ * @param[in] len : record length (< 32768)
+ * @param[out] out : coded record, at least SDLOG_DELTA_BOUND(len) bytes
+ * @return  length of the coded record
+ */
+size_t sdLogDeltaRecord(struct SdLogDeltaHistory *hist, const uint8_t *rec, size_t len, uint8_t *out);
+
+/**
+ * @brief rebuild the records of a delta stream
+ * @param[in] hist : history, reset by the function
+ * @param[in] in : delta stream of a block
+ * @param[in] len : length of the delta stream
+ * @param[out] out : records
+ * @param[in] outSize : size of out
+ * @return  length of the records, -1 if the stream is corrupted or out too small
+ */
+int32_t sdLogUndeltaBlock(struct SdLogDeltaHistory *hist, const uint8_t *in, size_t len,
+                          uint8_t *out, size_t outSize);
+
+/**
+ * @brief entropy code a buffer into one block
+ * @param[in] in : data
+ * @param[in] len : data length, at most SDLOG_BLOCK_MAX_LEN
+ * @param[in] flags : SDLOG_BLOCK_DELTA if data is a delta stream
+ * @param[out] out : block, at least SDLOG_COMPRESS_BOUND(len) bytes
+ * @param[in] work : work area
+ * @return  length of the block, 0 if len is too large
+ */
+size_t sdLogCompressBlock(const uint8_t *in, size_t len, uint8_t flags, uint8_t *out,
+                          struct SdLogCompressWork *work);
+
+/**
+ * @brief decode one block (entropy coding only)
+ * @param[in] blk : block data
+ * @param[in] avail : number of bytes available in blk
+ * @param[out] out : data, at least SDLOG_BLOCK_MAX_LEN bytes
+ * @param[out] consumed : length of the block in blk
+ * @param[out] flags : block flags
+ * @return  data length, -1 if the block is incomplete, -2 if it is corrupted
+ */
+int32_t sdLogDecompressBlock(const uint8_t *blk, size_t avail, uint8_t *out, size_t *consumed,
+                             uint8_t *flags);
+
+#ifdef __cplusplus
+}
+#endif
@@ -26,6 +26,7 @@
 
 #include "modules/meteo/wind_estimator.h"
 #include "modules/meteo/lib_ukf_wind_estimator/UKF_Wind_Estimator.h"
+#include "modules/meteo/wind_estimator_srukf.h"
 #include "mcu_periph/sys_time.h"
 #include "math/pprz_algebra_float.h"
 #include "math/pprz_geodetic_float.h"
@@ -40,6 +41,14 @@
 #include <hal.h>
 #endif
 
+/**
+ * Use the generic square-root UKF instead of the generated one,
+ * same model and parameters, lower CPU and stack usage
+ */
+#ifndef WE_UKF_SRUKF
+#define WE_UKF_SRUKF FALSE
+#endif
+
 /**
  * Default parameters
  */
@@ -128,10 +137,19 @@ struct WindEstimator wind_estimator;
 static uint32_t time_step_before;     // last periodic time
 
 /* Thread declaration
- * MATLAB UKF is using at least 6.6KB of stack
+ * MATLAB UKF is using at least 6.6KB of stack,
+ * the square-root UKF has its workspace in a static structure
  */
+#ifndef WE_UKF_STACK_SIZE
+#if WE_UKF_SRUKF
+#define WE_UKF_STACK_SIZE (2 * 1024)
+#else
+#define WE_UKF_STACK_SIZE (8 * 1024)
+#endif
+#endif
+
 #ifndef SITL
-static THD_WORKING_AREA(wa_thd_windestimation, 8 * 1024);
+static THD_WORKING_AREA(wa_thd_windestimation, WE_UKF_STACK_SIZE);
 static __attribute__((noreturn)) void thd_windestimate(void *arg);
 
 static MUTEX_DECL(we_ukf_mtx);        // mutex for data acces protection
@@ -144,7 +162,11 @@ static SEMAPHORE_DECL(we_ukf_sem, 0); // semaaphore for sending signal
 /*----------------------------------------------------*/
 void init_calculator(void)
 {
+#if WE_UKF_SRUKF
+  wind_estimator_srukf_init();
+#else
   UKF_Wind_Estimator_initialize();
+#endif
 
   // FIXME would be better to force Matlab to do this in initialize function
   // zero input vector
@@ -250,7 +272,11 @@ static inline void wind_estimator_step(void)
   // estimate wind if airspeed is high enough
   if (ukf_U.va > 5.0f) {
     // run estimation
+#if WE_UKF_SRUKF
+    wind_estimator_srukf_step();
+#else
     UKF_Wind_Estimator_step();
+#endif
     // update output structure
     wind_estimator.airspeed.x = ukf_Y.xout[0];
     wind_estimator.airspeed.y = ukf_Y.xout[1];
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/meteo/wind_estimator_srukf.c"
+ *
+ * Wind estimator model on the generic square-root UKF.
+ *
+ * state: airspeed vector in body frame, wind in NED frame, airspeed scale factor
+ * inputs: body rates and specific acceleration (gravity removed) in body frame
+ * measurements: ground speed in NED frame, airspeed norm, angle of attack, sideslip
+ */
+
+#include "modules/meteo/wind_estimator_srukf.h"
+#include "modules/meteo/lib_ukf_wind_estimator/UKF_Wind_Estimator.h"
+#include "math/pprz_algebra_float.h"
+#include "math/pprz_rk_float.h"
+#include <math.h>
+#include <string.h>
+
+struct SrUkfFloat we_srukf;
+
+/** inputs of the models, constant over a step */
+struct WeSrukfInputs {
+  float u[6];             ///< rates and accel
+  struct FloatRMat ned_to_body;
+};
+
+static struct WeSrukfInputs we_inputs;
+static bool we_srukf_started;
+static float q_diag[WE_SRUKF_N], r_diag[WE_SRUKF_M];
+
+// matrix element of the generated parameters (column major)
+#define MAT_EL(_m, _l, _c, _n) _m[_l + _c * _n]
+
+/* airspeed dynamics in body frame, wind and scale factor constant */
+static void we_dynamics(float *o, const float *x, const int n, const float *u, const int m __attribute__((unused)))
+{
+  o[0] = u[2] * x[1] - u[1] * x[2] + u[3];
+  o[1] = u[0] * x[2] - u[2] * x[0] + u[4];
+  o[2] = u[1] * x[0] - u[0] * x[1] + u[5];
+  for (int i = 3; i < n; i++) {
+    o[i] = 0.f;
+  }
+}
+
+static void we_process(float *x_next, const float *x, float dt, void *user)
+{
+  struct WeSrukfInputs *in = (struct WeSrukfInputs *)user;
+  runge_kutta_4_float(x_next, x, WE_SRUKF_N, in->u, 6, we_dynamics, dt);
+}
+
+static void we_measure(float *y, const float *x, void *user)
+{
+  struct WeSrukfInputs *in = (struct WeSrukfInputs *)user;
+  struct FloatVect3 va_body = { x[0], x[1], x[2] };
+  struct FloatVect3 va_ned;
+  float_rmat_transp_vmult(&va_ned, &in->ned_to_body, &va_body);
+  const float va = float_vect3_norm(&va_body);
+  y[0] = va_ned.x + x[3];
+  y[1] = va_ned.y + x[4];
+  y[2] = va_ned.z + x[5];
+  y[3] = x[6] * va;
+  if (va > 0.0001f) {
+    y[4] = atan2f(x[2], x[0]);
+    y[5] = asinf(x[1] / va);
+  } else {
+    y[4] = 0.f;
+    y[5] = 0.f;
+  }
+}
+
+void wind_estimator_srukf_init(void)
+{
+  srukf_init(&we_srukf, WE_SRUKF_N, WE_SRUKF_M, we_process, we_measure, &we_inputs);
+  we_srukf_started = false;
+}
+
+/* square roots of the noise matrices only recomputed when the settings change */
+static void update_noise(void)
+{
+  uint8_t i;
+  bool changed = false;
+  for (i = 0; i < WE_SRUKF_N; i++) {
+    changed |= q_diag[i] != MAT_EL(ukf_params.Q, i, i, WE_SRUKF_N);
+    q_diag[i] = MAT_EL(ukf_params.Q, i, i, WE_SRUKF_N);
+  }
+  if (changed) {
+    srukf_set_process_noise(&we_srukf, q_diag);
+  }
+  changed = false;
+  for (i = 0; i < WE_SRUKF_M; i++) {
+    changed |= r_diag[i] != MAT_EL(ukf_params.R, i, i, WE_SRUKF_M);
+    r_diag[i] = MAT_EL(ukf_params.R, i, i, WE_SRUKF_M);
+  }
+  if (changed) {
+    srukf_set_measurement_noise(&we_srukf, r_diag);
+  }
+}
+
+void wind_estimator_srukf_step(void)
+{
+  uint8_t i, j;
+
+  if (!we_srukf_started) {
+    float p0[WE_SRUKF_N];
+    for (i = 0; i < WE_SRUKF_N; i++) {
+      p0[i] = MAT_EL(ukf_init.P0, i, i, WE_SRUKF_N);
+    }
+    srukf_set_params(&we_srukf, ukf_init.alpha, ukf_init.beta, ukf_init.ki);
+    srukf_set_state(&we_srukf, ukf_init.x0, p0);
+    // force the noise update
+    for (i = 0; i < WE_SRUKF_N; i++) {
+      q_diag[i] = -1.f;
+    }
+    for (i = 0; i < WE_SRUKF_M; i++) {
+      r_diag[i] = -1.f;
+    }
+    we_srukf_started = true;
+  }
+  update_noise();
+
+  // inputs
+  for (i = 0; i < 3; i++) {
+    we_inputs.u[i] = ukf_U.rates[i];
+    we_inputs.u[3 + i] = ukf_U.accel[i];
+  }
+  struct FloatQuat q = { ukf_U.q[0], ukf_U.q[1], ukf_U.q[2], ukf_U.q[3] };
+  float_quat_normalize(&q);
+  float_rmat_of_quat(&we_inputs.ned_to_body, &q);
+
+  const float z[WE_SRUKF_M] = {
+    ukf_U.vk[0], ukf_U.vk[1], ukf_U.vk[2], ukf_U.va, ukf_U.aoa, ukf_U.sideslip
+  };
+  srukf_predict(&we_srukf, ukf_params.dt);
+  srukf_update(&we_srukf, z);
+
+  // outputs, Pout being the lower triangular square root of the covariance
+  for (i = 0; i < WE_SRUKF_N; i++) {
+    ukf_Y.xout[i] = we_srukf.x[i];
+    for (j = 0; j < WE_SRUKF_N; j++) {
+      MAT_EL(ukf_Y.Pout, i, j, WE_SRUKF_N) = we_srukf.S[j][i];
+    }
+  }
+}
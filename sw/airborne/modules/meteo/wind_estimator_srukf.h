@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/meteo/wind_estimator_srukf.h"
+ *
+ * Wind estimator model on the generic square-root UKF (math/pprz_srukf_float.h).
+ *
+ * Same model, inputs and outputs as the generated UKF_Wind_Estimator:
+ * ukf_U, ukf_init and ukf_params are read, ukf_Y is written, so that both
+ * implementations are interchangeable (WE_UKF_SRUKF option of wind_estimator).
+ * The state is initialized from ukf_init at the first step after
+ * wind_estimator_srukf_init.
+ */
+
+#ifndef WIND_ESTIMATOR_SRUKF_H
+#define WIND_ESTIMATOR_SRUKF_H
+
+#include "math/pprz_srukf_float.h"
+
+#define WE_SRUKF_N 7
+#define WE_SRUKF_M 6
+
+#if SRUKF_MAX_N < WE_SRUKF_N || SRUKF_MAX_M < WE_SRUKF_M
+#error "wind estimator needs SRUKF_MAX_N >= 7 and SRUKF_MAX_M >= 6"
+#endif
+
+extern struct SrUkfFloat we_srukf;
+
+extern void wind_estimator_srukf_init(void);
+extern void wind_estimator_srukf_step(void);
+
+#endif /* WIND_ESTIMATOR_SRUKF_H */
@@ -5,6 +5,7 @@
 #define FORMATION_C
 
 #include "multi/formation.h"
+#include "modules/multi/neighbors.h"
 
 #include "std.h"
 #include "state.h"
@@ -124,7 +125,7 @@ int stop_formation(void)
 int formation_flight(void)
 {
   static uint8_t _1Hz = 0;
-  uint8_t nb = 0, i;
+  uint8_t nb = 0, i, j;
   float hspeed_dir = stateGetHorizontalSpeedDir_f();
   float ch = cosf(hspeed_dir);
   float sh = sinf(hspeed_dir);
@@ -177,24 +178,21 @@ int formation_flight(void)
 
   struct EnuCoor_f *my_pos = stateGetPositionEnu_f();
   // compute control forces
-  for (i = 0; i < NB_ACS; ++i) {
-    if (ti_acs[i].ac_id == AC_ID) { continue; }
-    struct EnuCoor_f *ac = acInfoGetPositionEnu_f(ti_acs[i].ac_id);
-    struct EnuCoor_f *ac_speed = acInfoGetVelocityEnu_f(ti_acs[i].ac_id);
-
-    float delta_t = Max((int)(gps.tow - acInfoGetItow(ti_acs[i].ac_id)) / 1000., 0.);
-    if (delta_t > FORM_CARROT) {
+  neighbors_update();
+  for (j = 0; j < neighbors.nb; ++j) {
+    i = neighbors.ti_idx[j];
+    if (neighbors.age[j] > FORM_CARROT) {
       // if AC not responding for too long
       formation[i].status = LOST;
       continue;
     } else {
       // compute control if AC is ACTIVE and around the same altitude (maybe not so useful)
       formation[i].status = ACTIVE;
-      if (ac->z > 0 && fabs(my_pos->z - ac->z) < form_prox) {
-        form_e += (ac->x + ac_speed->x * delta_t - my_pos->x) - (form[i].east  - form[ti_acs_id[AC_ID]].east);
-        form_n += (ac->y + ac_speed->y * delta_t - my_pos->y) - (form[i].north - form[ti_acs_id[AC_ID]].north);
-        form_a += (ac->z + ac_speed->z * delta_t - my_pos->z) - (form[i].alt   - form[ti_acs_id[AC_ID]].alt);
-        form_speed += acInfoGetGspeed(ti_acs[i].ac_id);
+      if (neighbors.z[j] > 0 && fabs(my_pos->z - neighbors.z[j]) < form_prox) {
+        form_e += (neighbors.x[j] - my_pos->x) - (form[i].east  - form[ti_acs_id[AC_ID]].east);
+        form_n += (neighbors.y[j] - my_pos->y) - (form[i].north - form[ti_acs_id[AC_ID]].north);
+        form_a += (neighbors.z[j] - my_pos->z) - (form[i].alt   - form[ti_acs_id[AC_ID]].alt);
+        form_speed += acInfoGetGspeed(neighbors.ac_id[j]);
         //form_speed_e += ac->gspeed * sinf(ac->course);
         //form_speed_n += ac->gspeed * cosf(ac->course);
         ++nb;
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/multi/neighbors.c"
+ * Shared snapshot of the other aircraft for multi-agent controllers
+ */
+
+#include "modules/multi/neighbors.h"
+#include "generated/airframe.h"     // AC_ID
+
+struct Neighbors neighbors;
+
+static bool neighbors_valid;
+
+void neighbors_init(void)
+{
+  neighbors.nb = 0;
+  neighbors_valid = false;
+}
+
+void neighbors_update(void)
+{
+  if (neighbors_valid && neighbors.tick == sys_time.nb_tick) {
+    return; // already up to date
+  }
+  neighbors.tick = sys_time.nb_tick;
+  neighbors_valid = true;
+
+  uint8_t i, n = 0;
+  for (i = 0; i < NEIGHBORS_MASK_SIZE; i++) {
+    neighbors.stale[i] = 0;
+  }
+  // first two slots are reserved for ground station and this aircraft
+  for (i = 2; i < ti_acs_idx && i < NB_ACS; i++) {
+    uint8_t id = ti_acs[i].ac_id;
+    if (id == AC_ID || id == 0) { continue; }
+    struct EnuCoor_f *pos = acInfoGetPositionEnu_f(id);
+    struct EnuCoor_f *vel = acInfoGetVelocityEnu_f(id);
+    float age = Max((int)(gps.tow - ti_acs[i].itow) / 1000.f, 0.f);
+    neighbors.ac_id[n] = id;
+    neighbors.ti_idx[n] = i;
+    neighbors.x[n] = pos->x + vel->x * age;
+    neighbors.y[n] = pos->y + vel->y * age;
+    neighbors.z[n] = pos->z + vel->z * age;
+    neighbors.vx[n] = vel->x;
+    neighbors.vy[n] = vel->y;
+    neighbors.vz[n] = vel->z;
+    neighbors.age[n] = age;
+    if (age > NEIGHBORS_STALE_TIME) {
+      neighbors.stale[n / 32] |= (1u << (n % 32));
+    }
+    n++;
+  }
+  neighbors.nb = n;
+}
+
+uint8_t neighbors_radius(struct EnuCoor_f *pos, float radius, uint8_t *idx, uint8_t max)
+{
+  const float r2 = radius * radius;
+  uint8_t i, nb = 0;
+  for (i = 0; i < neighbors.nb && nb < max; i++) {
+    const float dx = neighbors.x[i] - pos->x;
+    const float dy = neighbors.y[i] - pos->y;
+    const float dz = neighbors.z[i] - pos->z;
+    if (dx * dx + dy * dy + dz * dz <= r2 && !neighbors_is_stale(i)) {
+      idx[nb++] = i;
+    }
+  }
+  return nb;
+}
+
+uint8_t neighbors_k_nearest(struct EnuCoor_f *pos, uint8_t k, uint8_t *idx, float *dist2)
+{
+  float d2[NB_ACS];
+  uint8_t i, j, nb = 0;
+  if (k == 0) {
+    return 0;
+  }
+  for (i = 0; i < neighbors.nb; i++) {
+    if (neighbors_is_stale(i)) { continue; }
+    const float dx = neighbors.x[i] - pos->x;
+    const float dy = neighbors.y[i] - pos->y;
+    const float dz = neighbors.z[i] - pos->z;
+    const float d = dx * dx + dy * dy + dz * dz;
+    if (nb == k && d >= d2[nb - 1]) { continue; }
+    // insertion in the sorted list, dropping the farthest if full
+    j = (nb < k) ? nb++ : nb - 1;
+    while (j > 0 && d2[j - 1] > d) {
+      d2[j] = d2[j - 1];
+      idx[j] = idx[j - 1];
+      j--;
+    }
+    d2[j] = d;
+    idx[j] = i;
+  }
+  if (dist2 != NULL) {
+    for (i = 0; i < nb; i++) {
+      dist2[i] = d2[i];
+    }
+  }
+  return nb;
+}
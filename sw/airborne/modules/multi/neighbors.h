@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/multi/neighbors.h"
+ * Shared snapshot of the other aircraft for multi-agent controllers
+ *
+ * Once per system tick, the positions and velocities of all the aircraft
+ * known by traffic_info are converted to the local ENU frame, extrapolated
+ * to the current time and stored as arrays (one per component),
+ * so that the controllers don't convert and filter the traffic table
+ * on their own.
+ */
+
+#ifndef NEIGHBORS_H
+#define NEIGHBORS_H
+
+#include "std.h"
+#include "modules/multi/traffic_info.h"
+
+/** Time after which an aircraft is considered as stale (s) */
+#ifndef NEIGHBORS_STALE_TIME
+#define NEIGHBORS_STALE_TIME 5.f
+#endif
+
+#define NEIGHBORS_MASK_SIZE ((NB_ACS + 31) / 32)
+
+/** Snapshot of the other aircraft
+ *  Stale aircraft are kept in the snapshot (for controllers with their own
+ *  timeout) but are ignored by the queries.
+ */
+struct Neighbors {
+  uint8_t nb;                 ///< number of aircraft in the snapshot
+  uint8_t ac_id[NB_ACS];      ///< aircraft id
+  uint8_t ti_idx[NB_ACS];     ///< index in traffic_info table
+  float x[NB_ACS];            ///< ENU position, extrapolated to snapshot time (m)
+  float y[NB_ACS];
+  float z[NB_ACS];
+  float vx[NB_ACS];           ///< ENU velocity (m/s)
+  float vy[NB_ACS];
+  float vz[NB_ACS];
+  float age[NB_ACS];          ///< time since last update (s)
+  uint32_t stale[NEIGHBORS_MASK_SIZE];  ///< stale bit for each aircraft of the snapshot
+  uint32_t tick;              ///< system tick of the snapshot
+};
+
+extern struct Neighbors neighbors;
+
+extern void neighbors_init(void);
+
+/** Build the snapshot if not done yet for the current system tick
+ *  To be called by the controllers before using the snapshot or the queries.
+ */
+extern void neighbors_update(void);
+
+/** Test if an aircraft of the snapshot is stale */
+static inline bool neighbors_is_stale(uint8_t i)
+{
+  return (neighbors.stale[i / 32] >> (i % 32)) & 1;
+}
+
+/** Find the (non stale) aircraft within a radius
+ * @param[in] pos position in ENU (m)
+ * @param[in] radius distance (m)
+ * @param[out] idx indexes in the snapshot of the aircraft found
+ * @param[in] max size of idx
+ * @return number of aircraft found
+ */
+extern uint8_t neighbors_radius(struct EnuCoor_f *pos, float radius, uint8_t *idx, uint8_t max);
+
+/** Find the k nearest (non stale) aircraft
+ * @param[in] pos position in ENU (m)
+ * @param[in] k max number of aircraft
+ * @param[out] idx indexes in the snapshot, sorted by distance
+ * @param[out] dist2 squared distances (m^2), can be NULL
+ * @return number of aircraft found (at most k)
+ */
+extern uint8_t neighbors_k_nearest(struct EnuCoor_f *pos, uint8_t k, uint8_t *idx, float *dist2);
+
+#endif /* NEIGHBORS_H */
@@ -9,6 +9,7 @@
 #include "pprzlink/dl_protocol.h"
 
 #include "potential.h"
+#include "modules/multi/neighbors.h"
 #include "state.h"
 #include "firmwares/fixedwing/stabilization/stabilization_attitude.h"
 #include "firmwares/fixedwing/guidance/guidance_v.h"
@@ -68,25 +69,22 @@ int potential_task(void)
 
   // compute control forces
   int8_t nb = 0;
-  for (i = 0; i < NB_ACS; ++i) {
-    if (ti_acs[i].ac_id == AC_ID) { continue; }
-    struct EnuCoor_f *ac = acInfoGetPositionEnu_f(ti_acs[i].ac_id);
-    struct EnuCoor_f *ac_speed = acInfoGetVelocityEnu_f(ti_acs[i].ac_id);
-    float delta_t = Max((int)(gps.tow - acInfoGetItow(ti_acs[i].ac_id)) / 1000., 0.);
+  neighbors_update();
+  for (i = 0; i < neighbors.nb; ++i) {
     // if AC not responding for too long, continue, else compute force
-    if (delta_t > CARROT) { continue; }
+    if (neighbors.age[i] > CARROT) { continue; }
     else {
-      float de = ac->x  + ac_speed->x * delta_t - stateGetPositionEnu_f()->x;
+      float de = neighbors.x[i] - stateGetPositionEnu_f()->x;
       if (de > FORCE_MAX_DIST || de < -FORCE_MAX_DIST) { continue; }
-      float dn = ac->y + ac_speed->y * delta_t - stateGetPositionEnu_f()->y;
+      float dn = neighbors.y[i] - stateGetPositionEnu_f()->y;
       if (dn > FORCE_MAX_DIST || dn < -FORCE_MAX_DIST) { continue; }
-      float da = ac->z + ac_speed->z * delta_t - stateGetPositionEnu_f()->z;
+      float da = neighbors.z[i] - stateGetPositionEnu_f()->z;
       if (da > FORCE_MAX_DIST || da < -FORCE_MAX_DIST) { continue; }
       float dist = sqrtf(de * de + dn * dn + da * da);
       if (dist == 0.) { continue; }
-      float dve = stateGetHorizontalSpeedNorm_f() * sh - ac_speed->x;
-      float dvn = stateGetHorizontalSpeedNorm_f() * ch - ac_speed->y;
-      float dva = stateGetSpeedEnu_f()->z - ac_speed->z;
+      float dve = stateGetHorizontalSpeedNorm_f() * sh - neighbors.vx[i];
+      float dvn = stateGetHorizontalSpeedNorm_f() * ch - neighbors.vy[i];
+      float dva = stateGetSpeedEnu_f()->z - neighbors.vz[i];
       float scal = dve * de + dvn * dn + dva * da;
       if (scal < 0.) { continue; } // No risk of collision
       float d3 = dist * dist * dist;
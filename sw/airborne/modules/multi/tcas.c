@@ -26,11 +26,17 @@
  */
 
 #include "multi/tcas.h"
+#include "multi/tcas_sap.h"
 #include "state.h"
 #include "firmwares/fixedwing/nav.h"
 #include "generated/flight_plan.h"  // SECURITY_HEIGHT
 
 #include "subsystems/datalink/downlink.h"
+#include "mcu_periph/sys_time.h"
+#if PERIODIC_TELEMETRY
+#include "subsystems/datalink/telemetry.h"
+#endif
+#include <float.h>
 
 float tcas_alt_setpoint;
 float tcas_tau_ta, tcas_tau_ra, tcas_dmod, tcas_alim;
@@ -62,11 +68,88 @@ struct tcas_ac_status tcas_acs_status[NB_ACS];
 
 #define TCAS_HUGE_TAU 100*TCAS_TAU_TA
 
+#ifndef TCAS_VMAX       // max ground speed of this aircraft (m/s), for sweep and prune
+#ifdef NOMINAL_AIRSPEED
+#define TCAS_VMAX (2.f * NOMINAL_AIRSPEED)
+#else
+#define TCAS_VMAX 30.f
+#endif
+#endif
+
+struct TcasStats tcas_stats;
+
+#if PERIODIC_TELEMETRY
+static void send_tcas_stats(struct transport_tx *trans, struct link_device *dev)
+{
+  float stats[3] = { tcas_stats.nb_monitored, tcas_stats.time, tcas_stats.time_max };
+  pprz_msg_send_PAYLOAD_FLOAT(trans, dev, AC_ID, 3, stats);
+}
+#endif
+
 void callTCAS(void) { if (tcas_status == TCAS_RA) { v_ctl_altitude_setpoint = tcas_alt_setpoint; } }
 
 /* AC is inside the horizontol dmod area and twice the vertical alim separation */
 #define TCAS_IsInside() ( (ddh < Square(tcas_dmod) && ddv < Square(2*tcas_alim)) ? 1 : 0 )
 
+#if TCAS_SWEEP_AND_PRUNE
+
+/** Sweep and prune structure
+ *  For each aircraft, the earliest time at which a conflict (TA or inside the
+ *  protected volume) is possible is computed when a new report is received,
+ *  assuming a closing speed bounded by the aircraft speed plus TCAS_VMAX.
+ *  Aircraft are kept sorted by this time, so that only the first ones of the
+ *  list (and the ones with an alarm) are monitored.
+ */
+struct TcasSap {
+  uint8_t idx[NB_ACS];          ///< aircraft indexes sorted by t_conflict
+  uint8_t nb;                   ///< number of aircraft in idx
+  float t_conflict[NB_ACS];     ///< earliest possible conflict time (s, sys_time)
+  uint32_t itow[NB_ACS];        ///< time of the report used to compute t_conflict
+  float tau_ta, dmod, alim;     ///< parameters used to compute t_conflict
+};
+
+static struct TcasSap tcas_sap;
+
+static void tcas_sap_init(void)
+{
+  uint8_t i;
+  tcas_sap.nb = 0;
+  for (i = 2; i < NB_ACS; i++) {
+    tcas_sap.idx[tcas_sap.nb++] = i;
+    tcas_sap.t_conflict[i] = 0.f;
+    tcas_sap.itow[i] = 0;
+  }
+  tcas_sap.tau_ta = -1.f; // force update
+}
+
+/* compute the earliest possible conflict time for new reports and sort the list */
+static void tcas_sap_update(float now)
+{
+  uint8_t i;
+  bool all = (tcas_sap.tau_ta != tcas_tau_ta || tcas_sap.dmod != tcas_dmod || tcas_sap.alim != tcas_alim);
+  tcas_sap.tau_ta = tcas_tau_ta;
+  tcas_sap.dmod = tcas_dmod;
+  tcas_sap.alim = tcas_alim;
+  const float r_inside = sqrtf(Square(tcas_dmod) + Square(2 * tcas_alim));
+  struct EnuCoor_f *pos = stateGetPositionEnu_f();
+  for (i = 2; i < NB_ACS; i++) {
+    if (ti_acs[i].ac_id == 0) {
+      tcas_sap.t_conflict[i] = FLT_MAX; // no AC data
+      continue;
+    }
+    if (!all && tcas_sap.itow[i] == ti_acs[i].itow) { continue; } // no new report
+    tcas_sap.itow[i] = ti_acs[i].itow;
+    struct EnuCoor_f *ac_pos = acInfoGetPositionEnu_f(ti_acs[i].ac_id);
+    struct EnuCoor_f *ac_vel = acInfoGetVelocityEnu_f(ti_acs[i].ac_id);
+    float d = sqrtf(Square(ac_pos->x - pos->x) + Square(ac_pos->y - pos->y) + Square(ac_pos->z - pos->z));
+    float v = sqrtf(Square(ac_vel->x) + Square(ac_vel->y) + Square(ac_vel->z)) + TCAS_VMAX;
+    tcas_sap.t_conflict[i] = tcas_sap_conflict_time(now, d, v, tcas_tau_ta, r_inside);
+  }
+  tcas_sap_sort(tcas_sap.idx, tcas_sap.nb, tcas_sap.t_conflict);
+}
+
+#endif /* TCAS_SWEEP_AND_PRUNE */
+
 void tcas_init(void)
 {
   tcas_alt_setpoint = ground_alt + SECURITY_HEIGHT;
@@ -82,6 +165,15 @@ void tcas_init(void)
     tcas_acs_status[i].status = TCAS_NO_ALARM;
     tcas_acs_status[i].resolve = RA_NONE;
   }
+  tcas_stats.nb_monitored = 0;
+  tcas_stats.time = 0;
+  tcas_stats.time_max = 0;
+#if TCAS_SWEEP_AND_PRUNE
+  tcas_sap_init();
+#endif
+#if PERIODIC_TELEMETRY
+  register_periodic_telemetry(DefaultPeriodic, PPRZ_MSG_ID_PAYLOAD_FLOAT, send_tcas_stats);
+#endif
 }
 
 void parseTcasResolve(uint8_t *buf)
@@ -113,9 +205,82 @@ static inline enum tcas_resolve tcas_test_direction(uint8_t id)
 }
 
 
+/* monitor conflict with one aircraft and store closest one */
+static void tcas_monitor(uint8_t i, float vx, float vy, float *tau_min, uint8_t *ac_id_close)
+{
+  if (ti_acs[i].ac_id == 0) { return; } // no AC data
+  uint32_t dt = gps.tow - ti_acs[i].itow;
+  if (dt > 3 * TCAS_DT_MAX) {
+    tcas_acs_status[i].status = TCAS_NO_ALARM; // timeout, reset status
+    return;
+  }
+  if (dt > TCAS_DT_MAX) { return; } // lost com but keep current status
+  struct EnuCoor_f *pos = stateGetPositionEnu_f();
+  struct EnuCoor_f *ac_pos = acInfoGetPositionEnu_f(ti_acs[i].ac_id);
+  struct EnuCoor_f *ac_vel = acInfoGetVelocityEnu_f(ti_acs[i].ac_id);
+  float dx = ac_pos->x - pos->x;
+  float dy = ac_pos->y - pos->y;
+  float dz = ac_pos->z - pos->z;
+  float dvx = vx - ac_vel->x;
+  float dvy = vy - ac_vel->y;
+  float dvz = stateGetSpeedEnu_f()->z - ac_vel->z;
+  float scal = dvx * dx + dvy * dy + dvz * dz;
+  float ddh = dx * dx + dy * dy;
+  float ddv = dz * dz;
+  float tau = TCAS_HUGE_TAU;
+  if (scal > 0.) { tau = (ddh + ddv) / scal; }
+  // monitor conflicts
+  uint8_t inside = TCAS_IsInside();
+  //enum tcas_resolve test_dir = RA_NONE;
+  switch (tcas_acs_status[i].status) {
+    case TCAS_RA:
+      if (tau >= TCAS_HUGE_TAU && !inside) {
+        tcas_acs_status[i].status = TCAS_NO_ALARM; // conflict is now resolved
+        tcas_acs_status[i].resolve = RA_NONE;
+        DOWNLINK_SEND_TCAS_RESOLVED(DefaultChannel, DefaultDevice, &(ti_acs[i].ac_id));
+      }
+      break;
+    case TCAS_TA:
+      if (tau < tcas_tau_ra || inside) {
+        tcas_acs_status[i].status = TCAS_RA; // TA -> RA
+        // Downlink alert
+        //test_dir = tcas_test_direction(ti_acs[i].ac_id);
+        //DOWNLINK_SEND_TCAS_RA(DefaultChannel, DefaultDevice,&(ti_acs[i].ac_id),&test_dir);// FIXME only one closest AC ???
+        break;
+      }
+      if (tau > tcas_tau_ta && !inside) {
+        tcas_acs_status[i].status = TCAS_NO_ALARM;  // conflict is now resolved
+      }
+      tcas_acs_status[i].resolve = RA_NONE;
+      DOWNLINK_SEND_TCAS_RESOLVED(DefaultChannel, DefaultDevice, &(ti_acs[i].ac_id));
+      break;
+    case TCAS_NO_ALARM:
+      if (tau < tcas_tau_ta || inside) {
+        tcas_acs_status[i].status = TCAS_TA; // NO_ALARM -> TA
+        // Downlink warning
+        DOWNLINK_SEND_TCAS_TA(DefaultChannel, DefaultDevice, &(ti_acs[i].ac_id));
+      }
+      if (tau < tcas_tau_ra || inside) {
+        tcas_acs_status[i].status = TCAS_RA; // NO_ALARM -> RA = big problem ?
+        // Downlink alert
+        //test_dir = tcas_test_direction(ti_acs[i].ac_id);
+        //DOWNLINK_SEND_TCAS_RA(DefaultChannel, DefaultDevice,&(ti_acs[i].ac_id),&test_dir);
+      }
+      break;
+    default:
+      break;
+  }
+  // store closest AC
+  if (tau < *tau_min) {
+    *tau_min = tau;
+    *ac_id_close = ti_acs[i].ac_id;
+  }
+}
+
 /* conflicts detection and monitoring */
 void tcas_periodic_task_1Hz(void)
 {
+  uint32_t t_start = get_sys_time_usec();
   // no TCAS under security_height
   if (stateGetPositionUtm_f()->alt < ground_alt + SECURITY_HEIGHT) {
     uint8_t i;
@@ -128,73 +293,32 @@ void tcas_periodic_task_1Hz(void)
   uint8_t i;
   float vx = stateGetHorizontalSpeedNorm_f() * sinf(stateGetHorizontalSpeedDir_f());
   float vy = stateGetHorizontalSpeedNorm_f() * cosf(stateGetHorizontalSpeedDir_f());
-  for (i = 2; i < NB_ACS; i++) {
-    if (ti_acs[i].ac_id == 0) { continue; } // no AC data
-    uint32_t dt = gps.tow - ti_acs[i].itow;
-    if (dt > 3 * TCAS_DT_MAX) {
-      tcas_acs_status[i].status = TCAS_NO_ALARM; // timeout, reset status
-      continue;
-    }
-    if (dt > TCAS_DT_MAX) { continue; } // lost com but keep current status
-    float dx = acInfoGetPositionEnu_f(ti_acs[i].ac_id)->x - stateGetPositionEnu_f()->x;
-    float dy = acInfoGetPositionEnu_f(ti_acs[i].ac_id)->y - stateGetPositionEnu_f()->y;
-    float dz = acInfoGetPositionEnu_f(ti_acs[i].ac_id)->z - stateGetPositionEnu_f()->z;
-    float dvx = vx - acInfoGetVelocityEnu_f(ti_acs[i].ac_id)->x;
-    float dvy = vy - acInfoGetVelocityEnu_f(ti_acs[i].ac_id)->y;
-    float dvz = stateGetSpeedEnu_f()->z - acInfoGetVelocityEnu_f(ti_acs[i].ac_id)->z;
-    float scal = dvx * dx + dvy * dy + dvz * dz;
-    float ddh = dx * dx + dy * dy;
-    float ddv = dz * dz;
-    float tau = TCAS_HUGE_TAU;
-    if (scal > 0.) { tau = (ddh + ddv) / scal; }
-    // monitor conflicts
-    uint8_t inside = TCAS_IsInside();
-    //enum tcas_resolve test_dir = RA_NONE;
-    switch (tcas_acs_status[i].status) {
-      case TCAS_RA:
-        if (tau >= TCAS_HUGE_TAU && !inside) {
-          tcas_acs_status[i].status = TCAS_NO_ALARM; // conflict is now resolved
-          tcas_acs_status[i].resolve = RA_NONE;
-          DOWNLINK_SEND_TCAS_RESOLVED(DefaultChannel, DefaultDevice, &(ti_acs[i].ac_id));
-        }
-        break;
-      case TCAS_TA:
-        if (tau < tcas_tau_ra || inside) {
-          tcas_acs_status[i].status = TCAS_RA; // TA -> RA
-          // Downlink alert
-          //test_dir = tcas_test_direction(ti_acs[i].ac_id);
-          //DOWNLINK_SEND_TCAS_RA(DefaultChannel, DefaultDevice,&(ti_acs[i].ac_id),&test_dir);// FIXME only one closest AC ???
-          break;
-        }
-        if (tau > tcas_tau_ta && !inside) {
-          tcas_acs_status[i].status = TCAS_NO_ALARM;  // conflict is now resolved
-        }
-        tcas_acs_status[i].resolve = RA_NONE;
-        DOWNLINK_SEND_TCAS_RESOLVED(DefaultChannel, DefaultDevice, &(ti_acs[i].ac_id));
-        break;
-      case TCAS_NO_ALARM:
-        if (tau < tcas_tau_ta || inside) {
-          tcas_acs_status[i].status = TCAS_TA; // NO_ALARM -> TA
-          // Downlink warning
-          DOWNLINK_SEND_TCAS_TA(DefaultChannel, DefaultDevice, &(ti_acs[i].ac_id));
-        }
-        if (tau < tcas_tau_ra || inside) {
-          tcas_acs_status[i].status = TCAS_RA; // NO_ALARM -> RA = big problem ?
-          // Downlink alert
-          //test_dir = tcas_test_direction(ti_acs[i].ac_id);
-          //DOWNLINK_SEND_TCAS_RA(DefaultChannel, DefaultDevice,&(ti_acs[i].ac_id),&test_dir);
-        }
-        break;
-      default:
-        break;
-    }
-    // store closest AC
-    if (tau < tau_min) {
-      tau_min = tau;
-      ac_id_close = ti_acs[i].ac_id;
-
+  tcas_stats.nb_monitored = 0;
+#if TCAS_SWEEP_AND_PRUNE
+  float now = get_sys_time_float();
+  tcas_sap_update(now);
+  uint8_t k;
+  // sweep the aircraft for which a conflict is possible
+  for (k = 0; k < tcas_sap.nb; k++) {
+    i = tcas_sap.idx[k];
+    if (tcas_sap.t_conflict[i] > now) { break; }
+    tcas_monitor(i, vx, vy, &tau_min, &ac_id_close);
+    tcas_stats.nb_monitored++;
+  }
+  // aircraft with an alarm are monitored until resolved
+  for (; k < tcas_sap.nb; k++) {
+    i = tcas_sap.idx[k];
+    if (tcas_acs_status[i].status != TCAS_NO_ALARM) {
+      tcas_monitor(i, vx, vy, &tau_min, &ac_id_close);
+      tcas_stats.nb_monitored++;
     }
   }
+#else
+  for (i = 2; i < NB_ACS; i++) {
+    tcas_monitor(i, vx, vy, &tau_min, &ac_id_close);
+    tcas_stats.nb_monitored++;
+  }
+#endif
   // set current conflict mode
   if (tcas_status == TCAS_RA && tcas_ac_RA != AC_ID && tcas_acs_status[ti_acs_id[tcas_ac_RA]].status == TCAS_RA) {
     ac_id_close = tcas_ac_RA; // keep RA until resolved
@@ -229,6 +353,10 @@ void tcas_periodic_task_1Hz(void)
 #ifdef TCAS_DEBUG
   if (tcas_status == TCAS_RA) { DOWNLINK_SEND_TCAS_DEBUG(DefaultChannel, DefaultDevice, &ac_id_close, &tau_min); }
 #endif
+  tcas_stats.time = get_sys_time_usec() - t_start;
+  if (tcas_stats.time > tcas_stats.time_max) {
+    tcas_stats.time_max = tcas_stats.time;
+  }
 }
 
 
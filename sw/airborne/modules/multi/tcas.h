@@ -53,6 +53,20 @@ struct tcas_ac_status {
 
 extern struct tcas_ac_status tcas_acs_status[NB_ACS];
 
+/** Use sweep and prune to monitor only the aircraft for which a conflict
+ *  is possible, FALSE to monitor all aircraft at each call */
+#ifndef TCAS_SWEEP_AND_PRUNE
+#define TCAS_SWEEP_AND_PRUNE TRUE
+#endif
+
+struct TcasStats {
+  uint8_t nb_monitored;   ///< number of aircraft monitored at last call
+  uint32_t time;          ///< duration of last conflict detection (us)
+  uint32_t time_max;      ///< max duration of conflict detection (us)
+};
+
+extern struct TcasStats tcas_stats;
+
 extern void tcas_init(void);
 extern void tcas_periodic_task_1Hz(void);
 extern void tcas_periodic_task_4Hz(void);
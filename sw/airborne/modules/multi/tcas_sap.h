@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/multi/tcas_sap.h"
+ * Sweep and prune helpers of the TCAS conflict detection
+ *
+ * A conflict with an aircraft (tau below tau_ta, or inside the protected
+ * volume) needs the distance to be below max(tau_ta * v, r_inside), where v
+ * bounds the closing speed. Since the distance can't decrease faster than v,
+ * no conflict is possible before the time returned by tcas_sap_conflict_time.
+ */
+
+#ifndef TCAS_SAP_H
+#define TCAS_SAP_H
+
+#include "std.h"
+
+/** Earliest possible conflict time
+ * @param t_report time of the report (s)
+ * @param d distance to the aircraft at t_report (m)
+ * @param v bound of the closing speed, aircraft speed plus own max speed (m/s)
+ * @param tau_ta traffic advisory time (s)
+ * @param r_inside radius of a sphere containing the protected volume (m)
+ * @return time before which no conflict is possible (s)
+ */
+static inline float tcas_sap_conflict_time(float t_report, float d, float v, float tau_ta, float r_inside)
+{
+  float r = Max(tau_ta * v, r_inside);
+  return t_report + (d - r) / v;
+}
+
+/** Sort aircraft indexes by conflict time
+ *  Insertion sort, the list is almost sorted from the last call.
+ * @param idx aircraft indexes
+ * @param nb number of indexes
+ * @param t_conflict conflict time of each aircraft, indexed by aircraft index
+ */
+static inline void tcas_sap_sort(uint8_t *idx, uint8_t nb, const float *t_conflict)
+{
+  uint8_t j, k;
+  for (k = 1; k < nb; k++) {
+    uint8_t id = idx[k];
+    float t = t_conflict[id];
+    for (j = k; j > 0 && t_conflict[idx[j - 1]] > t; j--) {
+      idx[j] = idx[j - 1];
+    }
+    idx[j] = id;
+  }
+}
+
+#endif /* TCAS_SAP_H */
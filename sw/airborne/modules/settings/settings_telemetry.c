@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/settings/settings_telemetry.c"
+ * Change driven telemetry of the settings values (DL_VALUE)
+ */
+
+#include "modules/settings/settings_telemetry.h"
+#include "generated/airframe.h"
+#include "generated/settings.h"
+#include "mcu_periph/sys_time.h"
+#include "pprzlink/messages.h"
+
+#ifndef SETTINGS_TELEMETRY_MODE
+#define SETTINGS_TELEMETRY_MODE SETTINGS_TELEMETRY_ON_CHANGE
+#endif
+
+#ifndef SETTINGS_TELEMETRY_MAX_PER_CALL
+#define SETTINGS_TELEMETRY_MAX_PER_CALL 4
+#endif
+
+#ifndef SETTINGS_TELEMETRY_REFRESH_DIV
+#define SETTINGS_TELEMETRY_REFRESH_DIV 4
+#endif
+
+/** Gain of the first order filters of the measurements */
+#ifndef SETTINGS_TELEMETRY_FILTER
+#define SETTINGS_TELEMETRY_FILTER 0.1f
+#endif
+
+struct SettingsTelemetry settings_telemetry;
+
+#if NB_SETTING > 0
+
+static float shadow[NB_SETTING];
+static float change_time[NB_SETTING];
+static uint32_t dirty[SETTINGS_DIRTY_SIZE];
+static uint16_t cursor;       ///< where to start the search of the next changed value
+static uint16_t refresh_idx;  ///< next value of the background refresh / round robin
+static uint8_t refresh_cnt;
+static float last_time;
+
+/** Find the next changed value, starting from the cursor
+ * @return index or -1 if none
+ */
+static int next_dirty(void)
+{
+  uint16_t w = cursor / 32;
+  uint32_t word = dirty[w] & (0xFFFFFFFF << (cursor % 32));
+  uint16_t n;
+  for (n = 0; n <= SETTINGS_DIRTY_SIZE; n++) {
+    if (word != 0) {
+      return w * 32 + __builtin_ctz(word);
+    }
+    w = (w + 1) % SETTINGS_DIRTY_SIZE;
+    word = dirty[w];
+  }
+  return -1;
+}
+
+/** Send one value
+ * @return false if the link could not take it
+ */
+static bool send_value(struct transport_tx *trans, struct link_device *dev, uint16_t i, float now)
+{
+  uint8_t ovrn = dev->nb_ovrn;
+  uint8_t idx = i;
+  float var = settings_get_value(idx);
+  pprz_msg_send_DL_VALUE(trans, dev, AC_ID, &idx, &var);
+  if (dev->nb_ovrn != ovrn) {
+    return false;
+  }
+  settings_telemetry.nb_values++;
+  if (dirty[i / 32] & (1u << (i % 32))) {
+    dirty[i / 32] &= ~(1u << (i % 32));
+    float latency = now - change_time[i];
+    settings_telemetry.latency += SETTINGS_TELEMETRY_FILTER * (latency - settings_telemetry.latency);
+    if (latency > settings_telemetry.latency_max) {
+      settings_telemetry.latency_max = latency;
+    }
+  }
+  return true;
+}
+
+void settings_telemetry_init(void)
+{
+  settings_telemetry.mode = SETTINGS_TELEMETRY_MODE;
+  settings_telemetry.max_per_call = SETTINGS_TELEMETRY_MAX_PER_CALL;
+  settings_telemetry.refresh_div = SETTINGS_TELEMETRY_REFRESH_DIV;
+  settings_telemetry_reset_stats(true);
+  // initial values are sent by the background refresh
+  settings_check_changes(shadow, dirty);
+  uint16_t i;
+  for (i = 0; i < SETTINGS_DIRTY_SIZE; i++) {
+    dirty[i] = 0;
+  }
+  cursor = 0;
+  refresh_idx = 0;
+  refresh_cnt = 0;
+  last_time = get_sys_time_float();
+}
+
+void settings_telemetry_send(struct transport_tx *trans, struct link_device *dev)
+{
+  float now = get_sys_time_float();
+  uint32_t bytes = dev->nb_bytes;
+  uint16_t i;
+
+  // update the dirty bitmap and time stamp the new changes
+  uint32_t before[SETTINGS_DIRTY_SIZE];
+  for (i = 0; i < SETTINGS_DIRTY_SIZE; i++) {
+    before[i] = dirty[i];
+  }
+  settings_check_changes(shadow, dirty);
+  for (i = 0; i < SETTINGS_DIRTY_SIZE; i++) {
+    uint32_t changed = dirty[i] & ~before[i];
+    while (changed != 0) {
+      uint16_t b = __builtin_ctz(changed);
+      change_time[i * 32 + b] = now;
+      settings_telemetry.nb_changes++;
+      changed &= changed - 1;
+    }
+  }
+
+  if (settings_telemetry.mode == SETTINGS_TELEMETRY_ROUND_ROBIN) {
+    // one value per call, as the generated PeriodicSendDlValue
+    send_value(trans, dev, refresh_idx, now);
+    refresh_idx = (refresh_idx + 1) % NB_SETTING;
+  } else {
+    // changed values first
+    uint8_t nb = 0;
+    int idx;
+    while (nb < settings_telemetry.max_per_call && (idx = next_dirty()) >= 0) {
+      if (!send_value(trans, dev, idx, now)) {
+        break; // link full, try again next time
+      }
+      cursor = (idx + 1) % NB_SETTING;
+      nb++;
+    }
+    // slow background refresh
+    if (nb == 0 && ++refresh_cnt >= settings_telemetry.refresh_div) {
+      refresh_cnt = 0;
+      if (send_value(trans, dev, refresh_idx, now)) {
+        refresh_idx = (refresh_idx + 1) % NB_SETTING;
+      }
+    }
+  }
+
+  // bandwidth measurement
+  bytes = dev->nb_bytes - bytes;
+  settings_telemetry.nb_bytes += bytes;
+  float dt = now - last_time;
+  if (dt > 0.f) {
+    settings_telemetry.bandwidth += SETTINGS_TELEMETRY_FILTER * (bytes / dt - settings_telemetry.bandwidth);
+  }
+  last_time = now;
+}
+
+#else
+
+void settings_telemetry_init(void)
+{
+  settings_telemetry_reset_stats(true);
+}
+
+void settings_telemetry_send(struct transport_tx *trans __attribute__((unused)),
+                             struct link_device *dev __attribute__((unused)))
+{
+}
+
+#endif
+
+void settings_telemetry_reset_stats(uint8_t reset)
+{
+  settings_telemetry.reset_stats = 0;
+  if (reset) {
+    settings_telemetry.nb_values = 0;
+    settings_telemetry.nb_changes = 0;
+    settings_telemetry.nb_bytes = 0;
+    settings_telemetry.latency = 0.f;
+    settings_telemetry.latency_max = 0.f;
+    settings_telemetry.bandwidth = 0.f;
+  }
+}
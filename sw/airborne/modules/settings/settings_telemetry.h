@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file "modules/settings/settings_telemetry.h"
+ * Change driven telemetry of the settings values (DL_VALUE)
+ *
+ * The generated settings code keeps a shadow copy of each value and a dirty
+ * bitmap. Changed values are sent first, several per call as long as
+ * the link accepts them. When nothing changed, the values are refreshed
+ * in the background at a lower rate.
+ * The legacy round robin scheme can be selected at runtime, with the same
+ * latency and bandwidth measurements for comparison.
+ */
+
+#ifndef SETTINGS_TELEMETRY_H
+#define SETTINGS_TELEMETRY_H
+
+#include "std.h"
+#include "pprzlink/pprzlink_transport.h"
+
+#define SETTINGS_TELEMETRY_ON_CHANGE    0
+#define SETTINGS_TELEMETRY_ROUND_ROBIN  1
+
+struct SettingsTelemetry {
+  uint8_t mode;           ///< SETTINGS_TELEMETRY_ON_CHANGE or SETTINGS_TELEMETRY_ROUND_ROBIN
+  uint8_t max_per_call;   ///< max number of changed values sent per call
+  uint8_t refresh_div;    ///< one background refresh value every refresh_div calls without change
+  uint8_t reset_stats;    ///< setting to reset the measurements, always back to 0
+  uint32_t nb_values;     ///< number of values sent
+  uint32_t nb_changes;    ///< number of values that changed since their last telemetry
+  uint32_t nb_bytes;      ///< number of bytes sent
+  float latency;          ///< average time between a change and its telemetry (s)
+  float latency_max;      ///< max time between a change and its telemetry (s)
+  float bandwidth;        ///< average bandwidth used (bytes/s)
+};
+
+extern struct SettingsTelemetry settings_telemetry;
+
+extern void settings_telemetry_init(void);
+
+/** Send the settings values, replaces PeriodicSendDlValue when the module is loaded */
+extern void settings_telemetry_send(struct transport_tx *trans, struct link_device *dev);
+
+/** Reset the measurements */
+extern void settings_telemetry_reset_stats(uint8_t reset);
+
+#endif /* SETTINGS_TELEMETRY_H */
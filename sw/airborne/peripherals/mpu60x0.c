@@ -73,6 +73,7 @@ void mpu60x0_set_default_config(struct Mpu60x0Config *c)
    * Increase to include slave data.
    */
   c->nb_bytes = 15;
+  c->fifo_enable = false;
   c->nb_slaves = 0;
   c->nb_slave_init = 0;
 
@@ -149,6 +150,28 @@ void mpu60x0_send_config(Mpu60x0ConfigSet mpu_set, void *mpu, struct Mpu60x0Conf
       }
       config->init_status++;
       break;
+    case MPU60X0_CONF_FIFO_EN:
+      /* samples of the I2C slaves are not stored in the FIFO */
+      if (config->nb_slaves > 0) {
+        config->fifo_enable = false;
+      }
+      /* store accel and gyro samples in the FIFO */
+      if (config->fifo_enable) {
+        mpu_set(mpu, MPU60X0_REG_FIFO_EN, ((1 << MPU60X0_XG_FIFO_EN) |
+                                           (1 << MPU60X0_YG_FIFO_EN) |
+                                           (1 << MPU60X0_ZG_FIFO_EN) |
+                                           (1 << MPU60X0_ACCEL_FIFO_EN)));
+      }
+      config->init_status++;
+      break;
+    case MPU60X0_CONF_FIFO_USER:
+      /* reset and enable the FIFO */
+      if (config->fifo_enable) {
+        mpu_set(mpu, MPU60X0_REG_USER_CTRL, ((1 << MPU60X0_FIFO_EN) |
+                                             (1 << MPU60X0_FIFO_RESET)));
+      }
+      config->init_status++;
+      break;
     case MPU60X0_CONF_DONE:
       config->initialized = true;
       break;
@@ -122,6 +122,8 @@ enum Mpu60x0ConfStatus {
   MPU60X0_CONF_I2C_SLAVES,
   MPU60X0_CONF_INT_ENABLE,
   MPU60X0_CONF_UNDOC1,
+  MPU60X0_CONF_FIFO_EN,
+  MPU60X0_CONF_FIFO_USER,
   MPU60X0_CONF_DONE
 };
 
@@ -145,6 +147,7 @@ struct Mpu60x0Config {
   bool drdy_int_enable;               ///< Enable Data Ready Interrupt
   uint8_t clk_sel;                      ///< Clock select
   uint8_t nb_bytes;                     ///< number of bytes to read starting with MPU60X0_REG_INT_STATUS
+  bool fifo_enable;                     ///< store gyro and accel samples in the FIFO (not with I2C slaves)
   enum Mpu60x0ConfStatus init_status;   ///< init status
   bool initialized;                   ///< config done flag
 
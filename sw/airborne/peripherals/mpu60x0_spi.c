@@ -60,6 +60,10 @@ void mpu60x0_spi_init(struct Mpu60x0_Spi *mpu, struct spi_periph *spi_p, uint8_t
   mpu->config.init_status = MPU60X0_CONF_UNINIT;
 
   mpu->slave_init_status = MPU60X0_SPI_CONF_UNINIT;
+
+  mpu->fifo_status = MPU60X0_SPI_FIFO_COUNT;
+  mpu->fifo_nb = 0;
+  mpu->fifo_overflows = 0;
 }
 
 
@@ -116,20 +120,85 @@ void mpu60x0_spi_read(struct Mpu60x0_Spi *mpu)
 {
   if (mpu->config.initialized && mpu->spi_trans.status == SPITransDone) {
     mpu->spi_trans.output_length = 1;
-    mpu->spi_trans.input_length = 1 + mpu->config.nb_bytes;
-    /* set read bit and multiple byte bit, then address */
-    mpu->tx_buf[0] = MPU60X0_REG_INT_STATUS | MPU60X0_SPI_READ;
+    mpu->spi_trans.input_buf = &(mpu->rx_buf[0]);
+    if (mpu->config.fifo_enable) {
+      /* number of bytes in the FIFO, the samples are read in the event */
+      mpu->fifo_status = MPU60X0_SPI_FIFO_COUNT;
+      mpu->spi_trans.input_length = 3;
+      mpu->tx_buf[0] = MPU60X0_REG_FIFO_COUNT_H | MPU60X0_SPI_READ;
+    } else {
+      mpu->spi_trans.input_length = 1 + mpu->config.nb_bytes;
+      /* set read bit and multiple byte bit, then address */
+      mpu->tx_buf[0] = MPU60X0_REG_INT_STATUS | MPU60X0_SPI_READ;
+    }
     spi_submit(mpu->spi_p, &(mpu->spi_trans));
   }
 }
 
 #define Int16FromBuf(_buf,_idx) ((int16_t)((_buf[_idx]<<8) | _buf[_idx+1]))
 
+static void mpu60x0_spi_fifo_event(struct Mpu60x0_Spi *mpu)
+{
+  uint16_t count, nb, i;
+
+  switch (mpu->fifo_status) {
+    case MPU60X0_SPI_FIFO_COUNT:
+      count = (mpu->rx_buf[1] << 8) | mpu->rx_buf[2];
+      nb = count / MPU60X0_FIFO_SAMPLE_LEN;
+      if (count > MPU60X0_FIFO_SIZE - MPU60X0_FIFO_SAMPLE_LEN) {
+        /* overflow, samples are lost and the next ones may be misaligned */
+        mpu->fifo_overflows++;
+        mpu->fifo_status = MPU60X0_SPI_FIFO_RESET;
+        mpu60x0_spi_write_to_reg(mpu, MPU60X0_REG_USER_CTRL, ((1 << MPU60X0_FIFO_EN) |
+                                                              (1 << MPU60X0_FIFO_RESET)));
+      } else if (nb > 0) {
+        /* the remaining samples are read on next call */
+        if (nb > MPU60X0_FIFO_BURST_MAX) {
+          nb = MPU60X0_FIFO_BURST_MAX;
+        }
+        mpu->fifo_status = MPU60X0_SPI_FIFO_DATA;
+        mpu->spi_trans.output_length = 1;
+        mpu->spi_trans.input_length = 1 + nb * MPU60X0_FIFO_SAMPLE_LEN;
+        mpu->spi_trans.input_buf = &(mpu->fifo_buf[0]);
+        mpu->tx_buf[0] = MPU60X0_REG_FIFO_R_W | MPU60X0_SPI_READ;
+        spi_submit(mpu->spi_p, &(mpu->spi_trans));
+      } else {
+        mpu->spi_trans.status = SPITransDone;
+      }
+      break;
+    case MPU60X0_SPI_FIFO_DATA:
+      /* accel then gyro, in register order */
+      nb = (mpu->spi_trans.input_length - 1) / MPU60X0_FIFO_SAMPLE_LEN;
+      for (i = 0; i < nb; i++) {
+        uint16_t idx = 1 + i * MPU60X0_FIFO_SAMPLE_LEN;
+        mpu->fifo_accel[i][0] = Int16FromBuf(mpu->fifo_buf, idx);
+        mpu->fifo_accel[i][1] = Int16FromBuf(mpu->fifo_buf, idx + 2);
+        mpu->fifo_accel[i][2] = Int16FromBuf(mpu->fifo_buf, idx + 4);
+        mpu->fifo_rates[i][0] = Int16FromBuf(mpu->fifo_buf, idx + 6);
+        mpu->fifo_rates[i][1] = Int16FromBuf(mpu->fifo_buf, idx + 8);
+        mpu->fifo_rates[i][2] = Int16FromBuf(mpu->fifo_buf, idx + 10);
+      }
+      mpu->fifo_nb = nb;
+      /* last sample for the users of the single sample data */
+      memcpy(mpu->data_accel.value, mpu->fifo_accel[nb - 1], sizeof(mpu->data_accel.value));
+      memcpy(mpu->data_rates.value, mpu->fifo_rates[nb - 1], sizeof(mpu->data_rates.value));
+      mpu->data_available = true;
+      mpu->spi_trans.input_buf = &(mpu->rx_buf[0]);
+      mpu->spi_trans.status = SPITransDone;
+      break;
+    default:
+      mpu->spi_trans.status = SPITransDone;
+      break;
+  }
+}
+
 void mpu60x0_spi_event(struct Mpu60x0_Spi *mpu)
 {
   if (mpu->config.initialized) {
     if (mpu->spi_trans.status == SPITransFailed) {
       mpu->spi_trans.status = SPITransDone;
+    } else if (mpu->spi_trans.status == SPITransSuccess && mpu->config.fifo_enable) {
+      mpu60x0_spi_fifo_event(mpu);
     } else if (mpu->spi_trans.status == SPITransSuccess) {
       // Successfull reading
       if (bit_is_set(mpu->rx_buf[1], 0)) {
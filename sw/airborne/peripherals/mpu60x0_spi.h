@@ -39,6 +39,13 @@
 #define MPU60X0_BUFFER_LEN 32
 #define MPU60X0_BUFFER_EXT_LEN 16
 
+/** Max number of samples read from the FIFO at once */
+#ifndef MPU60X0_FIFO_BURST_MAX
+#define MPU60X0_FIFO_BURST_MAX 32
+#endif
+/** Size of a FIFO sample: accel and gyro */
+#define MPU60X0_FIFO_SAMPLE_LEN 12
+
 enum Mpu60x0SpiSlaveInitStatus {
   MPU60X0_SPI_CONF_UNINIT,
   MPU60X0_SPI_CONF_I2C_MST_CLK,
@@ -48,6 +55,12 @@ enum Mpu60x0SpiSlaveInitStatus {
   MPU60X0_SPI_CONF_DONE
 };
 
+enum Mpu60x0SpiFifoStatus {
+  MPU60X0_SPI_FIFO_COUNT,
+  MPU60X0_SPI_FIFO_DATA,
+  MPU60X0_SPI_FIFO_RESET
+};
+
 struct Mpu60x0_Spi {
   struct spi_periph *spi_p;
   struct spi_transaction spi_trans;
@@ -66,6 +79,13 @@ struct Mpu60x0_Spi {
   uint8_t data_ext[MPU60X0_BUFFER_EXT_LEN];
   struct Mpu60x0Config config;
   enum Mpu60x0SpiSlaveInitStatus slave_init_status;
+  /* FIFO read, with config.fifo_enable */
+  volatile uint8_t fifo_buf[1 + MPU60X0_FIFO_BURST_MAX * MPU60X0_FIFO_SAMPLE_LEN];
+  enum Mpu60x0SpiFifoStatus fifo_status;
+  uint8_t fifo_nb;                    ///< number of samples in fifo_accel and fifo_rates, oldest first
+  int16_t fifo_accel[MPU60X0_FIFO_BURST_MAX][3];
+  int16_t fifo_rates[MPU60X0_FIFO_BURST_MAX][3];
+  uint32_t fifo_overflows;            ///< number of FIFO resets after an overflow
 };
 
 // Functions
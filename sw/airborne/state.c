@@ -35,6 +35,18 @@
 
 struct State state;
 
+#if STATE_CONV_STATS
+struct StateConvStats state_conv_stats;
+#endif
+
+/** Mark a representation as tried in the current epoch and count the conversion.
+ *  If the conversion fails, it is not tried again until the next epoch.
+ */
+#define StateConvTry(_type, _repr) {      \
+    SetBit(state._type##_tried, _repr);     \
+    STATE_CONV_COUNT(_type, _repr);         \
+  }
+
 /**
  * @addtogroup state_interface
  * @{
@@ -43,7 +55,11 @@ struct State state;
 void stateInit(void)
 {
   state.pos_status = 0;
+  state.pos_tried = 0;
+  state.pos_epoch = 0;
   state.speed_status = 0;
+  state.speed_tried = 0;
+  state.speed_epoch = 0;
   state.accel_status = 0;
   state.ned_to_body_orientation.status = 0;
   state.rate_status = 0;
@@ -67,9 +83,10 @@ void stateInit(void)
 
 void stateCalcPositionEcef_i(void)
 {
-  if (bit_is_set(state.pos_status, POS_ECEF_I)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_ECEF_I)) {
     return;
   }
+  StateConvTry(pos, POS_ECEF_I);
 
   if (bit_is_set(state.pos_status, POS_ECEF_F)) {
     ECEF_BFP_OF_REAL(state.ecef_pos_i, state.ecef_pos_f);
@@ -99,9 +116,10 @@ void stateCalcPositionEcef_i(void)
 
 void stateCalcPositionNed_i(void)
 {
-  if (bit_is_set(state.pos_status, POS_NED_I)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_NED_I)) {
     return;
   }
+  StateConvTry(pos, POS_NED_I);
 
   int errno = 0;
   if (state.ned_initialized_i) {
@@ -179,9 +197,10 @@ void stateCalcPositionNed_i(void)
 
 void stateCalcPositionEnu_i(void)
 {
-  if (bit_is_set(state.pos_status, POS_ENU_I)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_ENU_I)) {
     return;
   }
+  StateConvTry(pos, POS_ENU_I);
 
   int errno = 0;
   if (state.ned_initialized_i) {
@@ -266,9 +285,10 @@ void stateCalcPositionEnu_i(void)
  */
 void stateCalcPositionLla_i(void)
 {
-  if (bit_is_set(state.pos_status, POS_LLA_I)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_LLA_I)) {
     return;
   }
+  StateConvTry(pos, POS_LLA_I);
 
   int errno = 0;
   if (bit_is_set(state.pos_status, POS_ECEF_I)) {
@@ -364,9 +384,10 @@ void stateCalcPositionLla_i(void)
 
 void stateCalcPositionUtm_f(void)
 {
-  if (bit_is_set(state.pos_status, POS_UTM_F)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_UTM_F)) {
     return;
   }
+  StateConvTry(pos, POS_UTM_F);
 
   if (bit_is_set(state.pos_status, POS_LLA_F)) {
     utm_of_lla_f(&state.utm_pos_f, &state.lla_pos_f);
@@ -401,9 +422,10 @@ void stateCalcPositionUtm_f(void)
 
 void stateCalcPositionEcef_f(void)
 {
-  if (bit_is_set(state.pos_status, POS_ECEF_F)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_ECEF_F)) {
     return;
   }
+  StateConvTry(pos, POS_ECEF_F);
 
   if (bit_is_set(state.pos_status, POS_ECEF_I)) {
     ECEF_FLOAT_OF_BFP(state.ecef_pos_f, state.ecef_pos_i);
@@ -432,9 +454,10 @@ void stateCalcPositionEcef_f(void)
 
 void stateCalcPositionNed_f(void)
 {
-  if (bit_is_set(state.pos_status, POS_NED_F)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_NED_F)) {
     return;
   }
+  StateConvTry(pos, POS_NED_F);
 
   int errno = 0;
   if (state.ned_initialized_f) {
@@ -499,9 +522,10 @@ void stateCalcPositionNed_f(void)
 
 void stateCalcPositionEnu_f(void)
 {
-  if (bit_is_set(state.pos_status, POS_ENU_F)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_ENU_F)) {
     return;
   }
+  StateConvTry(pos, POS_ENU_F);
 
   int errno = 0;
   if (state.ned_initialized_f) {
@@ -572,9 +596,10 @@ void stateCalcPositionEnu_f(void)
 
 void stateCalcPositionLla_f(void)
 {
-  if (bit_is_set(state.pos_status, POS_LLA_F)) {
+  if (bit_is_set(state.pos_status | state.pos_tried, POS_LLA_F)) {
     return;
   }
+  StateConvTry(pos, POS_LLA_F);
 
   int errno = 0;
   if (bit_is_set(state.pos_status, POS_LLA_I)) {
@@ -673,9 +698,10 @@ void stateCalcPositionLla_f(void)
 
 void stateCalcSpeedNed_i(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_NED_I)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_NED_I)) {
     return;
   }
+  StateConvTry(speed, SPEED_NED_I);
 
   int errno = 0;
   if (state.ned_initialized_i) {
@@ -723,9 +749,10 @@ void stateCalcSpeedNed_i(void)
 
 void stateCalcSpeedEnu_i(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_ENU_I)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_ENU_I)) {
     return;
   }
+  StateConvTry(speed, SPEED_ENU_I);
 
   int errno = 0;
   if (state.ned_initialized_i) {
@@ -775,9 +802,10 @@ void stateCalcSpeedEnu_i(void)
 
 void stateCalcSpeedEcef_i(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_ECEF_I)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_ECEF_I)) {
     return;
   }
+  StateConvTry(speed, SPEED_ECEF_I);
 
   if (bit_is_set(state.speed_status, SPEED_ECEF_F)) {
     SPEEDS_BFP_OF_REAL(state.ecef_speed_i, state.ecef_speed_f);
@@ -800,9 +828,10 @@ void stateCalcSpeedEcef_i(void)
 
 void stateCalcHorizontalSpeedNorm_i(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_HNORM_I)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_HNORM_I)) {
     return;
   }
+  StateConvTry(speed, SPEED_HNORM_I);
 
   if (bit_is_set(state.speed_status, SPEED_HNORM_F)) {
     state.h_speed_norm_i = SPEED_BFP_OF_REAL(state.h_speed_norm_f);
@@ -846,9 +875,10 @@ void stateCalcHorizontalSpeedNorm_i(void)
 
 void stateCalcHorizontalSpeedDir_i(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_HDIR_I)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_HDIR_I)) {
     return;
   }
+  StateConvTry(speed, SPEED_HDIR_I);
 
   if (bit_is_set(state.speed_status, SPEED_HDIR_F)) {
     state.h_speed_dir_i = SPEED_BFP_OF_REAL(state.h_speed_dir_f);
@@ -877,9 +907,10 @@ void stateCalcHorizontalSpeedDir_i(void)
 
 void stateCalcSpeedNed_f(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_NED_F)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_NED_F)) {
     return;
   }
+  StateConvTry(speed, SPEED_NED_F);
 
   int errno = 0;
   if (state.ned_initialized_f) {
@@ -927,9 +958,10 @@ void stateCalcSpeedNed_f(void)
 
 void stateCalcSpeedEnu_f(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_ENU_F)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_ENU_F)) {
     return;
   }
+  StateConvTry(speed, SPEED_ENU_F);
 
   int errno = 0;
   if (state.ned_initialized_f) {
@@ -977,9 +1009,10 @@ void stateCalcSpeedEnu_f(void)
 
 void stateCalcSpeedEcef_f(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_ECEF_F)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_ECEF_F)) {
     return;
   }
+  StateConvTry(speed, SPEED_ECEF_F);
 
   if (bit_is_set(state.speed_status, SPEED_ECEF_I)) {
     SPEEDS_FLOAT_OF_BFP(state.ecef_speed_f, state.ned_speed_i);
@@ -1002,9 +1035,10 @@ void stateCalcSpeedEcef_f(void)
 
 void stateCalcHorizontalSpeedNorm_f(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_HNORM_F)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_HNORM_F)) {
     return;
   }
+  StateConvTry(speed, SPEED_HNORM_F);
 
   if (bit_is_set(state.speed_status, SPEED_HNORM_I)) {
     state.h_speed_norm_f = SPEED_FLOAT_OF_BFP(state.h_speed_norm_i);
@@ -1029,9 +1063,10 @@ void stateCalcHorizontalSpeedNorm_f(void)
 
 void stateCalcHorizontalSpeedDir_f(void)
 {
-  if (bit_is_set(state.speed_status, SPEED_HDIR_F)) {
+  if (bit_is_set(state.speed_status | state.speed_tried, SPEED_HDIR_F)) {
     return;
   }
+  StateConvTry(speed, SPEED_HDIR_F);
 
   if (bit_is_set(state.speed_status, SPEED_HDIR_I)) {
     state.h_speed_dir_f = SPEED_FLOAT_OF_BFP(state.h_speed_dir_i);
@@ -1338,4 +1373,27 @@ void stateCalcAirspeed_f(void)
 }
 /** @}*/
 
+
+
+/******************************************************************************
+ *                                                                            *
+ * statistics of the conversions                                              *
+ *                                                                            *
+ *****************************************************************************/
+
+void stateConvStatsPeriodic(void)
+{
+#if STATE_CONV_STATS
+  uint8_t i;
+  for (i = 0; i < POS_REPR_NB; i++) {
+    state_conv_stats.pos_per_s[i] = state_conv_stats.pos[i];
+    state_conv_stats.pos[i] = 0;
+  }
+  for (i = 0; i < SPEED_REPR_NB; i++) {
+    state_conv_stats.speed_per_s[i] = state_conv_stats.speed[i];
+    state_conv_stats.speed[i] = 0;
+  }
+#endif
+}
+
 /** @}*/
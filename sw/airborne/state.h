@@ -53,6 +53,8 @@
  * call: stateGetPositionLla_f() and only then the LLA float position representation
  * is calculated on the fly and returned. It's also only calculated once,
  * until a new position is set which invalidates all the other representations again.
+ * Each set starts a new epoch (see stateGetPositionEpoch()), a conversion that
+ * can't be done (e.g. local origin not set) is only tried once per epoch.
  */
 
 /**
@@ -74,6 +76,7 @@
 #define POS_ENU_F  7
 #define POS_LLA_F  8
 #define POS_UTM_F  9
+#define POS_REPR_NB 10
 #define POS_LOCAL_COORD ((1<<POS_NED_I)|(1<<POS_NED_F)|(1<<POS_ENU_I)|(1<<POS_ENU_F))
 #define POS_GLOBAL_COORD ((1<<POS_ECEF_I)|(1<<POS_ECEF_F)|(1<<POS_LLA_I)|(1<<POS_LLA_F)|(1<<POS_UTM_I)|(1<<POS_UTM_F))
 /**@}*/
@@ -92,6 +95,7 @@
 #define SPEED_ENU_F   7
 #define SPEED_HNORM_F 8
 #define SPEED_HDIR_F  9
+#define SPEED_REPR_NB 10
 #define SPEED_LOCAL_COORD ((1<<SPEED_NED_I)|(1<<SPEED_ENU_I)|(1<<SPEED_NED_F)|(1<<SPEED_ENU_F))
 /**@}*/
 
@@ -143,6 +147,17 @@ struct State {
    */
   uint16_t pos_status;
 
+  /**
+   * Position representations already computed or tried in the current epoch.
+   * A conversion that failed is not tried again until the next epoch.
+   */
+  uint16_t pos_tried;
+
+  /**
+   * Position epoch, incremented each time the position or the origin is set.
+   */
+  uint32_t pos_epoch;
+
   /**
    * Position in EarthCenteredEarthFixed coordinates.
    * Units: centimeters
@@ -260,6 +275,16 @@ struct State {
    */
   uint16_t speed_status;
 
+  /**
+   * Speed representations already computed or tried in the current epoch.
+   */
+  uint16_t speed_tried;
+
+  /**
+   * Speed epoch, incremented each time the speed or the origin is set.
+   */
+  uint32_t speed_epoch;
+
   /**
    * Velocity in EarthCenteredEarthFixed coordinates.
    * Units: m/s in BFP with #INT32_SPEED_FRAC
@@ -450,6 +475,58 @@ extern struct State state;
 
 extern void stateInit(void);
 
+/** Start a new position epoch, only the given representations are valid */
+static inline void stateNewPositionEpoch(uint16_t status)
+{
+  state.pos_status = status;
+  state.pos_tried = 0;
+  state.pos_epoch++;
+}
+
+/** Start a new speed epoch, only the given representations are valid */
+static inline void stateNewSpeedEpoch(uint16_t status)
+{
+  state.speed_status = status;
+  state.speed_tried = 0;
+  state.speed_epoch++;
+}
+
+/// Get the position epoch, to know if the position changed since the last read.
+static inline uint32_t stateGetPositionEpoch(void)
+{
+  return state.pos_epoch;
+}
+
+/// Get the speed epoch, to know if the speed changed since the last read.
+static inline uint32_t stateGetSpeedEpoch(void)
+{
+  return state.speed_epoch;
+}
+
+/** Conversion statistics.
+ * When STATE_CONV_STATS is TRUE, the conversions of each position and speed
+ * representation are counted and stateConvStatsPeriodic (to call at 1Hz)
+ * stores the number of conversions per second in state_conv_stats.
+ */
+#ifndef STATE_CONV_STATS
+#define STATE_CONV_STATS FALSE
+#endif
+
+#if STATE_CONV_STATS
+struct StateConvStats {
+  uint16_t pos[POS_REPR_NB];          ///< conversions in the current second
+  uint16_t speed[SPEED_REPR_NB];
+  uint16_t pos_per_s[POS_REPR_NB];    ///< conversions during the last second
+  uint16_t speed_per_s[SPEED_REPR_NB];
+};
+extern struct StateConvStats state_conv_stats;
+#define STATE_CONV_COUNT(_type, _repr) { state_conv_stats._type[_repr]++; }
+#else
+#define STATE_CONV_COUNT(_type, _repr) {}
+#endif
+
+extern void stateConvStatsPeriodic(void);
+
 /** @addtogroup state_position
  *  @{ */
 
@@ -464,8 +541,8 @@ static inline void stateSetLocalOrigin_i(struct LtpDef_i *ltp_def)
   state.ned_origin_f.hmsl = M_OF_MM(state.ned_origin_i.hmsl);
 
   /* clear bits for all local frame representations */
-  state.pos_status &= ~(POS_LOCAL_COORD);
-  state.speed_status &= ~(SPEED_LOCAL_COORD);
+  stateNewPositionEpoch(state.pos_status & ~(POS_LOCAL_COORD));
+  stateNewSpeedEpoch(state.speed_status & ~(SPEED_LOCAL_COORD));
   ClearBit(state.accel_status, ACCEL_NED_I);
   ClearBit(state.accel_status, ACCEL_NED_F);
 
@@ -480,8 +557,8 @@ static inline void stateSetLocalUtmOrigin_f(struct UtmCoor_f *utm_def)
   state.utm_initialized_f = true;
 
   /* clear bits for all local frame representations */
-  state.pos_status &= ~(POS_LOCAL_COORD);
-  state.speed_status &= ~(SPEED_LOCAL_COORD);
+  stateNewPositionEpoch(state.pos_status & ~(POS_LOCAL_COORD));
+  stateNewSpeedEpoch(state.speed_status & ~(SPEED_LOCAL_COORD));
   ClearBit(state.accel_status, ACCEL_NED_I);
   ClearBit(state.accel_status, ACCEL_NED_F);
 }
@@ -524,7 +601,7 @@ static inline void stateSetPositionEcef_i(struct EcefCoor_i *ecef_pos)
 {
   VECT3_COPY(state.ecef_pos_i, *ecef_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_ECEF_I);
+  stateNewPositionEpoch(1 << POS_ECEF_I);
 }
 
 /// Set position from local NED coordinates (int).
@@ -532,7 +609,7 @@ static inline void stateSetPositionNed_i(struct NedCoor_i *ned_pos)
 {
   VECT3_COPY(state.ned_pos_i, *ned_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_NED_I);
+  stateNewPositionEpoch(1 << POS_NED_I);
 }
 
 /// Set position from local ENU coordinates (int).
@@ -540,7 +617,7 @@ static inline void stateSetPositionEnu_i(struct EnuCoor_i *enu_pos)
 {
   VECT3_COPY(state.enu_pos_i, *enu_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_ENU_I);
+  stateNewPositionEpoch(1 << POS_ENU_I);
 }
 
 /// Set position from LLA coordinates (int).
@@ -548,7 +625,7 @@ static inline void stateSetPositionLla_i(struct LlaCoor_i *lla_pos)
 {
   LLA_COPY(state.lla_pos_i, *lla_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_LLA_I);
+  stateNewPositionEpoch(1 << POS_LLA_I);
 }
 
 /// Set multiple position coordinates (int).
@@ -559,7 +636,7 @@ static inline void stateSetPosition_i(
   struct LlaCoor_i *lla_pos)
 {
   /* clear all status bit */
-  state.pos_status = 0;
+  stateNewPositionEpoch(0);
   if (ecef_pos != NULL) {
     VECT3_COPY(state.ecef_pos_i, *ecef_pos);
     state.pos_status |= (1 << POS_ECEF_I);
@@ -583,7 +660,7 @@ static inline void stateSetPositionUtm_f(struct UtmCoor_f *utm_pos)
 {
   state.utm_pos_f = *utm_pos;
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_UTM_F);
+  stateNewPositionEpoch(1 << POS_UTM_F);
 }
 
 /// Set position from ECEF coordinates (float).
@@ -591,7 +668,7 @@ static inline void stateSetPositionEcef_f(struct EcefCoor_f *ecef_pos)
 {
   VECT3_COPY(state.ecef_pos_f, *ecef_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_ECEF_F);
+  stateNewPositionEpoch(1 << POS_ECEF_F);
 }
 
 /// Set position from local NED coordinates (float).
@@ -599,7 +676,7 @@ static inline void stateSetPositionNed_f(struct NedCoor_f *ned_pos)
 {
   VECT3_COPY(state.ned_pos_f, *ned_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_NED_F);
+  stateNewPositionEpoch(1 << POS_NED_F);
 }
 
 /// Set position from local ENU coordinates (float).
@@ -607,7 +684,7 @@ static inline void stateSetPositionEnu_f(struct EnuCoor_f *enu_pos)
 {
   VECT3_COPY(state.enu_pos_f, *enu_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_ENU_F);
+  stateNewPositionEpoch(1 << POS_ENU_F);
 }
 
 /// Set position from LLA coordinates (float).
@@ -615,7 +692,7 @@ static inline void stateSetPositionLla_f(struct LlaCoor_f *lla_pos)
 {
   LLA_COPY(state.lla_pos_f, *lla_pos);
   /* clear bits for all position representations and only set the new one */
-  state.pos_status = (1 << POS_LLA_F);
+  stateNewPositionEpoch(1 << POS_LLA_F);
 }
 
 /// Set multiple position coordinates (float).
@@ -627,7 +704,7 @@ static inline void stateSetPosition_f(
   struct UtmCoor_f *utm_pos)
 {
   /* clear all status bit */
-  state.pos_status = 0;
+  stateNewPositionEpoch(0);
   if (ecef_pos != NULL) {
     VECT3_COPY(state.ecef_pos_f, *ecef_pos);
     state.pos_status |= (1 << POS_ECEF_F);
@@ -764,7 +841,7 @@ static inline void stateSetSpeedNed_i(struct NedCoor_i *ned_speed)
 {
   VECT3_COPY(state.ned_speed_i, *ned_speed);
   /* clear bits for all speed representations and only set the new one */
-  state.speed_status = (1 << SPEED_NED_I);
+  stateNewSpeedEpoch(1 << SPEED_NED_I);
 }
 
 /// Set ground speed in local ENU coordinates (int).
@@ -772,7 +849,7 @@ static inline void stateSetSpeedEnu_i(struct EnuCoor_i *enu_speed)
 {
   VECT3_COPY(state.enu_speed_i, *enu_speed);
   /* clear bits for all speed representations and only set the new one */
-  state.speed_status = (1 << SPEED_ENU_I);
+  stateNewSpeedEpoch(1 << SPEED_ENU_I);
 }
 
 /// Set ground speed in ECEF coordinates (int).
@@ -780,7 +857,7 @@ static inline void stateSetSpeedEcef_i(struct EcefCoor_i *ecef_speed)
 {
   VECT3_COPY(state.ecef_speed_i, *ecef_speed);
   /* clear bits for all speed representations and only set the new one */
-  state.speed_status = (1 << SPEED_ECEF_I);
+  stateNewSpeedEpoch(1 << SPEED_ECEF_I);
 }
 
 /// Set multiple speed coordinates (int).
@@ -790,7 +867,7 @@ static inline void stateSetSpeed_i(
   struct EnuCoor_i *enu_speed)
 {
   /* clear all status bit */
-  state.speed_status = 0;
+  stateNewSpeedEpoch(0);
   if (ecef_speed != NULL) {
     VECT3_COPY(state.ecef_speed_i, *ecef_speed);
     state.speed_status |= (1 << SPEED_ECEF_I);
@@ -810,7 +887,7 @@ static inline void stateSetSpeedNed_f(struct NedCoor_f *ned_speed)
 {
   VECT3_COPY(state.ned_speed_f, *ned_speed);
   /* clear bits for all speed representations and only set the new one */
-  state.speed_status = (1 << SPEED_NED_F);
+  stateNewSpeedEpoch(1 << SPEED_NED_F);
 }
 
 /// Set ground speed in local ENU coordinates (float).
@@ -818,7 +895,7 @@ static inline void stateSetSpeedEnu_f(struct EnuCoor_f *enu_speed)
 {
   VECT3_COPY(state.enu_speed_f, *enu_speed);
   /* clear bits for all speed representations and only set the new one */
-  state.speed_status = (1 << SPEED_ENU_F);
+  stateNewSpeedEpoch(1 << SPEED_ENU_F);
 }
 
 /// Set ground speed in ECEF coordinates (float).
@@ -826,7 +903,7 @@ static inline void stateSetSpeedEcef_f(struct EcefCoor_f *ecef_speed)
 {
   VECT3_COPY(state.ecef_speed_f, *ecef_speed);
   /* clear bits for all speed representations and only set the new one */
-  state.speed_status = (1 << SPEED_ECEF_F);
+  stateNewSpeedEpoch(1 << SPEED_ECEF_F);
 }
 
 /// Set multiple speed coordinates (float).
@@ -836,7 +913,7 @@ static inline void stateSetSpeed_f(
   struct EnuCoor_f *enu_speed)
 {
   /* clear all status bit */
-  state.speed_status = 0;
+  stateNewSpeedEpoch(0);
   if (ecef_speed != NULL) {
     VECT3_COPY(state.ecef_speed_f, *ecef_speed);
     state.speed_status |= (1 << SPEED_ECEF_F);
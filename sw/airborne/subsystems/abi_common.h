@@ -33,6 +33,7 @@
 #include "math/pprz_algebra_int.h"
 #include "math/pprz_algebra_float.h"
 #include "subsystems/gps.h"
+#include "subsystems/imu/imu_batch.h"
 /* Include here headers with structure definition you may want to use with ABI
  * Ex: '#include "subsystems/gps.h"' in order to use the GpsState structure
  */
@@ -73,5 +74,101 @@ typedef struct abi_struct abi_event;
 #define ABI_FOREACH(head,el) for(el=head; el; el=el->next)
 #define ABI_PREPEND(head,add) { (add)->next = head; head = add; }
 
+/** Struct mode.
+ * When ABI_USE_STRUCT is TRUE, subscribers are stored in a contiguous array per
+ * message (size set at build time with ABI_<MSG>_SUBSCRIBERS, default ABI_MAX_SUBSCRIBERS)
+ * and messages are dispatched as a const structure (struct AbiMsg<MSG>).
+ * Callbacks with the arguments list (AbiBindMsg<MSG>) and callbacks with a
+ * pointer to the message structure (AbiBindMsgPtr<MSG>) can be mixed.
+ * Publishers can send a structure with AbiSendMsgPtr<MSG> in both modes.
+ */
+#ifndef ABI_USE_STRUCT
+#define ABI_USE_STRUCT FALSE
+#endif
+
+#if ABI_USE_STRUCT
+
+#ifndef ABI_MAX_SUBSCRIBERS
+#define ABI_MAX_SUBSCRIBERS 8
+#endif
+
+/** Subscriber of a message in struct mode */
+struct abi_subscriber {
+  uint8_t id;           ///< sender id
+  bool ptr;             ///< callback takes a pointer to the message structure
+  abi_callback cb;      ///< callback
+  abi_event *ev;        ///< event used to bind, to find the subscriber when binding again
+};
+
+/** Number of binding failures because a subscriber array is full */
+ABI_EXTERN uint8_t abi_bind_errors;
+
+/** Add a subscriber or update it if the event is already bound */
+static inline void abi_bind_subscriber(struct abi_subscriber *subs, uint8_t *nb, uint8_t size,
+                                       uint8_t sender_id, abi_event *ev, abi_callback cb, bool ptr)
+{
+  uint8_t i = 0;
+  while (i < *nb && subs[i].ev != ev) {
+    i++;
+  }
+  if (i == *nb) {
+    if (*nb == size) {
+      abi_bind_errors++;
+      return;
+    }
+    (*nb)++;
+  }
+  ev->id = sender_id;
+  ev->cb = cb;
+  subs[i].id = sender_id;
+  subs[i].ptr = ptr;
+  subs[i].cb = cb;
+  subs[i].ev = ev;
+}
+
+#endif /* ABI_USE_STRUCT */
+
+/** Statistics.
+ * When ABI_STATS is TRUE, the number of messages sent, the number of callbacks
+ * called and the time spent in dispatch are counted for each message
+ * in abi_stats[ABI_<MSG>_ID].
+ * ABI_STATS_TIME can be redefined to use a cycle counter.
+ */
+#ifndef ABI_STATS
+#define ABI_STATS FALSE
+#endif
+
+#if ABI_STATS
+#include "mcu_periph/sys_time.h"
+
+#ifndef ABI_STATS_TIME
+#define ABI_STATS_TIME() get_sys_time_usec()
+#endif
+
+struct abi_stats {
+  uint32_t publish;     ///< number of messages sent
+  uint32_t dispatch;    ///< number of callbacks called
+  uint32_t time;        ///< total dispatch time (ABI_STATS_TIME unit)
+  uint32_t time_max;    ///< max dispatch time of one message
+};
+
+static inline void abi_stats_end(struct abi_stats *stats, uint32_t t0)
+{
+  uint32_t dt = ABI_STATS_TIME() - t0;
+  stats->time += dt;
+  if (dt > stats->time_max) {
+    stats->time_max = dt;
+  }
+}
+
+#define ABI_STATS_START(_id) uint32_t abi_stats_t0 = ABI_STATS_TIME(); abi_stats[_id].publish++
+#define ABI_STATS_DISPATCH(_id) abi_stats[_id].dispatch++
+#define ABI_STATS_END(_id) abi_stats_end(&abi_stats[_id], abi_stats_t0)
+#else
+#define ABI_STATS_START(_id) {}
+#define ABI_STATS_DISPATCH(_id) {}
+#define ABI_STATS_END(_id) {}
+#endif /* ABI_STATS */
+
 #endif /* ABI_COMMON_H */
 
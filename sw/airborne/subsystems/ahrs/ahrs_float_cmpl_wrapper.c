@@ -34,6 +34,16 @@
 #endif
 PRINT_CONFIG_VAR(AHRS_FC_OUTPUT_ENABLED)
 
+/** if TRUE, propagate once per IMU_BATCH block instead of each gyro message */
+#ifndef AHRS_FC_USE_IMU_BATCH
+#define AHRS_FC_USE_IMU_BATCH FALSE
+#endif
+PRINT_CONFIG_VAR(AHRS_FC_USE_IMU_BATCH)
+
+#if AHRS_FC_USE_IMU_BATCH
+#include "subsystems/imu/imu_batch.h"
+#endif
+
 /** if TRUE with push the estimation results to the state interface */
 static bool ahrs_fc_output_enabled;
 static uint32_t ahrs_fc_last_stamp;
@@ -127,8 +137,12 @@ PRINT_CONFIG_VAR(AHRS_FC_MAG_ID)
 #define AHRS_FC_GPS_ID GPS_MULTI_ID
 #endif
 PRINT_CONFIG_VAR(AHRS_FC_GPS_ID)
+#if AHRS_FC_USE_IMU_BATCH
+static abi_event batch_ev;
+#else
 static abi_event gyro_ev;
 static abi_event accel_ev;
+#endif
 static abi_event mag_ev;
 static abi_event aligner_ev;
 static abi_event body_to_imu_ev;
@@ -136,6 +150,47 @@ static abi_event geo_mag_ev;
 static abi_event gps_ev;
 
 
+#if AHRS_FC_USE_IMU_BATCH
+/** Propagation and accel update once per block of samples.
+ * The increments of the block are summed, so that the propagation keeps
+ * the coning and sculling corrections done at the sensor rate.
+ */
+static void batch_cb(uint8_t __attribute__((unused)) sender_id,
+                     uint32_t stamp, struct ImuBatch *batch)
+{
+  ahrs_fc_last_stamp = stamp;
+  if (!ahrs_fc.is_aligned) {
+    return;
+  }
+
+  float dt = 0.f;
+  struct FloatVect3 angle = { 0.f, 0.f, 0.f };
+  struct FloatVect3 vel = { 0.f, 0.f, 0.f };
+  uint8_t i;
+  for (i = 0; i < batch->nb; i++) {
+    dt += batch->dt[i];
+    VECT3_ADD(angle, batch->delta_angle[i]);
+    VECT3_ADD(vel, batch->delta_vel[i]);
+  }
+  if (dt <= 0.f) {
+    return;
+  }
+
+  /* the block is in body frame, the filter in IMU frame */
+  struct FloatRMat *body_to_imu_rmat = orientationGetRMat_f(&ahrs_fc.body_to_imu);
+  struct FloatRates rates_body = { angle.x / dt, angle.y / dt, angle.z / dt };
+  struct FloatVect3 accel_body;
+  VECT3_SDIV(accel_body, vel, dt);
+  struct FloatRates gyro_f;
+  struct FloatVect3 accel_f;
+  float_rmat_ratemult(&gyro_f, body_to_imu_rmat, &rates_body);
+  float_rmat_vmult(&accel_f, body_to_imu_rmat, &accel_body);
+
+  ahrs_fc_propagate(&gyro_f, dt);
+  compute_body_orientation_and_rates();
+  ahrs_fc_update_accel(&accel_f, dt);
+}
+#else
 static void gyro_cb(uint8_t __attribute__((unused)) sender_id,
                     uint32_t stamp, struct Int32Rates *gyro)
 {
@@ -189,6 +244,7 @@ static void accel_cb(uint8_t __attribute__((unused)) sender_id,
   }
 #endif
 }
+#endif
 
 static void mag_cb(uint8_t __attribute__((unused)) sender_id,
                    uint32_t __attribute__((unused)) stamp,
@@ -289,8 +345,12 @@ void ahrs_fc_register(void)
   /*
    * Subscribe to scaled IMU measurements and attach callbacks
    */
+#if AHRS_FC_USE_IMU_BATCH
+  AbiBindMsgIMU_BATCH(AHRS_FC_IMU_ID, &batch_ev, batch_cb);
+#else
   AbiBindMsgIMU_GYRO_INT32(AHRS_FC_IMU_ID, &gyro_ev, gyro_cb);
   AbiBindMsgIMU_ACCEL_INT32(AHRS_FC_IMU_ID, &accel_ev, accel_cb);
+#endif
   AbiBindMsgIMU_MAG_INT32(AHRS_FC_MAG_ID, &mag_ev, mag_cb);
   AbiBindMsgIMU_LOWPASSED(ABI_BROADCAST, &aligner_ev, aligner_cb);
   AbiBindMsgBODY_TO_IMU_QUAT(ABI_BROADCAST, &body_to_imu_ev, body_to_imu_cb);
@@ -34,7 +34,7 @@
 
 #include "math/pprz_algebra_float.h"
 #include "math/pprz_algebra_int.h"
-#include "math/pprz_rk_float.h"
+#include "math/pprz_integrator_float.h"
 
 #if SEND_INVARIANT_FILTER
 #include "subsystems/datalink/telemetry.h"
@@ -187,12 +187,10 @@ void ahrs_float_invariant_propagate(struct FloatRates* gyro, float dt)
   error_output(&ahrs_float_inv);
 
   // propagate model
-  struct inv_state new_state;
-  runge_kutta_4_float((float *)&new_state,
-                      (float *)&ahrs_float_inv.state, INV_STATE_DIM,
-                      (float *)&ahrs_float_inv.cmd, INV_COMMAND_DIM,
-                      invariant_model, dt);
-  ahrs_float_inv.state = new_state;
+  static float rk4_ws[INTEGRATOR_RK4_WS_SIZE(INV_STATE_DIM)];
+  integrator_rk4_float((float *)&ahrs_float_inv.state, INV_STATE_DIM,
+                       (float *)&ahrs_float_inv.cmd, INV_COMMAND_DIM,
+                       invariant_model, dt, rk4_ws);
 
   // normalize quaternion
   float_quat_normalize(&ahrs_float_inv.state.quat);
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file subsystems/imu/imu_batch.c
+ * Batched IMU ingestion for sensors with a FIFO.
+ */
+
+#include "subsystems/imu/imu_batch.h"
+#include "subsystems/imu.h"
+#include "subsystems/abi.h"
+
+/** Gain of the sample period estimation */
+#ifndef IMU_BATCH_PERIOD_GAIN
+#define IMU_BATCH_PERIOD_GAIN 0.01f
+#endif
+
+/** Max deviation of the sample period from the nominal ODR */
+#ifndef IMU_BATCH_PERIOD_TOL
+#define IMU_BATCH_PERIOD_TOL 0.1f
+#endif
+
+static void imu_batch_integrator_reset(struct ImuBatchIntegrator *integ)
+{
+  integ->nb = 0;
+  integ->dt = 0.f;
+  FLOAT_VECT3_ZERO(integ->alpha);
+  FLOAT_VECT3_ZERO(integ->beta);
+  FLOAT_VECT3_ZERO(integ->vel);
+  FLOAT_VECT3_ZERO(integ->scul);
+}
+
+void imu_batch_init(struct ImuBatchInput *in, uint8_t sender_id, float odr)
+{
+  in->sender_id = sender_id;
+  in->odr = odr;
+  in->period = 1.f / odr;
+  in->last_stamp = 0;
+  in->last_burst = 0;
+  in->initialized = false;
+  in->decimation = IMU_BATCH_DECIMATION;
+  imu_batch_integrator_reset(&in->integ);
+  FLOAT_VECT3_ZERO(in->integ.last_da);
+  FLOAT_VECT3_ZERO(in->integ.last_dv);
+  in->out.nb = 0;
+  in->nb_samples = 0;
+  in->nb_blocks = 0;
+  in->nb_dropped = 0;
+}
+
+void imu_batch_stamps(struct ImuBatchInput *in, uint32_t *stamp, uint8_t nb, uint32_t burst_stamp)
+{
+  if (nb == 0) {
+    return;
+  }
+  const float nominal = 1.f / in->odr;
+  if (in->initialized) {
+    // sample period from the time between two bursts, follows the drift of the sensor clock
+    float period = (burst_stamp - in->last_burst) * 1e-6f / nb;
+    Bound(period, (1.f - IMU_BATCH_PERIOD_TOL) * nominal, (1.f + IMU_BATCH_PERIOD_TOL) * nominal);
+    in->period += IMU_BATCH_PERIOD_GAIN * (period - in->period);
+  } else {
+    in->period = nominal;
+    in->last_stamp = burst_stamp - (uint32_t)(nb * nominal * 1e6f);
+    in->initialized = true;
+  }
+  uint8_t i;
+  for (i = 0; i < nb; i++) {
+    uint32_t s = burst_stamp - (uint32_t)((nb - 1 - i) * in->period * 1e6f + 0.5f);
+    // keep the time stamps increasing
+    if ((int32_t)(s - in->last_stamp) <= 0) {
+      s = in->last_stamp + 1;
+    }
+    stamp[i] = s;
+    in->last_stamp = s;
+  }
+  in->last_burst = burst_stamp;
+}
+
+bool imu_batch_integrate(struct ImuBatchIntegrator *integ, struct FloatRates *gyro,
+                         struct FloatVect3 *accel, float dt, uint8_t decimation)
+{
+  struct FloatVect3 da = { gyro->p * dt, gyro->q * dt, gyro->r * dt };
+  struct FloatVect3 dv = { accel->x * dt, accel->y * dt, accel->z * dt };
+  struct FloatVect3 tmp, cross;
+
+  // coning: beta += 1/2 (alpha + last_da / 6) x da
+  VECT3_SMUL(tmp, integ->last_da, 1.f / 6.f);
+  VECT3_ADD(tmp, integ->alpha);
+  VECT3_CROSS_PRODUCT(cross, tmp, da);
+  VECT3_ADD_SCALED(integ->beta, cross, 0.5f);
+
+  // sculling: scul += 1/2 (alpha x dv + vel x da) + 1/12 (last_da x dv + last_dv x da)
+  VECT3_CROSS_PRODUCT(cross, integ->alpha, dv);
+  VECT3_ADD_SCALED(integ->scul, cross, 0.5f);
+  VECT3_CROSS_PRODUCT(cross, integ->vel, da);
+  VECT3_ADD_SCALED(integ->scul, cross, 0.5f);
+  VECT3_CROSS_PRODUCT(cross, integ->last_da, dv);
+  VECT3_ADD_SCALED(integ->scul, cross, 1.f / 12.f);
+  VECT3_CROSS_PRODUCT(cross, integ->last_dv, da);
+  VECT3_ADD_SCALED(integ->scul, cross, 1.f / 12.f);
+
+  VECT3_ADD(integ->alpha, da);
+  VECT3_ADD(integ->vel, dv);
+  VECT3_COPY(integ->last_da, da);
+  VECT3_COPY(integ->last_dv, dv);
+  integ->dt += dt;
+  integ->nb++;
+  return integ->nb >= decimation;
+}
+
+/** Move the integrated sample to the output block */
+static void imu_batch_output(struct ImuBatchInput *in, uint32_t stamp)
+{
+  struct ImuBatchIntegrator *integ = &in->integ;
+  struct ImuBatch *out = &in->out;
+  uint8_t n = out->nb;
+  struct FloatVect3 rot;
+
+  out->stamp[n] = stamp;
+  out->dt[n] = integ->dt;
+  VECT3_SUM(out->delta_angle[n], integ->alpha, integ->beta);
+  // velocity increment with rotation compensation 1/2 alpha x vel and sculling
+  VECT3_CROSS_PRODUCT(rot, integ->alpha, integ->vel);
+  VECT3_SUM(out->delta_vel[n], integ->vel, integ->scul);
+  VECT3_ADD_SCALED(out->delta_vel[n], rot, 0.5f);
+  RATES_ASSIGN(out->gyro[n], integ->alpha.x / integ->dt, integ->alpha.y / integ->dt, integ->alpha.z / integ->dt);
+  VECT3_SDIV(out->accel[n], integ->vel, integ->dt);
+  out->nb++;
+  imu_batch_integrator_reset(integ);
+}
+
+static void imu_batch_publish(struct ImuBatchInput *in)
+{
+  if (in->out.nb > 0) {
+    AbiSendMsgIMU_BATCH(in->sender_id, in->out.stamp[in->out.nb - 1], &in->out);
+    in->out.nb = 0;
+    in->nb_blocks++;
+  }
+}
+
+void imu_batch_push(struct ImuBatchInput *in, struct Int32Rates *gyro, struct Int32Vect3 *accel,
+                    uint8_t nb, uint32_t burst_stamp)
+{
+  if (nb == 0) {
+    return;
+  }
+  if (nb > IMU_BATCH_BURST_MAX) {
+    // keep the most recent samples, the last one is at burst time
+    uint8_t drop = nb - IMU_BATCH_BURST_MAX;
+    gyro += drop;
+    accel += drop;
+    nb = IMU_BATCH_BURST_MAX;
+    in->nb_dropped += drop;
+  }
+  uint32_t *stamp = in->stamp;
+  imu_batch_stamps(in, stamp, nb, burst_stamp);
+
+  struct FloatRMat *body_to_imu_rmat = orientationGetRMat_f(&imu.body_to_imu);
+  struct Int32Rates gyro_prev = imu.gyro;
+  struct Int32Vect3 accel_prev = imu.accel;
+  struct Int32Rates gyro_sum = { 0, 0, 0 };
+  struct Int32Vect3 accel_sum = { 0, 0, 0 };
+  uint8_t i;
+  for (i = 0; i < nb; i++) {
+    // scaling from the IMU implementation
+    RATES_COPY(imu.gyro_unscaled, gyro[i]);
+    VECT3_COPY(imu.accel_unscaled, accel[i]);
+    imu_scale_gyro(&imu);
+    imu_scale_accel(&imu);
+    RATES_ADD(gyro_sum, imu.gyro);
+    VECT3_ADD(accel_sum, imu.accel);
+
+    // rotation to body frame
+    struct FloatRates gyro_imu, gyro_body;
+    struct FloatVect3 accel_imu, accel_body;
+    RATES_FLOAT_OF_BFP(gyro_imu, imu.gyro);
+    ACCELS_FLOAT_OF_BFP(accel_imu, imu.accel);
+    float_rmat_transp_ratemult(&gyro_body, body_to_imu_rmat, &gyro_imu);
+    float_rmat_transp_vmult(&accel_body, body_to_imu_rmat, &accel_imu);
+
+    if (imu_batch_integrate(&in->integ, &gyro_body, &accel_body, in->period, in->decimation)) {
+      imu_batch_output(in, stamp[i]);
+      if (in->out.nb == IMU_BATCH_SIZE) {
+        imu_batch_publish(in);
+      }
+    }
+  }
+  imu_batch_publish(in);
+  in->nb_samples += nb;
+
+  // mean of the burst for the single sample messages
+  RATES_COPY(imu.gyro_prev, gyro_prev);
+  VECT3_COPY(imu.accel_prev, accel_prev);
+  RATES_SDIV(imu.gyro, gyro_sum, nb);
+  VECT3_SDIV(imu.accel, accel_sum, nb);
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file subsystems/imu/imu_batch.h
+ * Batched IMU ingestion for sensors with a FIFO.
+ *
+ * A driver reads the whole sensor FIFO in one burst and gives the raw samples
+ * to imu_batch_push. The time stamp of each sample is reconstructed from the
+ * burst time and the sample period, which is estimated online to follow the
+ * drift of the sensor clock.
+ * Samples are scaled (with the imu_scale_gyro/accel functions of the IMU),
+ * rotated to the body frame, optionally decimated with coning and sculling
+ * corrected integration, and published as a single block with the IMU_BATCH
+ * ABI message.
+ * The mean of the burst is left in imu.gyro and imu.accel, so that the
+ * driver can still publish IMU_GYRO_INT32 and IMU_ACCEL_INT32 once per burst
+ * for the estimators using them.
+ * The MPU6000 IMU reads its FIFO with IMU_MPU_USE_FIFO, and the float_cmpl AHRS
+ * propagates once per block with AHRS_FC_USE_IMU_BATCH.
+ */
+
+#ifndef IMU_BATCH_H
+#define IMU_BATCH_H
+
+#include "std.h"
+#include "math/pprz_algebra_int.h"
+#include "math/pprz_algebra_float.h"
+
+/** Max number of samples in a block */
+#ifndef IMU_BATCH_SIZE
+#define IMU_BATCH_SIZE 32
+#endif
+
+/** Max number of samples in a burst given to imu_batch_push,
+ *  older samples of a larger burst are dropped.
+ *  The FIFO of the MPU60x0 holds 85 gyro and accel samples.
+ */
+#ifndef IMU_BATCH_BURST_MAX
+#define IMU_BATCH_BURST_MAX 96
+#endif
+
+/** Number of samples integrated in each output sample (1 for no decimation) */
+#ifndef IMU_BATCH_DECIMATION
+#define IMU_BATCH_DECIMATION 1
+#endif
+
+/** Block of samples in body frame.
+ *  With decimation, each output sample is integrated over its interval,
+ *  gyro and accel are then the mean values over the interval.
+ */
+struct ImuBatch {
+  uint8_t nb;                                   ///< number of samples
+  uint32_t stamp[IMU_BATCH_SIZE];               ///< time of the sample, end of interval (us)
+  float dt[IMU_BATCH_SIZE];                     ///< length of the interval (s)
+  struct FloatRates gyro[IMU_BATCH_SIZE];       ///< body rates (rad/s)
+  struct FloatVect3 accel[IMU_BATCH_SIZE];      ///< body specific force (m/s^2)
+  struct FloatVect3 delta_angle[IMU_BATCH_SIZE]; ///< integrated angle with coning correction (rad)
+  struct FloatVect3 delta_vel[IMU_BATCH_SIZE];  ///< integrated velocity with sculling correction (m/s)
+};
+
+/** Integration state between two output samples */
+struct ImuBatchIntegrator {
+  uint8_t nb;                   ///< number of samples integrated
+  float dt;                     ///< integrated time (s)
+  struct FloatVect3 alpha;      ///< sum of angle increments (rad)
+  struct FloatVect3 beta;       ///< coning correction (rad)
+  struct FloatVect3 vel;        ///< sum of velocity increments (m/s)
+  struct FloatVect3 scul;       ///< sculling correction (m/s)
+  struct FloatVect3 last_da;    ///< last angle increment
+  struct FloatVect3 last_dv;    ///< last velocity increment
+};
+
+/** Input of a sensor */
+struct ImuBatchInput {
+  uint8_t sender_id;            ///< ABI sender id of the blocks
+  float odr;                    ///< nominal output data rate of the sensor (Hz)
+  float period;                 ///< estimated sample period (s)
+  uint32_t last_stamp;          ///< time stamp of the last sample (us)
+  uint32_t last_burst;          ///< time of the last burst (us)
+  bool initialized;
+  uint8_t decimation;           ///< number of samples per output sample
+  struct ImuBatchIntegrator integ;
+  struct ImuBatch out;          ///< block being built
+  uint32_t stamp[IMU_BATCH_BURST_MAX]; ///< time stamps of the burst being processed (us)
+  uint32_t nb_samples;          ///< number of samples received
+  uint32_t nb_blocks;           ///< number of blocks published
+  uint32_t nb_dropped;          ///< number of samples dropped from too large bursts
+};
+
+/** Init a sensor input
+ * @param in input
+ * @param sender_id ABI sender id
+ * @param odr nominal output data rate (Hz)
+ */
+extern void imu_batch_init(struct ImuBatchInput *in, uint8_t sender_id, float odr);
+
+/** Reconstruct the time stamps of a burst
+ * The last sample is assumed to be acquired at burst time.
+ * @param in input, the period estimation is updated
+ * @param stamp output time stamps (us)
+ * @param nb number of samples in the burst
+ * @param burst_stamp time of the FIFO read (us)
+ */
+extern void imu_batch_stamps(struct ImuBatchInput *in, uint32_t *stamp, uint8_t nb, uint32_t burst_stamp);
+
+/** Add one sample to an integrator
+ * @return true if decimation samples have been integrated
+ */
+extern bool imu_batch_integrate(struct ImuBatchIntegrator *integ, struct FloatRates *gyro,
+                                struct FloatVect3 *accel, float dt, uint8_t decimation);
+
+/** Process a burst read from the sensor FIFO and publish the block(s)
+ * @param in input
+ * @param gyro unscaled gyro samples in IMU frame (channel order and signs applied), oldest first
+ * @param accel unscaled accel samples in IMU frame
+ * @param nb number of samples, only the last IMU_BATCH_BURST_MAX are used
+ * @param burst_stamp time of the FIFO read (us)
+ */
+extern void imu_batch_push(struct ImuBatchInput *in, struct Int32Rates *gyro, struct Int32Vect3 *accel,
+                           uint8_t nb, uint32_t burst_stamp);
+
+#endif /* IMU_BATCH_H */
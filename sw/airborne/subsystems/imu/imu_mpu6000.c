@@ -102,6 +102,12 @@ PRINT_CONFIG_VAR(IMU_MPU_Y_SIGN)
 #endif
 PRINT_CONFIG_VAR(IMU_MPU_Z_SIGN)
 
+PRINT_CONFIG_VAR(IMU_MPU_USE_FIFO)
+#if IMU_MPU_USE_FIFO
+/** Output data rate, the internal sampling is 8kHz without DLPF */
+#define IMU_MPU_ODR ((IMU_MPU_LOWPASS_FILTER == MPU60X0_DLPF_256HZ ? 8000.f : 1000.f) / (IMU_MPU_SMPLRT_DIV + 1))
+#endif
+
 
 struct ImuMpu6000 imu_mpu_spi;
 
@@ -114,6 +120,10 @@ void imu_mpu_spi_init(void)
   imu_mpu_spi.mpu.config.dlpf_cfg_acc = IMU_MPU_ACCEL_LOWPASS_FILTER; // only for ICM sensors
   imu_mpu_spi.mpu.config.gyro_range = IMU_MPU_GYRO_RANGE;
   imu_mpu_spi.mpu.config.accel_range = IMU_MPU_ACCEL_RANGE;
+#if IMU_MPU_USE_FIFO
+  imu_mpu_spi.mpu.config.fifo_enable = true;
+  imu_batch_init(&imu_mpu_spi.batch, IMU_MPU6000_ID, IMU_MPU_ODR);
+#endif
 }
 
 
@@ -125,6 +135,30 @@ void imu_mpu_spi_periodic(void)
 void imu_mpu_spi_event(void)
 {
   mpu60x0_spi_event(&imu_mpu_spi.mpu);
+#if IMU_MPU_USE_FIFO
+  if (imu_mpu_spi.mpu.data_available && imu_mpu_spi.mpu.config.fifo_enable) {
+    uint32_t now_ts = get_sys_time_usec();
+    static struct Int32Vect3 accel[MPU60X0_FIFO_BURST_MAX];
+    static struct Int32Rates rates[MPU60X0_FIFO_BURST_MAX];
+    uint8_t i;
+
+    // set channel order
+    for (i = 0; i < imu_mpu_spi.mpu.fifo_nb; i++) {
+      accel[i].x = IMU_MPU_X_SIGN * (int32_t)(imu_mpu_spi.mpu.fifo_accel[i][IMU_MPU_CHAN_X]);
+      accel[i].y = IMU_MPU_Y_SIGN * (int32_t)(imu_mpu_spi.mpu.fifo_accel[i][IMU_MPU_CHAN_Y]);
+      accel[i].z = IMU_MPU_Z_SIGN * (int32_t)(imu_mpu_spi.mpu.fifo_accel[i][IMU_MPU_CHAN_Z]);
+      rates[i].p = IMU_MPU_X_SIGN * (int32_t)(imu_mpu_spi.mpu.fifo_rates[i][IMU_MPU_CHAN_X]);
+      rates[i].q = IMU_MPU_Y_SIGN * (int32_t)(imu_mpu_spi.mpu.fifo_rates[i][IMU_MPU_CHAN_Y]);
+      rates[i].r = IMU_MPU_Z_SIGN * (int32_t)(imu_mpu_spi.mpu.fifo_rates[i][IMU_MPU_CHAN_Z]);
+    }
+    imu_mpu_spi.mpu.data_available = false;
+
+    // publish the block, and the mean of the burst for the single sample messages
+    imu_batch_push(&imu_mpu_spi.batch, rates, accel, imu_mpu_spi.mpu.fifo_nb, now_ts);
+    AbiSendMsgIMU_GYRO_INT32(IMU_MPU6000_ID, now_ts, &imu.gyro);
+    AbiSendMsgIMU_ACCEL_INT32(IMU_MPU6000_ID, now_ts, &imu.accel);
+  }
+#endif
   if (imu_mpu_spi.mpu.data_available) {
     uint32_t now_ts = get_sys_time_usec();
 
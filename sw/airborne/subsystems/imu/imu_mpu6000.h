@@ -32,6 +32,12 @@
 #include "subsystems/imu.h"
 
 #include "peripherals/mpu60x0_spi.h"
+#include "subsystems/imu/imu_batch.h"
+
+/** Read the samples from the MPU FIFO and publish them with IMU_BATCH */
+#ifndef IMU_MPU_USE_FIFO
+#define IMU_MPU_USE_FIFO FALSE
+#endif
 
 #ifndef IMU_MPU_GYRO_RANGE
 #define IMU_MPU_GYRO_RANGE MPU60X0_GYRO_RANGE_2000
@@ -70,6 +76,9 @@
 
 struct ImuMpu6000 {
   struct Mpu60x0_Spi mpu;
+#if IMU_MPU_USE_FIFO
+  struct ImuBatchInput batch;
+#endif
 };
 
 extern struct ImuMpu6000 imu_mpu_spi;
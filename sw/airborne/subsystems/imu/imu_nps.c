@@ -25,6 +25,15 @@
 
 #include "nps_sensors.h"
 
+#if IMU_NPS_FIFO
+#include NPS_SENSORS_PARAMS
+
+/** Output data rate of the simulated sensor */
+#ifndef IMU_NPS_ODR
+#define IMU_NPS_ODR (1. / NPS_GYRO_DT)
+#endif
+#endif
+
 struct ImuNps imu_nps;
 
 void imu_nps_init(void)
@@ -34,18 +43,34 @@ void imu_nps_init(void)
   imu_nps.mag_available = false;
   imu_nps.accel_available = false;
 
+#if IMU_NPS_FIFO
+  imu_nps.fifo_nb = 0;
+  imu_nps.fifo_overrun = 0;
+  imu_batch_init(&imu_nps.batch, IMU_BOARD_ID, IMU_NPS_ODR);
+#endif
 }
 
 
 void imu_feed_gyro_accel(void)
 {
 
+#if IMU_NPS_FIFO
+  if (imu_nps.fifo_nb < IMU_NPS_FIFO) {
+    RATES_ASSIGN(imu_nps.fifo_gyro[imu_nps.fifo_nb], sensors.gyro.value.x, sensors.gyro.value.y, sensors.gyro.value.z);
+    VECT3_ASSIGN(imu_nps.fifo_accel[imu_nps.fifo_nb], sensors.accel.value.x, sensors.accel.value.y, sensors.accel.value.z);
+    imu_nps.fifo_nb++;
+  } else {
+    imu_nps.fifo_overrun++;
+  }
+#else
   RATES_ASSIGN(imu.gyro_unscaled, sensors.gyro.value.x, sensors.gyro.value.y, sensors.gyro.value.z);
   VECT3_ASSIGN(imu.accel_unscaled, sensors.accel.value.x, sensors.accel.value.y, sensors.accel.value.z);
 
   // set availability flags...
+  // (with the FIFO, samples are only published when the watermark is reached)
   imu_nps.accel_available = true;
   imu_nps.gyro_available = true;
+#endif
 
 }
 
@@ -61,6 +86,16 @@ void imu_feed_mag(void)
 void imu_nps_event(void)
 {
   uint32_t now_ts = get_sys_time_usec();
+#if IMU_NPS_FIFO
+  // read the FIFO when the watermark is reached
+  if (imu_nps.fifo_nb >= IMU_NPS_FIFO) {
+    imu_batch_push(&imu_nps.batch, imu_nps.fifo_gyro, imu_nps.fifo_accel, imu_nps.fifo_nb, now_ts);
+    imu_nps.fifo_nb = 0;
+    // mean of the burst for the estimators using single samples
+    AbiSendMsgIMU_GYRO_INT32(IMU_BOARD_ID, now_ts, &imu.gyro);
+    AbiSendMsgIMU_ACCEL_INT32(IMU_BOARD_ID, now_ts, &imu.accel);
+  }
+#endif
   if (imu_nps.gyro_available) {
     imu_nps.gyro_available = false;
     imu_scale_gyro(&imu);
@@ -23,6 +23,7 @@
 #define IMU_NPS_H
 
 #include "subsystems/imu.h"
+#include "subsystems/imu/imu_batch.h"
 
 #include "generated/airframe.h"
 
@@ -69,10 +70,25 @@
 #endif
 
 
+/** Number of samples read per FIFO burst, 0 to publish each sample.
+ *  Simulates a sensor FIFO with a watermark, the samples are published
+ *  with imu_batch.
+ */
+#ifndef IMU_NPS_FIFO
+#define IMU_NPS_FIFO 0
+#endif
+
 struct ImuNps {
   uint8_t mag_available;
   uint8_t accel_available;
   uint8_t gyro_available;
+#if IMU_NPS_FIFO
+  struct Int32Rates fifo_gyro[IMU_NPS_FIFO];
+  struct Int32Vect3 fifo_accel[IMU_NPS_FIFO];
+  uint8_t fifo_nb;
+  uint32_t fifo_overrun;
+  struct ImuBatchInput batch;
+#endif
 };
 
 extern struct ImuNps imu_nps;
@@ -41,7 +41,7 @@
 
 #include "math/pprz_algebra_float.h"
 #include "math/pprz_algebra_int.h"
-#include "math/pprz_rk_float.h"
+#include "math/pprz_integrator_float.h"
 #include "math/pprz_isa.h"
 
 #include "state.h"
@@ -359,12 +359,10 @@ void ins_float_invariant_propagate(struct FloatRates* gyro, struct FloatVect3* a
   error_output(&ins_float_inv);
 
   // propagate model
-  struct inv_state new_state;
-  runge_kutta_4_float((float *)&new_state,
-                      (float *)&ins_float_inv.state, INV_STATE_DIM,
-                      (float *)&ins_float_inv.cmd, INV_COMMAND_DIM,
-                      invariant_model, dt);
-  ins_float_inv.state = new_state;
+  static float rk4_ws[INTEGRATOR_RK4_WS_SIZE(INV_STATE_DIM)];
+  integrator_rk4_float((float *)&ins_float_inv.state, INV_STATE_DIM,
+                       (float *)&ins_float_inv.cmd, INV_COMMAND_DIM,
+                       invariant_model, dt, rk4_ws);
 
   // normalize quaternion
   float_quat_normalize(&ins_float_inv.state.quat);
@@ -94,6 +94,19 @@ PRINT_CONFIG_MSG("INS_SONAR_UPDATE_ON_AGL defaulting to FALSE")
 #ifndef INS_VFF_VZ_R_GPS
 #define INS_VFF_VZ_R_GPS 2.0
 #endif
+
+/** GPS_LAG (in seconds) is compensated in the extended vertical filter
+ *  when it keeps a history (VFF_EXTENDED_DELAY_STEPS)
+ */
+#if USE_VFF_EXTENDED && defined GPS_LAG
+#include "mcu_periph/sys_time.h"
+#define INS_VFF_GPS_STAMP() (get_sys_time_usec() - (uint32_t)(GPS_LAG * 1e6))
+#define ins_vff_update_gps_z(_z, _conf) vff_update_z_conf_delayed(_z, _conf, INS_VFF_GPS_STAMP())
+#define ins_vff_update_gps_vz(_vz, _conf) vff_update_vz_conf_delayed(_vz, _conf, INS_VFF_GPS_STAMP())
+#else
+#define ins_vff_update_gps_z(_z, _conf) vff_update_z_conf(_z, _conf)
+#define ins_vff_update_gps_vz(_vz, _conf) vff_update_vz_conf(_vz, _conf)
+#endif
 #endif // USE_GPS
 
 /** maximum number of propagation steps without any updates in between */
@@ -428,10 +441,10 @@ void ins_int_update_gps(struct GpsState *gps_s)
   ned_of_ecef_vect_i(&gps_speed_cm_s_ned, &ins_int.ltp_def, &gps_s->ecef_vel);
 
 #if INS_USE_GPS_ALT
-  vff_update_z_conf(((float)gps_pos_cm_ned.z) / 100.0, INS_VFF_R_GPS);
+  ins_vff_update_gps_z(((float)gps_pos_cm_ned.z) / 100.0, INS_VFF_R_GPS);
 #endif
 #if INS_USE_GPS_ALT_SPEED
-  vff_update_vz_conf(((float)gps_speed_cm_s_ned.z) / 100.0, INS_VFF_VZ_R_GPS);
+  ins_vff_update_gps_vz(((float)gps_speed_cm_s_ned.z) / 100.0, INS_VFF_VZ_R_GPS);
   ins_int.propagation_cnt = 0;
 #endif
 
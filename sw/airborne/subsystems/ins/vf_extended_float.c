@@ -86,8 +86,55 @@ PRINT_CONFIG_VAR(DEBUG_VFF_EXTENDED)
 #define R_ALT 0.2f
 #define R_OBS_HEIGHT 8.f
 
+/** Number of filter steps kept to fuse delayed measurements (0 to disable)
+ *  The history should cover the largest measurement lag
+ *  (i.e. lag * propagation frequency).
+ */
+#ifndef VFF_EXTENDED_DELAY_STEPS
+#define VFF_EXTENDED_DELAY_STEPS 0
+#endif
+
 struct VffExtended vff;
 
+#if VFF_EXTENDED_DELAY_STEPS
+#include "filters/delayed_state_buffer.h"
+#include "mcu_periph/sys_time.h"
+
+/** Max number of measurements recorded in a filter step */
+#ifndef VFF_EXTENDED_DELAY_MAX_MEAS
+#define VFF_EXTENDED_DELAY_MAX_MEAS 4
+#endif
+
+enum VffMeasType {
+  VFF_MEAS_BARO,
+  VFF_MEAS_Z,
+  VFF_MEAS_VZ
+};
+
+/** Inputs of a filter step, replayed after a delayed measurement */
+struct VffStep {
+  float accel;
+  float dt;
+  uint8_t nb_meas;
+  struct {
+    uint8_t type;
+    float value;
+    float conf;
+  } meas[VFF_EXTENDED_DELAY_MAX_MEAS];
+};
+
+DELAYED_STATE_BUFFER_DEF(vff_delay, VFF_EXTENDED_DELAY_STEPS, struct VffExtended, struct VffStep)
+static struct DelayedStateBuffer vff_delay_buf;
+
+static void vff_delay_push(float accel, float dt);
+static void vff_delay_record(uint8_t type, float value, float conf);
+#define vff_delay_reset() delayed_state_buffer_reset(&vff_delay_buf)
+#else
+#define vff_delay_push(_accel, _dt) {}
+#define vff_delay_record(_type, _value, _conf) {}
+#define vff_delay_reset() {}
+#endif
+
 void vff_update_obs_height(float obs_height);
 
 #if PERIODIC_TELEMETRY
@@ -148,6 +195,10 @@ void vff_init(float init_z, float init_zdot, float init_accel_bias, float init_o
   vff.r_alt = R_ALT;
   vff.r_obs_height = R_OBS_HEIGHT;
 
+#if VFF_EXTENDED_DELAY_STEPS
+  DELAYED_STATE_BUFFER_INIT(&vff_delay_buf, vff_delay, VFF_EXTENDED_DELAY_STEPS);
+#endif
+
 #if PERIODIC_TELEMETRY
   register_periodic_telemetry(DefaultPeriodic, PPRZ_MSG_ID_VFF_EXTENDED, send_vffe);
 #endif
@@ -178,7 +229,7 @@ void vff_init(float init_z, float init_zdot, float init_accel_bias, float init_o
  *
  * Pk1 = F * Pk0 * F' + Q;
  */
-void vff_propagate(float accel, float dt)
+static void propagate(float accel, float dt)
 {
   /* update state */
   vff.zdotdot = accel + 9.81f - vff.bias;
@@ -209,6 +260,12 @@ void vff_propagate(float accel, float dt)
   vff.P[2][2] = FPF22 + Qbiasbias;
   vff.P[3][3] = FPF33 + Qoffoff;
   vff.P[4][4] = FPF44 + Qobsobs;
+}
+
+void vff_propagate(float accel, float dt)
+{
+  vff_delay_push(accel, dt);
+  propagate(accel, dt);
 
 #if DEBUG_VFF_EXTENDED
   RunOnceEvery(10, send_vffe(&(DefaultChannel).trans_tx, &(DefaultDevice).device));
@@ -310,6 +367,7 @@ static void update_alt_conf(float z_meas, float conf)
 void vff_update_z_conf(float z_meas, float conf)
 {
   if (conf < 0.f) { return; }
+  vff_delay_record(VFF_MEAS_Z, z_meas, conf);
   update_alt_conf(z_meas, conf);
 }
 
@@ -327,6 +385,7 @@ void vff_update_agl(float z_meas, float conf)
 void vff_update_baro_conf(float z_meas, float conf)
 {
   if (conf < 0.f) { return; }
+  vff_delay_record(VFF_MEAS_BARO, z_meas, conf);
   update_biased_z_conf(z_meas, conf);
 }
 
@@ -387,6 +446,7 @@ void vff_realign(float z_meas)
   vff.zdot = 0.f;
   vff.offset = 0.f;
   vff.obs_height = 0.f;
+  vff_delay_reset();
 }
 
 /*
@@ -434,5 +494,108 @@ void vff_update_vz_conf(float vz_meas, float conf)
 {
   if (conf < 0.f) { return; }
 
+  vff_delay_record(VFF_MEAS_VZ, vz_meas, conf);
   update_vz_conf(vz_meas, conf);
 }
+
+#if VFF_EXTENDED_DELAY_STEPS
+
+static void vff_delay_push(float accel, float dt)
+{
+  struct VffStep *step = delayed_state_buffer_push(&vff_delay_buf, get_sys_time_usec(), &vff);
+  step->accel = accel;
+  step->dt = dt;
+  step->nb_meas = 0;
+}
+
+static bool vff_delay_add_meas(struct VffStep *step, uint8_t type, float value, float conf)
+{
+  if (step == NULL || step->nb_meas >= VFF_EXTENDED_DELAY_MAX_MEAS) {
+    return false;
+  }
+  step->meas[step->nb_meas].type = type;
+  step->meas[step->nb_meas].value = value;
+  step->meas[step->nb_meas].conf = conf;
+  step->nb_meas++;
+  return true;
+}
+
+static void vff_delay_record(uint8_t type, float value, float conf)
+{
+  vff_delay_add_meas(delayed_state_buffer_last_input(&vff_delay_buf), type, value, conf);
+}
+
+static void apply_meas(uint8_t type, float value, float conf)
+{
+  switch (type) {
+    case VFF_MEAS_BARO:
+      update_biased_z_conf(value, conf);
+      break;
+    case VFF_MEAS_Z:
+      update_alt_conf(value, conf);
+      break;
+    case VFF_MEAS_VZ:
+      update_vz_conf(value, conf);
+      break;
+    default:
+      break;
+  }
+}
+
+/** Replay a filter step, the state is always the global vff */
+static void vff_delay_step(void *state __attribute__((unused)), void *input)
+{
+  struct VffStep *step = (struct VffStep *)input;
+  propagate(step->accel, step->dt);
+  uint8_t i;
+  for (i = 0; i < step->nb_meas; i++) {
+    apply_meas(step->meas[i].type, step->meas[i].value, step->meas[i].conf);
+  }
+}
+
+/** Fuse a measurement at the end of the filter step containing stamp
+ *  and replay the following steps.
+ *  Measurements that are too old, or when the step is full, are fused now.
+ */
+static void update_delayed(uint8_t type, float value, float conf, uint32_t stamp)
+{
+  int32_t age = delayed_state_buffer_find(&vff_delay_buf, stamp);
+  if (age > 0) {
+    struct VffStep *step = delayed_state_buffer_input(&vff_delay_buf, age);
+    if (step->nb_meas < VFF_EXTENDED_DELAY_MAX_MEAS) {
+      delayed_state_buffer_rewind(&vff_delay_buf, age, &vff, vff_delay_step);
+      apply_meas(type, value, conf);
+      vff_delay_add_meas(step, type, value, conf);
+      delayed_state_buffer_replay(&vff_delay_buf, age, &vff, vff_delay_step);
+      return;
+    }
+  }
+  vff_delay_record(type, value, conf);
+  apply_meas(type, value, conf);
+}
+
+void vff_update_z_conf_delayed(float z_meas, float conf, uint32_t stamp)
+{
+  if (conf < 0.f) { return; }
+  update_delayed(VFF_MEAS_Z, z_meas, conf, stamp);
+}
+
+void vff_update_vz_conf_delayed(float vz_meas, float conf, uint32_t stamp)
+{
+  if (conf < 0.f) { return; }
+  update_delayed(VFF_MEAS_VZ, vz_meas, conf, stamp);
+}
+
+#else
+
+void vff_update_z_conf_delayed(float z_meas, float conf, uint32_t stamp __attribute__((unused)))
+{
+  vff_update_z_conf(z_meas, conf);
+}
+
+void vff_update_vz_conf_delayed(float vz_meas, float conf, uint32_t stamp __attribute__((unused)))
+{
+  vff_update_vz_conf(vz_meas, conf);
+}
+
+#endif
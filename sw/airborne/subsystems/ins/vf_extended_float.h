@@ -30,6 +30,8 @@
 #ifndef VF_EXTENDED_FLOAT_H
 #define VF_EXTENDED_FLOAT_H
 
+#include "std.h"
+
 #define VFF_STATE_SIZE 5
 
 struct VffExtended {
@@ -65,4 +67,12 @@ extern void vff_update_vz_conf(float vz_meas, float conf);
 extern void vff_realign(float z_meas);
 extern void vff_update_agl(float z_meas, float conf);
 
+/** Fuse delayed measurements
+ *  Only compensated when VFF_EXTENDED_DELAY_STEPS is set,
+ *  otherwise fused as current measurements.
+ * @param stamp measurement time (us, from get_sys_time_usec)
+ */
+extern void vff_update_z_conf_delayed(float z_meas, float conf, uint32_t stamp);
+extern void vff_update_vz_conf_delayed(float vz_meas, float conf, uint32_t stamp);
+
 #endif /* VF_EXTENDED_FLOAT_H */
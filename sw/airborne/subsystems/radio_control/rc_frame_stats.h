@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file subsystems/radio_control/rc_frame_stats.h
+ *
+ * Arrival time statistics of radio control frames.
+ *
+ * Frames are time stamped at their estimated arrival time,
+ * the gap between frames gives the frame period and its jitter.
+ */
+
+#ifndef RC_FRAME_STATS_H
+#define RC_FRAME_STATS_H
+
+#include "std.h"
+#include <math.h>
+
+/** Weight of a new gap in the running mean and variance */
+#ifndef RC_FRAME_STATS_ALPHA
+#define RC_FRAME_STATS_ALPHA (1.f / 64.f)
+#endif
+
+struct RcFrameStats {
+  uint32_t last_time;   ///< arrival time of the last frame (us)
+  uint32_t nb_frames;   ///< number of frames
+  uint32_t gap_min;     ///< min gap between frames (us)
+  uint32_t gap_max;     ///< max gap between frames (us)
+  float gap_mean;       ///< running mean of the gap (us)
+  float gap_var;        ///< running variance of the gap (us^2)
+};
+
+static inline void rc_frame_stats_init(struct RcFrameStats *s)
+{
+  s->last_time = 0;
+  s->nb_frames = 0;
+  s->gap_min = UINT32_MAX;
+  s->gap_max = 0;
+  s->gap_mean = 0.f;
+  s->gap_var = 0.f;
+}
+
+/** Add a frame
+ * @param s statistics
+ * @param t arrival time of the frame (us)
+ */
+static inline void rc_frame_stats_update(struct RcFrameStats *s, uint32_t t)
+{
+  if (s->nb_frames > 0) {
+    const uint32_t gap = t - s->last_time;
+    if (s->nb_frames == 1) {
+      s->gap_mean = (float)gap;
+    } else {
+      const float d = (float)gap - s->gap_mean;
+      s->gap_mean += RC_FRAME_STATS_ALPHA * d;
+      s->gap_var = (1.f - RC_FRAME_STATS_ALPHA) * (s->gap_var + RC_FRAME_STATS_ALPHA * d * d);
+    }
+    if (gap < s->gap_min) { s->gap_min = gap; }
+    if (gap > s->gap_max) { s->gap_max = gap; }
+  }
+  s->last_time = t;
+  s->nb_frames++;
+}
+
+/** Jitter of the frame period (us), standard deviation of the gap */
+static inline float rc_frame_stats_jitter(struct RcFrameStats *s)
+{
+  return sqrtf(s->gap_var);
+}
+
+#endif /* RC_FRAME_STATS_H */
@@ -30,31 +30,8 @@
 #include <string.h>
 #include <stdbool.h>
 
-/*
- * SBUS protocol and state machine status
- */
-#define SBUS_START_BYTE 0x0f
-#define SBUS_END_BYTE_0 0x00 // only possible end byte for SBUS v1
-#define SBUS_END_BYTE_1 0x04 // with SBUS v2 and 14CH mode
-#define SBUS_END_BYTE_2 0x14 // end byte is cycling
-#define SBUS_END_BYTE_3 0x24 // through the following 4 types
-#define SBUS_END_BYTE_4 0x34 // in order
-#define SBUS_END_BYTE_5 0x08 // with SBUS v2 and 12CH mode
-#define SBUS_BIT_PER_CHANNEL 11
-#define SBUS_BIT_PER_BYTE 8
-#define SBUS_FLAGS_BYTE 22
-#define SBUS_FRAME_LOST_BIT 2
-#define SBUS_RC_FAILSAFE_BIT 4
-#define SBUS_RC_LOST_BIT 5
-
-#define SBUS_STATUS_UNINIT 0
-#define SBUS_STATUS_GOT_START 1
-
-/**
- * Time before timeout when receiving
- * a full SBUS frame
- */
-#define SBUS_TIMEOUT_MS 4
+/** Max number of bytes read from the UART at once */
+#define SBUS_SPAN_LENGTH 64
 
 /** Set polarity using RC_POLARITY_GPIO.
  * SBUS signal has a reversed polarity compared to normal UART
@@ -74,8 +51,7 @@ void sbus_common_init(struct Sbus *sbus_p, struct uart_periph *dev,
   sbus_p->frame_available = false;
   sbus_p->rc_failsafe = true;
   sbus_p->rc_lost = true;
-  sbus_p->status = SBUS_STATUS_UNINIT;
-  sbus_p->start_time = 0;
+  sbus_decoder_init(&sbus_p->decoder);
 
   // Set UART parameter, SBUS used a baud rate of 100000, 8 data bits, even parity bit, and 2 stop bits
   uart_periph_set_baudrate(dev, B100000);
@@ -91,87 +67,27 @@ void sbus_common_init(struct Sbus *sbus_p, struct uart_periph *dev,
 
 }
 
-/** Decode the raw buffer */
-static void decode_sbus_buffer(const uint8_t *src, uint16_t *dst,
-		                       bool *is_frame_available, bool *is_rc_failsafe, bool *is_rc_lost,
-                               uint16_t *dstppm __attribute__((unused)))
-{
-  // decode sbus data, unrolling the loop for efficiency
-  dst[0]  = ((src[0]) | (src[1] << 8))                  & 0x07FF;
-  dst[1]  = ((src[1] >> 3) | (src[2] << 5))                  & 0x07FF;
-  dst[2]  = ((src[2] >> 6) | (src[3] << 2)  | (src[4] << 10))  & 0x07FF;
-  dst[3]  = ((src[4] >> 1) | (src[5] << 7))                  & 0x07FF;
-  dst[4]  = ((src[5] >> 4) | (src[6] << 4))                  & 0x07FF;
-  dst[5]  = ((src[6] >> 7) | (src[7] << 1) | (src[8] << 9))   & 0x07FF;
-  dst[6]  = ((src[8] >> 2) | (src[9] << 6))                  & 0x07FF;
-  dst[7]  = ((src[9] >> 5)  | (src[10] << 3))                 & 0x07FF;
-  dst[8]  = ((src[11]) | (src[12] << 8))                 & 0x07FF;
-  dst[9]  = ((src[12] >> 3) | (src[13] << 5))                 & 0x07FF;
-  dst[10] = ((src[13] >> 6) | (src[14] << 2) | (src[15] << 10)) & 0x07FF;
-  dst[11] = ((src[15] >> 1) | (src[16] << 7))                 & 0x07FF;
-  dst[12] = ((src[16] >> 4) | (src[17] << 4))                 & 0x07FF;
-  dst[13] = ((src[17] >> 7) | (src[18] << 1) | (src[19] << 9))  & 0x07FF;
-  dst[14] = ((src[19] >> 2) | (src[20] << 6))                 & 0x07FF;
-  dst[15] = ((src[20] >> 5) | (src[21] << 3))                 & 0x07FF;
-
-  // Convert sbus to ppm
-#if PERIODIC_TELEMETRY
-  for (int channel = 0; channel < SBUS_NB_CHANNEL; channel++) {
-    dstppm[channel] = USEC_OF_RC_PPM_TICKS(dst[channel]);
-  }
-#endif
-
-  // Test frame loss flag
-  *is_frame_available = !bit_is_set(src[SBUS_FLAGS_BYTE], SBUS_FRAME_LOST_BIT);
-  // Check if receiver is in Failsafe mode
-  *is_rc_failsafe = bit_is_set(src[SBUS_FLAGS_BYTE], SBUS_RC_FAILSAFE_BIT);
-  // Also check if the RC link is lost
-  *is_rc_lost = bit_is_set(src[SBUS_FLAGS_BYTE], SBUS_RC_LOST_BIT);
-
-}
-
 // Decoding event function
-// Reading from UART
+// Reading all available bytes from UART at once
 void sbus_common_decode_event(struct Sbus *sbus_p, struct uart_periph *dev)
 {
-  uint8_t rbyte;
-  if (uart_char_available(dev)) {
-    // Took too long to receive a full SBUS frame (usually during boot to synchronize)
-    if(get_sys_time_msec() > (sbus_p->start_time+SBUS_TIMEOUT_MS)) {
-      sbus_p->status = SBUS_STATUS_UNINIT;
-    }
-
-    do {
-      rbyte = uart_getch(dev);
-      switch (sbus_p->status) {
-        case SBUS_STATUS_UNINIT:
-          // Wait for the start byte
-          if (rbyte == SBUS_START_BYTE) {
-            sbus_p->status++;
-            sbus_p->idx = 0;
-            sbus_p->start_time = get_sys_time_msec();
-          }
-          break;
-        case SBUS_STATUS_GOT_START:
-          // Store buffer
-          sbus_p->buffer[sbus_p->idx] = rbyte;
-          sbus_p->idx++;
-          if (sbus_p->idx == SBUS_BUF_LENGTH) {
-            // Decode if last byte is (one of) the correct end byte
-            if (rbyte == SBUS_END_BYTE_0 ||
-                rbyte == SBUS_END_BYTE_1 ||
-                rbyte == SBUS_END_BYTE_2 ||
-                rbyte == SBUS_END_BYTE_3 ||
-                rbyte == SBUS_END_BYTE_4 ||
-                rbyte == SBUS_END_BYTE_5) {
-              decode_sbus_buffer(sbus_p->buffer, sbus_p->pulses, &sbus_p->frame_available, &sbus_p->rc_failsafe, &sbus_p->rc_lost, sbus_p->ppm);
-            }
-            sbus_p->status = SBUS_STATUS_UNINIT;
-          }
-          break;
-        default:
-          break;
+  uint8_t span[SBUS_SPAN_LENGTH];
+  uint16_t n;
+  uint8_t flags = 0;
+  while ((n = uart_get_bytes(dev, span, SBUS_SPAN_LENGTH)) > 0) {
+    if (sbus_decoder_parse(&sbus_p->decoder, span, n, get_sys_time_usec(), sbus_p->pulses, &flags) > 0) {
+      // Convert sbus to ppm
+#if PERIODIC_TELEMETRY
+      for (int channel = 0; channel < SBUS_NB_CHANNEL; channel++) {
+        sbus_p->ppm[channel] = USEC_OF_RC_PPM_TICKS(sbus_p->pulses[channel]);
       }
-    } while (uart_char_available(dev));
+#endif
+      // Test frame loss flag
+      sbus_p->frame_available = !bit_is_set(flags, SBUS_FRAME_LOST_BIT);
+      // Check if receiver is in Failsafe mode
+      sbus_p->rc_failsafe = bit_is_set(flags, SBUS_RC_FAILSAFE_BIT);
+      // Also check if the RC link is lost
+      sbus_p->rc_lost = bit_is_set(flags, SBUS_RC_LOST_BIT);
+    }
   }
 }
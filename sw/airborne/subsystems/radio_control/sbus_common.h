@@ -30,6 +30,7 @@
 #include "std.h"
 #include "mcu_periph/uart.h"
 #include "mcu_periph/gpio.h"
+#include "subsystems/radio_control/sbus_decoder.h"
 
 /* in case you want to override RADIO_CONTROL_NB_CHANNEL */
 #include "generated/airframe.h"
@@ -53,14 +54,12 @@
 /**
  * Define number of channels.
  *
- * SBUS frame always have 16 channels
+ * SBUS frame always have 16 channels (SBUS_NB_CHANNEL)
  * but only the X first one will be available
  * depending of the RC transmitter.
  * The radio XML file is used to assign the
  * input values to RC channels.
  */
-#define SBUS_BUF_LENGTH 24
-#define SBUS_NB_CHANNEL 16
 
 /**
  * Default number of channels to actually use.
@@ -82,10 +81,7 @@ struct Sbus {
   bool frame_available;             ///< A data frame is available
   bool rc_failsafe;                 ///< Receiver set to in failsafe mode
   bool rc_lost;                     ///< RC reception is lost
-  uint8_t buffer[SBUS_BUF_LENGTH];  ///< Input buffer
-  uint8_t idx;                      ///< Input index
-  uint8_t status;                   ///< Decoder state-machine status
-  uint32_t start_time;              ///< Decoder start time
+  struct SbusDecoder decoder;       ///< Frame decoder, with arrival time of the last frame
 };
 
 /**
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file subsystems/radio_control/sbus_decoder.c
+ *
+ * Futaba SBUS frame decoder, independent of the UART.
+ */
+
+#include "subsystems/radio_control/sbus_decoder.h"
+#include <string.h>
+
+/*
+ * SBUS protocol and state machine status
+ */
+#define SBUS_START_BYTE 0x0f
+#define SBUS_END_BYTE_0 0x00 // only possible end byte for SBUS v1
+#define SBUS_END_BYTE_1 0x04 // with SBUS v2 and 14CH mode
+#define SBUS_END_BYTE_2 0x14 // end byte is cycling
+#define SBUS_END_BYTE_3 0x24 // through the following 4 types
+#define SBUS_END_BYTE_4 0x34 // in order
+#define SBUS_END_BYTE_5 0x08 // with SBUS v2 and 12CH mode
+#define SBUS_BIT_PER_CHANNEL 11
+
+#define SBUS_STATUS_UNINIT 0
+#define SBUS_STATUS_GOT_START 1
+
+void sbus_decoder_init(struct SbusDecoder *dec)
+{
+  dec->idx = 0;
+  dec->status = SBUS_STATUS_UNINIT;
+  dec->start_time = 0;
+  dec->frame_time = 0;
+  rc_frame_stats_init(&dec->stats);
+}
+
+/** Little endian 32 bits load from any address */
+static inline uint32_t sbus_load32(const uint8_t *p)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  uint32_t v;
+  memcpy(&v, p, sizeof(v)); // single (unaligned) load
+  return v;
+#else
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+#endif
+}
+
+/* channel i starts at bit 11*i, the 11 bits are within the 32 bits word
+ * loaded from its first byte (bit offset in byte is at most 7)
+ * the last word is loaded from byte 20, still in the frame buffer */
+#define SBUS_CHANNEL(_src, _i) \
+  ((sbus_load32(&(_src)[((_i) * SBUS_BIT_PER_CHANNEL) >> 3]) >> (((_i) * SBUS_BIT_PER_CHANNEL) & 7)) & 0x07FF)
+
+void sbus_decode_channels(const uint8_t *src, uint16_t *dst)
+{
+  dst[0]  = SBUS_CHANNEL(src, 0);
+  dst[1]  = SBUS_CHANNEL(src, 1);
+  dst[2]  = SBUS_CHANNEL(src, 2);
+  dst[3]  = SBUS_CHANNEL(src, 3);
+  dst[4]  = SBUS_CHANNEL(src, 4);
+  dst[5]  = SBUS_CHANNEL(src, 5);
+  dst[6]  = SBUS_CHANNEL(src, 6);
+  dst[7]  = SBUS_CHANNEL(src, 7);
+  dst[8]  = SBUS_CHANNEL(src, 8);
+  dst[9]  = SBUS_CHANNEL(src, 9);
+  dst[10] = SBUS_CHANNEL(src, 10);
+  dst[11] = SBUS_CHANNEL(src, 11);
+  dst[12] = SBUS_CHANNEL(src, 12);
+  dst[13] = SBUS_CHANNEL(src, 13);
+  dst[14] = SBUS_CHANNEL(src, 14);
+  dst[15] = SBUS_CHANNEL(src, 15);
+}
+
+static inline bool sbus_is_end_byte(uint8_t b)
+{
+  return (b == SBUS_END_BYTE_0 ||
+          b == SBUS_END_BYTE_1 ||
+          b == SBUS_END_BYTE_2 ||
+          b == SBUS_END_BYTE_3 ||
+          b == SBUS_END_BYTE_4 ||
+          b == SBUS_END_BYTE_5);
+}
+
+uint8_t sbus_decoder_parse(struct SbusDecoder *dec, const uint8_t *buf, uint16_t len,
+                           uint32_t now_us, uint16_t *channels, uint8_t *flags)
+{
+  uint8_t nb = 0;
+  uint16_t i = 0;
+
+  if (len == 0) {
+    return 0;
+  }
+  // Took too long to receive a full SBUS frame (usually during boot to synchronize)
+  // bytes are time stamped assuming that the span was received without gap
+  const uint32_t first_time = now_us - (uint32_t)(len - 1) * SBUS_BYTE_TIME_US;
+  if ((int32_t)(first_time - dec->start_time) > SBUS_TIMEOUT_US) {
+    dec->status = SBUS_STATUS_UNINIT;
+  }
+
+  while (i < len) {
+    if (dec->status == SBUS_STATUS_UNINIT) {
+      // Wait for the start byte
+      const uint8_t *start = memchr(&buf[i], SBUS_START_BYTE, len - i);
+      if (start == NULL) {
+        break;
+      }
+      i = (uint16_t)(start - buf) + 1;
+      dec->status = SBUS_STATUS_GOT_START;
+      dec->idx = 0;
+      dec->start_time = now_us - (uint32_t)(len - i) * SBUS_BYTE_TIME_US;
+    } else {
+      // Store buffer
+      const uint16_t n = Min((uint16_t)(SBUS_BUF_LENGTH - dec->idx), (uint16_t)(len - i));
+      memcpy(&dec->buffer[dec->idx], &buf[i], n);
+      dec->idx += n;
+      i += n;
+      if (dec->idx == SBUS_BUF_LENGTH) {
+        // Decode if last byte is (one of) the correct end byte
+        if (sbus_is_end_byte(dec->buffer[SBUS_BUF_LENGTH - 1])) {
+          sbus_decode_channels(dec->buffer, channels);
+          *flags = dec->buffer[SBUS_FLAGS_BYTE];
+          // last byte of the frame arrived before the rest of the span
+          dec->frame_time = now_us - (uint32_t)(len - i) * SBUS_BYTE_TIME_US;
+          rc_frame_stats_update(&dec->stats, dec->frame_time);
+          nb++;
+        }
+        dec->status = SBUS_STATUS_UNINIT;
+      }
+    }
+  }
+  return nb;
+}
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file subsystems/radio_control/sbus_decoder.h
+ *
+ * Futaba SBUS frame decoder, independent of the UART.
+ *
+ * Received bytes are parsed by spans (all the bytes available on the UART
+ * at once), several frames can be decoded from one span.
+ * Channels are extracted with one 32 bits load, shift and mask per channel
+ * instead of combining bytes.
+ * Frames are time stamped at the estimated arrival time of their last byte.
+ */
+
+#ifndef RC_SBUS_DECODER_H
+#define RC_SBUS_DECODER_H
+
+#include "std.h"
+#include "subsystems/radio_control/rc_frame_stats.h"
+
+/**
+ * SBUS frame always have 16 channels
+ * Frame is a start byte, 22 bytes of channel data, a flags byte and an end byte
+ */
+#define SBUS_BUF_LENGTH 24
+#define SBUS_NB_CHANNEL 16
+
+#define SBUS_FLAGS_BYTE 22
+#define SBUS_FRAME_LOST_BIT 2
+#define SBUS_RC_FAILSAFE_BIT 4
+#define SBUS_RC_LOST_BIT 5
+
+/** Transmission time of a byte (us), 12 bits at 100000 bauds */
+#define SBUS_BYTE_TIME_US 120
+
+/**
+ * Time before timeout when receiving
+ * a full SBUS frame
+ */
+#define SBUS_TIMEOUT_US 4000
+
+struct SbusDecoder {
+  uint8_t buffer[SBUS_BUF_LENGTH];  ///< Input buffer
+  uint8_t idx;                      ///< Input index
+  uint8_t status;                   ///< Decoder state-machine status
+  uint32_t start_time;              ///< Arrival time of the start byte (us)
+  uint32_t frame_time;              ///< Arrival time of the last frame (us)
+  struct RcFrameStats stats;        ///< Frame period statistics
+};
+
+extern void sbus_decoder_init(struct SbusDecoder *dec);
+
+/** Decode the 16 channels of a frame
+ * @param src frame without start byte (SBUS_BUF_LENGTH bytes)
+ * @param dst channel values
+ */
+extern void sbus_decode_channels(const uint8_t *src, uint16_t *dst);
+
+/** Parse a span of received bytes
+ * @param dec decoder
+ * @param buf received bytes
+ * @param len number of bytes
+ * @param now_us time of the reception of the last byte (us)
+ * @param channels channel values of the last decoded frame
+ * @param flags flags byte of the last decoded frame
+ * @return number of frames decoded from the span
+ */
+extern uint8_t sbus_decoder_parse(struct SbusDecoder *dec, const uint8_t *buf, uint16_t len,
+                                  uint32_t now_us, uint16_t *channels, uint8_t *flags);
+
+#endif /* RC_SBUS_DECODER_H */
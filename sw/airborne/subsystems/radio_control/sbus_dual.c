@@ -77,31 +77,41 @@ static inline void sbus_dual_decode_event(void)
   sbus_common_decode_event(&sbus2, &SBUS2_UART_DEV);
 }
 
+/** Count a new frame of a receiver
+ * @return true if the frame can be used
+ */
+static bool sbus_dual_new_frame(struct Sbus *sbus_p)
+{
+  if (!sbus_p->frame_available) {
+    return false;
+  }
+  sbus_p->frame_available = false;
+  radio_control.frame_cpt++;
+  radio_control.time_since_last_frame = 0;
+  if (radio_control.radio_ok_cpt > 0) {
+    radio_control.radio_ok_cpt--;
+    return false;
+  }
+  radio_control.status = RC_OK;
+  return true;
+}
+
 void radio_control_impl_event(void (* _received_frame_handler)(void))
 {
   sbus_dual_decode_event();
-  if (sbus2.frame_available) {
-    radio_control.frame_cpt++;
-    radio_control.time_since_last_frame = 0;
-    if (radio_control.radio_ok_cpt > 0) {
-      radio_control.radio_ok_cpt--;
-    } else {
-      radio_control.status = RC_OK;
-      NormalizePpmIIR(sbus2.pulses, radio_control);
-      _received_frame_handler();
-    }
-    sbus2.frame_available = false;
+  const bool new1 = sbus_dual_new_frame(&sbus1);
+  const bool new2 = sbus_dual_new_frame(&sbus2);
+  // when both receivers have a new frame, only use the one that arrived last
+  struct Sbus *sbus_p = NULL;
+  if (new1 && new2) {
+    sbus_p = ((int32_t)(sbus1.decoder.frame_time - sbus2.decoder.frame_time) >= 0) ? &sbus1 : &sbus2;
+  } else if (new1) {
+    sbus_p = &sbus1;
+  } else if (new2) {
+    sbus_p = &sbus2;
   }
-  if (sbus1.frame_available) {
-    radio_control.frame_cpt++;
-    radio_control.time_since_last_frame = 0;
-    if (radio_control.radio_ok_cpt > 0) {
-      radio_control.radio_ok_cpt--;
-    } else {
-      radio_control.status = RC_OK;
-      NormalizePpmIIR(sbus1.pulses, radio_control);
-      _received_frame_handler();
-    }
-    sbus1.frame_available = false;
+  if (sbus_p != NULL) {
+    NormalizePpmIIR(sbus_p->pulses, radio_control);
+    _received_frame_handler();
   }
 }
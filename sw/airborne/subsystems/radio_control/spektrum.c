@@ -108,6 +108,8 @@ static inline void spektrum_init_sat(struct spektrum_sat_t *sat)
   sat->valid = false;
   sat->timer = get_sys_time_msec();
   sat->idx = 0;
+  sat->frame_time = 0;
+  rc_frame_stats_init(&sat->stats);
 
   // Initialize values
   for (uint8_t i = 0; i < SPEKTRUM_MAX_CHANNELS; i++) {
@@ -262,21 +264,23 @@ static void spektrum_uart_check(struct uart_periph *dev, struct spektrum_sat_t *
     sat->timer = t; // reset counter
     uint16_t bytes_cnt = uart_char_available(dev); // The amount of bytes in the buffer
     // sync space detected but buffer not empty, flush data
-    if (bytes_cnt > 0) {
-      for (uint8_t i = 0; i < bytes_cnt; i++) {
-        uart_getch(dev);
-      }
+    uint8_t trash[SPEKTRUM_FRAME_LEN];
+    while (bytes_cnt > 0) {
+      bytes_cnt -= uart_get_bytes(dev, trash, Min(bytes_cnt, SPEKTRUM_FRAME_LEN));
     }
   }
-  // check and parse bytes in uart buffer
-  while (uart_char_available(dev)) {
-    sat->buf[sat->idx++] = uart_getch(dev);
+  // read the missing bytes of the frame at once
+  uint16_t n = uart_get_bytes(dev, &sat->buf[sat->idx], SPEKTRUM_FRAME_LEN - sat->idx);
+  if (n > 0) {
+    sat->idx += n;
     sat->timer = t; // reset counter
     if (sat->idx == SPEKTRUM_FRAME_LEN) {
+      // bytes still in the UART buffer arrived after the end of the frame
+      sat->frame_time = get_sys_time_usec() - uart_char_available(dev) * SPEKTRUM_BYTE_TIME_US;
+      rc_frame_stats_update(&sat->stats, sat->frame_time);
       // buffer is full, parse frame
       spektrum_parser(sat);
       sat->idx = 0; // reset index
-      break; // stop here to handle RC frame
     }
   }
 }
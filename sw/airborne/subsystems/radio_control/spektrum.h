@@ -30,6 +30,7 @@
 #define RADIO_CONTROL_SPEKTRUM_H
 
 #include "std.h"
+#include "subsystems/radio_control/rc_frame_stats.h"
 
 /* Include channels information */
 #include "spektrum_radio.h"
@@ -43,6 +44,7 @@
 #define SPEKTRUM_MAX_FRAMES 2             ///< Maximum amount of RC frames containing different channels
 #define SPEKTRUM_MAX_CHANNELS (SPEKTRUM_CHANNELS_PER_FRAME * SPEKTRUM_MAX_FRAMES)
 #define SPEKTRUM_MIN_FRAME_SPACE  7       ///< Minum amount of time between frames (7ms), in fact either 11 or 22 ms
+#define SPEKTRUM_BYTE_TIME_US 87          ///< Transmission time of a byte (10 bits at 115200 bauds)
 
 /* Set the event function to the correct */
 #define RadioControlEvent(_received_frame_handler) spektrum_event(_received_frame_handler)
@@ -55,6 +57,8 @@ struct spektrum_sat_t {
   uint8_t buf[SPEKTRUM_FRAME_LEN];        ///< input buffer
   uint8_t idx;                            ///< input buffer index
   int16_t values[SPEKTRUM_MAX_CHANNELS];  ///< RC channel values
+  uint32_t frame_time;                    ///< Arrival time of the last frame (us)
+  struct RcFrameStats stats;              ///< Frame period statistics
 };
 
 /* Main spektrum structure */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_math_trig_bench.c
+ *
+ * Cycles and accuracy of the float and fixed point trig implementations on target,
+ * host version in tests/math/test_pprz_trig.c
+ *
+ * PAYLOAD_FLOAT content:
+ *  - [0..3]   max error of sin and cos on [-4, 4]: libm, poly, lut, int
+ *  - [4..7]   cycles of sinf: libm, poly, lut, int
+ *  - [8..11]  cycles of sincosf: libm, poly, lut, int
+ *  - [12..14] cycles of atan2f: libm, poly, lut
+ *  - [15..19] cycles of the fixed point sine: flat table, compressed 4, 8, 12, 16 bits
+ *  - [20..21] cycles of int32_atan2 and int32_atan2_2
+ */
+
+#define DATALINK_C
+
+#include BOARD_CONFIG
+#include "mcu.h"
+#include "mcu_periph/sys_time.h"
+#include "subsystems/datalink/downlink.h"
+#include "led.h"
+#include "math/pprz_trig_float.h"
+#include "math/pprz_trig_int.h"
+#include "math/pprz_algebra_int.h"
+
+/* cycle counter only exists for STM32 architecture */
+#if defined(STM32F1) || defined(STM32F4)
+#include <libopencm3/cm3/dwt.h>
+#else
+#define dwt_read_cycle_counter() 0
+#define dwt_enable_cycle_counter() 0
+#endif
+
+#define NB_CALLS 32
+#define NB_RESULTS 22
+
+static inline void main_init(void);
+static inline void main_periodic(void);
+static inline void main_event(void);
+
+static float results[NB_RESULTS];
+static float xs[NB_CALLS], ys[NB_CALLS];
+static int32_t ias[NB_CALLS], iys[NB_CALLS], ixs[NB_CALLS];
+
+static float sinf_libm(float x) { return pprz_sinf_libm(x); }
+static float cosf_libm(float x) { return pprz_cosf_libm(x); }
+static void sincosf_libm(float x, float *s, float *c) { pprz_sincosf_libm(x, s, c); }
+static float atan2f_libm(float y, float x) { return pprz_atan2f_libm(y, x); }
+
+static float (*const sin_f[])(float) = { sinf_libm, pprz_sinf_poly, pprz_sinf_lut, pprz_sinf_int };
+static float (*const cos_f[])(float) = { cosf_libm, pprz_cosf_poly, pprz_cosf_lut, pprz_cosf_int };
+static void (*const sincos_f[])(float, float *, float *) = {
+  sincosf_libm, pprz_sincosf_poly, pprz_sincosf_lut, pprz_sincosf_int
+};
+static float (*const atan2_f[])(float, float) = { atan2f_libm, pprz_atan2f_poly, pprz_atan2f_lut };
+
+static int32_t trig_int_flat(int32_t a) { return pprz_trig_int[a]; }
+static int32_t trig_int_4(int32_t a) { return pprz_trig_int_4(a); }
+static int32_t trig_int_8(int32_t a) { return pprz_trig_int_8(a); }
+static int32_t trig_int_12(int32_t a) { return pprz_trig_int_12(a); }
+static int32_t trig_int_16(int32_t a) { return pprz_trig_int_16(a); }
+
+static int32_t (*const trig_int_f[])(int32_t) = { trig_int_flat, trig_int_4, trig_int_8, trig_int_12, trig_int_16 };
+static int32_t (*const atan2_int_f[])(int32_t, int32_t) = { int32_atan2, int32_atan2_2 };
+
+#define NB_OF(_t) (sizeof(_t) / sizeof(_t[0]))
+
+int main(void)
+{
+  main_init();
+
+  while (1) {
+    if (sys_time_check_and_ack_timer(0)) {
+      main_periodic();
+    }
+    main_event();
+  }
+  return 0;
+}
+
+static inline void main_init(void)
+{
+  mcu_init();
+  sys_time_register_timer((1. / PERIODIC_FREQUENCY), NULL);
+  mcu_int_enable();
+
+  downlink_init();
+  dwt_enable_cycle_counter();
+  pprz_trig_int_init();
+
+  uint32_t i, k;
+  for (i = 0; i < NB_CALLS; i++) {
+    xs[i] = -4.f + 8.f * i / NB_CALLS;
+    ys[i] = 1.f - 2.f * ((i * 7) % NB_CALLS) / NB_CALLS;
+    ias[i] = (i * 199) % TRIG_INT_SIZE;
+    iys[i] = 10000 * ys[i];
+    ixs[i] = 10000 * xs[i] / 4;
+  }
+
+  /* accuracy against double precision, done once as it is slow on target */
+  for (k = 0; k < NB_OF(sin_f); k++) {
+    float err = 0.f;
+    for (i = 0; i <= 8000; i++) {
+      const float x = -4.f + i / 1000.f;
+      err = Max(err, fabs(sin_f[k](x) - sin(x)));
+      err = Max(err, fabs(cos_f[k](x) - cos(x)));
+    }
+    results[k] = err;
+  }
+}
+
+static inline void main_periodic(void)
+{
+  volatile float sink = 0.f;
+  volatile int32_t isink = 0;
+  uint32_t pre_time, i, k, n = NB_OF(sin_f);
+
+  RunOnceEvery(10, {DOWNLINK_SEND_ALIVE(DefaultChannel, DefaultDevice, 16, MD5SUM);});
+  LED_PERIODIC();
+
+  /* cycles per call, including the indirect call and loop overhead */
+  for (k = 0; k < NB_OF(sin_f); k++) {
+    pre_time = dwt_read_cycle_counter();
+    for (i = 0; i < NB_CALLS; i++) {
+      sink += sin_f[k](xs[i]);
+    }
+    results[n++] = (float)(dwt_read_cycle_counter() - pre_time) / NB_CALLS;
+  }
+  for (k = 0; k < NB_OF(sincos_f); k++) {
+    float s, c;
+    pre_time = dwt_read_cycle_counter();
+    for (i = 0; i < NB_CALLS; i++) {
+      sincos_f[k](xs[i], &s, &c);
+      sink += s + c;
+    }
+    results[n++] = (float)(dwt_read_cycle_counter() - pre_time) / NB_CALLS;
+  }
+  for (k = 0; k < NB_OF(atan2_f); k++) {
+    pre_time = dwt_read_cycle_counter();
+    for (i = 0; i < NB_CALLS; i++) {
+      sink += atan2_f[k](ys[i], xs[i]);
+    }
+    results[n++] = (float)(dwt_read_cycle_counter() - pre_time) / NB_CALLS;
+  }
+  for (k = 0; k < NB_OF(trig_int_f); k++) {
+    pre_time = dwt_read_cycle_counter();
+    for (i = 0; i < NB_CALLS; i++) {
+      isink += trig_int_f[k](ias[i]);
+    }
+    results[n++] = (float)(dwt_read_cycle_counter() - pre_time) / NB_CALLS;
+  }
+  for (k = 0; k < NB_OF(atan2_int_f); k++) {
+    pre_time = dwt_read_cycle_counter();
+    for (i = 0; i < NB_CALLS; i++) {
+      isink += atan2_int_f[k](iys[i], ixs[i]);
+    }
+    results[n++] = (float)(dwt_read_cycle_counter() - pre_time) / NB_CALLS;
+  }
+
+  RunOnceEvery(10, {DOWNLINK_SEND_PAYLOAD_FLOAT(DefaultChannel, DefaultDevice, NB_RESULTS, results);});
+}
+
+static inline void main_event(void)
+{
+  mcu_event();
+}
@@ -139,6 +139,7 @@ The $GPGGA Sentence (Fix data)
 #include <Ivy/timer.h>
 #include <Ivy/version.h>
 
+#include "serial_bridge.h"
 
 
 /*
@@ -578,6 +579,16 @@ static gboolean gps_periodic(gpointer data __attribute__ ((unused)))
 
 int fd = 0;
 
+/** Serial writer, so that the Ivy thread never waits for the (slow) port */
+struct serial_bridge bridge;
+unsigned int batch = 2;
+
+/** max length of an NMEA sentence is 82 characters */
+#define NMEA_MAX_SENTENCE 128
+#define NMEA_QUEUE_LEN 64
+/** max sentences per write, at most a full queue */
+#define NMEA_MAX_BATCH NMEA_QUEUE_LEN
+
 /**
  * Open port
  */
@@ -606,6 +617,12 @@ void open_port(const char* device)
 
   /* write options back to port */
   tcsetattr(fd, TCSANOW, &options);
+
+  /* start writer thread, sentences of a message are sent with a single write */
+  if (serial_bridge_start(&bridge, fd, NMEA_MAX_SENTENCE, NMEA_QUEUE_LEN, batch, NULL, NULL) != 0) {
+    fprintf(stderr, "ERROR: IVY2NMEA: unable to start serial writer\n");
+    exit(EXIT_FAILURE);
+  }
 }
 
 /**
@@ -614,7 +631,9 @@ void open_port(const char* device)
 
 void write_port(char* buff, int len)
 {
-  write(fd, buff,len);
+  if (!serial_bridge_send(&bridge, buff, len) && verbose) {
+    printf("serial queue full, sentence dropped\n");
+  }
 }
 
 /**
@@ -623,6 +642,7 @@ void write_port(char* buff, int len)
 
 void close_port(void)
 {
+  serial_bridge_stop(&bridge);
   close(fd);
 }
 
@@ -652,7 +672,8 @@ gboolean parse_args(int argc, char** argv)
     "   -v --verbose                           Print verbose information\n"
     "   --id <ac_id>                           e.g. 1\n"
     "   --port <gps out port>                  e.g. /dev/ttyS0\n"
-    "   --ivy_bus <ivy bus>                    e.g. 127.255.255.255\n";
+    "   --ivy_bus <ivy bus>                    e.g. 127.255.255.255\n"
+    "   --batch <n>                            max sentences per serial write, 1 to 64 (default 2)\n";
 
   while (1) {
 
@@ -660,6 +681,7 @@ gboolean parse_args(int argc, char** argv)
       {"ivy_bus", 1, NULL, 0},
       {"id", 1, NULL, 0},
       {"port", 1, NULL, 0},
+      {"batch", 1, NULL, 0},
       {"help", 0, NULL, 'h'},
       {"verbose", 0, NULL, 'v'},
       {0, 0, 0, 0}
@@ -679,6 +701,16 @@ gboolean parse_args(int argc, char** argv)
             ac_id = strdup(optarg); break;
           case 2:
             port = strdup(optarg); break;
+          case 3: {
+            char *end;
+            unsigned long b = strtoul(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || b < 1 || b > NMEA_MAX_BATCH) {
+              fprintf(stderr, "ERROR: IVY2NMEA: --batch must be between 1 and %d\n", NMEA_MAX_BATCH);
+              exit(EXIT_FAILURE);
+            }
+            batch = (unsigned int)b;
+            break;
+          }
           default:
             break;
         }
@@ -18,6 +18,8 @@
 #include <Ivy/version.h>
 //#include <Ivy/ivyglibloop.h>
 
+#include "serial_bridge.h"
+
 
 #define Dprintf(X, ... )
 //#define Dprintf printf
@@ -42,9 +44,14 @@ char *port = "";
 long int count_ivy = 0;
 long int count_serial = 0;
 
-long int rx_bytes = 0;
 long int tx_bytes = 0;
-long int rx_error = 0;
+atomic_long rx_error = 0;   // updated by the serial reader thread
+
+// reader and writer threads, started after the modem configuration
+struct serial_bridge bridge;
+gboolean bridge_started = FALSE;
+#define SERIAL_QUEUE_LEN 64
+#define SERIAL_BATCH 4
 
 char modem_id[32] = "";
 int power_level = 4;
@@ -301,7 +308,8 @@ void send_ivy(void)
 
   count_serial++;
 
-  sprintf(status_serial_str, "Read %d from '%s': forwarding to IVY [%ld] {Rx=%ld} {Err=%ld}", remote_uav.ac_id, port,  count_serial, rx_bytes, rx_error);
+  sprintf(status_serial_str, "Read %d from '%s': forwarding to IVY [%ld] {Rx=%ld} {Err=%ld}", remote_uav.ac_id, port,  count_serial,
+          atomic_load(&bridge.stats.rx_bytes), atomic_load(&rx_error));
   gtk_label_set_text( GTK_LABEL(status_serial), status_serial_str );
 }
 
@@ -335,7 +343,6 @@ void open_port(const char* device) {
 }
 
 unsigned char* buf_tx = (unsigned char*) &local_uav;
-unsigned char* buf_rx = (unsigned char*) &remote_uav;
 
 void send_port(void)
 {
@@ -356,7 +363,9 @@ void send_port(void)
     local_uav.footer += buf_tx[i];
     Dprintf("%x ", buf_tx[i]);
   }
-  bytes = write(fd, &local_uav, sizeof(local_uav));
+  bytes = 0;
+  if (serial_bridge_send(&bridge, &local_uav, sizeof(local_uav)))
+    bytes = sizeof(local_uav);
 
   tx_bytes += bytes;
 
@@ -597,81 +606,70 @@ int handle_api(void)
 }
 
 
-void read_port(void)
+/// Frame decoder, called from the reader thread
+static size_t decode_uav(void *user, const uint8_t *buf, size_t len, uint8_t *frame, size_t *frame_len)
 {
-  int i;
-  static int counter = 0;
-  // Never ever read more than the available space
-  int readsize = sizeof(remote_uav) - counter;
-  int bytes = read(fd, buf_rx + counter, readsize);
-
-  // Init CRC
+  size_t i;
   unsigned char crc = 0;
 
-  // Dprintf("READ: %d bytes",bytes);
+  *frame_len = 0;
+  if (buf[0] != '@')
+  {
+    // resync on the next header
+    const uint8_t *head = memchr(buf, '@', len);
+    Dprintf("Header not found (%zu bytes skipped)\n", head ? (size_t)(head - buf) : len);
+    return head ? (size_t)(head - buf) : len;
+  }
+  if (len < sizeof(remote_uav))
+    return 0; // Wait for more data
 
-  if (bytes <= 0)
-    return;
+  for (i=0;i<(sizeof(remote_uav)-1);i++)
+  {
+    crc += buf[i];
+  }
+  if (buf[sizeof(remote_uav)-1] != crc)
+  {
+    Dprintf("Checksum Error\n");
+    atomic_fetch_add(&rx_error, 1);
+    return 1; // skip this header
+  }
+  memcpy(frame, buf, sizeof(remote_uav));
+  *frame_len = sizeof(remote_uav);
+  return sizeof(remote_uav);
+}
 
-  rx_bytes += bytes;
+/// Frame handler, called from the main loop
+static void on_uav_frame(void *user, const uint8_t *frame, size_t len)
+{
+  memcpy(&remote_uav, frame, sizeof(remote_uav));
+  Dprintf("RECEIVED %d (%zu bytes)\n",remote_uav.ac_id, len);
 
-  counter += bytes;
+  new_serial_data = 1;
 
-  if (counter >= sizeof(remote_uav))
-  {
-    if (buf_rx[0] != '@')
-    {
-      int head = 0;
-      for (head=0; head<sizeof(remote_uav);head++)
-      {
-        if (buf_rx[head] == '@')
-        {
-          Dprintf("Found header location %d\n",head);
-          break;
-        }
-      }
-      if (head<sizeof(remote_uav))
-      {
-        int movesize = (sizeof(remote_uav)-head);
-        memcpy(&buf_rx[0],&buf_rx[head],movesize );
-        Dprintf("Moved %d bytes to the front\n",movesize);
-      }
-      else
-      {
-        rx_error++;
-        Dprintf("Header Not Found at All (bytes=%d)\n",bytes);
-        for (i=0;i<counter;i++)
-        {
-          crc += buf_rx[i];
-          Dprintf("%x ", buf_rx[i]);
-        }
-        Dprintf("\n");
-      }
-      counter -= head;
-      return;
-      // Wait for more data
-    }
-    for (i=0;i<(sizeof(remote_uav)-1);i++)
-    {
-      crc += buf_rx[i];
-      Dprintf("%x ", buf_rx[i]);
-    }
-    if (buf_rx[sizeof(remote_uav)-1] != crc)
-    {
-      Dprintf("Checksum Error\n");
-      rx_error++;
-    }
-    Dprintf("RECEIVED %d (%d bytes)\n",remote_uav.ac_id, counter);
-    counter -= sizeof(remote_uav);
+  send_ivy();
+}
 
-    new_serial_data = 1;
+gboolean on_serial_data(GIOChannel *source, GIOCondition condition, gpointer data)
+{
+  serial_bridge_poll(&bridge, on_uav_frame, NULL);
+  return TRUE;
+}
 
-    send_ivy();
+void start_bridge(void)
+{
+  if (serial_bridge_start(&bridge, fd, sizeof(remote_uav), SERIAL_QUEUE_LEN, SERIAL_BATCH, decode_uav, NULL) != 0)
+  {
+    fprintf(stderr, "Unable to start serial bridge\n");
+    exit(EXIT_FAILURE);
   }
+  g_io_add_watch(g_io_channel_unix_new(serial_bridge_rx_fd(&bridge)), G_IO_IN, on_serial_data, NULL);
+  bridge_started = TRUE;
 }
 
 void close_port(void)
 {
+  if (bridge_started)
+    serial_bridge_stop(&bridge);
   close(fd);
 }
 
@@ -688,8 +686,9 @@ gboolean timeout_callback(gpointer data)
   if ((power_level >= 0) && (handle_api() == 0))
     return TRUE;
 
-  // Every Time
-  read_port();
+  // Reception is handled by the reader thread once the modem is configured
+  if (!bridge_started)
+    start_bridge();
 
   // One out of 4
   if (dispatch > 2)
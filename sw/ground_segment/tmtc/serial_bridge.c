@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file serial_bridge.c
+ * Serial bridge engine for the Ivy/serial tools.
+ */
+
+#include "serial_bridge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+/** Minimum size of the reception buffer */
+#define SB_RX_BUF_MIN 4096
+
+//////////////////////////////////////////////////////////////////////////////////
+// SPSC queue
+//////////////////////////////////////////////////////////////////////////////////
+
+int sb_queue_init(struct sb_queue *q, size_t slot_size, size_t nb)
+{
+  size_t n = 1;
+  while (n < nb) {
+    n <<= 1;
+  }
+  // frame length is stored in the first two bytes of each slot
+  q->slot_size = slot_size + 2;
+  q->nb = n;
+  q->data = malloc(q->slot_size * n);
+  atomic_init(&q->head, 0);
+  atomic_init(&q->tail, 0);
+  return (q->data == NULL) ? -1 : 0;
+}
+
+void sb_queue_free(struct sb_queue *q)
+{
+  free(q->data);
+  q->data = NULL;
+}
+
+bool sb_queue_push(struct sb_queue *q, const void *frame, size_t len)
+{
+  if (len > q->slot_size - 2) {
+    return false;
+  }
+  size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  size_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+  if (head - tail >= q->nb) {
+    return false; // full
+  }
+  uint8_t *slot = q->data + (head & (q->nb - 1)) * q->slot_size;
+  slot[0] = len & 0xff;
+  slot[1] = len >> 8;
+  memcpy(slot + 2, frame, len);
+  atomic_store_explicit(&q->head, head + 1, memory_order_release);
+  return true;
+}
+
+bool sb_queue_pop(struct sb_queue *q, void *frame, size_t *len)
+{
+  size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  size_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+  if (head == tail) {
+    return false; // empty
+  }
+  const uint8_t *slot = q->data + (tail & (q->nb - 1)) * q->slot_size;
+  *len = slot[0] | (slot[1] << 8);
+  memcpy(frame, slot + 2, *len);
+  atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// SERIAL PORT
+//////////////////////////////////////////////////////////////////////////////////
+
+int serial_bridge_open_port(const char *device, speed_t speed)
+{
+  int fd = open(device, O_RDWR | O_NOCTTY);
+  if (fd == -1) {
+    return -1;
+  }
+  struct termios options;
+  if (tcgetattr(fd, &options) == 0) {
+    cfmakeraw(&options);
+    options.c_cflag |= CLOCAL | CREAD;
+    options.c_cc[VMIN] = 1;
+    options.c_cc[VTIME] = 0;
+    cfsetispeed(&options, speed);
+    cfsetospeed(&options, speed);
+    tcsetattr(fd, TCSANOW, &options);
+  }
+  return fd;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// THREADS
+//////////////////////////////////////////////////////////////////////////////////
+
+static void *reader_thread(void *arg)
+{
+  struct serial_bridge *sb = (struct serial_bridge *)arg;
+  size_t size = sb->max_frame * 4 > SB_RX_BUF_MIN ? sb->max_frame * 4 : SB_RX_BUF_MIN;
+  uint8_t *buf = malloc(size);
+  uint8_t *frame = malloc(sb->max_frame);
+  size_t start = 0, end = 0;
+  if (buf == NULL || frame == NULL) {
+    fprintf(stderr, "serial_bridge: unable to allocate the read buffers (%zu bytes), reader stopped\n",
+            size + sb->max_frame);
+  }
+  // the stop pipe is closed by serial_bridge_stop to end a wait on the port
+  struct pollfd fds[2] = {
+    { .fd = sb->fd, .events = POLLIN },
+    { .fd = sb->stop_notify[0], .events = POLLIN }
+  };
+
+  while (buf != NULL && frame != NULL && atomic_load(&sb->running)) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents != 0 || !atomic_load(&sb->running)) {
+      break;
+    }
+    if (end == size) {
+      if (start == 0) {
+        start = end = 0; // no frame in a full buffer, drop it
+      } else {
+        memmove(buf, buf + start, end - start);
+        end -= start;
+        start = 0;
+      }
+    }
+    ssize_t n = read(sb->fd, buf + end, size - end);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break; // port closed
+    }
+    end += n;
+    atomic_fetch_add(&sb->stats.rx_bytes, n);
+
+    // decode all available frames
+    int pushed = 0;
+    while (start < end) {
+      size_t frame_len = 0;
+      size_t used = sb->decode(sb->user, buf + start, end - start, frame, &frame_len);
+      if (used == 0) {
+        break;
+      }
+      start += used;
+      if (frame_len > 0) {
+        if (sb_queue_push(&sb->rx, frame, frame_len)) {
+          atomic_fetch_add(&sb->stats.rx_frames, 1);
+          pushed++;
+        } else {
+          atomic_fetch_add(&sb->stats.rx_dropped, 1);
+        }
+      }
+    }
+    if (start == end) {
+      start = end = 0;
+    }
+    // wake up the Ivy thread once for all the frames it has not seen yet
+    if (pushed > 0 && !atomic_exchange(&sb->rx_pending, true)) {
+      if (write(sb->rx_notify[1], "r", 1) < 0) {
+        atomic_store(&sb->rx_pending, false);
+      }
+    }
+  }
+  free(buf);
+  free(frame);
+  return NULL;
+}
+
+static void *writer_thread(void *arg)
+{
+  struct serial_bridge *sb = (struct serial_bridge *)arg;
+  uint8_t *out = malloc(sb->max_frame * sb->batch);
+  char c;
+  if (out == NULL) {
+    fprintf(stderr, "serial_bridge: unable to allocate the write buffer (%zu bytes), writer stopped\n",
+            sb->max_frame * sb->batch);
+  }
+
+  while (out != NULL && atomic_load(&sb->running)) {
+    ssize_t n = read(sb->tx_notify[0], &c, 1);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    // send all queued frames, up to batch frames per write
+    for (;;) {
+      size_t len = 0, frame_len;
+      unsigned int nb = 0;
+      while (nb < sb->batch && sb_queue_pop(&sb->tx, out + len, &frame_len)) {
+        len += frame_len;
+        nb++;
+      }
+      if (nb == 0) {
+        break;
+      }
+      size_t done = 0;
+      while (done < len) {
+        ssize_t w = write(sb->fd, out + done, len - done);
+        if (w < 0 && errno == EINTR) {
+          continue;
+        }
+        if (w <= 0) {
+          break;
+        }
+        done += w;
+      }
+      atomic_fetch_add(&sb->stats.tx_bytes, done);
+      atomic_fetch_add(&sb->stats.tx_frames, nb);
+      atomic_fetch_add(&sb->stats.tx_writes, 1);
+    }
+  }
+  free(out);
+  return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+// BRIDGE
+//////////////////////////////////////////////////////////////////////////////////
+
+int serial_bridge_start(struct serial_bridge *sb, int fd, size_t max_frame, size_t queue_len,
+                        unsigned int batch, sb_decoder decode, void *user)
+{
+  memset(sb, 0, sizeof(*sb));
+  sb->fd = fd;
+  sb->max_frame = max_frame;
+  sb->batch = batch > 0 ? batch : 1;
+  sb->decode = decode;
+  sb->user = user;
+  atomic_init(&sb->rx_pending, false);
+  atomic_init(&sb->running, true);
+
+  // threads use blocking I/O
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+  if (sb_queue_init(&sb->rx, max_frame, queue_len) != 0 ||
+      sb_queue_init(&sb->tx, max_frame, queue_len) != 0 ||
+      pipe(sb->rx_notify) != 0 || pipe(sb->tx_notify) != 0 || pipe(sb->stop_notify) != 0) {
+    return -1;
+  }
+  sb->frame = malloc(max_frame);
+  if (sb->frame == NULL) {
+    return -1;
+  }
+  fcntl(sb->rx_notify[0], F_SETFL, O_NONBLOCK);
+  fcntl(sb->tx_notify[1], F_SETFL, O_NONBLOCK);
+
+  if (pthread_create(&sb->writer, NULL, writer_thread, sb) != 0) {
+    return -1;
+  }
+  if (decode != NULL) {
+    if (pthread_create(&sb->reader, NULL, reader_thread, sb) != 0) {
+      return -1;
+    }
+    sb->has_reader = true;
+  }
+  return 0;
+}
+
+void serial_bridge_stop(struct serial_bridge *sb)
+{
+  atomic_store(&sb->running, false);
+  // wake up both threads, they free their buffers before returning
+  close(sb->tx_notify[1]);
+  close(sb->stop_notify[1]);
+  pthread_join(sb->writer, NULL);
+  if (sb->has_reader) {
+    pthread_join(sb->reader, NULL);
+  }
+  close(sb->tx_notify[0]);
+  close(sb->stop_notify[0]);
+  close(sb->rx_notify[0]);
+  close(sb->rx_notify[1]);
+  free(sb->frame);
+  sb->frame = NULL;
+  sb_queue_free(&sb->rx);
+  sb_queue_free(&sb->tx);
+}
+
+size_t serial_bridge_poll(struct serial_bridge *sb, sb_handler handler, void *user)
+{
+  size_t len, nb = 0;
+  char c;
+  // consume the wake up byte before clearing the flag,
+  // so that frames pushed after this point trigger a new one
+  while (read(sb->rx_notify[0], &c, 1) > 0);
+  atomic_store(&sb->rx_pending, false);
+  while (sb_queue_pop(&sb->rx, sb->frame, &len)) {
+    handler(user, sb->frame, len);
+    nb++;
+  }
+  return nb;
+}
+
+bool serial_bridge_send(struct serial_bridge *sb, const void *frame, size_t len)
+{
+  if (!sb_queue_push(&sb->tx, frame, len)) {
+    atomic_fetch_add(&sb->stats.tx_dropped, 1);
+    return false;
+  }
+  // nothing to do if the pipe is full, the writer is already awake
+  ssize_t ret __attribute__((unused)) = write(sb->tx_notify[1], "t", 1);
+  return true;
+}
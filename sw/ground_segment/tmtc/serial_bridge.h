@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file serial_bridge.h
+ * Serial bridge engine for the Ivy/serial tools.
+ *
+ * A reader thread waits for data on the serial port, decodes the frames
+ * with a user function and hands them to the Ivy (main loop) thread through
+ * a single producer / single consumer lock-free queue.
+ * The Ivy thread is woken up by a file descriptor that can be watched
+ * from the glib main loop, so no polling is needed.
+ * In the other direction, frames queued by the Ivy thread are written
+ * by a writer thread, several frames per write (batching).
+ *
+ * Works on any file descriptor (serial port, pty, pipe).
+ */
+
+#ifndef SERIAL_BRIDGE_H
+#define SERIAL_BRIDGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <termios.h>
+
+/** Single producer / single consumer queue of fixed size slots */
+struct sb_queue {
+  uint8_t *data;          ///< nb slots of slot_size bytes
+  size_t slot_size;       ///< bytes per slot (frame length stored in the first 2 bytes)
+  size_t nb;              ///< number of slots, power of 2
+  atomic_size_t head;     ///< next slot to write, only written by the producer
+  atomic_size_t tail;     ///< next slot to read, only written by the consumer
+};
+
+/** Frame decoder
+ * @param user user data
+ * @param buf received bytes
+ * @param len number of bytes in buf
+ * @param frame output frame (max_frame bytes)
+ * @param frame_len output frame length
+ * @return number of bytes consumed, 0 if more bytes are needed
+ *         (a frame is valid only if frame_len > 0)
+ */
+typedef size_t (*sb_decoder)(void *user, const uint8_t *buf, size_t len, uint8_t *frame, size_t *frame_len);
+
+/** Frame handler, called from the Ivy thread */
+typedef void (*sb_handler)(void *user, const uint8_t *frame, size_t len);
+
+struct serial_bridge_stats {
+  atomic_long rx_bytes;
+  atomic_long rx_frames;
+  atomic_long rx_dropped;   ///< frames lost because the queue was full
+  atomic_long tx_bytes;
+  atomic_long tx_frames;
+  atomic_long tx_dropped;
+  atomic_long tx_writes;    ///< number of write calls
+};
+
+struct serial_bridge {
+  int fd;                   ///< serial port
+  struct sb_queue rx;       ///< decoded frames, reader thread -> Ivy thread
+  struct sb_queue tx;       ///< frames to send, Ivy thread -> writer thread
+  size_t max_frame;         ///< max frame length
+  unsigned int batch;       ///< max number of frames per write
+  sb_decoder decode;
+  void *user;
+  int rx_notify[2];         ///< pipe to wake up the Ivy thread
+  int tx_notify[2];         ///< pipe to wake up the writer thread
+  int stop_notify[2];       ///< pipe to wake up the reader thread on stop
+  uint8_t *frame;           ///< frame buffer of serial_bridge_poll
+  atomic_bool rx_pending;   ///< a wake up byte is in rx_notify
+  atomic_bool running;
+  bool has_reader;
+  pthread_t reader;
+  pthread_t writer;
+  struct serial_bridge_stats stats;
+};
+
+/** Open a serial port in blocking mode (8N1, raw)
+ * @return file descriptor or -1
+ */
+extern int serial_bridge_open_port(const char *device, speed_t speed);
+
+/** Start the bridge threads
+ * @param sb bridge
+ * @param fd opened port
+ * @param max_frame max frame length in both directions
+ * @param queue_len number of frames in each queue (rounded to a power of 2)
+ * @param batch max number of frames per write
+ * @param decode frame decoder, NULL for write only
+ * @param user user data for decoder
+ * @return 0 on success
+ */
+extern int serial_bridge_start(struct serial_bridge *sb, int fd, size_t max_frame, size_t queue_len,
+                               unsigned int batch, sb_decoder decode, void *user);
+
+/** Stop the threads and free the queues (the port is not closed) */
+extern void serial_bridge_stop(struct serial_bridge *sb);
+
+/** File descriptor readable when frames have been received,
+ *  to be watched from the main loop before calling serial_bridge_poll
+ */
+static inline int serial_bridge_rx_fd(struct serial_bridge *sb)
+{
+  return sb->rx_notify[0];
+}
+
+/** Handle all received frames, from the Ivy thread
+ * @return number of frames handled
+ */
+extern size_t serial_bridge_poll(struct serial_bridge *sb, sb_handler handler, void *user);
+
+/** Queue a frame to send, from the Ivy thread
+ * @return false if the queue is full or the frame too long
+ */
+extern bool serial_bridge_send(struct serial_bridge *sb, const void *frame, size_t len);
+
+/** Queue functions, exported for reuse and tests */
+extern int sb_queue_init(struct sb_queue *q, size_t slot_size, size_t nb);
+extern void sb_queue_free(struct sb_queue *q);
+extern bool sb_queue_push(struct sb_queue *q, const void *frame, size_t len);
+extern bool sb_queue_pop(struct sb_queue *q, void *frame, size_t *len);
+
+#endif /* SERIAL_BRIDGE_H */
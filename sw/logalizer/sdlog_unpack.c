@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file sdlog_unpack.c
+ * Decode the compressed logs of the ChibiOS SD logger (SDLOG_COMPRESS)
+ *
+ * usage:
+ *   sdlog_unpack <input> <output>      decode a log, uncompressed logs are copied
+ *   sdlog_unpack -b <raw log> [block]  compression round trip and throughput on a raw log
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "modules/loggers/sdlog_chibios/sdLogCompress.h"
+
+static uint8_t *read_file(const char *name, size_t *len)
+{
+  FILE *f = fopen(name, "rb");
+  if (f == NULL) {
+    return NULL;
+  }
+  fseek(f, 0L, SEEK_END);
+  *len = ftell(f);
+  fseek(f, 0L, SEEK_SET);
+  uint8_t *buf = malloc(*len + 1);
+  if (buf != NULL && fread(buf, 1, *len, f) != *len) {
+    free(buf);
+    buf = NULL;
+  }
+  fclose(f);
+  return buf;
+}
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int unpack(const char *in_name, const char *out_name)
+{
+  size_t len, idx = 0, nb_blocks = 0, nb_err = 0, out_len = 0;
+  uint8_t *in = read_file(in_name, &len);
+  if (in == NULL) {
+    fprintf(stderr, "sdlog_unpack: can't read %s\n", in_name);
+    return EXIT_FAILURE;
+  }
+  FILE *out = fopen(out_name, "wb");
+  if (out == NULL) {
+    fprintf(stderr, "sdlog_unpack: can't open %s\n", out_name);
+    return EXIT_FAILURE;
+  }
+  if (len < 2 || in[0] != SDLOG_BLOCK_MAGIC0 || in[1] != SDLOG_BLOCK_MAGIC1) {
+    // not compressed
+    fwrite(in, 1, len, out);
+    fclose(out);
+    printf("%s is not compressed, copied to %s\n", in_name, out_name);
+    return EXIT_SUCCESS;
+  }
+
+  static uint8_t block[SDLOG_BLOCK_MAX_LEN], raw[SDLOG_BLOCK_MAX_LEN];
+  static struct SdLogDeltaHistory hist;
+  while (idx < len) {
+    size_t consumed;
+    uint8_t flags;
+    int32_t n = sdLogDecompressBlock(&in[idx], len - idx, block, &consumed, &flags);
+    if (n >= 0 && (flags & SDLOG_BLOCK_DELTA)) {
+      n = sdLogUndeltaBlock(&hist, block, n, raw, sizeof(raw));
+      n = n < 0 ? -2 : n;
+    } else if (n >= 0) {
+      memcpy(raw, block, n);
+    }
+    if (n >= 0) {
+      fwrite(raw, 1, n, out);
+      out_len += n;
+      idx += consumed;
+      nb_blocks++;
+    } else if (n == -1) {
+      // truncated block at the end of the file (power loss)
+      break;
+    } else {
+      // corrupted block, search the next one
+      nb_err++;
+      idx++;
+      while (idx + 1 < len && !(in[idx] == SDLOG_BLOCK_MAGIC0 && in[idx + 1] == SDLOG_BLOCK_MAGIC1)) {
+        idx++;
+      }
+    }
+  }
+  fclose(out);
+  printf("%zu blocks, %zu -> %zu bytes, %zu corrupted blocks, %zu bytes not decoded\n",
+         nb_blocks, len, out_len, nb_err, len - idx);
+  return nb_err == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/** length of the next record as sent by the logger:
+ *  a pprzlog frame (STX, LEN ...) or a text line
+ */
+static size_t next_record(const uint8_t *buf, size_t len)
+{
+  if (len >= 2 && buf[0] == 0x99 && buf[1] >= 4 && buf[1] <= len) {
+    return buf[1];
+  }
+  size_t n = 0;
+  while (n < len && n < 255 && buf[n++] != '\n');
+  return n;
+}
+
+static int bench(const char *in_name, size_t block)
+{
+  size_t len;
+  uint8_t *in = read_file(in_name, &len);
+  if (in == NULL) {
+    fprintf(stderr, "sdlog_unpack: can't read %s\n", in_name);
+    return EXIT_FAILURE;
+  }
+  if (block < 512 || block > SDLOG_BLOCK_MAX_LEN) {
+    block = SDLOG_BLOCK_MAX_LEN;
+  }
+  uint8_t *comp = malloc(2 * len + 1024);
+  uint8_t *buf = malloc(block);
+  uint8_t *raw = malloc(SDLOG_BLOCK_MAX_LEN);
+  static struct SdLogDeltaHistory hist;
+  static struct SdLogCompressWork work;
+  size_t clen = 0, fill = 0, nb_rec = 0;
+
+  // same block building as the logger thread: whole records, history reset per block
+  double t0 = now();
+  sdLogDeltaReset(&hist);
+  for (size_t idx = 0; idx < len;) {
+    const size_t n = next_record(&in[idx], len - idx);
+    if (fill + SDLOG_DELTA_BOUND(n) > block) {
+      clen += sdLogCompressBlock(buf, fill, SDLOG_BLOCK_DELTA, &comp[clen], &work);
+      sdLogDeltaReset(&hist);
+      fill = 0;
+    }
+    fill += sdLogDeltaRecord(&hist, &in[idx], n, &buf[fill]);
+    idx += n;
+    nb_rec++;
+  }
+  if (fill) {
+    clen += sdLogCompressBlock(buf, fill, SDLOG_BLOCK_DELTA, &comp[clen], &work);
+  }
+  const double t_comp = now() - t0;
+
+  t0 = now();
+  size_t cidx = 0, ridx = 0, consumed;
+  uint8_t flags;
+  int ok = 1;
+  while (cidx < clen) {
+    int32_t r = sdLogDecompressBlock(&comp[cidx], clen - cidx, buf, &consumed, &flags);
+    if (r >= 0) {
+      r = sdLogUndeltaBlock(&hist, buf, r, raw, SDLOG_BLOCK_MAX_LEN);
+    }
+    if (r < 0 || ridx + r > len || memcmp(raw, &in[ridx], r) != 0) {
+      ok = 0;
+      break;
+    }
+    cidx += consumed;
+    ridx += r;
+  }
+  const double t_dec = now() - t0;
+  ok = ok && ridx == len;
+
+  printf("%s: %zu records, %zu -> %zu bytes (ratio %.2f) with %zu bytes blocks\n",
+         in_name, nb_rec, len, clen, (double) len / clen, block);
+  printf("compress %.1f MB/s, decompress %.1f MB/s, round trip %s\n",
+         len / t_comp / 1e6, len / t_dec / 1e6, ok ? "OK" : "FAILED");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+int main(int argc, char *argv[])
+{
+  if (argc >= 3 && strcmp(argv[1], "-b") == 0) {
+    return bench(argv[2], argc > 3 ? (size_t) atoi(argv[3]) : 4096);
+  }
+  if (argc != 3) {
+    puts("usage: sdlog_unpack <input> <output>\n"
+         "       sdlog_unpack -b <raw log> [block size]");
+    return EXIT_FAILURE;
+  }
+  return unpack(argv[1], argv[2]);
+}
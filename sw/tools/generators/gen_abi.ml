@@ -92,7 +92,35 @@ module Gen_onboard = struct
   let print_struct = fun h size ->
     Printf.fprintf h "\n/* Array and linked list structure */\n";
     Printf.fprintf h "#define ABI_MESSAGE_NB %d\n\n" (size+1);
-    Printf.fprintf h "ABI_EXTERN abi_event* abi_queues[ABI_MESSAGE_NB];\n"
+    Printf.fprintf h "#if !ABI_USE_STRUCT\n";
+    Printf.fprintf h "ABI_EXTERN abi_event* abi_queues[ABI_MESSAGE_NB];\n";
+    Printf.fprintf h "#endif\n";
+    Printf.fprintf h "#if ABI_STATS\n";
+    Printf.fprintf h "ABI_EXTERN struct abi_stats abi_stats[ABI_MESSAGE_NB];\n";
+    Printf.fprintf h "#endif\n"
+
+  (* Print message structures, fields in declaration order *)
+  let print_msg_structs = fun h messages ->
+    Printf.fprintf h "\n/* Message structures */\n";
+    List.iter (fun msg ->
+      Printf.fprintf h "struct AbiMsg%s {\n" (Compat.capitalize_ascii msg.name);
+      if msg.fields = [] then Printf.fprintf h "  uint8_t unused;\n";
+      List.iter (fun (n, t) -> Printf.fprintf h "  %s %s;\n" t n) msg.fields;
+      Printf.fprintf h "};\n"
+    ) messages
+
+  (* Print subscriber arrays (struct mode) *)
+  let print_subscribers = fun h messages ->
+    Printf.fprintf h "\n#if ABI_USE_STRUCT\n";
+    Printf.fprintf h "/* Subscriber arrays, size can be set per message */\n";
+    List.iter (fun msg ->
+      let name = Compat.capitalize_ascii msg.name in
+      let size = sprintf "ABI_%s_SUBSCRIBERS" name in
+      Printf.fprintf h "#ifndef %s\n#define %s ABI_MAX_SUBSCRIBERS\n#endif\n" size size;
+      Printf.fprintf h "ABI_EXTERN struct abi_subscriber abi_subscribers%s[%s];\n" name size;
+      Printf.fprintf h "ABI_EXTERN uint8_t abi_nb_subscribers%s;\n" name
+    ) messages;
+    Printf.fprintf h "#endif\n"
 
   (* Print arguments' function from fields *)
   let print_args = fun h fields ->
@@ -105,16 +133,23 @@ module Gen_onboard = struct
     Printf.fprintf h "(uint8_t sender_id";
     args h fields
 
+  (* Print arguments' call from fields, with optional prefix *)
+  let print_call_args = fun h prefix fields ->
+    List.iter (fun (n, _) -> Printf.fprintf h ", %s%s" prefix n) fields;
+    Printf.fprintf h ");\n"
+
   (* Print callbacks prototypes for all messages *)
   let print_callbacks = fun h messages ->
     Printf.fprintf h "\n/* Callbacks */\n";
     List.iter (fun msg ->
-      Printf.fprintf h "typedef void (*abi_callback%s)" (Compat.capitalize_ascii msg.name);
+      let name = Compat.capitalize_ascii msg.name in
+      Printf.fprintf h "typedef void (*abi_callback%s)" name;
       print_args h msg.fields;
       Printf.fprintf h ";\n";
+      Printf.fprintf h "typedef void (*abi_ptr_callback%s)(uint8_t sender_id, const struct AbiMsg%s *msg);\n" name name
     ) messages
 
-  (* Print a bind function *)
+  (* Print a bind function (linked list) *)
   let print_msg_bind = fun h msg ->
     let name = Compat.capitalize_ascii msg.name in
     Printf.fprintf h "\nstatic inline void AbiBindMsg%s(uint8_t sender_id, abi_event * ev, abi_callback%s cb) {\n" name name;
@@ -124,36 +159,88 @@ module Gen_onboard = struct
     Printf.fprintf h "  ABI_PREPEND(abi_queues[ABI_%s_ID],ev);\n" name;
     Printf.fprintf h "}\n"
 
-  (* Print a send function *)
+  (* Print a send function (linked list) *)
   let print_msg_send = fun h msg ->
-    (* print arguments *)
-    let rec args = fun h l ->
-      match l with
-          [] -> Printf.fprintf h ");\n"
-        | [(n,_)] -> Printf.fprintf h ", %s);\n" n
-        | (n,_)::l' -> Printf.fprintf h ", %s" n; args h l'
-    in
     let name = Compat.capitalize_ascii msg.name in
     Printf.fprintf h "\nstatic inline void AbiSendMsg%s" name;
     print_args h msg.fields;
     Printf.fprintf h " {\n";
     Printf.fprintf h "  abi_event* e;\n";
+    Printf.fprintf h "  ABI_STATS_START(ABI_%s_ID);\n" name;
     Printf.fprintf h "  ABI_FOREACH(abi_queues[ABI_%s_ID],e) {\n" name;
     Printf.fprintf h "    if (e->id == ABI_BROADCAST || e->id == sender_id) {\n";
     Printf.fprintf h "      abi_callback%s cb = (abi_callback%s)(e->cb);\n" name name;
     Printf.fprintf h "      cb(sender_id";
-    args h msg.fields;
+    print_call_args h "" msg.fields;
+    Printf.fprintf h "      ABI_STATS_DISPATCH(ABI_%s_ID);\n" name;
     Printf.fprintf h "    }\n";
     Printf.fprintf h "  }\n";
+    Printf.fprintf h "  ABI_STATS_END(ABI_%s_ID);\n" name;
+    Printf.fprintf h "}\n";
+    (* send from a structure, unpacked for the callbacks *)
+    Printf.fprintf h "\nstatic inline void AbiSendMsgPtr%s(uint8_t sender_id, const struct AbiMsg%s *msg) {\n" name name;
+    if msg.fields = [] then Printf.fprintf h "  (void) msg;\n";
+    Printf.fprintf h "  AbiSendMsg%s(sender_id" name;
+    print_call_args h "msg->" msg.fields;
+    Printf.fprintf h "}\n"
+
+  (* Print bind functions (struct mode) *)
+  let print_msg_bind_struct = fun h msg ->
+    let name = Compat.capitalize_ascii msg.name in
+    let size = sprintf "ABI_%s_SUBSCRIBERS" name in
+    Printf.fprintf h "\nstatic inline void AbiBindMsg%s(uint8_t sender_id, abi_event * ev, abi_callback%s cb) {\n" name name;
+    Printf.fprintf h "  abi_bind_subscriber(abi_subscribers%s, &abi_nb_subscribers%s, %s, sender_id, ev, (abi_callback)cb, false);\n" name name size;
+    Printf.fprintf h "}\n";
+    Printf.fprintf h "\nstatic inline void AbiBindMsgPtr%s(uint8_t sender_id, abi_event * ev, abi_ptr_callback%s cb) {\n" name name;
+    Printf.fprintf h "  abi_bind_subscriber(abi_subscribers%s, &abi_nb_subscribers%s, %s, sender_id, ev, (abi_callback)cb, true);\n" name name size;
+    Printf.fprintf h "}\n"
+
+  (* Print send functions (struct mode) *)
+  let print_msg_send_struct = fun h msg ->
+    let name = Compat.capitalize_ascii msg.name in
+    Printf.fprintf h "\nstatic inline void AbiSendMsgPtr%s(uint8_t sender_id, const struct AbiMsg%s *msg) {\n" name name;
+    Printf.fprintf h "  const struct abi_subscriber *s = abi_subscribers%s;\n" name;
+    Printf.fprintf h "  const struct abi_subscriber *end = s + abi_nb_subscribers%s;\n" name;
+    Printf.fprintf h "  ABI_STATS_START(ABI_%s_ID);\n" name;
+    Printf.fprintf h "  for (; s < end; s++) {\n";
+    Printf.fprintf h "    if (s->id == ABI_BROADCAST || s->id == sender_id) {\n";
+    Printf.fprintf h "      if (s->ptr) {\n";
+    Printf.fprintf h "        ((abi_ptr_callback%s)(s->cb))(sender_id, msg);\n" name;
+    Printf.fprintf h "      } else {\n";
+    Printf.fprintf h "        ((abi_callback%s)(s->cb))(sender_id" name;
+    print_call_args h "msg->" msg.fields;
+    Printf.fprintf h "      }\n";
+    Printf.fprintf h "      ABI_STATS_DISPATCH(ABI_%s_ID);\n" name;
+    Printf.fprintf h "    }\n";
+    Printf.fprintf h "  }\n";
+    Printf.fprintf h "  ABI_STATS_END(ABI_%s_ID);\n" name;
+    Printf.fprintf h "}\n";
+    Printf.fprintf h "\nstatic inline void AbiSendMsg%s" name;
+    print_args h msg.fields;
+    Printf.fprintf h " {\n";
+    if msg.fields = [] then
+      Printf.fprintf h "  const struct AbiMsg%s msg = { 0 };\n" name
+    else begin
+      Printf.fprintf h "  const struct AbiMsg%s msg = { " name;
+      Printf.fprintf h "%s };\n" (String.concat ", " (List.map fst msg.fields))
+    end;
+    Printf.fprintf h "  AbiSendMsgPtr%s(sender_id, &msg);\n" name;
     Printf.fprintf h "}\n"
 
   (* Print bind and send functions for all messages *)
   let print_bind_send = fun h messages ->
     Printf.fprintf h "\n/* Bind and Send functions */\n";
+    Printf.fprintf h "\n#if ABI_USE_STRUCT\n";
+    List.iter (fun msg ->
+      print_msg_bind_struct h msg;
+      print_msg_send_struct h msg
+    ) messages;
+    Printf.fprintf h "\n#else /* linked list */\n";
     List.iter (fun msg ->
       print_msg_bind h msg;
       print_msg_send h msg
-    ) messages
+    ) messages;
+    Printf.fprintf h "\n#endif /* ABI_USE_STRUCT */\n"
 
 end (* module Gen_onboard *)
 
@@ -190,9 +277,13 @@ let () =
     (** Print general structure definition *)
     Gen_onboard.print_struct h highest_id;
 
-    (** Print Messages callbacks definition *)
+    (** Print Messages structures and callbacks definition *)
+    Gen_onboard.print_msg_structs h messages;
     Gen_onboard.print_callbacks h messages;
 
+    (** Print subscribers arrays for struct mode *)
+    Gen_onboard.print_subscribers h messages;
+
     (** Print Bind and Send functions for all messages *)
     Gen_onboard.print_bind_send h messages;
 
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2020 Paparazzi Team
+#
+# This file is part of paparazzi.
+#
+# paparazzi is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# paparazzi is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with paparazzi; see the file COPYING.  If not, see
+# <http://www.gnu.org/licenses/>.
+#
+
+"""
+Generate a geoid separation grid header from the EGM96 15' model (WW15MGH.DAC)
+for use with math/pprz_geodetic_geoid.h
+
+The source file is a 721x1440 array of big endian int16 in cm,
+rows from north (+90deg) to south (-90deg), columns from 0deg eastward.
+The generated grid has rows from south to north and columns from -180deg eastward.
+"""
+
+from __future__ import print_function
+
+import argparse
+import bz2
+import os
+import struct
+import sys
+
+SRC_NB_LAT = 721
+SRC_NB_LON = 1440
+SRC_PER_DEG = 4
+
+
+def read_egm96(path):
+    opener = bz2.open if path.endswith('.bz2') else open
+    with opener(path, 'rb') as f:
+        raw = f.read(SRC_NB_LAT * SRC_NB_LON * 2)
+    if len(raw) != SRC_NB_LAT * SRC_NB_LON * 2:
+        sys.exit("Error: unexpected size for %s" % path)
+    return struct.unpack('>%dh' % (SRC_NB_LAT * SRC_NB_LON), raw)
+
+
+def resample(src, resolution):
+    """Sample the source model at the grid nodes (resolution in deg, multiple of 0.25)"""
+    k = int(round(resolution * SRC_PER_DEG))
+    nb_lat = 180 * SRC_PER_DEG // k + 1
+    nb_lon = 360 * SRC_PER_DEG // k
+    grid = []
+    for i in range(nb_lat):
+        row = SRC_NB_LAT - 1 - i * k  # from south pole
+        for j in range(nb_lon):
+            col = (j * k + 180 * SRC_PER_DEG) % SRC_NB_LON  # from -180deg
+            grid.append(src[row * SRC_NB_LON + col])
+    return nb_lat, nb_lon, grid
+
+
+def write_header(out, src_name, resolution, nb_lat, nb_lon, grid):
+    out.write("/* This file has been generated by gen_geoid.py from %s */\n" % src_name)
+    out.write("/* Please DO NOT EDIT */\n\n")
+    out.write("#ifndef GEOID_GRID_H\n#define GEOID_GRID_H\n\n")
+    out.write("#define GEOID_GRID_RESOLUTION %s\n" % resolution)
+    out.write("#define GEOID_GRID_NB_LAT %d\n" % nb_lat)
+    out.write("#define GEOID_GRID_NB_LON %d\n" % nb_lon)
+    out.write("#define GEOID_GRID_STEP %d\n\n" % int(round(resolution * 1e7)))
+    out.write("/* geoid separation in cm, rows from south to north, columns from -180deg eastward */\n")
+    out.write("static const int16_t geoid_grid_data[GEOID_GRID_NB_LAT * GEOID_GRID_NB_LON] = {\n")
+    for i in range(nb_lat):
+        row = grid[i * nb_lon:(i + 1) * nb_lon]
+        for j in range(0, nb_lon, 16):
+            out.write("  " + ", ".join("%d" % v for v in row[j:j + 16]) + ",\n")
+    out.write("};\n\n#endif /* GEOID_GRID_H */\n")
+
+
+def main():
+    home = os.getenv("PAPARAZZI_HOME", os.path.normpath(os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), '../../..')))
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('-r', '--resolution', type=float, default=2.5,
+                        help="grid step in degrees, multiple of 0.25 (default: 2.5)")
+    parser.add_argument('-i', '--input', default=os.path.join(home, 'data', 'srtm', 'WW15MGH.DAC.bz2'),
+                        help="EGM96 15' grid file (WW15MGH.DAC, optionally bz2 compressed)")
+    parser.add_argument('-o', '--output', help="output header (default: stdout)")
+    args = parser.parse_args()
+
+    k = args.resolution * SRC_PER_DEG
+    if k < 1 or abs(k - round(k)) > 1e-9 or (180 * SRC_PER_DEG) % int(round(k)) != 0:
+        sys.exit("Error: resolution must be a multiple of 0.25deg dividing 180deg")
+
+    src = read_egm96(args.input)
+    nb_lat, nb_lon, grid = resample(src, args.resolution)
+    if args.output:
+        with open(args.output, 'w') as out:
+            write_header(out, os.path.basename(args.input), args.resolution, nb_lat, nb_lon, grid)
+    else:
+        write_header(sys.stdout, os.path.basename(args.input), args.resolution, nb_lat, nb_lon, grid)
+
+
+if __name__ == '__main__':
+    main()
@@ -48,6 +48,77 @@ let rec flatten = fun xml r ->
 
 module StringSet = Set.Make(struct type t = string let compare = compare end)
 
+(** Short name of a setting (16 chars max), used as MAVLink parameter id *)
+let short_name = fun s ->
+  let varname = Str.split (Str.regexp "[_.]+") (ExtXml.attrib s "var") in
+  let shortname = List.fold_left (fun acc c ->
+    try acc ^"_"^ (Str.first_chars c 3) with _ -> acc ^"_"^ c
+  ) "" varname in
+  try String.sub shortname 1 16 with _ -> String.sub shortname 1 ((String.length shortname)-1)
+
+(** FNV-1a hash of a name, 32 bits, with a seed (0 for the default basis)
+ *  Must be the same as settings_hash in the generated code.
+ *)
+let settings_hash = fun seed name ->
+  let h = ref (if seed = 0 then 0x811c9dc5 else seed) in
+  String.iter (fun c -> h := ((!h lxor (Char.code c)) * 0x01000193) land 0xffffffff) name;
+  !h
+
+(** Minimal perfect hash (hash and displace)
+ *  The keys are spread in n buckets with the default hash. For each bucket,
+ *  largest first, a seed is searched so that all its keys go in free slots.
+ *  Buckets with a single key are put directly in a free slot (negative value).
+ *  @return displacement table and key index of each slot
+ *)
+let perfect_hash = fun keys ->
+  let n = Array.length keys in
+  let buckets = Array.make n [] in
+  Array.iteri (fun i k ->
+    let b = (settings_hash 0 k) mod n in
+    buckets.(b) <- buckets.(b) @ [i]) keys;
+  let order = List.stable_sort
+      (fun a b -> compare (List.length buckets.(b)) (List.length buckets.(a)))
+      (Array.to_list (Array.init n (fun i -> i))) in
+  let g = Array.make n 0
+  and slots = Array.make n (-1) in
+  let rec distinct = function
+      [] -> true
+    | p :: ps -> not (List.mem p ps) && distinct ps in
+  List.iter (fun b ->
+    let items = buckets.(b) in
+    if List.length items > 1 then begin
+      let rec try_seed = fun d ->
+        let pos = List.map (fun i -> (settings_hash d keys.(i)) mod n) items in
+        if distinct pos && List.for_all (fun p -> slots.(p) < 0) pos then begin
+          g.(b) <- d;
+          List.iter2 (fun i p -> slots.(p) <- i) items pos
+        end
+        else try_seed (d + 1) in
+      try_seed 1
+    end) order;
+  let free = ref 0 in
+  List.iter (fun b ->
+    match buckets.(b) with
+      [i] ->
+        while slots.(!free) >= 0 do incr free done;
+        slots.(!free) <- i;
+        g.(b) <- - !free - 1
+    | _ -> ()) order;
+  g, slots
+
+(** C type of a setting, float by default *)
+let setting_type = fun s ->
+  match ExtXml.attrib_or_default s "type" "float" with
+    "bool" -> "SETTING_TYPE_BOOL"
+  | "int8" -> "SETTING_TYPE_INT8"
+  | "int16" -> "SETTING_TYPE_INT16"
+  | "int32" -> "SETTING_TYPE_INT32"
+  | "uint8" -> "SETTING_TYPE_UINT8"
+  | "uint16" -> "SETTING_TYPE_UINT16"
+  | "uint32" -> "SETTING_TYPE_UINT32"
+  | "double" -> "SETTING_TYPE_DOUBLE"
+  | _ -> "SETTING_TYPE_FLOAT"
+
 
 let print_dl_settings = fun settings ->
   let settings = flatten settings [] in
@@ -73,14 +144,7 @@ let print_dl_settings = fun settings ->
   lprintf "};\n";
 
   Xml2h.define "SETTINGS_NAMES_SHORT" "{ \\";
-  List.iter (fun b ->
-    let varname = Str.split (Str.regexp "[_.]+") (ExtXml.attrib b "var") in
-    let shortname = List.fold_left (fun acc c ->
-      try acc ^"_"^ (Str.first_chars c 3) with _ -> acc ^"_"^ c
-    ) "" varname in
-    let shorted = try String.sub shortname 1 16 with _ -> String.sub shortname 1 ((String.length shortname)-1) in
-    printf " \"%s\" , \\\n" shorted
-  ) settings;
+  List.iter (fun b -> printf " \"%s\" , \\\n" (short_name b)) settings;
   lprintf "};\n";
   Xml2h.define "NB_SETTING" (string_of_int (List.length settings));
 
@@ -117,6 +181,9 @@ let print_dl_settings = fun settings ->
   let nb_values = !idx in
 
   (** Macro to call to downlink current values *)
+  lprintf "#if USE_SETTINGS_TELEMETRY\n";
+  lprintf "#define PeriodicSendDlValue(_trans, _dev) settings_telemetry_send(_trans, _dev)\n";
+  lprintf "#else\n";
   lprintf "#define PeriodicSendDlValue(_trans, _dev) { \\\n";
   if nb_values > 0 then begin
     right ();
@@ -139,6 +206,7 @@ let print_dl_settings = fun settings ->
     left ()
   end;
   lprintf "}\n";
+  lprintf "#endif\n";
 
   (** Inline function to get a setting value *)
   lprintf "static inline float settings_get_value(uint8_t i) {\n";
@@ -155,6 +223,113 @@ let print_dl_settings = fun settings ->
   left ();
   lprintf "}\n";
   left ();
+  lprintf "}\n";
+
+  (** Inline function to update the shadow copies of the values and the dirty bitmap *)
+  Xml2h.define "SETTINGS_DIRTY_SIZE" "((NB_SETTING + 31) / 32)";
+  lprintf "static inline void settings_check_one(float v, float *shadow, uint32_t *dirty, uint16_t i) {\n";
+  right ();
+  lprintf "if (v != *shadow && (v == v || *shadow == *shadow)) {\n";
+  right ();
+  lprintf "*shadow = v;\n";
+  lprintf "dirty[i / 32] |= (1u << (i %% 32));\n";
+  left ();
+  lprintf "}\n";
+  left ();
+  lprintf "}\n";
+  lprintf "static inline void settings_check_changes(float *shadow __attribute__((unused)), uint32_t *dirty __attribute__((unused))) {\n";
+  right ();
+  let idx = ref 0 in
+  List.iter
+    (fun s ->
+      let v = ExtXml.attrib s "var" in
+      lprintf "settings_check_one(%s, &shadow[%d], dirty, %d);\n" v !idx !idx; incr idx)
+    settings;
+  left ();
+  lprintf "}\n";
+
+  (** Metadata of the settings *)
+  lprintf "\nenum SettingType {\n";
+  right ();
+  List.iter (fun t -> lprintf "SETTING_TYPE_%s,\n" t)
+    ["BOOL"; "INT8"; "INT16"; "INT32"; "UINT8"; "UINT16"; "UINT32"; "FLOAT"; "DOUBLE"];
+  left ();
+  lprintf "};\n";
+  lprintf "struct SettingMeta {\n";
+  right ();
+  lprintf "float min;\n";
+  lprintf "float max;\n";
+  lprintf "float step;\n";
+  lprintf "enum SettingType type;\n";
+  left ();
+  lprintf "};\n";
+  lprintf "static inline const struct SettingMeta *settings_get_meta(uint16_t i) {\n";
+  right ();
+  lprintf "static const struct SettingMeta meta[] = {\n";
+  right ();
+  List.iter
+    (fun s ->
+      lprintf "{ %s, %s, %s, %s }, /* %s */\n" (ExtXml.attrib s "min") (ExtXml.attrib s "max")
+        (ExtXml.attrib_or_default s "step" "1") (setting_type s) (ExtXml.attrib s "var"))
+    settings;
+  if nb_values = 0 then lprintf "{ 0, 0, 0, SETTING_TYPE_FLOAT }\n";
+  left ();
+  lprintf "};\n";
+  lprintf "return &meta[i];\n";
+  left ();
+  lprintf "}\n";
+  lprintf "static inline const char *settings_get_short_name(uint16_t i) {\n";
+  right ();
+  lprintf "static const char names[][16 + 1] = %s;\n" (if nb_values = 0 then "{ \"\" }" else "SETTINGS_NAMES_SHORT");
+  lprintf "return names[i];\n";
+  left ();
+  lprintf "}\n";
+
+  (** Lookup of a setting by short name (MAVLink parameter id) with a minimal perfect hash.
+      For settings with the same short name, the first one is found. *)
+  let keys = List.fold_left (fun (l, i) s ->
+      let n = short_name s in
+      ((if List.mem_assoc n l then l else l @ [(n, i)]), i + 1)) ([], 0) settings in
+  let keys = Array.of_list (fst keys) in
+  let g, slots = if Array.length keys > 0 then perfect_hash (Array.map fst keys) else [| 0 |], [| 0 |] in
+  let nb_keys = Array.length g in
+  Xml2h.define "SETTINGS_HASH_SIZE" (string_of_int nb_keys);
+  lprintf "static inline uint32_t settings_hash(uint32_t seed, const char *name) {\n";
+  right ();
+  lprintf "uint32_t h = (seed == 0) ? 0x811c9dc5 : seed;\n";
+  lprintf "uint8_t i;\n";
+  lprintf "for (i = 0; i < 16 && name[i] != '\\0'; i++) {\n";
+  right ();
+  lprintf "h = (h ^ (uint8_t)name[i]) * 0x01000193;\n";
+  left ();
+  lprintf "}\n";
+  lprintf "return h;\n";
+  left ();
+  lprintf "}\n";
+  lprintf "static inline int16_t settings_idx_from_short_name(const char *name) {\n";
+  right ();
+  if nb_values = 0 then begin
+    lprintf "(void)name;\n";
+    lprintf "return -1;\n"
+  end
+  else begin
+    lprintf "static const int32_t g[SETTINGS_HASH_SIZE] = { %s };\n"
+      (String.concat ", " (Array.to_list (Array.map string_of_int g)));
+    lprintf "static const uint16_t slot_idx[SETTINGS_HASH_SIZE] = { %s };\n"
+      (String.concat ", " (Array.to_list (Array.map (fun k -> if k < 0 then "0" else string_of_int (snd keys.(k))) slots)));
+    lprintf "int32_t d = g[settings_hash(0, name) %% SETTINGS_HASH_SIZE];\n";
+    lprintf "uint16_t i = (d < 0) ? slot_idx[-d - 1] : slot_idx[settings_hash(d, name) %% SETTINGS_HASH_SIZE];\n";
+    lprintf "const char *s = settings_get_short_name(i);\n";
+    lprintf "uint8_t j;\n";
+    lprintf "for (j = 0; j < 16; j++) {\n";
+    right ();
+    lprintf "if (s[j] != name[j]) { return -1; }\n";
+    lprintf "if (s[j] == '\\0') { break; }\n";
+    left ();
+    lprintf "}\n";
+    lprintf "return i;\n"
+  end;
+  left ();
   lprintf "}\n"
 
 
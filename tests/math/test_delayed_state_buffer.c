@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_delayed_state_buffer.c
+ * @brief Tests of the delayed state buffer.
+ *
+ * A scalar filter is run on a known input history. Delayed measurements
+ * fused with rewind/replay must give the same state as a filter that got
+ * every measurement on time.
+ */
+
+#include "tap.h"
+#include <math.h>
+#include <stdlib.h>
+
+#include "filters/delayed_state_buffer.h"
+
+#define BUF_SIZE 16
+#define STEP_PERIOD 2000
+#define MAX_MEAS 4
+
+struct TestState {
+  float x;
+};
+
+struct TestInput {
+  float u;
+  uint8_t nb_meas;
+  float meas[MAX_MEAS];
+};
+
+DELAYED_STATE_BUFFER_DEF(test_buf, BUF_SIZE, struct TestState, struct TestInput)
+static struct DelayedStateBuffer buf;
+
+/** propagation then a non commutative update, so the order of the steps matters */
+static void test_step(void *state, void *input)
+{
+  struct TestState *s = (struct TestState *)state;
+  struct TestInput *in = (struct TestInput *)input;
+  s->x = 0.9f * s->x + in->u;
+  int i;
+  for (i = 0; i < in->nb_meas; i++) {
+    s->x = 0.5f * (s->x + in->meas[i]);
+  }
+}
+
+/** push n regular steps starting at stamp0, returns the current state */
+static struct TestState run_steps(uint32_t stamp0, int n, struct TestInput *history)
+{
+  struct TestState s = { 0.f };
+  delayed_state_buffer_reset(&buf);
+  int i;
+  for (i = 0; i < n; i++) {
+    struct TestInput *in = delayed_state_buffer_push(&buf, stamp0 + i * STEP_PERIOD, &s);
+    in->u = history[i].u;
+    in->nb_meas = 0;
+    test_step(&s, in);
+  }
+  return s;
+}
+
+static void test_find(uint32_t stamp0, const char *name)
+{
+  struct TestInput history[BUF_SIZE] = {{ 0 }};
+  run_steps(stamp0, 10, history);
+  uint32_t last = stamp0 + 9 * STEP_PERIOD;
+  bool found = true;
+  int age;
+  for (age = 0; age < 10; age++) {
+    uint32_t start = last - age * STEP_PERIOD;
+    found &= delayed_state_buffer_find(&buf, start) == age;
+    found &= delayed_state_buffer_find(&buf, start + STEP_PERIOD / 2) == age;
+    found &= delayed_state_buffer_find(&buf, start + STEP_PERIOD - 1) == age;
+  }
+  ok(found, "find returns the step containing the stamp (%s)", name);
+  ok(delayed_state_buffer_find(&buf, stamp0 - 1) == -1 &&
+     delayed_state_buffer_find(&buf, last + 10 * STEP_PERIOD) == 0,
+     "find rejects stamps older than the buffer, future stamps go to the last step (%s)", name);
+}
+
+static void test_find_jitter(void)
+{
+  struct TestState s = { 0.f };
+  uint32_t stamps[12];
+  delayed_state_buffer_reset(&buf);
+  srand(3);
+  uint32_t t = 1000000;
+  int i;
+  for (i = 0; i < 12; i++) {
+    stamps[i] = t;
+    delayed_state_buffer_push(&buf, t, &s);
+    t += STEP_PERIOD / 2 + rand() % (2 * STEP_PERIOD);
+  }
+  bool found = true;
+  for (i = 0; i < 12; i++) {
+    int age = 11 - i;
+    found &= delayed_state_buffer_find(&buf, stamps[i]) == age;
+    if (i < 11) {
+      found &= delayed_state_buffer_find(&buf, stamps[i + 1] - 1) == age;
+    }
+  }
+  ok(found, "find on irregular steps");
+}
+
+static void test_wraparound(void)
+{
+  struct TestInput history[3 * BUF_SIZE];
+  int i;
+  for (i = 0; i < 3 * BUF_SIZE; i++) {
+    history[i].u = (float)i;
+  }
+  run_steps(5000, 3 * BUF_SIZE - 3, history);
+  bool ok_inputs = buf.count == BUF_SIZE;
+  for (i = 0; i < BUF_SIZE; i++) {
+    struct TestInput *in = delayed_state_buffer_input(&buf, i);
+    ok_inputs &= in->u == (float)(3 * BUF_SIZE - 4 - i);
+  }
+  ok(ok_inputs, "ring keeps the last %d steps after wrapping around", BUF_SIZE);
+  uint32_t last = 5000 + (3 * BUF_SIZE - 4) * STEP_PERIOD;
+  ok(delayed_state_buffer_find(&buf, last - (BUF_SIZE - 1) * STEP_PERIOD) == BUF_SIZE - 1 &&
+     delayed_state_buffer_find(&buf, last - BUF_SIZE * STEP_PERIOD) == -1,
+     "overwritten steps are not found");
+}
+
+/** fuse a measurement taken at stamp into the buffer and current state */
+static bool fuse_delayed(struct TestState *s, uint32_t stamp, float meas)
+{
+  int32_t age = delayed_state_buffer_find(&buf, stamp);
+  if (age < 0) {
+    return false;
+  }
+  struct TestInput *in = delayed_state_buffer_input(&buf, age);
+  in->meas[in->nb_meas++] = meas;
+  delayed_state_buffer_rewind(&buf, age, s, test_step);
+  delayed_state_buffer_replay(&buf, age, s, test_step);
+  return true;
+}
+
+static void test_rewind_replay(void)
+{
+  const int n = 2 * BUF_SIZE + 5;
+  struct TestInput history[2 * BUF_SIZE + 5];
+  int i;
+  srand(11);
+  for (i = 0; i < n; i++) {
+    history[i].u = (float)rand() / RAND_MAX - 0.5f;
+    history[i].nb_meas = 0;
+  }
+  struct TestState s = run_steps(0xFFFFFFFFu - 20 * STEP_PERIOD, n, history);
+
+  // two measurements fused late, the second one older than the first
+  int step_a = n - 3, step_b = n - 9;
+  bool fused = fuse_delayed(&s, 0xFFFFFFFFu - 20 * STEP_PERIOD + step_a * STEP_PERIOD + 10, 3.f);
+  fused &= fuse_delayed(&s, 0xFFFFFFFFu - 20 * STEP_PERIOD + step_b * STEP_PERIOD + 10, -2.f);
+  ok(fused, "delayed measurements found across the timer wrap around");
+
+  // reference: all measurements applied on time
+  history[step_a].meas[history[step_a].nb_meas++] = 3.f;
+  history[step_b].meas[history[step_b].nb_meas++] = -2.f;
+  struct TestState ref = { 0.f };
+  for (i = 0; i < n; i++) {
+    test_step(&ref, &history[i]);
+  }
+  note("state after replay %f, reference %f", s.x, ref.x);
+  ok(fabsf(s.x - ref.x) < 1e-6f, "rewind and replay give the state of on time measurements");
+
+  // snapshots were corrected by the replays
+  struct TestState snap = { 0.f };
+  bool snap_ok = true;
+  for (i = 0; i < n; i++) {
+    int age = n - 1 - i;
+    if (age < BUF_SIZE) {
+      snap_ok &= fabsf(((struct TestState *)delayed_state_buffer_state(&buf, age))->x - snap.x) < 1e-6f;
+    }
+    test_step(&snap, &history[i]);
+  }
+  ok(snap_ok, "replayed snapshots match the on time states");
+}
+
+int main()
+{
+  note("running delayed state buffer tests");
+  plan(10);
+
+  DELAYED_STATE_BUFFER_INIT(&buf, test_buf, BUF_SIZE);
+  test_find(1000000, "regular");
+  test_find(0xFFFFFFFFu - 4 * STEP_PERIOD, "timer wrap");
+  test_find_jitter();
+  test_wraparound();
+  test_rewind_replay();
+
+  done_testing();
+}
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_geodetic_batch.c
+ * @brief Tests for batch geodetic conversions.
+ *
+ * Accuracy is checked against the single point double precision functions,
+ * and the cost per point of each version is reported.
+ */
+
+#include "tap.h"
+#include "test_utils.h"
+
+#include "math/pprz_geodetic_batch.h"
+
+#define NB_POINTS 10000
+
+static float lat_f[NB_POINTS], lon_f[NB_POINTS], alt_f[NB_POINTS];
+static double lat_d[NB_POINTS], lon_d[NB_POINTS], alt_d[NB_POINTS];
+static float ex_f[NB_POINTS], ey_f[NB_POINTS], ez_f[NB_POINTS];
+static double ex_d[NB_POINTS], ey_d[NB_POINTS], ez_d[NB_POINTS];
+static double cx_d[NB_POINTS], cy_d[NB_POINTS], cz_d[NB_POINTS];
+static struct EnuCoor_d enu_ref[NB_POINTS];
+
+/* reference rounded to float so that float and double versions share the same origin */
+static struct LlaCoor_d ref_lla = { (float)RadOfDeg(43.605278), (float)RadOfDeg(1.442778), 180.0 };
+static struct LtpDef_d ltp_d;
+
+static double max_err_f(void)
+{
+  double max_err = 0.;
+  int i;
+  for (i = 0; i < NB_POINTS; i++) {
+    double dx = ex_f[i] - enu_ref[i].x, dy = ey_f[i] - enu_ref[i].y, dz = ez_f[i] - enu_ref[i].z;
+    double err = sqrt(dx * dx + dy * dy + dz * dz);
+    if (err > max_err) {
+      max_err = err;
+    }
+  }
+  return max_err;
+}
+
+/** random points within +-max_angle of the reference, reference computed
+ *  in double from the float rounded inputs
+ */
+static void init_points(float max_angle)
+{
+  ltp_def_from_lla_d(&ltp_d, &ref_lla);
+  srand(42);
+  int i;
+  for (i = 0; i < NB_POINTS; i++) {
+    lat_f[i] = ref_lla.lat + rand_f(-max_angle, max_angle);
+    lon_f[i] = ref_lla.lon + rand_f(-max_angle, max_angle);
+    alt_f[i] = rand_f(0.f, 3000.f);
+    lat_d[i] = lat_f[i];
+    lon_d[i] = lon_f[i];
+    alt_d[i] = alt_f[i];
+    struct LlaCoor_d lla = { lat_d[i], lon_d[i], alt_d[i] };
+    enu_of_lla_point_d(&enu_ref[i], &ltp_d, &lla);
+  }
+}
+
+static void test_enu_of_lla_batch(void)
+{
+  note("--- enu_of_lla batch vs. enu_of_lla_point_d over %d points", NB_POINTS);
+  init_points(GEODETIC_BATCH_FAST_MAX_ANGLE);
+  double t0, t1;
+
+  struct LlaCoor_f ref_f = { ref_lla.lat, ref_lla.lon, ref_lla.alt };
+  struct LtpBatchDef_f def_f;
+  ltp_batch_def_from_lla_f(&def_f, &ref_f);
+  struct LtpBatchDef_d def_d;
+  ltp_batch_def_from_lla_d(&def_d, &ref_lla);
+  struct LlaArray_f lla_a_f = { lat_f, lon_f, alt_f };
+  struct LlaArray_d lla_a_d = { lat_d, lon_d, alt_d };
+  struct Vect3Array_f enu_a_f = { ex_f, ey_f, ez_f };
+  struct Vect3Array_d enu_a_d = { ex_d, ey_d, ez_d };
+
+  // single point float reference
+  struct LtpDef_f ltp_f;
+  ltp_def_from_lla_f(&ltp_f, &ref_f);
+  int i;
+  t0 = now_s();
+  for (i = 0; i < NB_POINTS; i++) {
+    struct LlaCoor_f lla = { lat_f[i], lon_f[i], alt_f[i] };
+    struct EnuCoor_f enu;
+    enu_of_lla_point_f(&enu, &ltp_f, &lla);
+    ex_f[i] = enu.x;
+    ey_f[i] = enu.y;
+    ez_f[i] = enu.z;
+  }
+  t1 = now_s();
+  note("enu_of_lla_point_f:      %6.1f ns/point, max error %.3f m",
+       (t1 - t0) * 1e9 / NB_POINTS, max_err_f());
+
+  t0 = now_s();
+  enu_of_lla_batch_f(&enu_a_f, &def_f, &lla_a_f, NB_POINTS);
+  t1 = now_s();
+  double err = max_err_f();
+  note("enu_of_lla_batch_f:      %6.1f ns/point, max error %.3f m", (t1 - t0) * 1e9 / NB_POINTS, err);
+  ok(err < 0.1, "enu_of_lla_batch_f error below 0.1m");
+
+  t0 = now_s();
+  enu_of_lla_batch_fast_f(&enu_a_f, &def_f, &lla_a_f, NB_POINTS);
+  t1 = now_s();
+  err = max_err_f();
+  note("enu_of_lla_batch_fast_f: %6.1f ns/point, max error %.3f m", (t1 - t0) * 1e9 / NB_POINTS, err);
+  ok(err < 0.1, "enu_of_lla_batch_fast_f error below 0.1m");
+
+  t0 = now_s();
+  for (i = 0; i < NB_POINTS; i++) {
+    struct LlaCoor_d lla = { lat_d[i], lon_d[i], alt_d[i] };
+    enu_of_lla_point_d(&enu_ref[i], &ltp_d, &lla);
+  }
+  t1 = now_s();
+  note("enu_of_lla_point_d:      %6.1f ns/point", (t1 - t0) * 1e9 / NB_POINTS);
+
+  t0 = now_s();
+  enu_of_lla_batch_d(&enu_a_d, &def_d, &lla_a_d, NB_POINTS);
+  t1 = now_s();
+  double max_err = 0.;
+  for (i = 0; i < NB_POINTS; i++) {
+    double dx = ex_d[i] - enu_ref[i].x, dy = ey_d[i] - enu_ref[i].y, dz = ez_d[i] - enu_ref[i].z;
+    max_err = Max(max_err, sqrt(dx * dx + dy * dy + dz * dz));
+  }
+  note("enu_of_lla_batch_d:      %6.1f ns/point, max error %.2e m", (t1 - t0) * 1e9 / NB_POINTS, max_err);
+  ok(max_err < 1e-6, "enu_of_lla_batch_d error below 1e-6m");
+}
+
+static void test_enu_of_lla_antimeridian(void)
+{
+  note("--- enu_of_lla batch across the 180deg meridian");
+  struct LlaCoor_d ref = { (float)RadOfDeg(-17.5), (float)RadOfDeg(179.9), 20.0 };
+  struct LtpDef_d ltp;
+  ltp_def_from_lla_d(&ltp, &ref);
+  srand(7);
+  int i;
+  for (i = 0; i < NB_POINTS; i++) {
+    lat_f[i] = ref.lat + rand_f(-GEODETIC_BATCH_FAST_MAX_ANGLE, GEODETIC_BATCH_FAST_MAX_ANGLE);
+    float lon = ref.lon + rand_f(-GEODETIC_BATCH_FAST_MAX_ANGLE, GEODETIC_BATCH_FAST_MAX_ANGLE);
+    // longitudes are given in [-pi, pi]
+    lon_f[i] = lon > M_PI ? lon - 2. * M_PI : lon;
+    alt_f[i] = rand_f(0.f, 3000.f);
+    struct LlaCoor_d lla = { lat_f[i], lon_f[i], alt_f[i] };
+    enu_of_lla_point_d(&enu_ref[i], &ltp, &lla);
+  }
+  struct LlaCoor_f ref_f = { ref.lat, ref.lon, ref.alt };
+  struct LtpBatchDef_f def_f;
+  ltp_batch_def_from_lla_f(&def_f, &ref_f);
+  struct LlaArray_f lla_a_f = { lat_f, lon_f, alt_f };
+  struct Vect3Array_f enu_a_f = { ex_f, ey_f, ez_f };
+
+  enu_of_lla_batch_f(&enu_a_f, &def_f, &lla_a_f, NB_POINTS);
+  double err = max_err_f();
+  note("enu_of_lla_batch_f max error %.3f m", err);
+  enu_of_lla_batch_fast_f(&enu_a_f, &def_f, &lla_a_f, NB_POINTS);
+  double err_fast = max_err_f();
+  note("enu_of_lla_batch_fast_f max error %.3f m", err_fast);
+  ok(err < 0.1 && err_fast < 0.1, "enu_of_lla batch float versions wrap the longitude difference");
+}
+
+static void test_ecef_batch(void)
+{
+  note("--- lla_of_ecef and enu_of_ecef batch vs. single point double");
+  init_points(0.5);
+  double t0, t1;
+  int i;
+  for (i = 0; i < NB_POINTS; i++) {
+    struct LlaCoor_d lla = { lat_d[i], lon_d[i], alt_d[i] * 30. - 5000. };
+    struct EcefCoor_d ecef;
+    ecef_of_lla_d(&ecef, &lla);
+    cx_d[i] = ecef.x;
+    cy_d[i] = ecef.y;
+    cz_d[i] = ecef.z;
+  }
+  struct Vect3Array_d ecef_a = { cx_d, cy_d, cz_d };
+  struct LlaArray_d lla_a = { lat_d, lon_d, alt_d };
+
+  t0 = now_s();
+  lla_of_ecef_batch_d(&lla_a, &ecef_a, NB_POINTS);
+  t1 = now_s();
+  double t_batch = (t1 - t0) * 1e9 / NB_POINTS;
+
+  double max_err_lat = 0., max_err_alt = 0.;
+  t0 = now_s();
+  for (i = 0; i < NB_POINTS; i++) {
+    struct EcefCoor_d ecef = { cx_d[i], cy_d[i], cz_d[i] };
+    struct LlaCoor_d lla;
+    lla_of_ecef_d(&lla, &ecef);
+    max_err_lat = Max(max_err_lat, fabs(lla.lat - lat_d[i]));
+    max_err_alt = Max(max_err_alt, fabs(lla.alt - alt_d[i]));
+  }
+  t1 = now_s();
+  note("lla_of_ecef_d: %6.1f ns/point, lla_of_ecef_batch_d: %6.1f ns/point",
+       (t1 - t0) * 1e9 / NB_POINTS, t_batch);
+  note("max difference lat %.2e rad, alt %.2e m", max_err_lat, max_err_alt);
+  ok(max_err_lat < 1e-9 && max_err_alt < 1e-4, "lla_of_ecef_batch_d matches lla_of_ecef_d");
+
+  for (i = 0; i < NB_POINTS; i++) {
+    ex_f[i] = cx_d[i];
+    ey_f[i] = cy_d[i];
+    ez_f[i] = cz_d[i];
+  }
+  struct Vect3Array_f ecef_a_f = { ex_f, ey_f, ez_f };
+  struct LlaArray_f lla_a_f = { lat_f, lon_f, alt_f };
+  t0 = now_s();
+  lla_of_ecef_batch_f(&lla_a_f, &ecef_a_f, NB_POINTS);
+  t1 = now_s();
+  t_batch = (t1 - t0) * 1e9 / NB_POINTS;
+  double max_err_lon_f = 0., max_err_lat_f = 0., max_err_alt_f = 0.;
+  for (i = 0; i < NB_POINTS; i++) {
+    max_err_lat_f = Max(max_err_lat_f, fabs(lat_f[i] - lat_d[i]));
+    max_err_lon_f = Max(max_err_lon_f, fabs(lon_f[i] - lon_d[i]));
+    max_err_alt_f = Max(max_err_alt_f, fabs(alt_f[i] - alt_d[i]));
+  }
+  note("lla_of_ecef_batch_f: %6.1f ns/point, max difference lat %.2e rad, lon %.2e rad, alt %.2e m",
+       t_batch, max_err_lat_f, max_err_lon_f, max_err_alt_f);
+  ok(max_err_lat_f < 2e-7 && max_err_lon_f < 2e-7 && max_err_alt_f < 2., "lla_of_ecef_batch_f matches lla_of_ecef_d");
+
+  struct LtpBatchDef_d def_d;
+  ltp_batch_def_from_lla_d(&def_d, &ref_lla);
+  struct Vect3Array_d enu_a = { ex_d, ey_d, ez_d };
+  enu_of_ecef_batch_d(&enu_a, &def_d, &ecef_a, NB_POINTS);
+  double max_err = 0.;
+  for (i = 0; i < NB_POINTS; i++) {
+    struct EcefCoor_d ecef = { cx_d[i], cy_d[i], cz_d[i] };
+    struct EnuCoor_d enu;
+    enu_of_ecef_point_d(&enu, &ltp_d, &ecef);
+    max_err = Max(max_err, fabs(enu.x - ex_d[i]) + fabs(enu.y - ey_d[i]) + fabs(enu.z - ez_d[i]));
+  }
+  ok(max_err < 1e-6, "enu_of_ecef_batch_d matches enu_of_ecef_point_d");
+}
+
+int main()
+{
+  note("running batch geodetic tests");
+  plan(7);
+
+  test_enu_of_lla_batch();
+  test_enu_of_lla_antimeridian();
+  test_ecef_batch();
+
+  done_testing();
+}
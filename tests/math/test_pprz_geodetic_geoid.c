@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_geodetic_geoid.c
+ * @brief Tests for the geoid grid interpolation.
+ *
+ * Uses a synthetic grid, linear in each cell direction,
+ * for which bilinear interpolation is exact.
+ */
+
+#include "tap.h"
+#include <stdlib.h>
+
+#include "math/pprz_geodetic_geoid.h"
+#include "math/pprz_algebra_float.h"
+
+#define STEP_DEG 2.5
+#define NB_LAT 73
+#define NB_LON 144
+
+static int16_t data[NB_LAT * NB_LON];
+static struct GeoidGrid grid = { data, NB_LAT, NB_LON, (int32_t)(STEP_DEG * 1e7) };
+
+/** separation in cm: linear in latitude, triangle in longitude (continuous at +-180deg) */
+static double synthetic_cm(double lat_deg, double lon_deg)
+{
+  return 20. * lat_deg / STEP_DEG + 30. * fabs(lon_deg) / STEP_DEG - 3000.;
+}
+
+static void init_grid(void)
+{
+  int i, j;
+  for (i = 0; i < NB_LAT; i++) {
+    for (j = 0; j < NB_LON; j++) {
+      data[i * NB_LON + j] = (int16_t)synthetic_cm(-90. + i * STEP_DEG, -180. + j * STEP_DEG);
+    }
+  }
+}
+
+static void test_geoid_grid_interp(void)
+{
+  note("--- bilinear interpolation vs. synthetic model");
+  srand(1);
+  int32_t max_err = 0;
+  int i;
+  for (i = 0; i < 100000; i++) {
+    double lat = -89. + 178. * rand() / RAND_MAX;
+    double lon = -180. + 360. * rand() / RAND_MAX;
+    // the triangle is not linear across 0deg longitude, stay within one side
+    if (fabs(lon) < STEP_DEG) {
+      continue;
+    }
+    int32_t h = geoid_grid_get_i(&grid, (int32_t)(lat * 1e7), (int32_t)(lon * 1e7));
+    int32_t err = abs(h - (int32_t)rint(synthetic_cm(lat, lon) * 10.));
+    if (err > max_err) {
+      max_err = err;
+    }
+  }
+  note("max error: %d mm", max_err);
+  ok(max_err <= 1, "integer interpolation within 1mm");
+
+  float h_f = geoid_grid_get_f(&grid, RadOfDeg(43.6), RadOfDeg(1.44));
+  double h_ref = synthetic_cm(43.6, 1.44) / 100.;
+  note("float: %f m, expected %f m", h_f, h_ref);
+  ok(fabs(h_f - h_ref) < 0.01, "float interpolation within 1cm");
+}
+
+static void test_geoid_grid_continuity(void)
+{
+  note("--- continuity across cells and around 180deg");
+  int32_t lat_edge = 425000000; // 42.5deg, cell boundary
+  int32_t h0 = geoid_grid_get_i(&grid, lat_edge - 1, 123456789);
+  int32_t h1 = geoid_grid_get_i(&grid, lat_edge + 1, 123456789);
+  ok(abs(h1 - h0) <= 1, "no step across latitude cell boundary");
+
+  h0 = geoid_grid_get_i(&grid, 100000000, 1799999999);
+  h1 = geoid_grid_get_i(&grid, 100000000, -1799999999);
+  ok(abs(h1 - h0) <= 1, "no step across 180deg longitude");
+
+  h0 = geoid_grid_get_i(&grid, 900000000, 0);
+  h1 = geoid_grid_get_i(&grid, -900000000, 0);
+  ok(h0 == (int32_t)rint(synthetic_cm(90., 0.) * 10.) && h1 == (int32_t)rint(synthetic_cm(-90., 0.) * 10.),
+     "poles are clamped to the first and last rows");
+}
+
+int main()
+{
+  note("running geoid grid tests");
+  plan(5);
+
+  init_grid();
+  test_geoid_grid_interp();
+  test_geoid_grid_continuity();
+
+  done_testing();
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_geodetic_wmm.c
+ * @brief Tests for the cached geomagnetic field tile.
+ *
+ * Compares the interpolated field against a direct mag_calc evaluation
+ * and reports the cost of both.
+ */
+
+#define NB_RUNS 20000
+
+#include "tap.h"
+#include "test_utils.h"
+#include <math.h>
+
+#include "math/pprz_geodetic_wmm2020.h"
+#include "math/pprz_geodetic_mag_tile.h"
+
+#define SDATE 2021.5
+
+static void test_mag_tile_build(void)
+{
+  note("--- build a tile incrementally");
+  struct MagTileService s;
+  mag_tile_service_init(&s, SDATE);
+
+  struct FloatVect3 field;
+  ok(!mag_tile_service_get_field(&s, 43.6, 1.44, 0.2, &field), "no field before first tile");
+
+  int steps = 0;
+  while (!mag_tile_service_step(&s, 1)) {
+    steps++;
+    if (steps > MAG_TILE_NB_NODES) {
+      break;
+    }
+  }
+  cmp_ok(s.nb_evals, "==", MAG_TILE_NB_NODES, "tile built with one evaluation per node");
+  ok(mag_tile_service_get_field(&s, 43.6, 1.44, 0.2, &field), "field available once tile is built");
+}
+
+static void test_mag_tile_accuracy(void)
+{
+  note("--- compare interpolated field with mag_calc");
+  double gh[MAXCOEFF];
+  int16_t nmax = extrapsh(SDATE, GEO_EPOCH, NMAX_1, NMAX_2, gh);
+
+  const double lat_c[] = { 43.6, -33.9, 64.1, 0.5 };
+  const double lon_c[] = { 1.44, 151.2, -21.9, -78.4 };
+  double max_err = 0.;
+
+  unsigned i;
+  for (i = 0; i < sizeof(lat_c) / sizeof(lat_c[0]); i++) {
+    struct MagTileService s;
+    mag_tile_service_init(&s, SDATE);
+    mag_tile_service_request(&s, lat_c[i], lon_c[i], 1.);
+    mag_tile_service_step(&s, MAG_TILE_NB_NODES);
+    const struct MagTile *t = &s.tile[s.active];
+
+    double dlat, dlon, dalt;
+    for (dlat = -0.5; dlat <= 0.5; dlat += 0.125) {
+      for (dlon = -0.5; dlon <= 0.5; dlon += 0.125) {
+        for (dalt = -2.; dalt <= 2.; dalt += 1.) {
+          double x, y, z;
+          mag_calc(1, lat_c[i] + dlat, lon_c[i] + dlon, 1. + dalt, nmax, gh, &x, &y, &z,
+                   IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+          struct FloatVect3 f;
+          mag_tile_get_field(t, lat_c[i] + dlat, lon_c[i] + dlon, 1. + dalt, &f);
+          double err = sqrt((f.x - x) * (f.x - x) + (f.y - y) * (f.y - y) + (f.z - z) * (f.z - z));
+          if (err > max_err) {
+            max_err = err;
+          }
+        }
+      }
+    }
+  }
+  note("max interpolation error: %.2f nT", max_err);
+  ok(max_err < 10., "interpolation error below 10nT over the tile");
+}
+
+static void test_mag_tile_gradient(void)
+{
+  note("--- compare interpolated gradient with finite differences of mag_calc");
+  double gh[MAXCOEFF];
+  int16_t nmax = extrapsh(SDATE, GEO_EPOCH, NMAX_1, NMAX_2, gh);
+
+  const double lat_c[] = { 43.6, -33.9, 64.1, 0.5 };
+  const double lon_c[] = { 1.44, 151.2, -21.9, -78.4 };
+  double max_err = 0., max_grad = 0.;
+
+  unsigned i;
+  for (i = 0; i < sizeof(lat_c) / sizeof(lat_c[0]); i++) {
+    struct MagTileService s;
+    mag_tile_service_init(&s, SDATE);
+    mag_tile_service_request(&s, lat_c[i], lon_c[i], 1.);
+    mag_tile_service_step(&s, MAG_TILE_NB_NODES);
+    const struct MagTile *t = &s.tile[s.active];
+
+    struct FloatVect3 f, g[3];
+    mag_tile_get_field_grad(t, lat_c[i] + 0.1, lon_c[i] - 0.1, 1.3, &f, g);
+
+    // central differences over 0.1 deg and 1 km, converted to nT/m
+    const double h_deg = 0.05, h_km = 0.5;
+    const double m_per_deg = RadOfDeg(1.) * MAG_TILE_EARTH_RADIUS;
+    const double step[3][3] = { { h_deg, 0., 0. }, { 0., h_deg, 0. }, { 0., 0., -h_km } };
+    const double dist[3] = { 2. * h_deg * m_per_deg, 2. * h_deg * m_per_deg * cos(RadOfDeg(lat_c[i] + 0.1)),
+                             2. * h_km * 1000.
+                           };
+    int k;
+    for (k = 0; k < 3; k++) {
+      double p[3], m[3];
+      mag_calc(1, lat_c[i] + 0.1 + step[k][0], lon_c[i] - 0.1 + step[k][1], 1.3 + step[k][2], nmax, gh,
+               &p[0], &p[1], &p[2], IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+      mag_calc(1, lat_c[i] + 0.1 - step[k][0], lon_c[i] - 0.1 - step[k][1], 1.3 - step[k][2], nmax, gh,
+               &m[0], &m[1], &m[2], IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+      const double ref[3] = { (p[0] - m[0]) / dist[k], (p[1] - m[1]) / dist[k], (p[2] - m[2]) / dist[k] };
+      const double got[3] = { g[k].x, g[k].y, g[k].z };
+      int j;
+      for (j = 0; j < 3; j++) {
+        max_err = fmax(max_err, fabs(got[j] - ref[j]));
+        max_grad = fmax(max_grad, fabs(ref[j]));
+      }
+    }
+  }
+  note("max gradient %.2e nT/m, max error %.2e nT/m", max_grad, max_err);
+  ok(max_err < 0.1 * max_grad, "gradient within 10%% of the largest gradient");
+}
+
+static void test_mag_tile_timing(void)
+{
+  note("--- lookup vs. full model evaluation");
+  double gh[MAXCOEFF];
+  int16_t nmax = extrapsh(SDATE, GEO_EPOCH, NMAX_1, NMAX_2, gh);
+  struct MagTileService s;
+  mag_tile_service_init(&s, SDATE);
+  mag_tile_service_request(&s, 43.6, 1.44, 0.2);
+  mag_tile_service_step(&s, MAG_TILE_NB_NODES);
+
+  double sum = 0.;
+  int i;
+  double t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    double x, y, z;
+    mag_calc(1, 43.6 + i * 1e-5, 1.44, 0.2, nmax, gh, &x, &y, &z, IEXT, EXT_COEFF1, EXT_COEFF2, EXT_COEFF3);
+    sum += x;
+  }
+  double t_calc = (now_s() - t0) * 1e6 / NB_RUNS;
+
+  t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    struct FloatVect3 f;
+    mag_tile_service_get_field(&s, 43.6 + i * 1e-5, 1.44, 0.2, &f);
+    sum += f.x;
+  }
+  double t_tile = (now_s() - t0) * 1e6 / NB_RUNS;
+
+  note("mag_calc: %.3f us/call, tile lookup: %.3f us/call (%g)", t_calc, t_tile, sum);
+}
+
+int main()
+{
+  note("running geomagnetic tile tests");
+  plan(5);
+
+  test_mag_tile_build();
+  test_mag_tile_accuracy();
+  test_mag_tile_gradient();
+  test_mag_tile_timing();
+
+  done_testing();
+}
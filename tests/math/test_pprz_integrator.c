@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_integrator.c
+ * @brief Tests for the fixed-step integrators, compared with the Runge-Kutta library.
+ */
+
+#define NB_RUNS 5000
+
+#include "tap.h"
+#include "test_utils.h"
+
+#include "math/pprz_rk_float.h"
+#include "math/pprz_integrator_float.h"
+
+/* attitude, speed and position driven by body rates and accel */
+#define NX 10
+#define NU 6
+
+static void kin_model(float *o, const float *x, const int n __attribute__((unused)),
+                      const float *u, const int m __attribute__((unused)))
+{
+  struct FloatQuat q = { x[0], x[1], x[2], x[3] };
+  struct FloatRates r = { u[0], u[1], u[2] };
+  struct FloatQuat qd;
+  float_quat_derivative(&qd, &r, &q);
+  o[0] = qd.qi;
+  o[1] = qd.qx;
+  o[2] = qd.qy;
+  o[3] = qd.qz;
+  struct FloatVect3 a_b = { u[3], u[4], u[5] };
+  struct FloatVect3 a_n;
+  float_quat_vmult(&a_n, &q, &a_b);
+  o[4] = a_n.x;
+  o[5] = a_n.y;
+  o[6] = a_n.z;
+  o[7] = x[4];
+  o[8] = x[5];
+  o[9] = x[6];
+}
+
+/* harmonic oscillator x'' = -x */
+static void osc_model(float *o, const float *x, const int n __attribute__((unused)),
+                      const float *u __attribute__((unused)), const int m __attribute__((unused)))
+{
+  o[0] = x[1];
+  o[1] = -x[0];
+}
+
+static void test_rk4_vs_runge_kutta(void)
+{
+  note("--- RK4 with workspace vs. runge_kutta_4_float");
+  float x_ref[NX] = { 1.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+  float x[NX];
+  float x_new[NX];
+  float ws[INTEGRATOR_RK4_WS_SIZE(NX)];
+  const float u[NU] = { 0.3f, -0.2f, 0.5f, 0.1f, 0.2f, -0.3f };
+  const float dt = 1.f / 512.f;
+  const int nb = 5000;
+  int i, j;
+
+  float_vect_copy(x, x_ref, NX);
+  float max_err = 0.f;
+  for (i = 0; i < nb; i++) {
+    runge_kutta_4_float(x_new, x_ref, NX, u, NU, kin_model, dt);
+    float_vect_copy(x_ref, x_new, NX);
+    integrator_rk4_float(x, NX, u, NU, kin_model, dt, ws);
+    for (j = 0; j < NX; j++) {
+      float err = fabsf(x[j] - x_ref[j]);
+      if (err > max_err) {
+        max_err = err;
+      }
+    }
+  }
+  note("max difference after %d steps: %g", nb, max_err);
+  ok(max_err < 1e-4f, "same trajectory as runge_kutta_4_float");
+
+  double t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    runge_kutta_4_float(x_new, x_ref, NX, u, NU, kin_model, dt);
+    float_vect_copy(x_ref, x_new, NX);
+  }
+  double t_rk = (now_s() - t0) * 1e6 / NB_RUNS;
+  t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    integrator_rk4_float(x, NX, u, NU, kin_model, dt, ws);
+  }
+  double t_int = (now_s() - t0) * 1e6 / NB_RUNS;
+  note("runge_kutta_4_float: %.3f us/step, integrator_rk4_float: %.3f us/step (x=%f)", t_rk, t_int, x[7]);
+}
+
+/** error on the oscillator after one period */
+static float osc_error(void (*step)(float *, const int, const float *, const int, integrator_model_float,
+                                    const float, float *), int nb)
+{
+  float x[2] = { 1.f, 0.f };
+  float ws[INTEGRATOR_RK4_WS_SIZE(2)];
+  const float dt = 2.f * M_PI / nb;
+  int i;
+  for (i = 0; i < nb; i++) {
+    step(x, 2, NULL, 0, osc_model, dt, ws);
+  }
+  return sqrtf((x[0] - 1.f) * (x[0] - 1.f) + x[1] * x[1]);
+}
+
+static void test_order(void)
+{
+  note("--- accuracy on a harmonic oscillator");
+  float e_euler = osc_error(integrator_euler_float, 200);
+  float e_heun = osc_error(integrator_heun_float, 200);
+  float e_heun2 = osc_error(integrator_heun_float, 400);
+  float e_rk4 = osc_error(integrator_rk4_float, 200);
+  note("error after one period, 200 steps: euler %g, heun %g, rk4 %g", e_euler, e_heun, e_rk4);
+  note("heun error ratio 200/400 steps: %g", e_heun / e_heun2);
+  ok(e_heun < e_euler / 10.f && e_rk4 < e_heun / 10.f, "errors decrease with the order of the scheme");
+  ok(e_heun / e_heun2 > 3.5f && e_heun / e_heun2 < 4.5f, "heun is second order");
+}
+
+static void test_semi_implicit(void)
+{
+  note("--- energy of a harmonic oscillator with semi-implicit euler");
+  float p = 1.f, v = 0.f;
+  float p_e = 1.f, v_e = 0.f;
+  const float dt = 0.01f;
+  float max_energy = 0.f;
+  int i;
+  for (i = 0; i < 100000; i++) {
+    float a = -p;
+    integrator_semi_implicit_euler_float(&p, &v, &a, 1, dt);
+    float e = p * p + v * v;
+    if (e > max_energy) {
+      max_energy = e;
+    }
+    float a_e = -p_e;
+    p_e += dt * v_e;
+    v_e += dt * a_e;
+  }
+  note("max energy: semi-implicit %f, explicit euler at the end %f", max_energy, p_e * p_e + v_e * v_e);
+  ok(max_energy < 1.01f, "energy stays bounded");
+}
+
+static void test_quat_exp(void)
+{
+  note("--- exponential map quaternion integration");
+  struct FloatQuat q = { 1.f, 0.f, 0.f, 0.f };
+  struct FloatQuat q_ref = q;
+  struct FloatRates r = { 1.2f, -0.7f, 2.5f };
+  const float dt = 1.f / 512.f;
+  float max_err = 0.f;
+  int i;
+  for (i = 0; i < 5000; i++) {
+    integrator_quat_exp_float(&q, &r, dt);
+    float_quat_integrate(&q_ref, &r, dt);
+    float err = fabsf(q.qi - q_ref.qi) + fabsf(q.qx - q_ref.qx) + fabsf(q.qy - q_ref.qy) + fabsf(q.qz - q_ref.qz);
+    if (err > max_err) {
+      max_err = err;
+    }
+  }
+  note("max difference with float_quat_integrate: %g, norm %f", max_err, float_quat_norm(&q));
+  ok(max_err < 1e-4f && fabsf(float_quat_norm(&q) - 1.f) < 1e-3f, "same as float_quat_integrate and norm preserved");
+}
+
+int main()
+{
+  note("running integrator tests");
+  plan(5);
+
+  test_rk4_vs_runge_kutta();
+  test_order();
+  test_semi_implicit();
+  test_quat_exp();
+
+  done_testing();
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_sched_table.c
+ * @brief Tests of the multi-dimensional breakpoint tables.
+ */
+
+#include "tap.h"
+#include "test_utils.h"
+#include <math.h>
+#include <stdlib.h>
+
+#include "math/pprz_sched_table_float.h"
+
+#define SIZE 3
+
+static const float pa[] = { 0.f, 40.f, 100.f };
+static const float pb[] = { 5.f, 10.f, 15.f, 20.f };
+static const float pc[] = { 14.f, 16.8f };
+
+#define NA (sizeof(pa) / sizeof(pa[0]))
+#define NB (sizeof(pb) / sizeof(pb[0]))
+#define NC (sizeof(pc) / sizeof(pc[0]))
+
+static float data[NC][NB][NA][SIZE];
+
+/* affine function of the variables, reproduced exactly by the interpolation */
+static void affine(float a, float b, float c, float *out)
+{
+  for (int k = 0; k < SIZE; k++) {
+    out[k] = 1.f + k + 0.02f * (k + 1) * a - 0.3f * b + (k - 1) * 2.f * c;
+  }
+}
+
+static float clamp(float x, const float *p, int n)
+{
+  return x < p[0] ? p[0] : (x > p[n - 1] ? p[n - 1] : x);
+}
+
+int main(void)
+{
+  plan(6);
+
+  for (unsigned int c = 0; c < NC; c++) {
+    for (unsigned int b = 0; b < NB; b++) {
+      for (unsigned int a = 0; a < NA; a++) {
+        affine(pa[a], pb[b], pc[c], data[c][b][a]);
+      }
+    }
+  }
+
+  struct SchedTableFloat t;
+  float out[SIZE], ref[SIZE];
+  sched_table_init_f(&t, data[0][0][0], SIZE, out);
+  sched_table_add_axis_f(&t, pa, NA, 1.f);
+  sched_table_add_axis_f(&t, pb, NB, 0.f);
+  ok(sched_table_add_axis_f(&t, pc, NC, 0.f) && !sched_table_add_axis_f(&t, pc, NC, 0.f),
+     "axes added up to SCHED_TABLE_MAX_DIM");
+
+  // grid points and affine function, inside and outside the grid (clamped)
+  float err_grid = 0.f, err_in = 0.f, err_out = 0.f;
+  for (unsigned int c = 0; c < NC; c++) {
+    for (unsigned int b = 0; b < NB; b++) {
+      for (unsigned int a = 0; a < NA; a++) {
+        const float vars[3] = { pa[a], pb[b], pc[c] };
+        sched_table_interp_f(&t, vars, out);
+        for (int k = 0; k < SIZE; k++) {
+          err_grid = fmaxf(err_grid, fabsf(out[k] - data[c][b][a][k]));
+        }
+      }
+    }
+  }
+  for (int i = 0; i < 10000; i++) {
+    const float vars[3] = { rand_f(0.f, 100.f), rand_f(5.f, 20.f), rand_f(14.f, 16.8f) };
+    sched_table_interp_f(&t, vars, out);
+    affine(vars[0], vars[1], vars[2], ref);
+    for (int k = 0; k < SIZE; k++) {
+      err_in = fmaxf(err_in, fabsf(out[k] - ref[k]));
+    }
+    const float vars_out[3] = { rand_f(-50.f, 150.f), rand_f(0.f, 30.f), rand_f(10.f, 20.f) };
+    sched_table_interp_f(&t, vars_out, out);
+    affine(clamp(vars_out[0], pa, NA), clamp(vars_out[1], pb, NB), clamp(vars_out[2], pc, NC), ref);
+    for (int k = 0; k < SIZE; k++) {
+      err_out = fmaxf(err_out, fabsf(out[k] - ref[k]));
+    }
+  }
+  note("max error on the grid %.2e, inside %.2e, outside %.2e", err_grid, err_in, err_out);
+  ok(err_grid == 0.f, "grid points reproduced exactly");
+  ok(err_in < 1e-4f, "affine function reproduced inside the grid");
+  ok(err_out < 1e-4f, "variables clamped outside the grid");
+
+  // update only above the thresholds
+  float vars[3] = { 50.f, 12.f, 15.f };
+  bool first = sched_table_update_f(&t, vars);
+  vars[0] += 0.9f;
+  bool below = sched_table_update_f(&t, vars);
+  const float kept = out[0];
+  vars[0] += 0.2f;
+  bool above = sched_table_update_f(&t, vars);
+  ok(first && !below && above && out[0] != kept, "table interpolated again only above the threshold");
+  sched_table_invalidate_f(&t);
+  ok(sched_table_update_f(&t, vars) && !sched_table_update_f(&t, vars), "table interpolated again after invalidation");
+
+  done_testing();
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_srukf.c
+ * @brief Tests of the square-root UKF and of its factorization primitives.
+ *
+ * On linear models the filter is compared to a double precision Kalman filter,
+ * and its robustness to a plain float UKF (covariance propagated directly and
+ * factorized at each step), both with very accurate measurements.
+ */
+
+#include "tap.h"
+#include "test_utils.h"
+#include <math.h>
+
+#include "math/pprz_srukf_float.h"
+#include "math/pprz_matrix_decomp_float.h"
+#include "math/pprz_algebra_float.h"
+
+#define NB_STEPS 500
+
+/* gaussian noise, Box-Muller */
+static float randn(void)
+{
+  const float u = rand_f(1e-6f, 1.f);
+  const float v = rand_f(0.f, 1.f);
+  return sqrtf(-2.f * logf(u)) * cosf(2.f * M_PI * v);
+}
+
+/* max abs difference between R^T R and A^T A */
+static double check_gram(float **R, float **A, int m, int n)
+{
+  double err = 0.;
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      double a = 0., r = 0.;
+      for (int k = 0; k < m; k++) {
+        a += (double)A[k][i] * A[k][j];
+      }
+      for (int k = 0; k < n; k++) {
+        r += (double)R[k][i] * R[k][j];
+      }
+      err = fmax(err, fabs(a - r));
+    }
+  }
+  return err;
+}
+
+/* constant velocity model, position measured */
+#define CV_N 2
+#define CV_M 1
+
+static void cv_process(float *xn, const float *x, float dt, void *user __attribute__((unused)))
+{
+  xn[0] = x[0] + dt * x[1];
+  xn[1] = x[1];
+}
+
+static void cv_measure(float *y, const float *x, void *user __attribute__((unused)))
+{
+  y[0] = x[0];
+}
+
+/* double precision Kalman filter of the same model */
+struct Kf {
+  double x[2];
+  double P[2][2];
+};
+
+static void kf_step(struct Kf *kf, double dt, const double q[2], double r, double z)
+{
+  // predict
+  kf->x[0] += dt * kf->x[1];
+  const double p00 = kf->P[0][0] + dt * (kf->P[0][1] + kf->P[1][0]) + dt * dt * kf->P[1][1] + q[0];
+  const double p01 = kf->P[0][1] + dt * kf->P[1][1];
+  const double p11 = kf->P[1][1] + q[1];
+  // update
+  const double s = p00 + r;
+  const double k0 = p00 / s, k1 = p01 / s;
+  const double e = z - kf->x[0];
+  kf->x[0] += k0 * e;
+  kf->x[1] += k1 * e;
+  kf->P[0][0] = p00 - k0 * p00;
+  kf->P[0][1] = kf->P[1][0] = p01 - k0 * p01;
+  kf->P[1][1] = p11 - k1 * p01;
+}
+
+/* plain float UKF of the same model, for the robustness comparison
+ * @return false if the covariance can not be factorized anymore
+ */
+struct Ukf {
+  float x[2];
+  float P[2][2];
+};
+
+static bool ukf_step(struct Ukf *ukf, const struct SrUkfFloat *ref, float dt, const float q[2], float r, float z)
+{
+  float X[5][2], Y[5], L[2][2], x[2] = { 0.f, 0.f }, y = 0.f;
+  // factorization of P (lower triangular)
+  if (!(ukf->P[0][0] > 0.f)) {
+    return false;
+  }
+  L[0][0] = sqrtf(ukf->P[0][0]);
+  L[1][0] = ukf->P[1][0] / L[0][0];
+  L[0][1] = 0.f;
+  const float l11 = ukf->P[1][1] - L[1][0] * L[1][0];
+  if (!(l11 > 0.f)) {
+    return false;
+  }
+  L[1][1] = sqrtf(l11);
+  for (int k = 0; k < 5; k++) {
+    float p[2] = { ukf->x[0], ukf->x[1] };
+    if (k > 0) {
+      const float g = k <= 2 ? ref->gamma : -ref->gamma;
+      p[0] += g * L[0][(k - 1) % 2];
+      p[1] += g * L[1][(k - 1) % 2];
+    }
+    cv_process(X[k], p, dt, NULL);
+    const float w = k == 0 ? ref->wm0 : ref->wi;
+    x[0] += w * X[k][0];
+    x[1] += w * X[k][1];
+  }
+  float P[2][2] = { { q[0], 0.f }, { 0.f, q[1] } };
+  for (int k = 0; k < 5; k++) {
+    const float w = k == 0 ? ref->wc0 : ref->wi;
+    for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < 2; j++) {
+        P[i][j] += w * (X[k][i] - x[i]) * (X[k][j] - x[j]);
+      }
+    }
+    Y[k] = X[k][0];
+    y += (k == 0 ? ref->wm0 : ref->wi) * Y[k];
+  }
+  float pyy = r, pxy[2] = { 0.f, 0.f };
+  for (int k = 0; k < 5; k++) {
+    const float w = k == 0 ? ref->wc0 : ref->wi;
+    pyy += w * (Y[k] - y) * (Y[k] - y);
+    pxy[0] += w * (X[k][0] - x[0]) * (Y[k] - y);
+    pxy[1] += w * (X[k][1] - x[1]) * (Y[k] - y);
+  }
+  const float K[2] = { pxy[0] / pyy, pxy[1] / pyy };
+  for (int i = 0; i < 2; i++) {
+    ukf->x[i] = x[i] + K[i] * (z - y);
+    for (int j = 0; j < 2; j++) {
+      ukf->P[i][j] = P[i][j] - K[i] * pyy * K[j];
+    }
+  }
+  return true;
+}
+
+/* toy model with the dimensions of the wind estimator, for the timing */
+#define T_N 7
+#define T_M 6
+
+static void toy_process(float *xn, const float *x, float dt, void *user __attribute__((unused)))
+{
+  for (int i = 0; i < T_N; i++) {
+    xn[i] = x[i] + dt * 0.1f * x[(i + 1) % T_N];
+  }
+}
+
+static void toy_measure(float *y, const float *x, void *user __attribute__((unused)))
+{
+  for (int i = 0; i < T_M; i++) {
+    y[i] = x[i] + 0.1f * x[i + 1] * x[i + 1];
+  }
+}
+
+/* magnetometer calibration model of mag_calib_ukf:
+ * bias and scale factor matrix less identity (column major), constant state
+ */
+static void mag_calibrate(const float *x, const float *m, float *c)
+{
+  const float v[3] = { m[0] - x[0], m[1] - x[1], m[2] - x[2] };
+  for (int i = 0; i < 3; i++) {
+    c[i] = v[i] + x[3 + i] * v[0] + x[6 + i] * v[1] + x[9 + i] * v[2];
+  }
+}
+
+static void mag_measure(float *y, const float *x, void *user)
+{
+  mag_calibrate(x, (const float *)user, y);
+}
+
+int main(void)
+{
+  plan(10);
+  srand(3);
+
+  note("--- factorization primitives");
+  {
+    float _a[10][4], _r[10][4];
+    MAKE_MATRIX_PTR(a, _a, 10);
+    MAKE_MATRIX_PTR(r, _r, 10);
+    for (int i = 0; i < 10; i++) {
+      for (int j = 0; j < 4; j++) {
+        _a[i][j] = _r[i][j] = rand_f(-2.f, 2.f);
+      }
+    }
+    pprz_qr_r_float(r, 10, 4);
+    bool upper = true;
+    for (int i = 0; i < 10; i++) {
+      for (int j = 0; j < 4; j++) {
+        upper &= (j < i) ? _r[i][j] == 0.f : (i != j || _r[i][j] > 0.f);
+      }
+    }
+    const double err = check_gram(r, a, 10, 4);
+    note("qr: max |R^T R - A^T A| %.2e", err);
+    ok(upper && err < 1e-4, "pprz_qr_r_float gives the Cholesky factor of A^T A");
+
+    // R of the first 4 rows, then rank-1 updates with the other rows
+    float _u[4][4], v[4];
+    MAKE_MATRIX_PTR(u, _u, 4);
+    float_mat_copy(u, a, 4, 4);
+    pprz_qr_r_float(u, 4, 4);
+    bool res = true;
+    for (int k = 4; k < 10; k++) {
+      float_vect_copy(v, _a[k], 4);
+      res &= pprz_cholupdate_float(u, v, 4, false);
+    }
+    const double err_up = check_gram(u, a, 10, 4);
+    for (int k = 9; k >= 4; k--) {
+      float_vect_copy(v, _a[k], 4);
+      res &= pprz_cholupdate_float(u, v, 4, true);
+    }
+    const double err_down = check_gram(u, a, 4, 4);
+    note("cholupdate: max error %.2e after updates, %.2e after downdates", err_up, err_down);
+    ok(res && err_up < 1e-4 && err_down < 1e-3, "pprz_cholupdate_float updates and downdates");
+    float_vect_copy(v, _a[0], 4);
+    float_vect_smul(v, v, 2.f, 4);
+    ok(!pprz_cholupdate_float(u, v, 4, true), "downdate to a non positive definite matrix detected");
+  }
+
+  note("--- linear model against a double precision Kalman filter");
+  {
+    const float dt = 0.1f, q[2] = { 1e-4f, 1e-3f }, r = 0.25f;
+    const float x0[2] = { 0.f, 0.f }, p0[2] = { 10.f, 1.f };
+    const double qd[2] = { q[0], q[1] };
+    static struct SrUkfFloat ukf;
+    struct Kf kf = { { 0., 0. }, { { p0[0], 0. }, { 0., p0[1] } } };
+    srukf_init(&ukf, CV_N, CV_M, cv_process, cv_measure, NULL);
+    srukf_set_state(&ukf, x0, p0);
+    srukf_set_process_noise(&ukf, q);
+    srukf_set_measurement_noise(&ukf, &r);
+    double err_x = 0., err_p = 0.;
+    float pos = 0.f;
+    for (int t = 0; t < NB_STEPS; t++) {
+      pos += dt * 2.f;
+      const float z = pos + 0.5f * randn();
+      srukf_predict(&ukf, dt);
+      srukf_update(&ukf, &z);
+      kf_step(&kf, dt, qd, r, z);
+      float P[4];
+      srukf_get_cov(&ukf, P);
+      for (int i = 0; i < 2; i++) {
+        err_x = fmax(err_x, fabs(ukf.x[i] - kf.x[i]) / (1. + fabs(kf.x[i])));
+        for (int j = 0; j < 2; j++) {
+          err_p = fmax(err_p, fabs(P[i * 2 + j] - kf.P[i][j]) / (1e-3 + fabs(kf.P[i][j])));
+        }
+      }
+    }
+    note("max relative error: state %.2e, covariance %.2e, speed %.3f", err_x, err_p, ukf.x[1]);
+    ok(err_x < 1e-3 && err_p < 1e-2 && ukf.nb_fail == 0, "same state and covariance as the Kalman filter");
+    ok(fabsf(ukf.x[1] - 2.f) < 0.1f, "speed estimated");
+  }
+
+  note("--- constant state (no process model)");
+  {
+    static struct SrUkfFloat ukf;
+    const float x0[2] = { 0.f, 0.f }, p0[2] = { 100.f, 100.f }, q[2] = { 0.f, 0.f }, r = 1.f;
+    srukf_init(&ukf, CV_N, CV_M, NULL, cv_measure, NULL);
+    srukf_set_state(&ukf, x0, p0);
+    srukf_set_process_noise(&ukf, q);
+    srukf_set_measurement_noise(&ukf, &r);
+    for (int t = 0; t < 100; t++) {
+      const float z = 3.f + randn();
+      srukf_predict(&ukf, 0.f);
+      srukf_update(&ukf, &z);
+    }
+    float P[4];
+    srukf_get_cov(&ukf, P);
+    // mean of 100 measurements, unobserved state unchanged
+    note("x %.3f var %.4f, unobserved var %.1f", ukf.x[0], P[0], P[3]);
+    ok(fabsf(ukf.x[0] - 3.f) < 0.3f && fabsf(P[0] - 1.f / (1.f / 100.f + 100.f)) < 1e-4f && fabsf(P[3] - 100.f) < 1e-2f,
+       "constant state estimated as a weighted mean");
+  }
+
+  note("--- robustness with very accurate measurements");
+  {
+    const float dt = 0.01f, q[2] = { 1e-12f, 1e-8f }, r = 1e-10f;
+    const float x0[2] = { 0.f, 0.f }, p0[2] = { 1e4f, 1e4f };
+    static struct SrUkfFloat sr;
+    struct Ukf ukf = { { 0.f, 0.f }, { { p0[0], 0.f }, { 0.f, p0[1] } } };
+    srukf_init(&sr, CV_N, CV_M, cv_process, cv_measure, NULL);
+    srukf_set_state(&sr, x0, p0);
+    srukf_set_process_noise(&sr, q);
+    srukf_set_measurement_noise(&sr, &r);
+    int ukf_fail = -1;
+    bool sr_ok = true;
+    float pos = 0.f;
+    for (int t = 0; t < 5 * NB_STEPS; t++) {
+      pos += dt * 1.f;
+      srukf_predict(&sr, dt);
+      srukf_update(&sr, &pos);
+      if (ukf_fail < 0 && !ukf_step(&ukf, &sr, dt, q, r, pos)) {
+        ukf_fail = t;
+      }
+      for (int i = 0; i < 2; i++) {
+        sr_ok &= isfinite(sr.x[i]) && sr.S[i][i] > 0.f;
+      }
+    }
+    note("square root filter: %d failed downdates, speed %.4f", sr.nb_fail, sr.x[1]);
+    if (ukf_fail < 0) {
+      note("plain UKF: covariance positive definite, speed %.4f", ukf.x[1]);
+    } else {
+      note("plain UKF: covariance not positive definite at step %d", ukf_fail);
+    }
+    ok(sr_ok, "covariance factor stays valid");
+    ok(fabsf(sr.x[1] - 1.f) < 1e-2f, "speed estimated");
+  }
+
+  note("--- timing, %d states and %d measurements", T_N, T_M);
+  {
+    static struct SrUkfFloat ukf;
+    const float x0[T_N] = { 1.f, 0.5f, 0.f, 0.f, 0.f, 0.f, 1.f };
+    const float p0[T_N] = { 0.2f, 0.2f, 0.2f, 0.2f, 0.2f, 0.2f, 0.2f };
+    const float q[T_N] = { 1e-2f, 1e-2f, 1e-2f, 1e-6f, 1e-6f, 1e-6f, 1e-8f };
+    const float r[T_M] = { 0.25f, 0.25f, 0.25f, 0.25f, 4e-6f, 4e-6f };
+    srukf_init(&ukf, T_N, T_M, toy_process, toy_measure, NULL);
+    srukf_set_state(&ukf, x0, p0);
+    srukf_set_process_noise(&ukf, q);
+    srukf_set_measurement_noise(&ukf, r);
+    float z[T_M];
+    double t_pred = 0., t_up = 0.;
+    for (int t = 0; t < 20 * NB_STEPS; t++) {
+      for (int i = 0; i < T_M; i++) {
+        z[i] = 1.f + 0.01f * randn();
+      }
+      double t0 = now_s();
+      srukf_predict(&ukf, 0.02f);
+      const double t1 = now_s();
+      srukf_update(&ukf, z);
+      t_pred += t1 - t0;
+      t_up += now_s() - t1;
+    }
+    note("predict %.2f us, update %.2f us, workspace %d bytes",
+         t_pred / (20 * NB_STEPS) * 1e6, t_up / (20 * NB_STEPS) * 1e6, (int)sizeof(struct SrUkfFloat));
+    bool finite = true;
+    for (int i = 0; i < T_N; i++) {
+      finite &= isfinite(ukf.x[i]);
+    }
+    ok(finite && ukf.nb_fail == 0, "nonlinear model runs without failed downdates");
+  }
+
+  note("--- magnetometer calibration, 12 states and 3 measurements");
+  {
+    static struct SrUkfFloat ukf;
+    static float raw[3];
+    // true calibration: m = A h + b
+    const float b[3] = { 0.15f, -0.2f, 0.05f };
+    const float A[3][3] = { { 1.1f, 0.05f, 0.f }, { 0.05f, 0.9f, -0.03f }, { 0.f, -0.03f, 1.05f } };
+    const float x0[12] = { 0.f }, q[12] = { 0.f };
+    float p0[12], r[3] = { 1e-4f, 1e-4f, 1e-4f };
+    for (int i = 0; i < 12; i++) {
+      p0[i] = i < 3 ? 1.f : 0.1f;
+    }
+    srukf_init(&ukf, 12, 3, NULL, mag_measure, raw);
+    srukf_set_state(&ukf, x0, p0);
+    srukf_set_process_noise(&ukf, q);
+    srukf_set_measurement_noise(&ukf, r);
+    double t_up = 0.;
+    const int nb = 4 * NB_STEPS;
+    for (int t = 0; t < nb; t++) {
+      // field of unit norm in random directions
+      float h[3] = { randn(), randn(), randn() };
+      const float n = sqrtf(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+      for (int i = 0; i < 3; i++) {
+        h[i] /= n;
+      }
+      for (int i = 0; i < 3; i++) {
+        raw[i] = A[i][0] * h[0] + A[i][1] * h[1] + A[i][2] * h[2] + b[i] + 0.01f * randn();
+      }
+      const double t0 = now_s();
+      srukf_predict(&ukf, 0.f);
+      srukf_update(&ukf, h);
+      t_up += now_s() - t0;
+    }
+    // calibrated measurements of new directions
+    double err = 0.;
+    for (int t = 0; t < 100; t++) {
+      const float h[3] = { cosf(t * 0.3f) * cosf(t * 0.7f), sinf(t * 0.3f) * cosf(t * 0.7f), sinf(t * 0.7f) };
+      float m[3], c[3];
+      for (int i = 0; i < 3; i++) {
+        m[i] = A[i][0] * h[0] + A[i][1] * h[1] + A[i][2] * h[2] + b[i];
+      }
+      mag_calibrate(ukf.x, m, c);
+      for (int i = 0; i < 3; i++) {
+        err = fmax(err, fabs(c[i] - h[i]));
+      }
+    }
+    note("bias %.3f %.3f %.3f, max calibrated error %.4f, %d failed downdates, update %.2f us",
+         ukf.x[0], ukf.x[1], ukf.x[2], err, ukf.nb_fail, t_up / nb * 1e6);
+    ok(err < 0.02, "magnetometer calibrated");
+  }
+
+  done_testing();
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_stat.c
+ * @brief Tests of the sliding window statistics against the batch functions, and update cost.
+ */
+
+#define NB_RUNS 20000
+
+#include "tap.h"
+#include "test_utils.h"
+#include <stdlib.h>
+
+#include "math/pprz_stat.h"
+
+#define N 300
+#define NB_SAMPLES 20000
+
+static float rand_seed_f(unsigned int *seed)
+{
+  return (float)rand_r(seed) / RAND_MAX - 0.5f;
+}
+
+/* two-pass covariance in double precision of the last n samples of a stream */
+static double ref_cov(const float *x, const float *y, int end, int n)
+{
+  double mx = 0., my = 0., c = 0.;
+  for (int i = end - n; i < end; i++) {
+    mx += x[i];
+    my += y[i];
+  }
+  mx /= n;
+  my /= n;
+  for (int i = end - n; i < end; i++) {
+    c += (x[i] - mx) * (y[i] - my);
+  }
+  return c / n;
+}
+
+/* previous implementation of set_cov_div in optical_flow_functions.c */
+struct old_history {
+  float input[N];
+  float OF[N];
+  float past_OF[N];
+  uint32_t ind;
+  uint8_t filled;
+};
+
+static float old_cov(struct old_history *h, int method, float input, float of, int delay)
+{
+  float cov = 0.f;
+  h->OF[h->ind] = of;
+  h->input[h->ind] = input;
+  int ind_past = h->ind - delay;
+  while (ind_past < 0) { ind_past += N; }
+  h->past_OF[h->ind] = h->OF[ind_past];
+  if (method == 0 && h->filled > 0) {
+    cov = covariance_f(h->input, h->OF, N);
+  } else if (method == 1 && h->filled > 1) {
+    cov = covariance_f(h->past_OF, h->OF, N);
+  }
+  if (h->filled < 2 && h->ind + 1 == N) {
+    h->filled++;
+  }
+  h->ind = (h->ind + 1) % N;
+  return cov;
+}
+
+int main(void)
+{
+  plan(6);
+
+  unsigned int seed = 71;
+  float *xs = malloc(sizeof(float) * NB_SAMPLES);
+  float *ys = malloc(sizeof(float) * NB_SAMPLES);
+  for (int i = 0; i < NB_SAMPLES; i++) {
+    xs[i] = rand_seed_f(&seed) + 0.3f * sinf(i * 0.05f);
+    ys[i] = 0.5f * xs[i] + 0.2f * rand_seed_f(&seed);
+  }
+
+  float bx[N], by[N];
+  struct MovingStatsFloat s;
+  init_moving_stats_f(&s, bx, by, N);
+
+  note("--- growing then sliding window vs batch functions");
+  float err_mean = 0.f, err_var = 0.f, err_cov = 0.f;
+  for (int i = 0; i < 2000; i++) {
+    update_moving_stats_f(&s, xs[i], ys[i]);
+    const int n = i + 1 < N ? i + 1 : N;
+    float *wx = &xs[i + 1 - n], *wy = &ys[i + 1 - n];
+    err_mean = fmaxf(err_mean, fabsf(moving_stats_mean_x_f(&s) - mean_f(wx, n)));
+    err_mean = fmaxf(err_mean, fabsf(moving_stats_mean_y_f(&s) - mean_f(wy, n)));
+    err_var = fmaxf(err_var, fabsf(moving_stats_variance_x_f(&s) - variance_f(wx, n)));
+    err_var = fmaxf(err_var, fabsf(moving_stats_variance_y_f(&s) - variance_f(wy, n)));
+    err_cov = fmaxf(err_cov, fabsf(moving_stats_covariance_f(&s) - covariance_f(wx, wy, n)));
+  }
+  note("max errors: mean %g, variance %g, covariance %g", err_mean, err_var, err_cov);
+  ok(moving_stats_nb_f(&s) == N, "window size reached");
+  ok(err_mean < 1e-5f && err_var < 1e-5f && err_cov < 1e-5f, "same mean, variance and covariance as the batch functions");
+
+  note("--- long run with an offset, vs double precision reference");
+  for (int i = 0; i < NB_SAMPLES; i++) {
+    xs[i] += 1000.f;
+  }
+  init_moving_stats_f(&s, bx, by, N);
+  double err_first = 0., err_last = 0., err_batch = 0.;
+  for (int k = 0; k < 50; k++) {
+    for (int i = 0; i < NB_SAMPLES; i++) {
+      update_moving_stats_f(&s, xs[i], ys[i]);
+      if ((k == 0 || k == 49) && i >= N && i % 97 == 0) {
+        const double ref = ref_cov(xs, ys, i + 1, N);
+        const double err = fabs(moving_stats_covariance_f(&s) - ref);
+        if (k == 0) {
+          err_first = fmax(err_first, err);
+          err_batch = fmax(err_batch, fabs(covariance_f(&xs[i + 1 - N], &ys[i + 1 - N], N) - ref));
+        } else {
+          err_last = fmax(err_last, err);
+        }
+      }
+    }
+  }
+  note("max covariance error: batch E[XY]-E[X]E[Y] %g, streaming %g, streaming after 1e6 updates %g",
+       err_batch, err_first, err_last);
+  ok(err_first < err_batch && err_last < 2. * err_first, "no drift of the streaming statistics");
+  for (int i = 0; i < NB_SAMPLES; i++) {
+    xs[i] -= 1000.f;
+  }
+
+  note("--- past samples and lagged covariance");
+  init_moving_stats_f(&s, bx, by, N);
+  int bad = 0;
+  for (int i = 0; i < 1000; i++) {
+    update_moving_stats_f(&s, xs[i], ys[i]);
+    for (uint32_t lag = 0; lag < 2 * N; lag += 37) {
+      const int j = i - (int)(lag % N);
+      const float expected = j >= 0 ? ys[j] : 0.f;
+      bad += moving_stats_past_y_f(&s, lag) != expected;
+    }
+  }
+  ok(bad == 0, "past samples read from the ring buffer");
+  // x delayed by lag against y, on the last N samples
+  const int lag = 25;
+  float dx[N - lag], dy[N - lag];
+  for (int i = 0; i < N - lag; i++) {
+    dx[i] = xs[1000 - N + i];
+    dy[i] = ys[1000 - N + i + lag];
+  }
+  ok(fabsf(moving_stats_lag_covariance_f(&s, lag) - covariance_f(dx, dy, N - lag)) < 1e-5f,
+     "lagged cross covariance");
+
+  note("--- optical flow hover detection, previous and new implementation");
+  float err_m[2] = { 0.f, 0.f };
+  for (int method = 0; method < 2; method++) {
+    struct old_history h = { .ind = 0, .filled = 0 };
+    for (int i = 0; i < N; i++) {
+      h.input[i] = h.OF[i] = h.past_OF[i] = 0.f;
+    }
+    float in[N], of[N], past[N], of_pair[N];
+    struct MovingStatsFloat cov_input, cov_past;
+    init_moving_stats_f(&cov_input, in, of, N);
+    init_moving_stats_f(&cov_past, past, of_pair, N);
+    uint8_t filled = 0;
+    for (int i = 0; i < 3 * N + 17; i++) {
+      const float c_old = old_cov(&h, method, xs[i] * 100.f, ys[i], N / 2);
+      update_moving_stats_f(&cov_input, xs[i] * 100.f, ys[i]);
+      const float p = moving_stats_past_y_f(&cov_input, N / 2);
+      update_moving_stats_f(&cov_past, p, ys[i]);
+      float c_new = 0.f;
+      if (method == 0 && filled > 0) {
+        c_new = moving_stats_covariance_f(&cov_input);
+      } else if (method == 1 && filled > 1) {
+        c_new = moving_stats_covariance_f(&cov_past);
+      }
+      if (filled < 2 && (i + 1) % N == 0) {
+        filled++;
+      }
+      err_m[method] = fmaxf(err_m[method], fabsf(c_new - c_old));
+    }
+  }
+  note("max difference: %g with the input, %g with the past flow", err_m[0], err_m[1]);
+  ok(err_m[0] < 1e-4f && err_m[1] < 1e-5f, "same covariances for both methods");
+
+  note("--- update cost, window of %d samples", N);
+  volatile float sink = 0.f;
+  double t0 = now_s();
+  for (int i = 0; i < NB_RUNS; i++) {
+    sink += covariance_f(bx, by, N);
+  }
+  const double t_batch = (now_s() - t0) / NB_RUNS;
+  t0 = now_s();
+  for (int i = 0; i < NB_RUNS; i++) {
+    update_moving_stats_f(&s, xs[i % NB_SAMPLES], ys[i % NB_SAMPLES]);
+    sink += moving_stats_covariance_f(&s);
+  }
+  const double t_stream = (now_s() - t0) / NB_RUNS;
+  note("batch covariance_f %.0f ns, streaming update %.1f ns", t_batch * 1e9, t_stream * 1e9);
+
+  free(xs);
+  free(ys);
+  done_testing();
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_pprz_trig.c
+ * @brief Accuracy and throughput of the float and fixed point trig implementations.
+ */
+
+#include "tap.h"
+#include "test_utils.h"
+#include <math.h>
+
+#include "math/pprz_trig_float.h"
+#include "math/pprz_trig_int.h"
+#include "math/pprz_algebra_int.h"
+
+#define NB_BENCH 4096
+
+struct TrigImpl {
+  const char *name;
+  float (*sin)(float);
+  float (*cos)(float);
+  void (*sincos)(float, float *, float *);
+  float (*atan2)(float, float);
+  float err;
+};
+
+static float sinf_libm(float x) { return pprz_sinf_libm(x); }
+static float cosf_libm(float x) { return pprz_cosf_libm(x); }
+static void sincosf_libm(float x, float *s, float *c) { pprz_sincosf_libm(x, s, c); }
+static float atan2f_libm(float y, float x) { return pprz_atan2f_libm(y, x); }
+
+static const struct TrigImpl impls[] = {
+  { "libm", sinf_libm, cosf_libm, sincosf_libm, atan2f_libm, PPRZ_TRIG_FLOAT_LIBM_ERR },
+  { "poly", pprz_sinf_poly, pprz_cosf_poly, pprz_sincosf_poly, pprz_atan2f_poly, PPRZ_TRIG_FLOAT_POLY_ERR },
+  { "lut", pprz_sinf_lut, pprz_cosf_lut, pprz_sincosf_lut, pprz_atan2f_lut, PPRZ_TRIG_FLOAT_LUT_ERR },
+  { "int", pprz_sinf_int, pprz_cosf_int, pprz_sincosf_int, pprz_atan2f_int, PPRZ_TRIG_FLOAT_INT_ERR },
+};
+
+#define NB_IMPLS (sizeof(impls) / sizeof(impls[0]))
+
+/* max error of sin and cos on [-range, range], and mismatch of sincos */
+static void check_sincos(const struct TrigImpl *t, float range, int nb, double *err, double *err_sincos)
+{
+  *err = 0.;
+  *err_sincos = 0.;
+  for (int i = 0; i <= nb; i++) {
+    const float x = -range + 2.f * range * i / nb;
+    const float s = t->sin(x);
+    const float c = t->cos(x);
+    float s2, c2;
+    t->sincos(x, &s2, &c2);
+    *err = fmax(*err, fabs(s - sin((double)x)));
+    *err = fmax(*err, fabs(c - cos((double)x)));
+    *err_sincos = fmax(*err_sincos, fmax(fabs(s - s2), fabs(c - c2)));
+  }
+}
+
+/* max error of atan2 on circles of several radius, axes included */
+static double check_atan2(float (*f)(float, float))
+{
+  const float radius[] = { 1e-3f, 1.f, 1e4f };
+  double err = 0.;
+  for (unsigned int k = 0; k < sizeof(radius) / sizeof(radius[0]); k++) {
+    for (int i = 0; i < 100000; i++) {
+      const double a = -M_PI + 2. * M_PI * i / 100000;
+      const float y = radius[k] * sin(a);
+      const float x = radius[k] * cos(a);
+      err = fmax(err, fabs(f(y, x) - atan2((double)y, (double)x)));
+    }
+  }
+  err = fmax(err, fabs(f(0.f, 0.f)));
+  return err;
+}
+
+int main(void)
+{
+  plan(3 * NB_IMPLS + 3);
+
+  static float xs[NB_BENCH], ys[NB_BENCH];
+  for (int i = 0; i < NB_BENCH; i++) {
+    xs[i] = -4.f + 8.f * ((i * 2654435761u) % NB_BENCH) / NB_BENCH;
+    ys[i] = cosf(i * 0.7f);
+  }
+
+  note("--- float implementations, max abs error and throughput");
+  for (unsigned int k = 0; k < NB_IMPLS; k++) {
+    const struct TrigImpl *t = &impls[k];
+    double err_small, err_large, err_sincos;
+    check_sincos(t, 4.f, 2000000, &err_small, &err_sincos);
+    check_sincos(t, PPRZ_TRIG_FLOAT_RANGE, 2000000, &err_large, &err_sincos);
+    const double err_atan2 = check_atan2(t->atan2);
+
+    volatile float sink = 0.f;
+    double t0 = now_s();
+    for (int r = 0; r < NB_RUNS; r++) {
+      for (int i = 0; i < NB_BENCH; i++) {
+        sink += t->sin(xs[i]);
+      }
+    }
+    const double t_sin = (now_s() - t0) / (NB_RUNS * NB_BENCH);
+    t0 = now_s();
+    for (int r = 0; r < NB_RUNS; r++) {
+      for (int i = 0; i < NB_BENCH; i++) {
+        float s, c;
+        t->sincos(xs[i], &s, &c);
+        sink += s + c;
+      }
+    }
+    const double t_sincos = (now_s() - t0) / (NB_RUNS * NB_BENCH);
+    t0 = now_s();
+    for (int r = 0; r < NB_RUNS; r++) {
+      for (int i = 0; i < NB_BENCH; i++) {
+        sink += t->atan2(ys[i], xs[i]);
+      }
+    }
+    const double t_atan2 = (now_s() - t0) / (NB_RUNS * NB_BENCH);
+
+    note("%-4s sin/cos err %.2e (|x|<4) %.2e (|x|<%g), atan2 err %.2e, sin %.1f ns, sincos %.1f ns, atan2 %.1f ns",
+         t->name, err_small, err_large, PPRZ_TRIG_FLOAT_RANGE, err_atan2, t_sin * 1e9, t_sincos * 1e9, t_atan2 * 1e9);
+    ok(fmax(err_small, err_large) < t->err, "%s: sin and cos within %g", t->name, t->err);
+    ok(err_sincos == 0., "%s: sincos same as sin and cos", t->name);
+    ok(err_atan2 < t->err, "%s: atan2 within %g", t->name, t->err);
+  }
+
+  ok(pprz_sinf(0.3f) == sinf(0.3f) && pprz_atan2f(0.3f, -2.f) == atan2f(0.3f, -2.f),
+     "libm selected by default");
+
+  note("--- fixed point implementations");
+  double err_sin = 0.;
+  for (int32_t a = -INT32_ANGLE_2_PI; a <= INT32_ANGLE_2_PI; a++) {
+    const double x = ANGLE_FLOAT_OF_BFP((double)a);
+    err_sin = fmax(err_sin, fabs(TRIG_FLOAT_OF_BFP((double)pprz_itrig_sin(a)) - sin(x)));
+    err_sin = fmax(err_sin, fabs(TRIG_FLOAT_OF_BFP((double)pprz_itrig_cos(a)) - cos(x)));
+  }
+  double err_atan[2] = { 0., 0. };
+  for (int i = 0; i < 100000; i++) {
+    const double a = -M_PI + 2. * M_PI * i / 100000;
+    const int32_t y = 10000 * sin(a);
+    const int32_t x = 10000 * cos(a);
+    const double ref = atan2(y, x);
+    err_atan[0] = fmax(err_atan[0], fabs(ANGLE_FLOAT_OF_BFP((double)int32_atan2(y, x)) - ref));
+    err_atan[1] = fmax(err_atan[1], fabs(ANGLE_FLOAT_OF_BFP((double)int32_atan2_2(y, x)) - ref));
+  }
+
+  static int32_t as[NB_BENCH], iy[NB_BENCH], ix[NB_BENCH];
+  for (int i = 0; i < NB_BENCH; i++) {
+    as[i] = ANGLE_BFP_OF_REAL(xs[i]);
+    iy[i] = 10000 * ys[i];
+    ix[i] = 10000 * xs[i];
+  }
+  volatile int32_t isink = 0;
+  double t0 = now_s();
+  for (int r = 0; r < NB_RUNS; r++) {
+    for (int i = 0; i < NB_BENCH; i++) {
+      isink += pprz_itrig_sin(as[i]);
+    }
+  }
+  const double t_isin = (now_s() - t0) / (NB_RUNS * NB_BENCH);
+  double t_iatan[2];
+  for (int k = 0; k < 2; k++) {
+    int32_t (*f)(int32_t, int32_t) = k == 0 ? int32_atan2 : int32_atan2_2;
+    t0 = now_s();
+    for (int r = 0; r < NB_RUNS; r++) {
+      for (int i = 0; i < NB_BENCH; i++) {
+        isink += f(iy[i], ix[i]);
+      }
+    }
+    t_iatan[k] = (now_s() - t0) / (NB_RUNS * NB_BENCH);
+  }
+  note("pprz_itrig_sin/cos err %.2e, %.1f ns", err_sin, t_isin * 1e9);
+  note("int32_atan2 err %.2e, %.1f ns, int32_atan2_2 err %.2e, %.1f ns",
+       err_atan[0], t_iatan[0] * 1e9, err_atan[1], t_iatan[1] * 1e9);
+  ok(err_sin < 1e-4, "pprz_itrig_sin and pprz_itrig_cos within table resolution");
+  ok(err_atan[0] < 0.075 && err_atan[1] < 0.012, "int32_atan2 and int32_atan2_2 bounded");
+
+  done_testing();
+}
@@ -75,14 +75,31 @@ static void test_pos_lla_i(void)
   }
 }
 
+static void test_pos_epoch(void)
+{
+  /* no local origin, so NED to ENU (int) conversion is not possible */
+  stateInit();
+  struct NedCoor_f ned_f = { 1.f, 2.f, 3.f };
+  stateSetPositionNed_f(&ned_f);
+  uint32_t epoch = stateGetPositionEpoch();
+  stateGetPositionEnu_i();
+  ok(bit_is_set(state.pos_tried, POS_ENU_I) && !bit_is_set(state.pos_status, POS_ENU_I),
+     "failed conversion is marked as tried for the current epoch");
+
+  stateSetPositionNed_f(&ned_f);
+  ok(stateGetPositionEpoch() == epoch + 1 && state.pos_tried == 0,
+     "setting the position starts a new epoch");
+}
+
 int main()
 {
   note("\n *** running state interface tests ***");
-  plan(1);
+  plan(3);
 
   stateInit();
 
   test_pos_lla_i();
+  test_pos_epoch();
 
   done_testing();
 }
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_utils.h
+ * @brief Helpers shared by the tests and their benchmarks.
+ *
+ * Define NB_RUNS before including this file to change the number of
+ * benchmark runs.
+ */
+
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include <stdlib.h>
+#include <time.h>
+
+/** Number of runs of the benchmarks */
+#ifndef NB_RUNS
+#define NB_RUNS 500
+#endif
+
+/** Monotonic time (s) */
+static inline double now_s(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/** Uniform random number in [min, max] from rand() */
+static inline float rand_f(float min, float max)
+{
+  return min + (max - min) * rand() / (float)RAND_MAX;
+}
+
+#endif /* TEST_UTILS_H */
@@ -0,0 +1,241 @@
+/* Automatically generated by gen_abi from abi_test_messages.xml */
+/* Version v5.15_devel */
+/* Please DO NOT EDIT */
+
+/* Onboard middleware library ABI
+ * send and receive messages of class test
+ */
+
+#ifndef ABI_MESSAGES_H
+#define ABI_MESSAGES_H
+
+#include "subsystems/abi_common.h"
+
+/* Messages IDs */
+#define ABI_TEST_SCALAR_ID 0
+#define ABI_TEST_VECT_ID 1
+#define ABI_TEST_EMPTY_ID 3
+
+/* Array and linked list structure */
+#define ABI_MESSAGE_NB 4
+
+#if !ABI_USE_STRUCT
+ABI_EXTERN abi_event* abi_queues[ABI_MESSAGE_NB];
+#endif
+#if ABI_STATS
+ABI_EXTERN struct abi_stats abi_stats[ABI_MESSAGE_NB];
+#endif
+
+/* Message structures */
+struct AbiMsgTEST_SCALAR {
+  uint32_t stamp;
+  float value;
+  int16_t count;
+};
+struct AbiMsgTEST_VECT {
+  uint32_t stamp;
+  struct FloatVect3 * vect;
+};
+struct AbiMsgTEST_EMPTY {
+  uint8_t unused;
+};
+
+/* Callbacks */
+typedef void (*abi_callbackTEST_SCALAR)(uint8_t sender_id, uint32_t stamp, float value, int16_t count);
+typedef void (*abi_ptr_callbackTEST_SCALAR)(uint8_t sender_id, const struct AbiMsgTEST_SCALAR *msg);
+typedef void (*abi_callbackTEST_VECT)(uint8_t sender_id, uint32_t stamp, struct FloatVect3 * vect);
+typedef void (*abi_ptr_callbackTEST_VECT)(uint8_t sender_id, const struct AbiMsgTEST_VECT *msg);
+typedef void (*abi_callbackTEST_EMPTY)(uint8_t sender_id);
+typedef void (*abi_ptr_callbackTEST_EMPTY)(uint8_t sender_id, const struct AbiMsgTEST_EMPTY *msg);
+
+#if ABI_USE_STRUCT
+/* Subscriber arrays, size can be set per message */
+#ifndef ABI_TEST_SCALAR_SUBSCRIBERS
+#define ABI_TEST_SCALAR_SUBSCRIBERS ABI_MAX_SUBSCRIBERS
+#endif
+ABI_EXTERN struct abi_subscriber abi_subscribersTEST_SCALAR[ABI_TEST_SCALAR_SUBSCRIBERS];
+ABI_EXTERN uint8_t abi_nb_subscribersTEST_SCALAR;
+#ifndef ABI_TEST_VECT_SUBSCRIBERS
+#define ABI_TEST_VECT_SUBSCRIBERS ABI_MAX_SUBSCRIBERS
+#endif
+ABI_EXTERN struct abi_subscriber abi_subscribersTEST_VECT[ABI_TEST_VECT_SUBSCRIBERS];
+ABI_EXTERN uint8_t abi_nb_subscribersTEST_VECT;
+#ifndef ABI_TEST_EMPTY_SUBSCRIBERS
+#define ABI_TEST_EMPTY_SUBSCRIBERS ABI_MAX_SUBSCRIBERS
+#endif
+ABI_EXTERN struct abi_subscriber abi_subscribersTEST_EMPTY[ABI_TEST_EMPTY_SUBSCRIBERS];
+ABI_EXTERN uint8_t abi_nb_subscribersTEST_EMPTY;
+#endif
+
+/* Bind and Send functions */
+
+#if ABI_USE_STRUCT
+
+static inline void AbiBindMsgTEST_SCALAR(uint8_t sender_id, abi_event * ev, abi_callbackTEST_SCALAR cb) {
+  abi_bind_subscriber(abi_subscribersTEST_SCALAR, &abi_nb_subscribersTEST_SCALAR, ABI_TEST_SCALAR_SUBSCRIBERS, sender_id, ev, (abi_callback)cb, false);
+}
+
+static inline void AbiBindMsgPtrTEST_SCALAR(uint8_t sender_id, abi_event * ev, abi_ptr_callbackTEST_SCALAR cb) {
+  abi_bind_subscriber(abi_subscribersTEST_SCALAR, &abi_nb_subscribersTEST_SCALAR, ABI_TEST_SCALAR_SUBSCRIBERS, sender_id, ev, (abi_callback)cb, true);
+}
+
+static inline void AbiSendMsgPtrTEST_SCALAR(uint8_t sender_id, const struct AbiMsgTEST_SCALAR *msg) {
+  const struct abi_subscriber *s = abi_subscribersTEST_SCALAR;
+  const struct abi_subscriber *end = s + abi_nb_subscribersTEST_SCALAR;
+  ABI_STATS_START(ABI_TEST_SCALAR_ID);
+  for (; s < end; s++) {
+    if (s->id == ABI_BROADCAST || s->id == sender_id) {
+      if (s->ptr) {
+        ((abi_ptr_callbackTEST_SCALAR)(s->cb))(sender_id, msg);
+      } else {
+        ((abi_callbackTEST_SCALAR)(s->cb))(sender_id, msg->stamp, msg->value, msg->count);
+      }
+      ABI_STATS_DISPATCH(ABI_TEST_SCALAR_ID);
+    }
+  }
+  ABI_STATS_END(ABI_TEST_SCALAR_ID);
+}
+
+static inline void AbiSendMsgTEST_SCALAR(uint8_t sender_id, uint32_t stamp, float value, int16_t count) {
+  const struct AbiMsgTEST_SCALAR msg = { stamp, value, count };
+  AbiSendMsgPtrTEST_SCALAR(sender_id, &msg);
+}
+
+static inline void AbiBindMsgTEST_VECT(uint8_t sender_id, abi_event * ev, abi_callbackTEST_VECT cb) {
+  abi_bind_subscriber(abi_subscribersTEST_VECT, &abi_nb_subscribersTEST_VECT, ABI_TEST_VECT_SUBSCRIBERS, sender_id, ev, (abi_callback)cb, false);
+}
+
+static inline void AbiBindMsgPtrTEST_VECT(uint8_t sender_id, abi_event * ev, abi_ptr_callbackTEST_VECT cb) {
+  abi_bind_subscriber(abi_subscribersTEST_VECT, &abi_nb_subscribersTEST_VECT, ABI_TEST_VECT_SUBSCRIBERS, sender_id, ev, (abi_callback)cb, true);
+}
+
+static inline void AbiSendMsgPtrTEST_VECT(uint8_t sender_id, const struct AbiMsgTEST_VECT *msg) {
+  const struct abi_subscriber *s = abi_subscribersTEST_VECT;
+  const struct abi_subscriber *end = s + abi_nb_subscribersTEST_VECT;
+  ABI_STATS_START(ABI_TEST_VECT_ID);
+  for (; s < end; s++) {
+    if (s->id == ABI_BROADCAST || s->id == sender_id) {
+      if (s->ptr) {
+        ((abi_ptr_callbackTEST_VECT)(s->cb))(sender_id, msg);
+      } else {
+        ((abi_callbackTEST_VECT)(s->cb))(sender_id, msg->stamp, msg->vect);
+      }
+      ABI_STATS_DISPATCH(ABI_TEST_VECT_ID);
+    }
+  }
+  ABI_STATS_END(ABI_TEST_VECT_ID);
+}
+
+static inline void AbiSendMsgTEST_VECT(uint8_t sender_id, uint32_t stamp, struct FloatVect3 * vect) {
+  const struct AbiMsgTEST_VECT msg = { stamp, vect };
+  AbiSendMsgPtrTEST_VECT(sender_id, &msg);
+}
+
+static inline void AbiBindMsgTEST_EMPTY(uint8_t sender_id, abi_event * ev, abi_callbackTEST_EMPTY cb) {
+  abi_bind_subscriber(abi_subscribersTEST_EMPTY, &abi_nb_subscribersTEST_EMPTY, ABI_TEST_EMPTY_SUBSCRIBERS, sender_id, ev, (abi_callback)cb, false);
+}
+
+static inline void AbiBindMsgPtrTEST_EMPTY(uint8_t sender_id, abi_event * ev, abi_ptr_callbackTEST_EMPTY cb) {
+  abi_bind_subscriber(abi_subscribersTEST_EMPTY, &abi_nb_subscribersTEST_EMPTY, ABI_TEST_EMPTY_SUBSCRIBERS, sender_id, ev, (abi_callback)cb, true);
+}
+
+static inline void AbiSendMsgPtrTEST_EMPTY(uint8_t sender_id, const struct AbiMsgTEST_EMPTY *msg) {
+  const struct abi_subscriber *s = abi_subscribersTEST_EMPTY;
+  const struct abi_subscriber *end = s + abi_nb_subscribersTEST_EMPTY;
+  ABI_STATS_START(ABI_TEST_EMPTY_ID);
+  for (; s < end; s++) {
+    if (s->id == ABI_BROADCAST || s->id == sender_id) {
+      if (s->ptr) {
+        ((abi_ptr_callbackTEST_EMPTY)(s->cb))(sender_id, msg);
+      } else {
+        ((abi_callbackTEST_EMPTY)(s->cb))(sender_id);
+      }
+      ABI_STATS_DISPATCH(ABI_TEST_EMPTY_ID);
+    }
+  }
+  ABI_STATS_END(ABI_TEST_EMPTY_ID);
+}
+
+static inline void AbiSendMsgTEST_EMPTY(uint8_t sender_id) {
+  const struct AbiMsgTEST_EMPTY msg = { 0 };
+  AbiSendMsgPtrTEST_EMPTY(sender_id, &msg);
+}
+
+#else /* linked list */
+
+static inline void AbiBindMsgTEST_SCALAR(uint8_t sender_id, abi_event * ev, abi_callbackTEST_SCALAR cb) {
+  if (abi_queues[ABI_TEST_SCALAR_ID] == ev) return;
+  ev->id = sender_id;
+  ev->cb = (abi_callback)cb;
+  ABI_PREPEND(abi_queues[ABI_TEST_SCALAR_ID],ev);
+}
+
+static inline void AbiSendMsgTEST_SCALAR(uint8_t sender_id, uint32_t stamp, float value, int16_t count) {
+  abi_event* e;
+  ABI_STATS_START(ABI_TEST_SCALAR_ID);
+  ABI_FOREACH(abi_queues[ABI_TEST_SCALAR_ID],e) {
+    if (e->id == ABI_BROADCAST || e->id == sender_id) {
+      abi_callbackTEST_SCALAR cb = (abi_callbackTEST_SCALAR)(e->cb);
+      cb(sender_id, stamp, value, count);
+      ABI_STATS_DISPATCH(ABI_TEST_SCALAR_ID);
+    }
+  }
+  ABI_STATS_END(ABI_TEST_SCALAR_ID);
+}
+
+static inline void AbiSendMsgPtrTEST_SCALAR(uint8_t sender_id, const struct AbiMsgTEST_SCALAR *msg) {
+  AbiSendMsgTEST_SCALAR(sender_id, msg->stamp, msg->value, msg->count);
+}
+
+static inline void AbiBindMsgTEST_VECT(uint8_t sender_id, abi_event * ev, abi_callbackTEST_VECT cb) {
+  if (abi_queues[ABI_TEST_VECT_ID] == ev) return;
+  ev->id = sender_id;
+  ev->cb = (abi_callback)cb;
+  ABI_PREPEND(abi_queues[ABI_TEST_VECT_ID],ev);
+}
+
+static inline void AbiSendMsgTEST_VECT(uint8_t sender_id, uint32_t stamp, struct FloatVect3 * vect) {
+  abi_event* e;
+  ABI_STATS_START(ABI_TEST_VECT_ID);
+  ABI_FOREACH(abi_queues[ABI_TEST_VECT_ID],e) {
+    if (e->id == ABI_BROADCAST || e->id == sender_id) {
+      abi_callbackTEST_VECT cb = (abi_callbackTEST_VECT)(e->cb);
+      cb(sender_id, stamp, vect);
+      ABI_STATS_DISPATCH(ABI_TEST_VECT_ID);
+    }
+  }
+  ABI_STATS_END(ABI_TEST_VECT_ID);
+}
+
+static inline void AbiSendMsgPtrTEST_VECT(uint8_t sender_id, const struct AbiMsgTEST_VECT *msg) {
+  AbiSendMsgTEST_VECT(sender_id, msg->stamp, msg->vect);
+}
+
+static inline void AbiBindMsgTEST_EMPTY(uint8_t sender_id, abi_event * ev, abi_callbackTEST_EMPTY cb) {
+  if (abi_queues[ABI_TEST_EMPTY_ID] == ev) return;
+  ev->id = sender_id;
+  ev->cb = (abi_callback)cb;
+  ABI_PREPEND(abi_queues[ABI_TEST_EMPTY_ID],ev);
+}
+
+static inline void AbiSendMsgTEST_EMPTY(uint8_t sender_id) {
+  abi_event* e;
+  ABI_STATS_START(ABI_TEST_EMPTY_ID);
+  ABI_FOREACH(abi_queues[ABI_TEST_EMPTY_ID],e) {
+    if (e->id == ABI_BROADCAST || e->id == sender_id) {
+      abi_callbackTEST_EMPTY cb = (abi_callbackTEST_EMPTY)(e->cb);
+      cb(sender_id);
+      ABI_STATS_DISPATCH(ABI_TEST_EMPTY_ID);
+    }
+  }
+  ABI_STATS_END(ABI_TEST_EMPTY_ID);
+}
+
+static inline void AbiSendMsgPtrTEST_EMPTY(uint8_t sender_id, const struct AbiMsgTEST_EMPTY *msg) {
+  (void) msg;
+  AbiSendMsgTEST_EMPTY(sender_id);
+}
+
+#endif /* ABI_USE_STRUCT */
+
+#endif // ABI_MESSAGES_H
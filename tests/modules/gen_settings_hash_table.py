@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+#
+# Copyright (C) 2020 Paparazzi Team
+#
+# This file is part of paparazzi.
+#
+# paparazzi is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# paparazzi is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with paparazzi; see the file COPYING.  If not, see
+# <http://www.gnu.org/licenses/>.
+#
+
+"""
+Generate settings_hash_table.h for test_settings_hash.c.
+
+Port of the lookup part of print_dl_settings in
+sw/tools/generators/gen_settings.ml (short_name, settings_hash, perfect_hash
+and the generated C code), applied to the dl_setting of the xml files of
+conf/settings and its first level subdirectories (in alphabetical order).
+Must be kept in sync with gen_settings.ml.
+
+usage: gen_settings_hash_table.py <paparazzi home> <output file>
+"""
+
+import glob
+import os
+import re
+import sys
+import xml.etree.ElementTree as ET
+
+
+def short_name(var):
+    """Short name of a setting (16 chars max), used as MAVLink parameter id"""
+    parts = [p for p in re.split(r'[_.]+', var) if p]
+    return ''.join('_' + p[:3] for p in parts)[1:17]
+
+
+def settings_hash(seed, name):
+    """FNV-1a hash of a name, 32 bits, with a seed (0 for the default basis)"""
+    h = 0x811c9dc5 if seed == 0 else seed
+    for c in name.encode():
+        h = ((h ^ c) * 0x01000193) & 0xffffffff
+    return h
+
+
+def perfect_hash(keys):
+    """Minimal perfect hash (hash and displace), see gen_settings.ml"""
+    n = len(keys)
+    buckets = [[] for _ in range(n)]
+    for i, k in enumerate(keys):
+        buckets[settings_hash(0, k) % n].append(i)
+    # stable sort, largest buckets first
+    order = sorted(range(n), key=lambda b: -len(buckets[b]))
+    g = [0] * n
+    slots = [-1] * n
+    for b in order:
+        items = buckets[b]
+        if len(items) > 1:
+            d = 1
+            while True:
+                pos = [settings_hash(d, keys[i]) % n for i in items]
+                if len(set(pos)) == len(pos) and all(slots[p] < 0 for p in pos):
+                    g[b] = d
+                    for i, p in zip(items, pos):
+                        slots[p] = i
+                    break
+                d += 1
+    free = 0
+    for b in order:
+        if len(buckets[b]) == 1:
+            while slots[free] >= 0:
+                free += 1
+            slots[free] = buckets[b][0]
+            g[b] = -free - 1
+    return g, slots
+
+
+def attrib(xml, name):
+    """attribute value, names are not case sensitive as in ExtXml"""
+    for k, v in xml.attrib.items():
+        if k.lower() == name:
+            return v
+    raise KeyError(name)
+
+
+def settings_files(home):
+    files = glob.glob(os.path.join(home, 'conf', 'settings', '*.xml'))
+    files += glob.glob(os.path.join(home, 'conf', 'settings', '*', '*.xml'))
+    return sorted(files)
+
+
+def flatten(xml, r):
+    """dl_setting nodes in document order"""
+    if xml.tag == 'dl_setting':
+        r.append(xml)
+    else:
+        for x in xml:
+            flatten(x, r)
+    return r
+
+
+def main(home, out):
+    settings = []
+    for f in settings_files(home):
+        try:
+            flatten(ET.parse(f).getroot(), settings)
+        except ET.ParseError as e:
+            sys.stderr.write('skipping %s: %s\n' % (f, e))
+    names = [short_name(attrib(s, 'var')) for s in settings]
+
+    # for settings with the same short name, the first one is found
+    keys = []
+    idx = []
+    for i, n in enumerate(names):
+        if n not in keys:
+            keys.append(n)
+            idx.append(i)
+    g, slots = perfect_hash(keys)
+
+    o = ['/*',
+         ' * Lookup part of the settings.h generated by gen_settings.ml for the dl_setting',
+         ' * of the xml files of conf/settings and its first level subdirectories',
+         ' * (in alphabetical order).',
+         ' * Generated by gen_settings_hash_table.py for test_settings_hash.c, do not edit.',
+         ' */',
+         '',
+         '#ifndef SETTINGS_HASH_TABLE_H',
+         '#define SETTINGS_HASH_TABLE_H',
+         '',
+         '#include <stdint.h>',
+         '',
+         '#define SETTINGS_NAMES_SHORT { \\']
+    o += [' "%s" , \\' % n for n in names]
+    o += ['};',
+          '#define NB_SETTING %d' % len(names),
+          'static inline const char *settings_get_short_name(uint16_t i) {',
+          '  static const char names[][16 + 1] = SETTINGS_NAMES_SHORT;',
+          '  return names[i];',
+          '}',
+          '#define SETTINGS_HASH_SIZE %d' % len(g),
+          'static inline uint32_t settings_hash(uint32_t seed, const char *name) {',
+          '  uint32_t h = (seed == 0) ? 0x811c9dc5 : seed;',
+          '  uint8_t i;',
+          "  for (i = 0; i < 16 && name[i] != '\\0'; i++) {",
+          '    h = (h ^ (uint8_t)name[i]) * 0x01000193;',
+          '  }',
+          '  return h;',
+          '}',
+          'static inline int16_t settings_idx_from_short_name(const char *name) {',
+          '  static const int32_t g[SETTINGS_HASH_SIZE] = { %s };' % ', '.join(map(str, g)),
+          '  static const uint16_t slot_idx[SETTINGS_HASH_SIZE] = { %s };' %
+          ', '.join('0' if k < 0 else str(idx[k]) for k in slots),
+          '  int32_t d = g[settings_hash(0, name) % SETTINGS_HASH_SIZE];',
+          '  uint16_t i = (d < 0) ? slot_idx[-d - 1] : slot_idx[settings_hash(d, name) % SETTINGS_HASH_SIZE];',
+          '  const char *s = settings_get_short_name(i);',
+          '  uint8_t j;',
+          '  for (j = 0; j < 16; j++) {',
+          "    if (s[j] != name[j]) { return -1; }",
+          "    if (s[j] == '\\0') { break; }",
+          '  }',
+          '  return i;',
+          '}',
+          '',
+          '#endif /* SETTINGS_HASH_TABLE_H */']
+    with open(out, 'w') as f:
+        f.write('\n'.join(o) + '\n')
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    main(sys.argv[1], sys.argv[2])
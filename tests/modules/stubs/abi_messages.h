@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file stubs/abi_messages.h
+ * ABI senders used by the host tests, implemented by the tests to capture
+ * the messages instead of the generated callbacks.
+ */
+
+#ifndef ABI_MESSAGES_H
+#define ABI_MESSAGES_H
+
+#include "subsystems/abi_common.h"
+
+extern void AbiSendMsgIMU_BATCH(uint8_t sender_id, uint32_t stamp, struct ImuBatch *batch);
+
+#endif /* ABI_MESSAGES_H */
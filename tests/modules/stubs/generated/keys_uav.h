@@ -0,0 +1,33 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file stubs/generated/keys_uav.h
+ * Dummy keys for the host tests of the secure datalink.
+ */
+
+#ifndef KEYS_UAV_H
+#define KEYS_UAV_H
+
+#define GCS_PUBLIC {0}
+#define UAV_PUBLIC {0}
+#define UAV_PRIVATE {0}
+
+#endif /* KEYS_UAV_H */
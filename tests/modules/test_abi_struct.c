@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_abi_struct.c
+ * @brief Test of the ABI bind and send functions generated by gen_abi.
+ *
+ * abi_test_messages.h is generated by gen_abi from abi_test_messages.xml,
+ * the test is built with the struct mode (test_abi_struct.run) and with the
+ * linked lists (test_abi_list.run), both with the statistics.
+ */
+
+#define ABI_C
+#define ABI_STATS TRUE
+#define ABI_STATS_TIME() (test_time += 10)
+#define ABI_TEST_VECT_SUBSCRIBERS 2
+
+#include "../math/tap.h"
+#include <stdint.h>
+
+static uint32_t test_time;
+
+#include "abi_test_messages.h"
+
+#define SENDER_A 1
+#define SENDER_B 2
+
+/* received messages */
+static int nb_scalar, nb_vect, nb_vect_b, nb_empty;
+static struct AbiMsgTEST_SCALAR last_scalar;
+static struct FloatVect3 *last_vect;
+
+static void scalar_cb(uint8_t sender_id __attribute__((unused)), uint32_t stamp, float value, int16_t count)
+{
+  nb_scalar++;
+  last_scalar.stamp = stamp;
+  last_scalar.value = value;
+  last_scalar.count = count;
+}
+
+static void vect_cb(uint8_t sender_id __attribute__((unused)), uint32_t stamp __attribute__((unused)),
+                    struct FloatVect3 *vect)
+{
+  nb_vect++;
+  last_vect = vect;
+}
+
+static void vect_b_cb(uint8_t sender_id __attribute__((unused)), uint32_t stamp __attribute__((unused)),
+                      struct FloatVect3 *vect __attribute__((unused)))
+{
+  nb_vect_b++;
+}
+
+static void empty_cb(uint8_t sender_id __attribute__((unused)))
+{
+  nb_empty++;
+}
+
+#if ABI_USE_STRUCT
+static int nb_scalar_ptr;
+static struct AbiMsgTEST_SCALAR last_scalar_ptr;
+
+static void scalar_ptr_cb(uint8_t sender_id __attribute__((unused)), const struct AbiMsgTEST_SCALAR *msg)
+{
+  nb_scalar_ptr++;
+  last_scalar_ptr = *msg;
+}
+#endif
+
+int main(void)
+{
+  abi_event scalar_ev, scalar_ptr_ev, vect_ev, vect_b_ev, vect_c_ev, empty_ev;
+
+#if ABI_USE_STRUCT
+  note("struct mode");
+  plan(9);
+#else
+  note("linked lists");
+  plan(7);
+#endif
+
+  ok(ABI_MESSAGE_NB == 4 && ABI_TEST_EMPTY_ID == 3, "message ids up to the highest one");
+
+  /* argument list callback, and structure callback in struct mode */
+  AbiBindMsgTEST_SCALAR(ABI_BROADCAST, &scalar_ev, scalar_cb);
+#if ABI_USE_STRUCT
+  AbiBindMsgPtrTEST_SCALAR(ABI_BROADCAST, &scalar_ptr_ev, scalar_ptr_cb);
+#else
+  (void) scalar_ptr_ev;
+#endif
+  AbiSendMsgTEST_SCALAR(SENDER_A, 1234, 1.5f, -7);
+  ok(nb_scalar == 1 && last_scalar.stamp == 1234 && last_scalar.value == 1.5f && last_scalar.count == -7,
+     "arguments received by an argument list callback");
+#if ABI_USE_STRUCT
+  ok(nb_scalar_ptr == 1 && last_scalar_ptr.stamp == 1234 && last_scalar_ptr.value == 1.5f
+     && last_scalar_ptr.count == -7, "structure received by a structure callback");
+#endif
+
+  /* structure sent, pointer fields are passed through */
+  struct FloatVect3 v = { 1.f, 2.f, 3.f };
+  struct AbiMsgTEST_VECT msg_vect = { 42, &v };
+  AbiBindMsgTEST_VECT(SENDER_A, &vect_ev, vect_cb);
+  AbiSendMsgPtrTEST_VECT(SENDER_A, &msg_vect);
+  ok(nb_vect == 1 && last_vect == &v, "structure sent to an argument list callback");
+
+  /* only the messages of the bound sender are received */
+  AbiSendMsgTEST_VECT(SENDER_B, 43, &v);
+  ok(nb_vect == 1, "message of another sender ignored");
+
+  /* binding an event again updates the subscriber */
+  AbiBindMsgTEST_VECT(SENDER_B, &vect_ev, vect_cb);
+  AbiSendMsgTEST_VECT(SENDER_A, 44, &v);
+  AbiSendMsgTEST_VECT(SENDER_B, 45, &v);
+  ok(nb_vect == 2, "event bound again to another sender");
+
+#if ABI_USE_STRUCT
+  /* two subscribers for TEST_VECT, the third binding is refused */
+  AbiBindMsgTEST_VECT(ABI_BROADCAST, &vect_b_ev, vect_b_cb);
+  AbiBindMsgTEST_VECT(ABI_BROADCAST, &vect_c_ev, vect_b_cb);
+  AbiSendMsgTEST_VECT(SENDER_A, 46, &v);
+  ok(abi_nb_subscribersTEST_VECT == 2 && abi_bind_errors == 1 && nb_vect_b == 1,
+     "binding to a full subscriber array refused");
+#else
+  (void) vect_b_ev;
+  (void) vect_c_ev;
+  (void) vect_b_cb;
+#endif
+
+  /* message without fields */
+  AbiBindMsgTEST_EMPTY(ABI_BROADCAST, &empty_ev, empty_cb);
+  AbiSendMsgTEST_EMPTY(SENDER_A);
+  AbiSendMsgTEST_EMPTY(SENDER_B);
+  ok(nb_empty == 2, "message without fields");
+
+  /* statistics, the time stub advances by 10 at each call */
+  struct abi_stats *s = &abi_stats[ABI_TEST_VECT_ID];
+#if ABI_USE_STRUCT
+  ok(s->publish == 5 && s->dispatch == 3 && s->time == 50 && s->time_max == 10,
+     "messages, callbacks and dispatch time counted");
+#else
+  ok(s->publish == 4 && s->dispatch == 2 && s->time == 40 && s->time_max == 10,
+     "messages, callbacks and dispatch time counted");
+#endif
+
+  done_testing();
+}
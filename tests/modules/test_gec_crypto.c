@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_gec_crypto.c
+ * @brief Test of the AEAD used by the secure datalink (gec_dl).
+ *
+ * ChaCha20-Poly1305 from HACL is checked with the RFC 8439 section 2.8.2
+ * vector, also when encrypting in place as gec_encrypt_message does.
+ * The replay window of the received counters is checked, and the cost of
+ * sending messages one per frame or batched in a single frame is measured.
+ */
+
+#define NB_RUNS 20000
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <string.h>
+
+#include "modules/datalink/gec/gec.h"
+
+#define NB_BATCH 8
+#define MSG_LEN 20
+
+/* RFC 8439 2.8.2 */
+static uint8_t rfc_key[32] = {
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+  0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f
+};
+static uint8_t rfc_nonce[12] = { 0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47 };
+static uint8_t rfc_aad[12] = { 0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7 };
+static const char rfc_plain[] = "Ladies and Gentlemen of the class of '99: If I could offer you only one "
+                                "tip for the future, sunscreen would be it.";
+static const uint8_t rfc_cipher[114] = {
+  0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc,
+  0x53, 0xef, 0x7e, 0xc2, 0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe,
+  0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6, 0x3d, 0xbe, 0xa4, 0x5e,
+  0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+  0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29, 0x05, 0xd6, 0xa5, 0xb6,
+  0x7e, 0xcd, 0x3b, 0x36, 0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c,
+  0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58, 0xfa, 0xb3, 0x24, 0xe4,
+  0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+  0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65,
+  0x86, 0xce, 0xc6, 0x4b, 0x61, 0x16
+};
+static const uint8_t rfc_tag[16] = {
+  0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60, 0x06, 0x91
+};
+
+/* gec.c only uses the random generator for the ephemeral keys */
+uint32_t rng_wait_and_get(void)
+{
+  return 4;
+}
+
+static bool receive(struct gec_sym_key *key, uint32_t counter)
+{
+  if (!gec_counter_is_valid(key, counter)) {
+    return false;
+  }
+  gec_counter_update(key, counter);
+  return true;
+}
+
+int main(void)
+{
+  uint32_t mlen = sizeof(rfc_cipher);
+  uint8_t buf[sizeof(rfc_cipher)], plain[sizeof(rfc_cipher)], tag[16];
+  int i, j;
+
+  plan(7);
+
+  Hacl_Chacha20Poly1305_aead_encrypt(buf, tag, (uint8_t *)rfc_plain, mlen, rfc_aad, sizeof(rfc_aad),
+                                     rfc_key, rfc_nonce);
+  ok(memcmp(buf, rfc_cipher, mlen) == 0 && memcmp(tag, rfc_tag, 16) == 0, "RFC 8439 2.8.2 encryption");
+
+  memcpy(buf, rfc_plain, mlen);
+  memset(tag, 0, sizeof(tag));
+  Hacl_Chacha20Poly1305_aead_encrypt(buf, tag, buf, mlen, rfc_aad, sizeof(rfc_aad), rfc_key, rfc_nonce);
+  ok(memcmp(buf, rfc_cipher, mlen) == 0 && memcmp(tag, rfc_tag, 16) == 0, "RFC 8439 2.8.2 encryption in place");
+
+  uint32_t res = Hacl_Chacha20Poly1305_aead_decrypt(plain, (uint8_t *)rfc_cipher, mlen, (uint8_t *)rfc_tag,
+                 rfc_aad, sizeof(rfc_aad), rfc_key, rfc_nonce);
+  ok(res == 0 && memcmp(plain, rfc_plain, mlen) == 0, "RFC 8439 2.8.2 decryption");
+
+  memcpy(buf, rfc_cipher, mlen);
+  buf[mlen / 2] ^= 1;
+  res = Hacl_Chacha20Poly1305_aead_decrypt(plain, buf, mlen, (uint8_t *)rfc_tag, rfc_aad, sizeof(rfc_aad),
+        rfc_key, rfc_nonce);
+  ok(res != 0, "tampered ciphertext rejected");
+
+  /* replay window, frames received out of order */
+  struct gec_sym_key key;
+  memset(&key, 0, sizeof(key));
+  bool accepted = true;
+  for (i = 1; i <= 2 * GEC_REPLAY_WINDOW; i += 2) {
+    accepted &= receive(&key, i + 1);
+    accepted &= receive(&key, i);
+  }
+  ok(accepted, "reordered counters accepted");
+
+  uint32_t last = key.counter;
+  bool rejected = !receive(&key, last) && !receive(&key, last - 1) && !receive(&key, 1);
+  ok(rejected, "replayed counters rejected");
+
+  uint32_t next = last + 2 * GEC_REPLAY_WINDOW;
+  ok(receive(&key, next) && receive(&key, next - GEC_REPLAY_WINDOW) &&
+     !receive(&key, next - GEC_REPLAY_WINDOW - 1), "counters out of the window rejected");
+
+  /* cost of the messages sent one per frame or batched (with one length byte each) */
+  uint8_t frame[NB_BATCH * (MSG_LEN + 1)], cipher[sizeof(frame)];
+  for (i = 0; i < (int)sizeof(frame); i++) {
+    frame[i] = i;
+  }
+  double t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    for (j = 0; j < NB_BATCH; j++) {
+      Hacl_Chacha20Poly1305_aead_encrypt(cipher, tag, frame, MSG_LEN, rfc_aad, 2, rfc_key, rfc_nonce);
+    }
+  }
+  double t_single = (now_s() - t0) / (NB_RUNS * NB_BATCH);
+  t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    Hacl_Chacha20Poly1305_aead_encrypt(cipher, tag, frame, sizeof(frame), rfc_aad, 2, rfc_key, rfc_nonce);
+  }
+  double t_batch = (now_s() - t0) / (NB_RUNS * NB_BATCH);
+  note("encryption per message of %d bytes: %.0f ns one per frame, %.0f ns batched by %d",
+       MSG_LEN, t_single * 1e9, t_batch * 1e9, NB_BATCH);
+  note("link bytes for %d messages: %d one per frame, %d batched", NB_BATCH,
+       NB_BATCH * (MSG_LEN + 1 + PPRZ_CRYPTO_OVERHEAD + 2), (int)sizeof(frame) + 1 + PPRZ_CRYPTO_OVERHEAD + 2);
+
+  done_testing();
+}
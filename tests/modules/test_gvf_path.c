@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_gvf_path.c
+ * @brief Tests of the GVF trajectory evaluation with cached terms against the
+ * direct evaluation, of the composite paths, and throughput benchmark.
+ */
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <math.h>
+
+#include "modules/guidance/gvf/trajectories/gvf_traj.h"
+#include "modules/guidance/gvf/trajectories/gvf_path.h"
+
+#define NB_POINTS 1024
+
+/* direct evaluation, as done by gvf_xxx_info before the cache */
+static void ref_eval(const float *p, enum trajectories type, float px, float py, float *phi,
+                     struct gvf_grad *grad, struct gvf_Hess *hess)
+{
+  if (type == LINE) {
+    float a = p[0], b = p[1], alpha = p[2];
+    *phi = -(px - a) * cosf(alpha) + (py - b) * sinf(alpha);
+    grad->nx =  -cosf(alpha);
+    grad->ny =   sinf(alpha);
+    hess->H11 = hess->H12 = hess->H21 = hess->H22 = 0;
+  } else if (type == ELLIPSE) {
+    float wx = p[0], wy = p[1], a = p[2], b = p[3], alpha = p[4];
+    float cosa = cosf(alpha);
+    float sina = sinf(alpha);
+    float xel = (px - wx) * cosa - (py - wy) * sina;
+    float yel = (px - wx) * sina + (py - wy) * cosa;
+    *phi = (xel / a) * (xel / a) + (yel / b) * (yel / b) - 1;
+    grad->nx = (2 * xel / (a * a)) * cosa + (2 * yel / (b * b)) * sina;
+    grad->ny = (2 * yel / (b * b)) * cosa - (2 * xel / (a * a)) * sina;
+    hess->H11 = 2 * (cosa * cosa / (a * a) + sina * sina / (b * b));
+    hess->H12 = 2 * sina * cosa * (1 / (b * b) - 1 / (a * a));
+    hess->H21 = hess->H12;
+    hess->H22 = 2 * (sina * sina / (a * a) + cosa * cosa / (b * b));
+  } else {
+    float a = p[0], b = p[1], alpha = p[2], w = p[3], off = p[4], A = p[5];
+    float cosa = cosf(alpha);
+    float sina = sinf(alpha);
+    float xs = (px - a) * sina - (py - b) * cosa;
+    float ys =  -(px - a) * cosa - (py - b) * sina;
+    float ang = (w * xs + off);
+    float cosang = cosf(ang);
+    float sinang = sinf(ang);
+    *phi = ys - A * sinang;
+    grad->nx =  -cosa - A * w * sina * cosang;
+    grad->ny =  -sina + A * w * cosa * cosang;
+    hess->H11 =  A * w * w * sina * sina * sinang;
+    hess->H12 = -A * w * w * sina * cosa * sinang;
+    hess->H21 = -A * w * w * cosa * sina * sinang;
+    hess->H22 =  A * w * w * cosa * cosa * sinang;
+  }
+}
+
+static float rel_err(float a, float b)
+{
+  return fabsf(a - b) / fmaxf(1.f, fabsf(b));
+}
+
+/* distance to a path, brute force */
+static float path_dist(const struct gvf_path *path, float px, float py)
+{
+  float d = INFINITY;
+  for (int i = 0; i <= 20000; i++) {
+    float x, y;
+    gvf_path_point(path, path->length * i / 20000.f, &x, &y);
+    d = fminf(d, hypotf(px - x, py - y));
+  }
+  return d;
+}
+
+int main(void)
+{
+  plan(6);
+  srand(3);
+
+  note("--- cached evaluation vs direct evaluation");
+  const enum trajectories types[] = { LINE, ELLIPSE, SIN };
+  float err = 0.f;
+  for (int k = 0; k < 3000; k++) {
+    float p[6] = { rand_f(-200, 200), rand_f(-200, 200), rand_f(-3.f, 3.f), rand_f(20, 150), rand_f(0, 3), rand_f(5, 50) };
+    enum trajectories type = types[k % 3];
+    if (type == ELLIPSE) {
+      p[4] = p[2];
+      p[2] = rand_f(20, 150);
+    } else if (type == SIN) {
+      p[3] = rand_f(0, 0.05f);
+    }
+    gvf_tra t = { .type = NONE };
+    gvf_traj_set(&t, type, p);
+    for (int i = 0; i < 10; i++) {
+      const float px = rand_f(-300, 300), py = rand_f(-300, 300);
+      float phi, phi_ref;
+      struct gvf_grad g, g_ref;
+      struct gvf_Hess h, h_ref;
+      gvf_traj_eval(&t, px, py, &phi, &g, &h);
+      ref_eval(p, type, px, py, &phi_ref, &g_ref, &h_ref);
+      err = fmaxf(err, rel_err(phi, phi_ref));
+      err = fmaxf(err, fmaxf(rel_err(g.nx, g_ref.nx), rel_err(g.ny, g_ref.ny)));
+      err = fmaxf(err, fmaxf(rel_err(h.H11, h_ref.H11), rel_err(h.H12, h_ref.H12)));
+      err = fmaxf(err, fmaxf(rel_err(h.H21, h_ref.H21), rel_err(h.H22, h_ref.H22)));
+    }
+  }
+  note("max relative error %.2e", err);
+  ok(err < 1e-4f, "same error, gradient and Hessian as the direct evaluation");
+
+  gvf_tra t = { .type = NONE };
+  float pe[5] = { 10.f, 20.f, 80.f, 40.f, 0.3f };
+  bool first = gvf_traj_set(&t, ELLIPSE, pe);
+  bool same = gvf_traj_set(&t, ELLIPSE, pe);
+  pe[4] = 0.4f;
+  bool moved = gvf_traj_set(&t, ELLIPSE, pe);
+  ok(first && !same && moved && t.sina == sinf(0.4f), "cached terms only updated when the parameters change");
+
+  note("--- composite path");
+  // survey sweeps with half turns, then an arc and a polyline
+  struct gvf_path path;
+  gvf_path_start(&path, 0.f, 0.f);
+  for (int i = 0; i < 6; i++) {
+    const float x = 60.f * i;
+    gvf_path_add_point(&path, x, i % 2 ? 0.f : 400.f);
+    gvf_path_add_turn(&path, x + 60.f, i % 2 ? 0.f : 400.f, i % 2);
+  }
+  gvf_path_add_arc(&path, path.x_end, path.y_end - 100.f, 100.f, M_PI / 2, -M_PI / 2);
+  for (int i = 0; i < 20 && path.nb < GVF_PATH_MAX_SEG; i++) {
+    gvf_path_add_point(&path, path.x_end + 30.f, path.y_end - 20.f * (i % 3));
+  }
+  note("%d segments, length %.0f m", path.nb, path.length);
+
+  int bad_find = 0;
+  for (int i = 0; i < 10000; i++) {
+    const float s = rand_f(-10.f, path.length + 10.f);
+    uint8_t ref = 0;
+    while (ref + 1 < path.nb && path.seg[ref + 1].start <= s) {
+      ref++;
+    }
+    bad_find += (gvf_path_find(&path, s) != ref);
+  }
+  ok(bad_find == 0, "binary search of the segment at an arc length");
+
+  float err_prog = 0.f;
+  for (int i = 0; i < 10000; i++) {
+    const float s = rand_f(0.f, path.length);
+    float x, y;
+    gvf_path_point(&path, s, &x, &y);
+    const struct gvf_path_seg *seg = &path.seg[gvf_path_find(&path, s)];
+    err_prog = fmaxf(err_prog, fabsf(gvf_path_seg_progress(seg, x, y) - (s - seg->start)));
+  }
+  note("max progress error %.2e m", err_prog);
+  ok(err_prog < 1e-2f, "progress of the points of the path");
+
+  // kinematic vehicle following the field, 1 m steps
+  float px = -30.f, py = -20.f, dmax = 0.f;
+  int steps = 0;
+  path.active = 0;
+  while (gvf_path_update(&path, px, py) && steps < 10 * path.length) {
+    float mx, my;
+    gvf_path_field(&path, 0.05f, 1.f, 1, &px, &py, &mx, &my, NULL);
+    px += mx;
+    py += my;
+    if (steps++ > 200) {
+      dmax = fmaxf(dmax, path_dist(&path, px, py));
+    }
+  }
+  note("path followed in %d steps, max distance %.1f m", steps, dmax);
+  ok(path.active == path.nb - 1 && steps < 1.2f * path.length, "end of the path reached");
+  ok(dmax < 10.f, "vehicle stays close to the path");
+
+  note("--- throughput of the field evaluation");
+  static float xs[NB_POINTS], ys[NB_POINTS], mx[NB_POINTS], my[NB_POINTS];
+  for (int i = 0; i < NB_POINTS; i++) {
+    xs[i] = rand_f(-300, 300);
+    ys[i] = rand_f(-300, 300);
+  }
+  volatile float sink = 0.f;
+  double t0 = now_s();
+  for (int r = 0; r < NB_RUNS; r++) {
+    for (int i = 0; i < NB_POINTS; i++) {
+      float phi;
+      struct gvf_grad g;
+      struct gvf_Hess h;
+      ref_eval(pe, ELLIPSE, xs[i], ys[i], &phi, &g, &h);
+      gvf_field_dir(1.f, 1, phi, &g, &mx[i], &my[i]);
+    }
+    sink += mx[r];
+  }
+  const double t_ref = (now_s() - t0) / (NB_RUNS * NB_POINTS);
+  t0 = now_s();
+  for (int r = 0; r < NB_RUNS; r++) {
+    gvf_traj_field(&t, 1.f, 1, NB_POINTS, xs, ys, mx, my, NULL);
+    sink += mx[r];
+  }
+  const double t_batch = (now_s() - t0) / (NB_RUNS * NB_POINTS);
+  t0 = now_s();
+  for (int r = 0; r < NB_RUNS; r++) {
+    path.active = 0;
+    gvf_path_field(&path, 0.05f, 1.f, NB_POINTS, xs, ys, mx, my, NULL);
+    sink += mx[r];
+  }
+  const double t_path = (now_s() - t0) / (NB_RUNS * NB_POINTS);
+  note("ellipse direct %.1f ns, batch %.1f ns, path %.1f ns per point", t_ref * 1e9, t_batch * 1e9, t_path * 1e9);
+
+  done_testing();
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_i2c_linux.c
+ * @brief Tests of the Linux I2C engine with a fake i2c-dev.
+ *
+ * The transfer function of the bus is replaced with i2c_linux_set_xfer
+ * by a fake bus that records the messages it runs. A transaction on a
+ * "plug" device holds the worker thread while the transactions under test
+ * are queued, so that they are all in the next batch.
+ */
+
+#include "../math/tap.h"
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <linux/i2c.h>
+
+#include "mcu_periph/i2c.h"
+
+struct i2c_periph i2c0;
+
+#define PLUG_ADDR 0x10
+#define NB_DEV 6
+#define MAX_CALLS 64
+
+/* fake bus */
+enum fake_mode { FAKE_OK, FAKE_ERROR, FAKE_PARTIAL, FAKE_NOT_SUPPORTED };
+static volatile enum fake_mode mode;
+static volatile uint8_t bad_addr;       ///< 7 bit address of the faulty device
+static volatile bool plug_in, plug_hold;
+static int nb_calls;
+static int call_nb_msgs[MAX_CALLS];
+static uint8_t call_first_addr[MAX_CALLS];
+static int bus_runs[128];               ///< messages that reached each device
+
+static int fake_xfer(int fd __attribute__((unused)), struct i2c_msg *msgs, unsigned int nb)
+{
+  if (msgs[0].addr == PLUG_ADDR >> 1) {
+    plug_in = true;
+    while (plug_hold) {
+      usleep(100);
+    }
+    return nb;
+  }
+  if (nb_calls < MAX_CALLS) {
+    call_nb_msgs[nb_calls] = nb;
+    call_first_addr[nb_calls] = msgs[0].addr << 1;
+  }
+  nb_calls++;
+  if (mode == FAKE_NOT_SUPPORTED && nb > 2) {
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  unsigned int i;
+  for (i = 0; i < nb; i++) {
+    if (msgs[i].addr == bad_addr) {
+      // the messages before the faulty one are done on the bus
+      if (mode == FAKE_PARTIAL) {
+        return i;
+      }
+      errno = EIO;
+      return -1;
+    }
+    bus_runs[msgs[i].addr]++;
+    if (msgs[i].flags & I2C_M_RD) {
+      msgs[i].buf[0] = msgs[i].addr;
+    }
+  }
+  return nb;
+}
+
+static struct i2c_transaction plug, trans[NB_DEV];
+
+static uint8_t dev_addr(int i)
+{
+  return 0x20 + 2 * i;
+}
+
+/** hold the worker, queue the transactions of the devices in mask, release */
+static void run_batch(int mask)
+{
+  plug.type = I2CTransTx;
+  plug.slave_addr = PLUG_ADDR;
+  plug.len_w = 1;
+  plug_in = false;
+  plug_hold = true;
+  i2c0.submit(&i2c0, &plug);
+  while (!plug_in) {
+    usleep(100);
+  }
+  int i;
+  for (i = 0; i < NB_DEV; i++) {
+    if (mask & (1 << i)) {
+      trans[i].type = I2CTransTxRx;
+      trans[i].slave_addr = dev_addr(i);
+      trans[i].len_w = 1;
+      trans[i].len_r = 1;
+      trans[i].buf[0] = 0;
+      i2c0.submit(&i2c0, &trans[i]);
+    }
+  }
+  plug_hold = false;
+  int k;
+  for (k = 0; k < 2000; k++) {
+    bool busy = false;
+    for (i = 0; i < NB_DEV; i++) {
+      busy |= (mask & (1 << i)) && (trans[i].status == I2CTransPending || trans[i].status == I2CTransRunning);
+    }
+    if (!busy) {
+      break;
+    }
+    usleep(500);
+  }
+}
+
+static int count_status(int mask, enum I2CTransactionStatus status)
+{
+  int i, n = 0;
+  for (i = 0; i < NB_DEV; i++) {
+    if ((mask & (1 << i)) && trans[i].status == status) {
+      n++;
+    }
+  }
+  return n;
+}
+
+static void reset_bus_runs(void)
+{
+  memset(bus_runs, 0, sizeof(bus_runs));
+  nb_calls = 0;
+}
+
+int main()
+{
+  note("running Linux I2C engine tests");
+  plan(8);
+
+  i2c0_hw_init();
+  i2c_linux_set_xfer(&i2c0, fake_xfer);
+  bad_addr = 0;
+  struct i2c_linux_stats stats;
+
+  // batching
+  reset_bus_runs();
+  run_batch(0x0f);
+  i2c_linux_get_stats(&i2c0, &stats);
+  note("4 transactions in %d ioctl(s)", nb_calls);
+  ok(count_status(0x0f, I2CTransSuccess) == 4 && nb_calls == 1 && call_nb_msgs[0] == 8 &&
+     trans[2].buf[0] == dev_addr(2) >> 1,
+     "queued transactions done in one ioctl");
+
+  // priority
+  i2c_linux_set_priority(&i2c0, dev_addr(3), 1);
+  reset_bus_runs();
+  run_batch(0x0f);
+  ok(nb_calls == 1 && call_first_addr[0] == dev_addr(3), "higher priority device first in the batch");
+  i2c_linux_set_priority(&i2c0, dev_addr(3), 0);
+
+  // failed batch: nothing is done again, all transactions that may not be done fail
+  mode = FAKE_ERROR;
+  bad_addr = dev_addr(2) >> 1;
+  reset_bus_runs();
+  run_batch(0x0f);
+  i2c_linux_get_stats(&i2c0, &stats);
+  bool replayed = false;
+  int i;
+  for (i = 0; i < NB_DEV; i++) {
+    replayed |= bus_runs[dev_addr(i) >> 1] > 2;
+  }
+  ok(nb_calls == 1 && !replayed, "failed batch is not done again");
+  ok(count_status(0x0f, I2CTransFailed) == 4 && stats.batch_errors == 1,
+     "all transactions of a failed batch reported as failed");
+
+  // drivers retry: the devices of the failed batch are done alone
+  reset_bus_runs();
+  run_batch(0x0f);
+  ok(nb_calls == 4 && count_status(0x0f, I2CTransSuccess) == 3 && trans[2].status == I2CTransFailed,
+     "retried transactions done one by one, error only on the faulty device");
+  reset_bus_runs();
+  run_batch(0x0b);
+  ok(nb_calls == 1 && count_status(0x0b, I2CTransSuccess) == 3, "devices batched again after a success");
+
+  // partial transfer, the transactions done before the faulty one succeed
+  mode = FAKE_PARTIAL;
+  bad_addr = dev_addr(3) >> 1;
+  reset_bus_runs();
+  run_batch(0x3b);
+  bad_addr = 0;
+  ok(nb_calls == 1 && trans[0].status == I2CTransSuccess && trans[1].status == I2CTransSuccess &&
+     count_status(0x38, I2CTransFailed) == 3, "partial transfer fails from the first transaction not done");
+  run_batch(0x3b); // clear solo devices
+
+  // adapter without multi message support
+  mode = FAKE_NOT_SUPPORTED;
+  run_batch(0x07);
+  reset_bus_runs();
+  run_batch(0x07);
+  mode = FAKE_OK;
+  ok(nb_calls == 3 && count_status(0x07, I2CTransSuccess) == 3, "no more batches if not supported by the adapter");
+
+  done_testing();
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_imu_batch.c
+ * @brief Test of the batched IMU ingestion.
+ *
+ * Bursts of raw samples are given to imu_batch_push and the published blocks
+ * are captured in place of the IMU_BATCH ABI message:
+ *  - the time stamps are back-dated from the burst time at the sample period,
+ *    which follows the drift of the sensor clock,
+ *  - with decimation, the coning corrected angle increments match the
+ *    rotation of a classical coning motion integrated at high rate.
+ */
+
+#include "../math/tap.h"
+#include <math.h>
+#include <string.h>
+
+#include "subsystems/imu.h"
+#include "subsystems/imu/imu_batch.h"
+
+#define ODR 1000.f
+#define NB_BURST 10
+#define DECIMATION 8
+
+/* coning motion: the rate vector rotates at CONE_FREQ around x with a half angle CONE_ANGLE */
+#define CONE_FREQ (2. * M_PI * 10.)
+#define CONE_ANGLE (5. * M_PI / 180.)
+#define NB_STEPS 100
+
+struct Imu imu;
+
+/* raw samples are rates and accels in BFP */
+void imu_scale_gyro(struct Imu *_imu)
+{
+  RATES_COPY(_imu->gyro, _imu->gyro_unscaled);
+}
+
+void imu_scale_accel(struct Imu *_imu)
+{
+  VECT3_COPY(_imu->accel, _imu->accel_unscaled);
+}
+
+static struct ImuBatch blocks[64];
+static int nb_blocks;
+
+void AbiSendMsgIMU_BATCH(uint8_t sender_id __attribute__((unused)), uint32_t stamp, struct ImuBatch *batch)
+{
+  if (nb_blocks < 64 && stamp == batch->stamp[batch->nb - 1]) {
+    blocks[nb_blocks++] = *batch;
+  }
+}
+
+static void push_still(struct ImuBatchInput *in, uint8_t nb, uint32_t burst_stamp)
+{
+  struct Int32Rates gyro[nb];
+  struct Int32Vect3 accel[nb];
+  memset(gyro, 0, sizeof(gyro));
+  memset(accel, 0, sizeof(accel));
+  imu_batch_push(in, gyro, accel, nb, burst_stamp);
+}
+
+/** Rate of the coning motion at time t */
+static void cone_rates(double *w, double t)
+{
+  w[0] = -2. * CONE_FREQ * sin(CONE_ANGLE / 2.) * sin(CONE_ANGLE / 2.);
+  w[1] = -CONE_FREQ * sin(CONE_ANGLE) * sin(CONE_FREQ * t);
+  w[2] = CONE_FREQ * sin(CONE_ANGLE) * cos(CONE_FREQ * t);
+}
+
+/** Quaternion product q = q * exp(v/2) */
+static void quat_rotate(double *q, const double *v)
+{
+  double n = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+  double s = n > 0. ? sin(n / 2.) / n : 0.5;
+  double r[4] = { cos(n / 2.), s * v[0], s * v[1], s * v[2] };
+  double p[4] = {
+    q[0] * r[0] - q[1] * r[1] - q[2] * r[2] - q[3] * r[3],
+    q[0] * r[1] + q[1] * r[0] + q[2] * r[3] - q[3] * r[2],
+    q[0] * r[2] - q[1] * r[3] + q[2] * r[0] + q[3] * r[1],
+    q[0] * r[3] + q[1] * r[2] - q[2] * r[1] + q[3] * r[0]
+  };
+  memcpy(q, p, sizeof(p));
+}
+
+/** Rotation vector of a quaternion */
+static void quat_rotvec(double *v, const double *q)
+{
+  double s = sqrt(q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+  double a = 2. * atan2(s, q[0]);
+  double k = s > 0. ? a / s : 2.;
+  v[0] = k * q[1];
+  v[1] = k * q[2];
+  v[2] = k * q[3];
+}
+
+int main(void)
+{
+  struct ImuBatchInput in;
+  struct FloatEulers zero = { 0.f, 0.f, 0.f };
+  uint32_t stamp[NB_BURST + 2];
+  int i, j, k;
+
+  plan(6);
+
+  orientationSetEulers_f(&imu.body_to_imu, &zero);
+
+  /* back-dating of the first burst at the nominal period */
+  imu_batch_init(&in, 1, ODR);
+  nb_blocks = 0;
+  push_still(&in, NB_BURST, 100000);
+  bool dated = nb_blocks == 1 && blocks[0].nb == NB_BURST;
+  for (i = 0; dated && i < NB_BURST; i++) {
+    dated = blocks[0].stamp[i] == 100000u - 1000u * (NB_BURST - 1 - i);
+  }
+  ok(dated, "first burst back-dated from the burst time at the nominal period");
+
+  /* sensor clock 2% slow, the FIFO is read with a jitter of a few samples */
+  imu_batch_init(&in, 1, ODR);
+  const double period = 1.02e-3;
+  double t = 0.1;
+  uint32_t last = 0;
+  bool increasing = true;
+  int nb = 0;
+  uint8_t n = 0;
+  for (i = 0; i < 2000; i++) {
+    n = NB_BURST + (i % 5) - 2;
+    t += n * period;
+    imu_batch_stamps(&in, stamp, n, (uint32_t)(t * 1e6));
+    for (j = 0; j < n; j++) {
+      if (nb > 0 && (int32_t)(stamp[j] - last) <= 0) {
+        increasing = false;
+      }
+      last = stamp[j];
+      nb++;
+    }
+  }
+  ok(fabs(in.period - period) < 1e-6, "period follows the sensor clock (%g s)", in.period);
+  ok(increasing, "time stamps are increasing over %d samples", nb);
+  double err = 0.;
+  for (j = 0; j < n; j++) {
+    double s = t - (n - 1 - j) * period;
+    err = fmax(err, fabs((double)stamp[j] * 1e-6 - s));
+  }
+  ok(err < 2e-6, "samples back-dated at the estimated period (max error %g s)", err);
+
+  /* coning motion, angle increments of each sample are integrated at high rate */
+  imu_batch_init(&in, 1, ODR);
+  in.decimation = DECIMATION;
+  nb_blocks = 0;
+  double dt = 1. / ODR;
+  double h = dt / NB_STEPS;
+  struct Int32Rates gyro[NB_BURST * DECIMATION];
+  struct Int32Vect3 accel[NB_BURST * DECIMATION];
+  double rot[NB_BURST][3];
+  memset(accel, 0, sizeof(accel));
+  for (i = 0; i < NB_BURST; i++) {
+    double q0[4] = { 1., 0., 0., 0. };
+    for (j = 0; j < DECIMATION; j++) {
+      double da[3] = { 0., 0., 0. };
+      double t0 = (i * DECIMATION + j) * dt;
+      for (k = 0; k < NB_STEPS; k++) {
+        double w[3], v[3];
+        cone_rates(w, t0 + (k + 0.5) * h);
+        v[0] = w[0] * h;
+        v[1] = w[1] * h;
+        v[2] = w[2] * h;
+        quat_rotate(q0, v);
+        da[0] += v[0];
+        da[1] += v[1];
+        da[2] += v[2];
+      }
+      RATES_ASSIGN(gyro[i * DECIMATION + j], RATE_BFP_OF_REAL(da[0] / dt),
+                   RATE_BFP_OF_REAL(da[1] / dt), RATE_BFP_OF_REAL(da[2] / dt));
+    }
+    quat_rotvec(rot[i], q0);
+  }
+  imu_batch_push(&in, gyro, accel, NB_BURST * DECIMATION, 1000000);
+  bool blocks_ok = nb_blocks == 1 && blocks[0].nb == NB_BURST;
+  ok(blocks_ok, "one block of %d decimated samples", NB_BURST);
+
+  double err_coning = 0., err_sum = 0.;
+  for (i = 0; blocks_ok && i < NB_BURST; i++) {
+    struct FloatVect3 *da = &blocks[0].delta_angle[i];
+    struct FloatRates *g = &blocks[0].gyro[i];
+    float d = blocks[0].dt[i];
+    err_coning = fmax(err_coning, sqrt((da->x - rot[i][0]) * (da->x - rot[i][0]) +
+                                       (da->y - rot[i][1]) * (da->y - rot[i][1]) +
+                                       (da->z - rot[i][2]) * (da->z - rot[i][2])));
+    err_sum = fmax(err_sum, sqrt((g->p * d - rot[i][0]) * (g->p * d - rot[i][0]) +
+                                 (g->q * d - rot[i][1]) * (g->q * d - rot[i][1]) +
+                                 (g->r * d - rot[i][2]) * (g->r * d - rot[i][2])));
+  }
+  ok(blocks_ok && err_coning < 0.1 * err_sum, "coning correction (error %g rad, %g rad without)",
+     err_coning, err_sum);
+
+  done_testing();
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_msg_pool.c
+ * @brief Tests and allocation latency benchmark for the SD logger message pools.
+ */
+
+#define NB_RUNS 20000
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "modules/loggers/sdlog_chibios/msg_pool.h"
+#include "tlsf.h"
+
+/* size of the TLSF heap used as reference, as HEAP_CCM on STM32F4 */
+#define HEAP_SIZE 16384
+
+static const uint16_t sizes[] = {16, 32, 64, 128};
+static const uint16_t nbs[] = {16, 32, 32, 16};
+#define NB_CLASS 4
+
+/* stress test: each thread allocates, fills, checks and frees messages */
+#define NB_THREADS 4
+#define NB_LOOPS 200000
+#define NB_HELD 24
+
+struct stress_arg {
+  struct MsgPool *pool;
+  unsigned int seed;
+  uint8_t tag;
+  int errors;
+  int fallbacks;
+};
+
+static void *stress_thread(void *p)
+{
+  struct stress_arg *arg = p;
+  uint8_t *held[NB_HELD] = { NULL };
+  size_t held_len[NB_HELD] = { 0 };
+  for (int i = 0; i < NB_LOOPS; i++) {
+    int k = rand_r(&arg->seed) % NB_HELD;
+    if (held[k] != NULL) {
+      for (size_t j = 0; j < held_len[k]; j++) {
+        if (held[k][j] != (uint8_t)(k + j + arg->tag)) {
+          arg->errors++;
+          break;
+        }
+      }
+      if (!msg_pool_free(arg->pool, held[k])) {
+        free(held[k]);
+      }
+      held[k] = NULL;
+    } else {
+      held_len[k] = 1 + rand_r(&arg->seed) % 160;
+      held[k] = msg_pool_alloc(arg->pool, held_len[k]);
+      if (held[k] == NULL) {
+        arg->fallbacks++;
+        held[k] = malloc(held_len[k]);
+      }
+      for (size_t j = 0; j < held_len[k]; j++) {
+        held[k][j] = (uint8_t)(k + j + arg->tag);
+      }
+    }
+  }
+  for (int k = 0; k < NB_HELD; k++) {
+    if (held[k] != NULL && !msg_pool_free(arg->pool, held[k])) {
+      free(held[k]);
+    }
+  }
+  return NULL;
+}
+
+int main(void)
+{
+  plan(17);
+
+  struct MsgPool pool;
+  struct MsgPoolStats stats;
+  const size_t mem_size = msg_pool_mem_size(sizes, nbs, NB_CLASS);
+  uint8_t *mem = aligned_alloc(MSG_POOL_ALIGN, mem_size);
+
+  note("--- init");
+  cmp_ok(mem_size, "==", 16 * 16 + 32 * 32 + 64 * 32 + 128 * 16, "memory size");
+  ok(!msg_pool_init(&pool, mem, mem_size - 1, sizes, nbs, NB_CLASS), "refuse too small memory");
+  ok(msg_pool_alloc(&pool, 8) == NULL, "refused pools are empty");
+  ok(msg_pool_init(&pool, mem, mem_size, sizes, nbs, NB_CLASS), "init");
+
+  note("--- size classes");
+  uint8_t *a = msg_pool_alloc(&pool, 10);
+  uint8_t *b = msg_pool_alloc(&pool, 17);
+  uint8_t *c = msg_pool_alloc(&pool, 128);
+  ok(a >= pool.cls[0].base && a < pool.cls[1].base, "small message in first class");
+  ok(b >= pool.cls[1].base && b < pool.cls[2].base, "17 bytes in second class");
+  ok(c >= pool.cls[3].base && c < pool.end, "128 bytes in last class");
+  ok(msg_pool_alloc(&pool, 129) == NULL && pool.oversize == 1, "oversize message refused");
+  int foreign;
+  ok(!msg_pool_free(&pool, &foreign), "foreign pointer not freed");
+  msg_pool_free(&pool, a);
+  msg_pool_free(&pool, b);
+  msg_pool_free(&pool, c);
+
+  note("--- exhaustion and statistics");
+  uint8_t *slots[16 + 32 + 32 + 16];
+  int n = 0, overlap = 0;
+  while ((slots[n] = msg_pool_alloc(&pool, 16)) != NULL) {
+    memset(slots[n], n, 16);
+    n++;
+  }
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < 16; j++) {
+      overlap += (slots[i][j] != (uint8_t) i);
+    }
+  }
+  ok(n == 16 + 32 + 32 + 16 && overlap == 0, "full classes spill to the next ones, no overlap (%d slots)", n);
+  msg_pool_get_stats(&pool, 0, &stats);
+  ok(stats.used == 16 && stats.highWater == 16 && stats.failed == 1, "stats of exhausted class");
+  for (int i = 0; i < n; i++) {
+    msg_pool_free(&pool, slots[i]);
+  }
+  int used = 0;
+  for (uint8_t i = 0; i < NB_CLASS; i++) {
+    msg_pool_get_stats(&pool, i, &stats);
+    used += stats.used;
+  }
+  ok(used == 0, "all slots released");
+  ok(!msg_pool_get_stats(&pool, NB_CLASS, &stats), "invalid class");
+
+  note("--- concurrent use by %d threads", NB_THREADS);
+  msg_pool_init(&pool, mem, mem_size, sizes, nbs, NB_CLASS);
+  pthread_t th[NB_THREADS];
+  struct stress_arg args[NB_THREADS];
+  for (int i = 0; i < NB_THREADS; i++) {
+    args[i] = (struct stress_arg) { &pool, 1234u + i, (uint8_t)(i * 64), 0, 0 };
+    pthread_create(&th[i], NULL, stress_thread, &args[i]);
+  }
+  int errors = 0, fallbacks = 0;
+  for (int i = 0; i < NB_THREADS; i++) {
+    pthread_join(th[i], NULL);
+    errors += args[i].errors;
+    fallbacks += args[i].fallbacks;
+  }
+  ok(errors == 0, "no corrupted message");
+  used = 0;
+  int high_water = 0;
+  for (uint8_t i = 0; i < NB_CLASS; i++) {
+    msg_pool_get_stats(&pool, i, &stats);
+    used += stats.used;
+    high_water += stats.highWater;
+  }
+  ok(used == 0, "all slots released after concurrent use");
+  note("high water sum %d, %d fallbacks for %d operations", high_water, fallbacks, NB_THREADS * NB_LOOPS);
+  n = 0;
+  while (msg_pool_alloc(&pool, 16) != NULL) {
+    n++;
+  }
+  ok(n == 16 + 32 + 32 + 16, "free lists are consistent after concurrent use");
+
+  note("--- allocation latency (allocate and free 32 messages), pool vs TLSF with a fragmented heap");
+  msg_pool_init(&pool, mem, mem_size, sizes, nbs, NB_CLASS);
+  static uint8_t heap_mem[HEAP_SIZE] __attribute__((aligned(8)));
+  tlsf_t heap = tlsf_create_with_pool(heap_mem, HEAP_SIZE, NULL);
+  // some long lived messages of random sizes, as left by a busy logger
+  unsigned int seed = 42;
+  for (int i = 0; i < 60; i++) {
+    void *p = tlsf_malloc(heap, 8 + rand_r(&seed) % 120);
+    if (i % 2) {
+      tlsf_free(heap, p);
+    }
+  }
+  void *ptr[32];
+  double pool_mean = 0, pool_max = 0, tlsf_mean = 0, tlsf_max = 0;
+  for (int r = 0; r < NB_RUNS; r++) {
+    double t0 = now_s();
+    for (int i = 0; i < 32; i++) {
+      ptr[i] = msg_pool_alloc(&pool, 8 + (i * 37 + r) % 120);
+    }
+    for (int i = 0; i < 32; i++) {
+      msg_pool_free(&pool, ptr[(i * 7) % 32]);
+    }
+    double dt = (now_s() - t0) * 1e9 / 64;
+    pool_mean += dt / NB_RUNS;
+    pool_max = dt > pool_max ? dt : pool_max;
+
+    t0 = now_s();
+    for (int i = 0; i < 32; i++) {
+      ptr[i] = tlsf_malloc(heap, 8 + (i * 37 + r) % 120);
+    }
+    for (int i = 0; i < 32; i++) {
+      tlsf_free(heap, ptr[(i * 7) % 32]);
+    }
+    dt = (now_s() - t0) * 1e9 / 64;
+    tlsf_mean += dt / NB_RUNS;
+    tlsf_max = dt > tlsf_max ? dt : tlsf_max;
+  }
+  note("pool: %.1f ns/op mean, %.1f ns/op worst run", pool_mean, pool_max);
+  note("TLSF: %.1f ns/op mean, %.1f ns/op worst run (without the heap mutex of the target)",
+       tlsf_mean, tlsf_max);
+  used = 0;
+  for (uint8_t i = 0; i < NB_CLASS; i++) {
+    msg_pool_get_stats(&pool, i, &stats);
+    used += stats.used;
+  }
+  ok(used == 0, "benchmark released all slots");
+
+  free(mem);
+  done_testing();
+}
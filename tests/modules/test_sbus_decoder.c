@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_sbus_decoder.c
+ * @brief Tests of the SBUS span decoder against the byte by byte decoder, and throughput benchmark.
+ */
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "subsystems/radio_control/sbus_decoder.h"
+
+#define NB_FRAMES 5000
+
+/* reference: byte by byte decoder of sbus_common.c before the span decoder */
+struct ref_sbus {
+  uint16_t pulses[SBUS_NB_CHANNEL];
+  uint8_t flags;
+  uint8_t buffer[SBUS_BUF_LENGTH];
+  uint8_t idx;
+  uint8_t status;
+};
+
+static void ref_decode_buffer(const uint8_t *src, uint16_t *dst)
+{
+  dst[0]  = ((src[0]) | (src[1] << 8))                  & 0x07FF;
+  dst[1]  = ((src[1] >> 3) | (src[2] << 5))                  & 0x07FF;
+  dst[2]  = ((src[2] >> 6) | (src[3] << 2)  | (src[4] << 10))  & 0x07FF;
+  dst[3]  = ((src[4] >> 1) | (src[5] << 7))                  & 0x07FF;
+  dst[4]  = ((src[5] >> 4) | (src[6] << 4))                  & 0x07FF;
+  dst[5]  = ((src[6] >> 7) | (src[7] << 1) | (src[8] << 9))   & 0x07FF;
+  dst[6]  = ((src[8] >> 2) | (src[9] << 6))                  & 0x07FF;
+  dst[7]  = ((src[9] >> 5)  | (src[10] << 3))                 & 0x07FF;
+  dst[8]  = ((src[11]) | (src[12] << 8))                 & 0x07FF;
+  dst[9]  = ((src[12] >> 3) | (src[13] << 5))                 & 0x07FF;
+  dst[10] = ((src[13] >> 6) | (src[14] << 2) | (src[15] << 10)) & 0x07FF;
+  dst[11] = ((src[15] >> 1) | (src[16] << 7))                 & 0x07FF;
+  dst[12] = ((src[16] >> 4) | (src[17] << 4))                 & 0x07FF;
+  dst[13] = ((src[17] >> 7) | (src[18] << 1) | (src[19] << 9))  & 0x07FF;
+  dst[14] = ((src[19] >> 2) | (src[20] << 6))                 & 0x07FF;
+  dst[15] = ((src[20] >> 5) | (src[21] << 3))                 & 0x07FF;
+}
+
+/* one byte, as uart_getch would give it; returns true if a frame is decoded */
+static __attribute__((noinline)) bool ref_parse_byte(struct ref_sbus *s, uint8_t rbyte)
+{
+  if (s->status == 0) {
+    if (rbyte == 0x0f) {
+      s->status = 1;
+      s->idx = 0;
+    }
+  } else {
+    s->buffer[s->idx++] = rbyte;
+    if (s->idx == SBUS_BUF_LENGTH) {
+      s->status = 0;
+      if (rbyte == 0x00 || rbyte == 0x04 || rbyte == 0x14 || rbyte == 0x24 || rbyte == 0x34 || rbyte == 0x08) {
+        ref_decode_buffer(s->buffer, s->pulses);
+        s->flags = s->buffer[SBUS_FLAGS_BYTE];
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+/* build a stream of frames, with some garbage and bad end bytes */
+static size_t build_stream(uint8_t *stream, unsigned int *seed)
+{
+  static const uint8_t end_bytes[] = { 0x00, 0x04, 0x14, 0x24, 0x34, 0x08, 0x55 };
+  size_t len = 0;
+  for (int f = 0; f < NB_FRAMES; f++) {
+    if (rand_r(seed) % 10 == 0) {
+      int garbage = rand_r(seed) % 8;
+      for (int i = 0; i < garbage; i++) {
+        stream[len++] = rand_r(seed) & 0xff;
+      }
+    }
+    stream[len++] = 0x0f;
+    for (int i = 0; i < 22; i++) {
+      stream[len++] = rand_r(seed) & 0xff;
+    }
+    stream[len++] = rand_r(seed) & 0x3c; // flags
+    stream[len++] = end_bytes[rand_r(seed) % sizeof(end_bytes)];
+  }
+  return len;
+}
+
+int main(void)
+{
+  plan(7);
+
+  unsigned int seed = 2020;
+  uint8_t *stream = malloc(NB_FRAMES * 40);
+  const size_t stream_len = build_stream(stream, &seed);
+
+  note("--- channel extraction");
+  int diff = 0;
+  for (int k = 0; k < 100000; k++) {
+    uint8_t buf[SBUS_BUF_LENGTH];
+    uint16_t ref[SBUS_NB_CHANNEL], out[SBUS_NB_CHANNEL];
+    for (int i = 0; i < SBUS_BUF_LENGTH; i++) {
+      buf[i] = rand_r(&seed) & 0xff;
+    }
+    ref_decode_buffer(buf, ref);
+    sbus_decode_channels(buf, out);
+    diff += memcmp(ref, out, sizeof(ref)) != 0;
+  }
+  ok(diff == 0, "word extraction equals byte extraction on random frames");
+
+  note("--- span parser vs byte by byte parser, random span lengths");
+  struct ref_sbus ref = { .status = 0 };
+  struct SbusDecoder dec;
+  sbus_decoder_init(&dec);
+  uint16_t channels[SBUS_NB_CHANNEL];
+  uint8_t flags = 0;
+  size_t pos = 0;
+  uint32_t now = 1000;
+  int nb_ref = 0, nb_dec = 0, mismatch = 0, bad_time = 0;
+  while (pos < stream_len) {
+    uint16_t n = 1 + rand_r(&seed) % 60;
+    if (pos + n > stream_len) {
+      n = stream_len - pos;
+    }
+    int ref_frames = 0;
+    size_t last_end = 0;
+    for (uint16_t i = 0; i < n; i++) {
+      if (ref_parse_byte(&ref, stream[pos + i])) {
+        ref_frames++;
+        last_end = i;
+      }
+    }
+    now += n * SBUS_BYTE_TIME_US;
+    const uint8_t nb = sbus_decoder_parse(&dec, &stream[pos], n, now, channels, &flags);
+    nb_ref += ref_frames;
+    nb_dec += nb;
+    if (nb != ref_frames) {
+      mismatch++;
+    } else if (nb > 0) {
+      mismatch += memcmp(channels, ref.pulses, sizeof(channels)) != 0 || flags != ref.flags;
+      bad_time += dec.frame_time != now - (n - 1 - last_end) * SBUS_BYTE_TIME_US;
+    }
+    pos += n;
+  }
+  note("%d frames decoded, %d by the reference", nb_dec, nb_ref);
+  ok(nb_dec > NB_FRAMES / 2 && nb_dec == nb_ref, "same number of frames");
+  ok(mismatch == 0, "same channels and flags for the last frame of each span");
+  ok(bad_time == 0, "frames time stamped at the arrival of their last byte");
+
+  note("--- timeout");
+  uint8_t frame[SBUS_BUF_LENGTH + 1] = { 0x0f }; // valid frame, end byte 0x00
+  sbus_decoder_init(&dec);
+  sbus_decoder_parse(&dec, frame, 10, 100000, channels, &flags);
+  uint8_t nb = sbus_decoder_parse(&dec, frame + 10, 15, 100000 + 15 * SBUS_BYTE_TIME_US, channels, &flags);
+  sbus_decoder_parse(&dec, frame, 10, 200000, channels, &flags);
+  nb += 2 * sbus_decoder_parse(&dec, frame + 10, 15, 200000 + SBUS_TIMEOUT_US + 15 * SBUS_BYTE_TIME_US,
+                               channels, &flags);
+  ok(nb == 1, "frame received in time is decoded, frame started too long ago is dropped");
+
+  note("--- frame period statistics");
+  sbus_decoder_init(&dec);
+  now = 0;
+  for (int f = 0; f < 2000; f++) {
+    now += 7000 + ((f % 2) ? 100 : -100);
+    sbus_decoder_parse(&dec, frame, sizeof(frame), now, channels, &flags);
+  }
+  note("period %.1f us, jitter %.1f us, min %u, max %u", dec.stats.gap_mean,
+       rc_frame_stats_jitter(&dec.stats), dec.stats.gap_min, dec.stats.gap_max);
+  ok(dec.stats.nb_frames == 2000 && dec.stats.gap_min == 6900 && dec.stats.gap_max == 7100, "frame count and gap bounds");
+  ok(fabsf(dec.stats.gap_mean - 7000.f) < 10.f && fabsf(rc_frame_stats_jitter(&dec.stats) - 100.f) < 10.f,
+     "period and jitter");
+
+  note("--- throughput");
+  const int nb_runs = 50;
+  uint16_t acc = 0;
+  double t0 = now_s();
+  for (int r = 0; r < nb_runs; r++) {
+    struct ref_sbus s = { .status = 0 };
+    for (size_t i = 0; i < stream_len; i++) {
+      if (ref_parse_byte(&s, stream[i])) {
+        acc += s.pulses[3];
+      }
+    }
+  }
+  const double t_ref = now_s() - t0;
+  t0 = now_s();
+  for (int r = 0; r < nb_runs; r++) {
+    sbus_decoder_init(&dec);
+    for (size_t i = 0; i < stream_len; i += 50) {
+      const uint16_t n = (stream_len - i) < 50 ? stream_len - i : 50;
+      if (sbus_decoder_parse(&dec, &stream[i], n, 0, channels, &flags)) {
+        acc += channels[3];
+      }
+    }
+  }
+  const double t_dec = now_s() - t0;
+  const double mb = (double)stream_len * nb_runs / 1e6;
+  note("byte by byte: %.1f MB/s, spans of 50 bytes: %.1f MB/s (%u)", mb / t_ref, mb / t_dec, acc);
+
+  t0 = now_s();
+  for (int r = 0; r < 2000000; r++) {
+    ref_decode_buffer(&stream[(r * 25) % (stream_len - 30)], channels);
+    acc += channels[r & 15];
+  }
+  const double t_ref_ch = now_s() - t0;
+  t0 = now_s();
+  for (int r = 0; r < 2000000; r++) {
+    sbus_decode_channels(&stream[(r * 25) % (stream_len - 30)], channels);
+    acc += channels[r & 15];
+  }
+  const double t_ch = now_s() - t0;
+  note("channel extraction: bytes %.1f ns/frame, words %.1f ns/frame (%u)",
+       t_ref_ch * 1e9 / 2000000, t_ch * 1e9 / 2000000, acc);
+
+  free(stream);
+  done_testing();
+}
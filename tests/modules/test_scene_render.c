@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_scene_render.c
+ * @brief Tests of the CPU scene renderer of the NPS cameras, and frame rate benchmark.
+ */
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "modules/computer_vision/lib/vision/scene_render.h"
+
+/* forward camera of a level aircraft heading north */
+static struct FloatRMat front = {{ 0.f, 1.f, 0.f, 0.f, 0.f, 1.f, 1.f, 0.f, 0.f }};
+/* camera looking down */
+static struct FloatRMat down = {{ 0.f, 1.f, 0.f, -1.f, 0.f, 0.f, 0.f, 0.f, 1.f }};
+
+static uint8_t pix_y(struct SceneCamera *cam, uint8_t *buf, int x, int y)
+{
+  return buf[2 * (y * cam->w + x) + 1];
+}
+
+static uint8_t pix_u(struct SceneCamera *cam, uint8_t *buf, int x, int y)
+{
+  return buf[4 * ((y * cam->w + x) / 2)];
+}
+
+static uint8_t pix_v(struct SceneCamera *cam, uint8_t *buf, int x, int y)
+{
+  return buf[4 * ((y * cam->w + x) / 2) + 2];
+}
+
+static double bench(struct SceneRender *scene, struct SceneCamera *cam, uint8_t *buf, uint8_t nb_threads)
+{
+  const int nb_frames = 30;
+  struct FloatVect3 pos = { -2.f, 0.f, -1.5f };
+  double t0 = now_s();
+  for (int f = 0; f < nb_frames; f++) {
+    pos.x += 0.1f;
+    scene_render(scene, cam, &pos, &front, buf, nb_threads);
+  }
+  return nb_frames / (now_s() - t0);
+}
+
+int main(void)
+{
+  plan(9);
+
+  struct SceneRender scene;
+  struct SceneCamera cam;
+  scene_render_init(&scene);
+  ok(scene_camera_init(&cam, 640, 480, 300.f, 300.f, 320.f, 240.f, 1.f) == 0, "camera init");
+  uint8_t *buf = malloc(2 * 640 * 480);
+  uint8_t *buf2 = malloc(2 * 640 * 480);
+
+  note("--- horizon and pole");
+  const struct SceneColor red = { 82, 90, 240 };
+  scene_render_add_pole(&scene, 10.f, 0.f, 0.4f, 3.f, red);
+  struct FloatVect3 pos = { 0.f, 0.f, -1.f };
+  scene_render(&scene, &cam, &pos, &front, buf, 1);
+  ok(pix_y(&cam, buf, 100, 200) == scene.sky.y && pix_y(&cam, buf, 100, 280) != scene.sky.y,
+     "sky above the horizon, ground below");
+  ok(pix_u(&cam, buf, 320, 240) == red.u && pix_v(&cam, buf, 320, 240) == red.v
+     && pix_u(&cam, buf, 340, 240) != red.u, "pole in the middle of the image, 12 pixels wide");
+
+  note("--- same image for any number of threads");
+  scene_render_init(&scene);
+  scene_render_default(&scene);
+  struct FloatRMat tilted;
+  struct FloatRMat roll = {{ 0.98f, 0.f, -0.199f, 0.f, 1.f, 0.f, 0.199f, 0.f, 0.98f }};
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      tilted.m[3 * i + j] = 0.f;
+      for (int k = 0; k < 3; k++) {
+        tilted.m[3 * i + j] += front.m[3 * i + k] * roll.m[3 * k + j];
+      }
+    }
+  }
+  VECT3_ASSIGN(pos, -3.f, 1.f, -1.7f);
+  scene_render(&scene, &cam, &pos, &tilted, buf, 1);
+  int diff = 0;
+  for (uint8_t n = 2; n <= 8; n += 3) {
+    memset(buf2, 0, 2 * 640 * 480);
+    scene_render(&scene, &cam, &pos, &tilted, buf2, n);
+    diff += memcmp(buf, buf2, 2 * 640 * 480) != 0;
+  }
+  ok(diff == 0, "1, 2, 5 and 8 threads give the same image");
+
+  note("--- tile culling");
+  struct SceneTileCone *cones = cam.cones;
+  struct SceneTileCone *all = malloc(sizeof(struct SceneTileCone) * cam.tiles_x * cam.tiles_y);
+  for (int i = 0; i < cam.tiles_x * cam.tiles_y; i++) {
+    all[i] = cones[i];
+    all[i].cos = -1.f; // whole sphere, all boxes tested
+    all[i].sin = 0.f;
+  }
+  diff = 0;
+  for (int k = 0; k < 20; k++) {
+    struct FloatVect3 p = { -5.f + k, 0.5f * k, -0.2f - 0.2f * k };
+    cam.cones = cones;
+    scene_render(&scene, &cam, &p, (k % 2) ? &front : &tilted, buf, 1);
+    cam.cones = all;
+    scene_render(&scene, &cam, &p, (k % 2) ? &front : &tilted, buf2, 1);
+    diff += memcmp(buf, buf2, 2 * 640 * 480) != 0;
+  }
+  cam.cones = cones;
+  free(all);
+  ok(diff == 0, "same images without culling of the boxes");
+
+  note("--- gate");
+  VECT3_ASSIGN(pos, 0.f, 0.f, -1.5f);
+  scene_render(&scene, &cam, &pos, &front, buf, 4);
+  int orange = 0;
+  for (int y = 0; y < 480; y++) {
+    for (int x = 0; x < 640; x++) {
+      uint8_t u = pix_u(&cam, buf, x, y), v = pix_v(&cam, buf, x, y);
+      orange += (u >= 42 && u <= 121 && v >= 134 && v <= 230);
+    }
+  }
+  note("%d pixels in the color filter of the gate detection", orange);
+  ok(orange > 1000 && pix_u(&cam, buf, 320, 240) > 121, "gate seen through its opening");
+
+  note("--- ground texture");
+  VECT3_ASSIGN(pos, 2.f, 5.f, -2.f);
+  scene_render(&scene, &cam, &pos, &down, buf, 4);
+  double sum = 0., sum2 = 0.;
+  for (int i = 0; i < 640 * 480; i++) {
+    const double y = buf[2 * i + 1];
+    sum += y;
+    sum2 += y * y;
+  }
+  const double var = sum2 / (640 * 480) - (sum / (640 * 480)) * (sum / (640 * 480));
+  note("bottom view: mean Y %.1f, variance %.1f", sum / (640 * 480), var);
+  ok(var > 200., "textured ground for optical flow");
+
+  note("--- fisheye");
+  struct SceneCamera fish;
+  scene_camera_init(&fish, 640, 480, 300.f, 300.f, 320.f, 240.f, 1.4f);
+  scene_render(&scene, &fish, &pos, &down, buf, 4);
+  ok(pix_y(&fish, buf, 0, 0) == 0 && pix_u(&fish, buf, 0, 0) == 128 && pix_y(&fish, buf, 320, 240) != 0,
+     "corners outside of the lens are black");
+  scene_camera_free(&fish);
+
+  note("--- frame rate of the default scene");
+  struct SceneCamera hd;
+  scene_camera_init(&hd, 1280, 720, 300.f, 300.f, 640.f, 360.f, 1.f);
+  uint8_t *buf_hd = malloc(2 * 1280 * 720);
+  note("640x480: %.0f fps with 1 thread, %.0f fps with 4 threads",
+       bench(&scene, &cam, buf, 1), bench(&scene, &cam, buf, 4));
+  const double fps_hd = bench(&scene, &hd, buf_hd, 4);
+  note("1280x720: %.0f fps with 1 thread, %.0f fps with 4 threads", bench(&scene, &hd, buf_hd, 1), fps_hd);
+  ok(fps_hd > 0., "benchmark done");
+
+  scene_camera_free(&hd);
+  scene_camera_free(&cam);
+  free(buf_hd);
+  free(buf);
+  free(buf2);
+  done_testing();
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_sdlog_compress.c
+ * @brief Tests and throughput of the SD logger compression.
+ *
+ * Synthetic telemetry logs are compressed by blocks as in the logger thread
+ * and decoded with the functions used by sdlog_unpack. Corrupted and
+ * truncated blocks must be detected, and the unpack tool must recover the
+ * other blocks of a damaged log.
+ */
+
+#define NB_RUNS 20
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "modules/loggers/sdlog_chibios/sdLogCompress.h"
+
+/* the decoding tool, its main is not used */
+#define main sdlog_unpack_main
+#include "../../sw/logalizer/sdlog_unpack.c"
+#undef main
+
+#define LOG_LEN 200000
+#define BLOCK_LEN 4096
+#define NB_MSG_TYPES 4
+
+static uint8_t log_buf[LOG_LEN];
+static uint8_t comp[SDLOG_COMPRESS_BOUND(LOG_LEN) * 2];
+static uint8_t dec[LOG_LEN];
+static struct SdLogDeltaHistory hist;
+static struct SdLogCompressWork work;
+
+/** Typical log: pprzlog frames of a few periodic messages with a time stamp,
+ *  slowly changing fields and noise, and some text lines.
+ *  @return log length
+ */
+static size_t make_log(uint8_t *buf, size_t size)
+{
+  static const uint8_t msg_len[NB_MSG_TYPES] = { 20, 36, 60, 150 };
+  uint32_t stamp[NB_MSG_TYPES] = { 0 };
+  size_t len = 0;
+  uint32_t i = 0;
+  srand(42);
+  while (len + 256 < size) {
+    uint8_t t = i % NB_MSG_TYPES;
+    if (i % 97 == 0) {
+      len += sprintf((char *)&buf[len], "# event %u at %u ms\n", i, stamp[0]);
+    }
+    uint8_t *m = &buf[len];
+    m[0] = 0x99;
+    m[1] = msg_len[t];
+    m[2] = 1;
+    m[3] = 10 + t;
+    stamp[t] += 10 * (t + 1);
+    memcpy(&m[4], &stamp[t], 4);
+    for (uint8_t k = 8; k + 2 < msg_len[t]; k += 2) {
+      int16_t v = (int16_t)(1000 * k + 50 * (i % 20) + (rand() % 3));
+      memcpy(&m[k], &v, 2);
+    }
+    m[msg_len[t] - 2] = (uint8_t)rand();
+    m[msg_len[t] - 1] = (uint8_t)rand();
+    len += msg_len[t];
+    i++;
+  }
+  return len;
+}
+
+/** Compress records of fixed length, or pprzlog frames and lines if rec_len is 0,
+ *  as the logger thread: whole records in each block, history reset per block
+ *  @return compressed length
+ */
+static size_t compress_log(const uint8_t *in, size_t len, size_t rec_len, uint8_t *out)
+{
+  static uint8_t buf[BLOCK_LEN + SDLOG_DELTA_BOUND(LOG_LEN)];
+  size_t clen = 0, fill = 0;
+  sdLogDeltaReset(&hist);
+  for (size_t idx = 0; idx < len;) {
+    size_t n = rec_len ? rec_len : next_record(&in[idx], len - idx);
+    if (n > len - idx) {
+      n = len - idx;
+    }
+    if (fill > 0 && fill + SDLOG_DELTA_BOUND(n) > BLOCK_LEN) {
+      clen += sdLogCompressBlock(buf, fill, SDLOG_BLOCK_DELTA, &out[clen], &work);
+      sdLogDeltaReset(&hist);
+      fill = 0;
+    }
+    fill += sdLogDeltaRecord(&hist, &in[idx], n, &buf[fill]);
+    idx += n;
+  }
+  if (fill) {
+    clen += sdLogCompressBlock(buf, fill, SDLOG_BLOCK_DELTA, &out[clen], &work);
+  }
+  return clen;
+}
+
+/** Decode one block with the record deltas
+ *  @return data length, -1 if incomplete, -2 if corrupted
+ */
+static int32_t decode_block(const uint8_t *blk, size_t avail, uint8_t *out, size_t *consumed)
+{
+  static uint8_t block[SDLOG_BLOCK_MAX_LEN];
+  uint8_t flags;
+  int32_t n = sdLogDecompressBlock(blk, avail, block, consumed, &flags);
+  if (n >= 0 && (flags & SDLOG_BLOCK_DELTA)) {
+    n = sdLogUndeltaBlock(&hist, block, n, out, SDLOG_BLOCK_MAX_LEN);
+    n = n < 0 ? -2 : n;
+  } else if (n >= 0) {
+    memcpy(out, block, n);
+  }
+  return n;
+}
+
+/** Decode a whole log, stops at the first error
+ *  @return decoded length, -1 if an error was found
+ */
+static int32_t decode_log(const uint8_t *in, size_t len, uint8_t *out)
+{
+  size_t idx = 0, olen = 0, consumed;
+  while (idx < len) {
+    int32_t n = decode_block(&in[idx], len - idx, &out[olen], &consumed);
+    if (n < 0) {
+      return -1;
+    }
+    idx += consumed;
+    olen += n;
+  }
+  return (int32_t)olen;
+}
+
+static bool round_trip(const uint8_t *in, size_t len, size_t rec_len, size_t *clen)
+{
+  *clen = compress_log(in, len, rec_len, comp);
+  int32_t dlen = decode_log(comp, *clen, dec);
+  return dlen == (int32_t)len && memcmp(dec, in, len) == 0;
+}
+
+static bool write_file(const char *name, const uint8_t *buf, size_t len)
+{
+  FILE *f = fopen(name, "wb");
+  if (f == NULL) {
+    return false;
+  }
+  bool ok = fwrite(buf, 1, len, f) == len;
+  fclose(f);
+  return ok;
+}
+
+int main()
+{
+  note("running SD logger compression tests");
+  plan(7);
+
+  size_t len = make_log(log_buf, LOG_LEN);
+  size_t clen;
+  bool ok_typ = round_trip(log_buf, len, 0, &clen);
+  ok(ok_typ, "typical log decoded identical");
+  note("typical log: %zu -> %zu bytes, ratio %.2f", len, clen, (double)len / clen);
+  ok((double)len / clen > 1.5, "typical log compressed at least by 1.5");
+
+  /* records longer than the history records, with 2 bytes length */
+  size_t i;
+  for (i = 0; i < LOG_LEN; i++) {
+    log_buf[i] = (uint8_t)(i % 300 < 150 ? i / 300 : (size_t)rand() % 4);
+  }
+  bool ok_long = round_trip(log_buf, LOG_LEN, 300, &clen);
+  ok(ok_long, "long records decoded identical");
+
+  /* random data is stored */
+  for (i = 0; i < LOG_LEN; i++) {
+    log_buf[i] = (uint8_t)rand();
+  }
+  uint8_t flags;
+  size_t consumed;
+  clen = sdLogCompressBlock(log_buf, SDLOG_BLOCK_MAX_LEN, 0, comp, &work);
+  bool ok_rand = clen == SDLOG_COMPRESS_BOUND(SDLOG_BLOCK_MAX_LEN) &&
+                 sdLogDecompressBlock(comp, clen, dec, &consumed, &flags) == SDLOG_BLOCK_MAX_LEN &&
+                 !(flags & SDLOG_BLOCK_HUFFMAN) && memcmp(dec, log_buf, SDLOG_BLOCK_MAX_LEN) == 0;
+  ok(ok_rand, "random data stored in a block of the bound size");
+
+  /* corruption of each byte of a block, and truncation */
+  len = make_log(log_buf, LOG_LEN);
+  clen = compress_log(log_buf, len, 0, comp);
+  size_t blk_len;
+  int32_t raw0 = decode_block(comp, clen, dec, &blk_len);
+  int nb_undetected = 0, nb_not_truncated = 0;
+  for (i = 0; i < blk_len; i++) {
+    comp[i] ^= 0x10;
+    int32_t n = decode_block(comp, clen, dec, &consumed);
+    /* wrong data decoded, unused flags or a longer data length are harmless */
+    if (n >= 0 && (n != raw0 || memcmp(dec, log_buf, n) != 0)) {
+      nb_undetected++;
+    }
+    comp[i] ^= 0x10;
+    if (decode_block(comp, i, dec, &consumed) != -1) {
+      nb_not_truncated++;
+    }
+  }
+  note("%zu bytes of the first block corrupted, %d not detected, %d truncations not detected",
+       blk_len, nb_undetected, nb_not_truncated);
+  ok(nb_undetected == 0 && nb_not_truncated == 0, "corrupted and truncated blocks detected");
+
+  /* unpack tool: damaged second block, and a truncated last block */
+  int32_t raw_len[LOG_LEN / 512];
+  size_t nb = 0, second = 0;
+  for (size_t idx = 0; idx < clen && nb < LOG_LEN / 512; idx += consumed) {
+    raw_len[nb++] = decode_block(&comp[idx], clen - idx, dec, &consumed);
+    if (nb == 1) {
+      second = consumed;
+    }
+  }
+  comp[second + SDLOG_BLOCK_HEADER_LEN + 200] ^= 0xff;
+  char in_name[] = "/tmp/test_sdlog_XXXXXX";
+  char out_name[sizeof(in_name) + 4];
+  int fd = mkstemp(in_name);
+  snprintf(out_name, sizeof(out_name), "%s.raw", in_name);
+  bool ok_unpack = fd >= 0 && nb > 3 && write_file(in_name, comp, clen - 10);
+  int ret = ok_unpack ? unpack(in_name, out_name) : EXIT_SUCCESS;
+  size_t olen = 0;
+  uint8_t *out = read_file(out_name, &olen);
+  /* all blocks but the second and the last one */
+  size_t start = raw_len[0] + raw_len[1];
+  ok_unpack = ok_unpack && ret == EXIT_FAILURE && out != NULL &&
+              olen == len - raw_len[1] - raw_len[nb - 1] &&
+              memcmp(out, log_buf, raw_len[0]) == 0 &&
+              memcmp(&out[raw_len[0]], &log_buf[start], olen - raw_len[0]) == 0;
+  ok(ok_unpack, "unpack skips the corrupted block and stops at the truncated one");
+  free(out);
+  if (fd >= 0) {
+    close(fd);
+    unlink(in_name);
+    unlink(out_name);
+  }
+
+  /* throughput */
+  len = make_log(log_buf, LOG_LEN);
+  double t0 = now_s();
+  for (i = 0; i < NB_RUNS; i++) {
+    clen = compress_log(log_buf, len, 0, comp);
+  }
+  double t_comp = (now_s() - t0) / NB_RUNS;
+  t0 = now_s();
+  int32_t dlen = 0;
+  for (i = 0; i < NB_RUNS; i++) {
+    dlen = decode_log(comp, clen, dec);
+  }
+  double t_dec = (now_s() - t0) / NB_RUNS;
+  note("compress %.1f MB/s, decompress %.1f MB/s", len / t_comp / 1e6, len / t_dec / 1e6);
+  ok(dlen == (int32_t)len, "throughput runs decoded");
+
+  done_testing();
+}
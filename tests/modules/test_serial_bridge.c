@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_serial_bridge.c
+ * @brief Round trip tests of the serial bridge engine over a pty pair.
+ *
+ * The bridge runs on the slave side of the pty, the test plays the
+ * remote device on the master side.
+ */
+
+#define _GNU_SOURCE
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "serial_bridge.h"
+
+#define FRAME_STX 0x99
+#define MAX_FRAME 64
+#define NB_FRAMES 500
+
+/** frames are STX, length, payload */
+static size_t decode_frame(void *user __attribute__((unused)), const uint8_t *buf, size_t len,
+                           uint8_t *frame, size_t *frame_len)
+{
+  if (buf[0] != FRAME_STX) {
+    return 1; // resync
+  }
+  if (len < 2 || len < 2u + buf[1]) {
+    return 0;
+  }
+  memcpy(frame, buf + 2, buf[1]);
+  *frame_len = buf[1];
+  return 2 + buf[1];
+}
+
+static size_t make_frame(uint8_t *out, int i)
+{
+  uint8_t len = 1 + i % (MAX_FRAME - 2); // whole frame fits in MAX_FRAME
+  out[0] = FRAME_STX;
+  out[1] = len;
+  int k;
+  for (k = 0; k < len; k++) {
+    out[2 + k] = (uint8_t)(i + k);
+  }
+  return 2 + len;
+}
+
+static int nb_received, nb_bad;
+
+static void on_frame(void *user __attribute__((unused)), const uint8_t *frame, size_t len)
+{
+  uint8_t ref[MAX_FRAME + 2];
+  size_t ref_len = make_frame(ref, nb_received);
+  if (len != ref_len - 2 || memcmp(frame, ref + 2, len) != 0) {
+    nb_bad++;
+  }
+  nb_received++;
+}
+
+static void test_queue(void)
+{
+  struct sb_queue q;
+  sb_queue_init(&q, 8, 3);
+  bool good = q.nb == 4;
+  int i;
+  for (i = 0; i < 4; i++) {
+    good &= sb_queue_push(&q, &i, sizeof(i));
+  }
+  good &= !sb_queue_push(&q, &i, sizeof(i));
+  for (i = 0; i < 4; i++) {
+    int v = -1;
+    size_t len = 0;
+    good &= sb_queue_pop(&q, &v, &len) && len == sizeof(v) && v == i;
+  }
+  size_t len;
+  good &= !sb_queue_pop(&q, &i, &len);
+  uint8_t big[16] = { 0 };
+  good &= !sb_queue_push(&q, big, sizeof(big));
+  sb_queue_free(&q);
+  ok(good, "queue keeps order, rejects when full and too long frames");
+}
+
+int main()
+{
+  note("running serial bridge tests");
+  plan(6);
+
+  test_queue();
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    diag("no pty available");
+    return 1;
+  }
+  struct termios tio;
+  tcgetattr(master, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(master, TCSANOW, &tio);
+  int fd = serial_bridge_open_port(ptsname(master), B115200);
+  ok(fd >= 0, "open pty slave as serial port");
+
+  struct serial_bridge sb;
+  serial_bridge_start(&sb, fd, MAX_FRAME, 64, 8, decode_frame, NULL);
+
+  // device -> bridge, frames written in chunks cutting through frames
+  static uint8_t stream[NB_FRAMES * (MAX_FRAME + 3)];
+  size_t stream_len = 0;
+  int i;
+  for (i = 0; i < NB_FRAMES; i++) {
+    if (i % 50 == 7) {
+      stream[stream_len++] = 0x42; // garbage between frames
+    }
+    stream_len += make_frame(stream + stream_len, i);
+  }
+  size_t sent = 0;
+  double t0 = now_s();
+  srand(5);
+  while (nb_received < NB_FRAMES && now_s() - t0 < 5.) {
+    if (sent < stream_len) {
+      size_t chunk = 1 + rand() % 300;
+      if (chunk > stream_len - sent) {
+        chunk = stream_len - sent;
+      }
+      ssize_t w = write(master, stream + sent, chunk);
+      if (w > 0) {
+        sent += w;
+      }
+    }
+    struct pollfd pfd = { .fd = serial_bridge_rx_fd(&sb), .events = POLLIN };
+    if (poll(&pfd, 1, 10) > 0) {
+      serial_bridge_poll(&sb, on_frame, NULL);
+    }
+  }
+  note("received %d frames in %.1f ms, %ld dropped", nb_received, (now_s() - t0) * 1e3,
+       atomic_load(&sb.stats.rx_dropped));
+  ok(nb_received == NB_FRAMES && nb_bad == 0, "all frames received in order through the pty");
+
+  // bridge -> device, the master side is read while sending since the pty buffer is small
+  static uint8_t rx[NB_FRAMES * (MAX_FRAME + 3)];
+  size_t expected = 0, got = 0;
+  i = 0;
+  t0 = now_s();
+  while ((i < NB_FRAMES || got < expected) && now_s() - t0 < 5.) {
+    if (i < NB_FRAMES) {
+      uint8_t frame[MAX_FRAME + 2];
+      size_t len = make_frame(frame, i);
+      if (serial_bridge_send(&sb, frame, len)) {
+        expected += len;
+        i++;
+        continue;
+      }
+    }
+    struct pollfd pfd = { .fd = master, .events = POLLIN };
+    if (poll(&pfd, 1, 10) > 0) {
+      ssize_t r = read(master, rx + got, sizeof(rx) - got);
+      if (r > 0) {
+        got += r;
+      }
+    }
+  }
+  int nb_sent = i;
+  size_t pos = 0;
+  bool same = got == expected;
+  for (i = 0; same && i < NB_FRAMES; i++) {
+    uint8_t frame[MAX_FRAME + 2];
+    size_t len = make_frame(frame, i);
+    same = memcmp(rx + pos, frame, len) == 0;
+    pos += len;
+  }
+  ok(same && nb_sent == NB_FRAMES, "all frames sent in order through the pty");
+  long writes = atomic_load(&sb.stats.tx_writes);
+  note("%ld frames sent with %ld writes", atomic_load(&sb.stats.tx_frames), writes);
+  ok(writes <= atomic_load(&sb.stats.tx_frames), "frames batched, no more writes than frames");
+
+  // reader is waiting on an idle port, stop must not hang
+  t0 = now_s();
+  serial_bridge_stop(&sb);
+  note("stop took %.3f ms", (now_s() - t0) * 1e3);
+  ok(sb.frame == NULL && now_s() - t0 < 1., "stop joins an idle reader");
+
+  close(fd);
+  close(master);
+  done_testing();
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_settings_hash.c
+ * @brief Tests of the settings lookup by short name (MAVLink parameter id).
+ *
+ * The minimal perfect hash lookup generated by gen_settings is compared
+ * with the linear scan it replaced, on a table generated from the settings
+ * files of the repository (settings_hash_table.h).
+ */
+
+#define NB_RUNS 1000
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "settings_hash_table.h"
+
+/** previous lookup, first setting with the name */
+static int16_t settings_idx_scan(const char *name)
+{
+  uint16_t i;
+  for (i = 0; i < NB_SETTING; i++) {
+    if (strncmp(name, settings_get_short_name(i), 16) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int main()
+{
+  note("running settings lookup tests");
+  plan(4);
+
+  // unique names
+  int nb_unique = 0;
+  uint16_t i;
+  for (i = 0; i < NB_SETTING; i++) {
+    if (settings_idx_scan(settings_get_short_name(i)) == i) {
+      nb_unique++;
+    }
+  }
+  note("%d settings, %d unique short names", NB_SETTING, nb_unique);
+  ok(SETTINGS_HASH_SIZE == nb_unique, "hash table is minimal");
+
+  bool found = true;
+  for (i = 0; i < NB_SETTING; i++) {
+    const char *name = settings_get_short_name(i);
+    found &= settings_idx_from_short_name(name) == settings_idx_scan(name);
+  }
+  ok(found, "all names found, duplicates resolve to the first setting");
+
+  // unknown names: one char changed, truncated, extended, random
+  bool rejected = settings_idx_from_short_name("") == settings_idx_scan("");
+  char name[17];
+  for (i = 0; i < NB_SETTING; i++) {
+    size_t len = strlen(settings_get_short_name(i));
+    size_t k;
+    for (k = 0; k < len; k++) {
+      strcpy(name, settings_get_short_name(i));
+      name[k] ^= 0x20;
+      rejected &= settings_idx_from_short_name(name) == settings_idx_scan(name);
+    }
+    strcpy(name, settings_get_short_name(i));
+    name[len - 1] = '\0';
+    rejected &= settings_idx_from_short_name(name) == settings_idx_scan(name);
+    if (len < 16) {
+      strcpy(name, settings_get_short_name(i));
+      name[len] = 'x';
+      name[len + 1] = '\0';
+      rejected &= settings_idx_from_short_name(name) == settings_idx_scan(name);
+    }
+  }
+  srand(1);
+  int nb_random = 0;
+  for (i = 0; i < 10000; i++) {
+    int len = 1 + rand() % 16, k;
+    for (k = 0; k < len; k++) {
+      name[k] = "abcdefghijklmnopqrstuvwxyz_0123"[rand() % 31];
+    }
+    name[len] = '\0';
+    int16_t idx = settings_idx_from_short_name(name);
+    rejected &= idx == settings_idx_scan(name);
+    nb_random += (idx < 0);
+  }
+  note("%d of 10000 random names rejected", nb_random);
+  ok(rejected, "unknown names rejected");
+
+  // full parameter download: every setting looked up by name
+  volatile int16_t sink = 0;
+  double t0 = now_s();
+  int r;
+  for (r = 0; r < NB_RUNS; r++) {
+    for (i = 0; i < NB_SETTING; i++) {
+      sink += settings_idx_scan(settings_get_short_name(i));
+    }
+  }
+  double t_scan = (now_s() - t0) / NB_RUNS;
+  t0 = now_s();
+  for (r = 0; r < NB_RUNS; r++) {
+    for (i = 0; i < NB_SETTING; i++) {
+      sink += settings_idx_from_short_name(settings_get_short_name(i));
+    }
+  }
+  double t_hash = (now_s() - t0) / NB_RUNS;
+  note("lookup of all %d settings: linear scan %.1f us (%.0f ns each), hash %.1f us (%.0f ns each)",
+       NB_SETTING, t_scan * 1e6, t_scan * 1e9 / NB_SETTING, t_hash * 1e6, t_hash * 1e9 / NB_SETTING);
+  ok(sink != 0, "lookups done");
+
+  done_testing();
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_spi_linux.c
+ * @brief Tests of the Linux SPI engine with a fake spidev.
+ *
+ * The transfer function of the bus is replaced with spi_linux_set_xfer
+ * by a fake device with a fixed latency, which records the order of the
+ * transactions and fills the received bytes.
+ */
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <string.h>
+#include <unistd.h>
+#include <linux/spi/spidev.h>
+
+#include "mcu_periph/spi.h"
+
+#define NB_TRANS 40
+#define XFER_LATENCY_US 500
+#define NB_POLLS 20000
+
+static struct spi_periph bus;
+static struct spi_transaction trans[NB_TRANS];
+static uint8_t tx_buf[NB_TRANS][4];
+static uint8_t rx_buf[NB_TRANS][8];
+
+/* fake spidev */
+static volatile bool xfer_fail;
+static volatile int xfer_latency_us = XFER_LATENCY_US;
+static int order[4 * NB_TRANS];
+static volatile int nb_done;
+static int max_batch;
+
+static int fake_xfer(int fd __attribute__((unused)), struct spi_ioc_transfer *xfers, unsigned int nb)
+{
+  if (xfer_latency_us > 0) {
+    usleep(xfer_latency_us);
+  }
+  if ((int)nb > max_batch) {
+    max_batch = nb;
+  }
+  if (xfer_fail) {
+    return -1;
+  }
+  unsigned int i, k;
+  for (i = 0; i < nb; i++) {
+    const uint8_t *tx = (const uint8_t *)(uintptr_t)xfers[i].tx_buf;
+    uint8_t *rx = (uint8_t *)(uintptr_t)xfers[i].rx_buf;
+    // answer is the id sent in the first byte, plus the byte index
+    for (k = 0; k < xfers[i].len; k++) {
+      rx[k] = tx[0] + k;
+    }
+    if (nb_done < (int)(sizeof(order) / sizeof(order[0]))) {
+      order[nb_done] = tx[0];
+    }
+    nb_done++;
+  }
+  return nb;
+}
+
+static int cb_order[4 * NB_TRANS];
+static int nb_cb;
+
+static void after_cb(struct spi_transaction *t)
+{
+  cb_order[nb_cb++] = t->output_buf[0];
+}
+
+static void setup(int i, uint16_t in_len, SPICallback cb)
+{
+  tx_buf[i][0] = i;
+  memset(rx_buf[i], 0, sizeof(rx_buf[i]));
+  trans[i].output_buf = tx_buf[i];
+  trans[i].output_length = 1;
+  trans[i].input_buf = rx_buf[i];
+  trans[i].input_length = in_len;
+  trans[i].select = SPISelectUnselect;
+  trans[i].dss = SPIDss8bit;
+  trans[i].before_cb = NULL;
+  trans[i].after_cb = cb;
+}
+
+static bool wait_done(int n)
+{
+  int k;
+  for (k = 0; k < 2000 && nb_done < n; k++) {
+    usleep(1000);
+  }
+  usleep(2 * XFER_LATENCY_US);
+  return nb_done >= n;
+}
+
+int main()
+{
+  note("running Linux SPI engine tests");
+  plan(8);
+
+  spi_linux_init_bus(&bus, -1, 1000000);
+  spi_linux_set_xfer(&bus, fake_xfer);
+  struct spi_linux_stats *stats = spi_linux_get_stats(&bus);
+
+  // batching and ordering, no callbacks
+  int i;
+  double t0 = now_s();
+  for (i = 0; i < 12; i++) {
+    setup(i, 4, NULL);
+    spi_submit(&bus, &trans[i]);
+  }
+  bool done = wait_done(12);
+  note("12 transactions in %u ioctls (max %d per ioctl), %.2f ms", stats->ioctls, max_batch, (now_s() - t0) * 1e3);
+  bool in_order = done;
+  bool rx_ok = done;
+  for (i = 0; i < 12; i++) {
+    in_order &= order[i] == i && trans[i].status == SPITransSuccess;
+    rx_ok &= rx_buf[i][0] == i && rx_buf[i][3] == i + 3;
+  }
+  ok(in_order, "transactions done in submission order");
+  ok(stats->ioctls < 12 && max_batch > 1, "queued transactions batched in one ioctl");
+  ok(rx_ok, "received bytes copied from the scratch buffer when longer than output");
+
+  // completions are never dropped: the worker may run while spi_event is not called
+  nb_done = 0;
+  int accepted = 0;
+  for (i = 0; i < NB_TRANS; i++) {
+    setup(i, 2, after_cb);
+    if (spi_submit(&bus, &trans[i])) {
+      accepted++;
+    }
+  }
+  wait_done(accepted);
+  note("%d of %d transactions with callback accepted, %u rejected", accepted, NB_TRANS, stats->queue_full);
+  spi_event();
+  bool cb_ok = nb_cb == accepted && accepted > 0;
+  for (i = 0; cb_ok && i < nb_cb; i++) {
+    cb_ok = cb_order[i] == i;
+  }
+  ok(cb_ok && (int)stats->queue_full == NB_TRANS - accepted,
+     "every accepted transaction is called back, the others are rejected at submit");
+
+  // slots are released by spi_event
+  nb_done = 0;
+  nb_cb = 0;
+  for (i = 0; i < accepted; i++) {
+    setup(i, 2, after_cb);
+    spi_submit(&bus, &trans[i]);
+  }
+  wait_done(accepted);
+  spi_event();
+  ok(nb_cb == accepted, "callback slots released after spi_event");
+
+  // error propagation
+  xfer_fail = true;
+  nb_cb = 0;
+  uint32_t errors = stats->errors;
+  for (i = 0; i < 5; i++) {
+    setup(i, 2, after_cb);
+    spi_submit(&bus, &trans[i]);
+  }
+  int k;
+  for (k = 0; k < 1000 && trans[4].status != SPITransFailed; k++) {
+    usleep(1000);
+  }
+  usleep(2 * XFER_LATENCY_US);
+  spi_event();
+  bool failed = nb_cb == 5 && stats->errors - errors == 5;
+  for (i = 0; i < 5; i++) {
+    failed &= trans[i].status == SPITransFailed;
+  }
+  ok(failed, "failed ioctl reported to all transactions of the batch");
+  xfer_fail = false;
+
+  // latency of a single transaction
+  nb_done = 0;
+  nb_cb = 0;
+  setup(0, 2, after_cb);
+  t0 = now_s();
+  spi_submit(&bus, &trans[0]);
+  while (nb_cb == 0 && now_s() - t0 < 1.) {
+    spi_event();
+  }
+  note("single transaction round trip %.3f ms (fake latency %.3f ms)", (now_s() - t0) * 1e3, XFER_LATENCY_US * 1e-3);
+  ok(nb_cb == 1, "single transaction called back");
+
+  // a driver polling a single device resubmits as soon as its transaction is done,
+  // its wake up must never be lost while the worker goes back to sleep
+  xfer_latency_us = 0;
+  int polls;
+  for (polls = 0; polls < NB_POLLS; polls++) {
+    setup(0, 2, NULL);
+    spi_submit(&bus, &trans[0]);
+    t0 = now_s();
+    while (trans[0].status != SPITransSuccess && now_s() - t0 < 1.);
+    if (trans[0].status != SPITransSuccess) {
+      break;
+    }
+  }
+  ok(polls == NB_POLLS, "single device polled %d times without stalling", polls);
+
+  done_testing();
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_tcas_sap.c
+ * @brief Randomized test of the TCAS sweep and prune against the pairwise test.
+ *
+ * Intruders fly straight and report their state once per second, the own
+ * aircraft changes its velocity at random within TCAS_VMAX. At each
+ * detection, every aircraft in conflict for the pairwise tau/inside test
+ * (as in tcas_monitor) must be in the swept part of the list.
+ */
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <math.h>
+#include <stdlib.h>
+
+#include "modules/multi/tcas_sap.h"
+
+#define NB_INTRUDERS 40
+#define TCAS_VMAX 30.f
+#define TAU_TA 20.f
+#define DMOD 10.f
+#define ALIM 15.f
+#define HUGE_TAU (100.f * TAU_TA)
+#define DT 0.1f
+#define DURATION 300.f
+#define NB_SEEDS 20
+
+struct Ac {
+  float x[3], v[3];
+  float rx[3], rv[3];   ///< last report
+  float t_report;
+};
+
+static float norm3(const float *a)
+{
+  return sqrtf(a[0] * a[0] + a[1] * a[1] + a[2] * a[2]);
+}
+
+/** pairwise conflict test of tcas_monitor on the last report */
+static bool pairwise_conflict(const float *own_x, const float *own_v, const struct Ac *ac)
+{
+  float d[3], dv[3];
+  int k;
+  for (k = 0; k < 3; k++) {
+    d[k] = ac->rx[k] - own_x[k];
+    dv[k] = own_v[k] - ac->rv[k];
+  }
+  float scal = dv[0] * d[0] + dv[1] * d[1] + dv[2] * d[2];
+  float ddh = d[0] * d[0] + d[1] * d[1];
+  float ddv = d[2] * d[2];
+  float tau = HUGE_TAU;
+  if (scal > 0.f) { tau = (ddh + ddv) / scal; }
+  bool inside = ddh < DMOD * DMOD && ddv < 4.f * ALIM * ALIM;
+  return tau < TAU_TA || inside;
+}
+
+static struct Ac acs[NB_INTRUDERS];
+static float t_conflict[NB_INTRUDERS];
+static uint8_t idx[NB_INTRUDERS];
+
+int main()
+{
+  note("running TCAS sweep and prune tests");
+  plan(3);
+
+  const float r_inside = sqrtf(DMOD * DMOD + 4.f * ALIM * ALIM);
+  long nb_conflicts = 0, nb_missed = 0, nb_monitored = 0, nb_calls = 0;
+  bool sorted = true;
+  int seed;
+  for (seed = 0; seed < NB_SEEDS; seed++) {
+    srand(seed + 1);
+    float own_x[3] = { 0.f, 0.f, 100.f }, own_v[3] = { 0.f, 0.f, 0.f };
+    int i, k;
+    for (i = 0; i < NB_INTRUDERS; i++) {
+      struct Ac *ac = &acs[i];
+      ac->x[0] = rand_f(-3000.f, 3000.f);
+      ac->x[1] = rand_f(-3000.f, 3000.f);
+      ac->x[2] = rand_f(50.f, 200.f);
+      // a quarter of the traffic heads to the own aircraft start point
+      float speed = rand_f(5.f, 25.f);
+      float dir = (i % 4 == 0) ? atan2f(-ac->x[1], -ac->x[0]) : rand_f(-M_PI, M_PI);
+      ac->v[0] = speed * cosf(dir);
+      ac->v[1] = speed * sinf(dir);
+      ac->v[2] = rand_f(-1.f, 1.f);
+      ac->t_report = -rand_f(0.f, 1.f);
+      idx[i] = i;
+      t_conflict[i] = -1e9f; // monitored until the first report
+    }
+    float t;
+    int step = 0;
+    for (t = 0.f; t < DURATION; t += DT, step++) {
+      // own aircraft, new random velocity every 2s
+      if (step % 20 == 0) {
+        float speed = rand_f(0.f, TCAS_VMAX);
+        float dir = rand_f(-M_PI, M_PI);
+        float vz = rand_f(-0.2f, 0.2f) * speed;
+        float vh = sqrtf(speed * speed - vz * vz);
+        own_v[0] = vh * cosf(dir);
+        own_v[1] = vh * sinf(dir);
+        own_v[2] = vz;
+      }
+      for (k = 0; k < 3; k++) { own_x[k] += own_v[k] * DT; }
+      for (i = 0; i < NB_INTRUDERS; i++) {
+        struct Ac *ac = &acs[i];
+        for (k = 0; k < 3; k++) { ac->x[k] += ac->v[k] * DT; }
+        if (t - ac->t_report >= 1.f) {
+          // new report, as tcas_sap_update
+          ac->t_report = t;
+          float d[3];
+          for (k = 0; k < 3; k++) {
+            ac->rx[k] = ac->x[k];
+            ac->rv[k] = ac->v[k];
+            d[k] = ac->x[k] - own_x[k];
+          }
+          t_conflict[i] = tcas_sap_conflict_time(t, norm3(d), norm3(ac->v) + TCAS_VMAX, TAU_TA, r_inside);
+        }
+      }
+      // detection at 1Hz
+      if (step % 10 != 5) { continue; }
+      nb_calls++;
+      tcas_sap_sort(idx, NB_INTRUDERS, t_conflict);
+      int swept = 0;
+      while (swept < NB_INTRUDERS && t_conflict[idx[swept]] <= t) { swept++; }
+      nb_monitored += swept;
+      for (k = 1; k < NB_INTRUDERS; k++) {
+        sorted &= t_conflict[idx[k - 1]] <= t_conflict[idx[k]];
+      }
+      for (k = 0; k < NB_INTRUDERS; k++) {
+        if (pairwise_conflict(own_x, own_v, &acs[idx[k]])) {
+          nb_conflicts++;
+          if (k >= swept) { nb_missed++; }
+        }
+      }
+    }
+  }
+  note("%ld detections, %ld conflicts, %.1f of %d aircraft monitored per detection",
+       nb_calls, nb_conflicts, (float)nb_monitored / nb_calls, NB_INTRUDERS);
+  ok(sorted, "aircraft sorted by conflict time");
+  ok(nb_conflicts > 0 && nb_missed == 0, "all pairwise conflicts are in the swept aircraft (%ld missed)", nb_missed);
+  ok(nb_monitored < nb_calls * NB_INTRUDERS / 2, "less than half of the aircraft monitored");
+
+  done_testing();
+}
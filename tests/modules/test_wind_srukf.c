@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_wind_srukf.c
+ * @brief Wind estimator on the generic square-root UKF against the generated UKF:
+ * estimates on a simulated circle in constant wind, cost of a step, and
+ * behavior with very confident measurements.
+ */
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <math.h>
+#include <string.h>
+
+#include "modules/meteo/lib_ukf_wind_estimator/UKF_Wind_Estimator.h"
+#include "modules/meteo/wind_estimator_srukf.h"
+
+#define DT 0.1f
+#define NB_STEPS 1200
+
+#define MAT_EL(_m, _l, _c, _n) _m[_l + _c * _n]
+
+/* gaussian noise, Box-Muller */
+static float randn(void)
+{
+  const float u = (rand() + 1.f) / ((float)RAND_MAX + 1.f);
+  const float v = rand() / (float)RAND_MAX;
+  return sqrtf(-2.f * logf(u)) * cosf(2.f * M_PI * v);
+}
+
+/* same initialization as wind_estimator.c with the default parameters */
+static void init_params(float r_gs, float r_va, float r_angle)
+{
+  memset(&ukf_U, 0, sizeof(ExtU));
+  memset(&ukf_Y, 0, sizeof(ExtY));
+  memset(&ukf_DW, 0, sizeof(DW));
+  memset(&ukf_init, 0, sizeof(ukf_init_type));
+  memset(&ukf_params, 0, sizeof(ukf_params_type));
+  ukf_init.x0[6] = 1.f;
+  for (int i = 0; i < 7; i++) {
+    MAT_EL(ukf_init.P0, i, i, 7) = 0.2f;
+  }
+  for (int i = 0; i < 3; i++) {
+    MAT_EL(ukf_params.R, i, i, 6) = r_gs * r_gs;
+    MAT_EL(ukf_params.Q, i, i, 7) = 0.1f * 0.1f;
+    MAT_EL(ukf_params.Q, 3 + i, 3 + i, 7) = 0.001f * 0.001f;
+  }
+  MAT_EL(ukf_params.R, 3, 3, 6) = r_va * r_va;
+  MAT_EL(ukf_params.R, 4, 4, 6) = r_angle * r_angle;
+  MAT_EL(ukf_params.R, 5, 5, 6) = r_angle * r_angle;
+  MAT_EL(ukf_params.Q, 6, 6, 7) = 0.0001f * 0.0001f;
+  ukf_init.ki = 0.f;
+  ukf_init.alpha = 0.5f;
+  ukf_init.beta = 2.f;
+  ukf_params.dt = DT;
+  UKF_Wind_Estimator_initialize();
+  wind_estimator_srukf_init();
+}
+
+/* level circle at constant airspeed in constant wind, noisy measurements */
+static void set_inputs(int t, const float wind[3], float noise)
+{
+  const float r = 0.15f;                  // yaw rate
+  const float psi = r * t * DT;
+  const float vb[3] = { 15.f, 0.f, 0.8f }; // airspeed in body frame
+  // accel such that the airspeed is constant in body frame
+  ukf_U.rates[0] = 0.f;
+  ukf_U.rates[1] = 0.f;
+  ukf_U.rates[2] = r;
+  ukf_U.accel[0] = r * vb[1];
+  ukf_U.accel[1] = -r * vb[0];
+  ukf_U.accel[2] = 0.f;
+  ukf_U.q[0] = cosf(psi / 2.f);
+  ukf_U.q[1] = 0.f;
+  ukf_U.q[2] = 0.f;
+  ukf_U.q[3] = sinf(psi / 2.f);
+  ukf_U.vk[0] = cosf(psi) * vb[0] - sinf(psi) * vb[1] + wind[0] + noise * randn();
+  ukf_U.vk[1] = sinf(psi) * vb[0] + cosf(psi) * vb[1] + wind[1] + noise * randn();
+  ukf_U.vk[2] = vb[2] + wind[2] + noise * randn();
+  const float va = sqrtf(vb[0] * vb[0] + vb[1] * vb[1] + vb[2] * vb[2]);
+  ukf_U.va = va + noise * randn();
+  ukf_U.aoa = atan2f(vb[2], vb[0]) + 0.01f * noise * randn();
+  ukf_U.sideslip = asinf(vb[1] / va) + 0.01f * noise * randn();
+}
+
+static float wind_err(const float *x, const float wind[3])
+{
+  return sqrtf((x[3] - wind[0]) * (x[3] - wind[0]) + (x[4] - wind[1]) * (x[4] - wind[1]) +
+               (x[5] - wind[2]) * (x[5] - wind[2]));
+}
+
+static bool all_finite(const float *x, int n)
+{
+  for (int i = 0; i < n; i++) {
+    if (!isfinite(x[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(void)
+{
+  plan(5);
+  srand(7);
+
+  const float wind[3] = { 3.f, -2.f, 0.f };
+  float x_gen[7], x_sr[7];
+  double t_gen = 0., t_sr = 0., diff = 0.;
+
+  note("--- circle in constant wind, default parameters");
+  init_params(0.5f, 0.5f, 0.002f);
+  for (int t = 0; t < NB_STEPS; t++) {
+    set_inputs(t, wind, 0.1f);
+    double t0 = now_s();
+    UKF_Wind_Estimator_step();
+    t_gen += now_s() - t0;
+    memcpy(x_gen, ukf_Y.xout, sizeof(x_gen));
+    t0 = now_s();
+    wind_estimator_srukf_step();
+    t_sr += now_s() - t0;
+    memcpy(x_sr, ukf_Y.xout, sizeof(x_sr));
+    if (t > NB_STEPS / 2) {
+      for (int i = 0; i < 7; i++) {
+        diff = fmax(diff, fabs(x_gen[i] - x_sr[i]));
+      }
+    }
+  }
+  note("wind error: generated %.3f m/s, square root %.3f m/s, max difference %.3f",
+       wind_err(x_gen, wind), wind_err(x_sr, wind), diff);
+  note("step: generated %.2f us, square root %.2f us (%.1fx)",
+       t_gen / NB_STEPS * 1e6, t_sr / NB_STEPS * 1e6, t_gen / t_sr);
+  note("filter structure %d bytes", (int)sizeof(we_srukf));
+  ok(wind_err(x_gen, wind) < 0.5f, "generated UKF estimates the wind");
+  ok(wind_err(x_sr, wind) < 0.5f && we_srukf.nb_fail == 0, "square root UKF estimates the wind");
+  ok(diff < 0.2, "both estimates agree");
+
+  note("--- very confident measurements");
+  init_params(1e-3f, 1e-3f, 1e-5f);
+  int fail_gen = -1;
+  bool sr_ok = true;
+  for (int t = 0; t < NB_STEPS; t++) {
+    set_inputs(t, wind, 0.f);
+    if (fail_gen < 0) {
+      UKF_Wind_Estimator_step();
+      if (!all_finite(ukf_Y.xout, 7)) {
+        fail_gen = t;
+      }
+      memcpy(x_gen, ukf_Y.xout, sizeof(x_gen));
+    }
+    wind_estimator_srukf_step();
+    sr_ok &= all_finite(ukf_Y.xout, 7);
+    memcpy(x_sr, ukf_Y.xout, sizeof(x_sr));
+  }
+  if (fail_gen < 0) {
+    note("generated: wind error %.3f m/s", wind_err(x_gen, wind));
+  } else {
+    note("generated: diverged at step %d", fail_gen);
+  }
+  note("square root: wind error %.3f m/s, %d failed downdates", wind_err(x_sr, wind), we_srukf.nb_fail);
+  ok(sr_ok, "square root UKF state stays finite");
+  ok(wind_err(x_sr, wind) < 0.5f, "square root UKF estimates the wind");
+
+  done_testing();
+}
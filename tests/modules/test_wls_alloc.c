@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2020 Paparazzi Team
+ *
+ * This file is part of paparazzi.
+ *
+ * paparazzi is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * paparazzi is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with paparazzi; see the file COPYING.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file test_wls_alloc.c
+ * @brief Tests of the WLS control allocation with a cached factorisation against
+ * the allocation from scratch, and throughput benchmark.
+ */
+
+#define NB_RUNS 20000
+
+#include "../math/tap.h"
+#include "../math/test_utils.h"
+#include <math.h>
+
+#include "firmwares/rotorcraft/stabilization/wls/wls_alloc.h"
+
+/* hexacopter of sw/airborne/test/test_alloc.c */
+static float g1g2[CA_N_V][CA_N_U] = {
+  {  0.0,  -0.015,  0.015,  0.0,  -0.015,   0.015 },
+  {  0.015,   -0.010, -0.010,   0.015,  -0.010,   -0.010 },
+  {   0.103,   0.103,    0.103,   -0.103,    -0.103,    -0.103 },
+  {-0.0009, -0.0009, -0.0009, -0.0009, -0.0009, -0.0009 }
+};
+static float Wv[CA_N_V] = {100, 100, 1, 10};
+static float *Bwls[CA_N_V];
+
+/* random objective and bounds, saturating the actuators with large objectives */
+static void random_problem(float *v, float *du_min, float *du_max, float *du_pref, float scale)
+{
+  for (int i = 0; i < CA_N_U; i++) {
+    const float u = rand_f(2000, 7600);
+    du_min[i] = -u;
+    du_max[i] = 9600 - u;
+    du_pref[i] = du_min[i];
+  }
+  v[0] = rand_f(-scale, scale);
+  v[1] = rand_f(-scale, scale);
+  v[2] = rand_f(-4 * scale, 4 * scale);
+  v[3] = rand_f(-scale / 100, scale / 100);
+}
+
+int main(void)
+{
+  plan(3);
+
+  for (int i = 0; i < CA_N_V; i++) {
+    Bwls[i] = g1g2[i];
+  }
+  srand(1);
+
+  struct WlsCache cache;
+  wls_cache_invalidate(&cache);
+  float v[CA_N_V], du_min[CA_N_U], du_max[CA_N_U], du_pref[CA_N_U];
+  float du[CA_N_U], du_cached[CA_N_U];
+
+  note("--- cached factorisation vs allocation from scratch");
+  float err = 0.f;
+  int diff_iter = 0, nb_sat = 0;
+  for (int k = 0; k < 2000; k++) {
+    random_problem(v, du_min, du_max, du_pref, k % 2 ? 30.f : 300.f);
+    const int it = wls_alloc(du, v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+    const int it_cached = wls_alloc_cached(&cache, du_cached, v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+    diff_iter += (it != it_cached);
+    nb_sat += (it > 1);
+    for (int i = 0; i < CA_N_U; i++) {
+      err = fmaxf(err, fabsf(du[i] - du_cached[i]) / (du_max[i] - du_min[i]));
+    }
+  }
+  note("%d problems with saturation, max relative difference %.2e", nb_sat, err);
+  ok(diff_iter == 0 && err < 1e-4f, "same iterations and solution with the cache");
+
+  // change of effectiveness without invalidation is not seen, then seen after it
+  random_problem(v, du_min, du_max, du_pref, 30.f);
+  wls_alloc_cached(&cache, du_cached, v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+  for (int i = 0; i < CA_N_U; i++) {
+    g1g2[2][i] *= 2.f;
+  }
+  float du_stale[CA_N_U];
+  wls_alloc_cached(&cache, du_stale, v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+  wls_cache_invalidate(&cache);
+  wls_alloc_cached(&cache, du_cached, v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+  wls_alloc(du, v, du_min, du_max, Bwls, 0, 0, Wv, 0, du_pref, 10000, 10);
+  float err_stale = 0.f, err_new = 0.f;
+  for (int i = 0; i < CA_N_U; i++) {
+    err_stale = fmaxf(err_stale, fabsf(du[i] - du_stale[i]));
+    err_new = fmaxf(err_new, fabsf(du[i] - du_cached[i]));
+  }
+  ok(err_stale > 1.f, "effectiveness kept in the cache until invalidated");
+  ok(err_new < 1e-2f, "effectiveness updated after invalidation");
+
+  note("--- throughput, unsaturated objectives");
+  static float vs[64][CA_N_V], mins[64][CA_N_U], maxs[64][CA_N_U], prefs[64][CA_N_U];
+  for (int k = 0; k < 64; k++) {
+    random_problem(vs[k], mins[k], maxs[k], prefs[k], 10.f);
+  }
+  double t0 = now_s();
+  for (int k = 0; k < NB_RUNS; k++) {
+    wls_alloc(du, vs[k % 64], mins[k % 64], maxs[k % 64], Bwls, 0, 0, Wv, 0, prefs[k % 64], 10000, 10);
+  }
+  const double t_ref = (now_s() - t0) / NB_RUNS;
+  t0 = now_s();
+  for (int k = 0; k < NB_RUNS; k++) {
+    wls_alloc_cached(&cache, du, vs[k % 64], mins[k % 64], maxs[k % 64], Bwls, 0, 0, Wv, 0, prefs[k % 64], 10000, 10);
+  }
+  const double t_cached = (now_s() - t0) / NB_RUNS;
+  note("wls_alloc %.2f us, wls_alloc_cached %.2f us", t_ref * 1e6, t_cached * 1e6);
+
+  done_testing();
+}